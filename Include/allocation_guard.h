@@ -0,0 +1,76 @@
+/**
+ * @file
+ *
+ * @brief Guard against heap-allocations in the main-loop. Every allocation
+ * is made through malloc, calloc, realloc or the aligned variants,
+ * including operator new, which are replaced by this module
+ *
+ * On the MCU the replacements are only included if USE_ALLOCATION_GUARD is
+ * set. Allocations before ALLOCATION_GUARD::enable_guard() are passed on to
+ * newlib, while allocations after it trap, such that the debugger halts at
+ * the allocating call
+ *
+ * On the host the replacements count every allocation, and forward them to
+ * glibc. Allocations while the guard is enabled are counted separately,
+ * such that the host-tools can check that the pipeline is allocation-free
+ *
+ * Usage:
+ *      initialize();                           // May allocate
+ *      ALLOCATION_GUARD::enable_guard();
+ *      while(1){
+ *        process_frame();                      // Must not allocate
+ *      }
+ *
+ * @note The replacements are only linked if a function in this module is
+ * used by the program
+ */
+#ifndef ACOUSTICS_ALLOCATION_GUARD_H
+#define ACOUSTICS_ALLOCATION_GUARD_H
+
+#include "parameters.h"
+
+
+/**
+ * @brief Namespace/wrapper for the allocation-guard
+ */
+namespace ALLOCATION_GUARD{
+
+
+/**
+ * @brief Enables the guard. Every allocation after this traps on the MCU,
+ * and is counted as guarded on the host
+ */
+void enable_guard();
+
+
+/**
+ * @brief Disables the guard, such that allocations are allowed again
+ */
+void disable_guard();
+
+
+/**
+ * @brief Checks if the guard is enabled
+ *
+ * @retval Returns 1 if enabled
+ */
+uint8_t check_enabled_guard();
+
+
+/**
+ * @brief Number of allocations made by the program. Only counted on the
+ * host, and always 0 on the MCU
+ */
+uint64_t get_num_allocations();
+
+
+/**
+ * @brief Number of allocations made while the guard was enabled. Only
+ * counted on the host
+ */
+uint64_t get_num_guarded_allocations();
+
+
+} /* namespace ALLOCATION_GUARD */
+
+#endif /* ACOUSTICS_ALLOCATION_GUARD_H */
@@ -8,6 +8,7 @@
 #define ACOUSTICS_ANALYZE_DATA_H
 
 #include "trilateration.h"
+#include "workspace.h"
 
 namespace ANALYZE_DATA{
 
@@ -35,11 +36,57 @@ void array_max_value(
 
 
 /**
- * @brief The function takes in raw data-signals, and uses the ARM 
- * Biquad IIR-filter to filter the data
+ * @brief Converts the data transferred by the DMA into one array of
+ * DMA_BUFFER_LENGTH measurements for each of the @p N hydrophones
+ * 
+ * The ADC is in scan-mode, and the DMA pushes the data in serial after
+ * the rank of the channels. With r1 = rank1, r2 = rank2 and r3 = rank3
+ *      {r1, r2, r3, r1, r2, r3, ... , r1, r2, r3}
+ * 
+ * @warning If the DMA instead pushes all of the data for one rank before 
+ * the next, the hydrophones will be mixed. This should be verified on the 
+ * hardware
+ * 
+ * @param p_adc_data The interleaved data from the DMA. Holds 
+ * @p N * DMA_BUFFER_LENGTH measurements
+ * 
+ * @param p_raw_data_array The converted data for each hydrophone, in the 
+ * same order as the ADC-ranks
+ */
+template<uint32_t N>
+void convert_adc_data(
+        const volatile uint16_t* p_adc_data,
+        float32_t* (&p_raw_data_array)[N]);
+
+
+/**
+ * @brief Converts a recorded frame into one array of DMA_BUFFER_LENGTH
+ * measurements for each of the @p N hydrophones. Equal to 
+ * convert_adc_data(), but reads the 16-bit samples of a recording directly,
+ * such that a frame can be processed without copying it first
+ * 
+ * @param p_samples The interleaved samples of the frame. See recording.h
+ * 
+ * @param p_raw_data_array The converted data for each hydrophone
+ */
+template<uint32_t N>
+void convert_recorded_data(
+        const uint16_t* p_samples,
+        float32_t* (&p_raw_data_array)[N]);
+
+
+/**
+ * @brief The function takes in raw data-signals from @p N hydrophones, 
+ * and uses the ARM Biquad IIR-filter to filter the data
+ * 
+ * Every hydrophone is filtered with its own filter-state, starting at 
+ * rest, such that the hydrophones do not affect each other
+ * 
+ * The filter may be done in-place, with @p p_raw_data_array and 
+ * @p p_filtered_data_array pointing to the same arrays
  * 
  * @param p_raw_data_array Raw data to be filtered
- * It is assumed that
+ * With three hydrophones it is assumed that
  *      @p p_raw_data_array = {p_raw_data_port,
  *                             p_raw_data_starboard,
  *                             p_raw_data_stern}
@@ -50,15 +97,53 @@ void array_max_value(
  *                                  p_filtered_data_starboard,
  *                                  p_filtered_data_stern}
  */
+template<uint32_t N>
 void filter_raw_data(
-        float32_t* p_raw_data_array[NUM_HYDROPHONES],
-        float32_t* p_filtered_data_array[NUM_HYDROPHONES]);
+        float32_t* (&p_raw_data_array)[N],
+        float32_t* (&p_filtered_data_array)[N]);
+
+
+/**
+ * @brief Filters the raw data from @p N hydrophones in-place, such that 
+ * no memory is needed for the filtered data. See the function above
+ * 
+ * @param p_data_array Raw data, overwritten by the filtered data
+ */
+template<uint32_t N>
+void filter_raw_data(float32_t* (&p_data_array)[N]);
+
+
+/**
+ * @brief Designs the fourth-order Butterworth band-pass used by 
+ * ANALYZE_DATA::filter_raw_data(), given as two second-order stages in the
+ * format of filter_coefficients. See FILTER_SETUP in parameters.h
+ * 
+ * The analog prototype is transformed to a band-pass and discretized with
+ * the bilinear transform, where the cut-off frequencies are prewarped. The
+ * gain is shared equally by the stages, giving unit gain at the center of
+ * the band
+ * 
+ * @retval Returns 1 if the filter is designed. Returns 0 if the frequencies
+ * are not finite, or not given as 0 < @p low_frequency < @p high_frequency
+ * < SAMPLE_FREQUENCY / 2. @p coefficients is then unchanged
+ * 
+ * @param low_frequency Lower cut-off frequency [Hz]
+ * 
+ * @param high_frequency Upper cut-off frequency [Hz]
+ * 
+ * @param coefficients The coefficients {b10, b11, b12, -a11, -a12, b20, ...}
+ */
+uint8_t design_bandpass_filter(
+        const float32_t& low_frequency,
+        const float32_t& high_frequency,
+        float32_t (&coefficients)[5 * num_stages]);
 
 
 /**
  * @brief A function that crosscorrelates the filtered data arrays and
  * returns an array which gives the number of samples between the 
- * measured signals at hyd1, hyd2, hyd3
+ * measured signals for every pair of the @p N hydrophones. See 
+ * hydrophone_array.h for the order of the pairs
  * 
  * @warning The values contained within @p p_lag_array are 
  * extremely sensitive to the sign. If the sign is negative, the 
@@ -72,21 +157,33 @@ void filter_raw_data(
  * 
  * 
  * 
- * @param p_filtered_data_array The array containing the 
- * It is assumed that
+ * @param p_filtered_data_array The array containing the filtered data
+ * With three hydrophones it is assumed that
  *      @p p_filtered_data_array = {p_filtered_data_port, 
  *                                  p_filtered_data_starboard,
  *                                  P_filtered_data_stern}
  * 
  * @param p_lag_array The array to hold the cross-correlated lags.
- * It is assumed that
+ * With three hydrophones it is assumed that
  *      @p p_lag_array = {p_lag_port_starboard,
  *                        p_lag_port_stern,
  *                        p_lag_starboard_stern}
+ * The lags are signed, and stored as two's complement
+ * 
+ * @param max_lag Largest abs lag searched for [samples]. Peaks further
+ * from zero lag are not physically possible with the current geometry, 
+ * and are ignored. Given by TRILATERATION::hydrophone_geometry.max_lag
+ * 
+ * @param workspace Workspace holding the cross-correlation of one pair at 
+ * a time. If it is too small, every lag is set to IN_BUFFER_LENGTH, such 
+ * that the frame is discarded by TRILATERATION::check_valid_signals()
  */
+template<uint32_t N>
 void calculate_xcorr_lag_array(
-        float32_t* p_filtered_data_array[NUM_HYDROPHONES],
-        uint32_t* p_lag_array[NUM_HYDROPHONES]);
+        float32_t* (&p_filtered_data_array)[N],
+        uint32_t* (&p_lag_array)[HydrophonePairs<N>::count],
+        const int32_t& max_lag,
+        Workspace& workspace);
 
 } /* namespace ANALYZE_DATA */
 
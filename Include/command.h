@@ -0,0 +1,256 @@
+/**
+ * @file
+ *
+ * @brief Commands sent by the topside to set and query the parameters in
+ * the registry given by parameter_registry.h, such that the system can be
+ * tuned without a rebuild and reflash
+ *
+ * A command is a single UDP-packet holding a CommandHeader followed by
+ * payload_length bytes of payload, all stored little-endian
+ *      {header, payload}
+ * The commands are
+ *      COMMAND_GET: Queries the parameters given by the entries, where the
+ *                   values are ignored. Queries every parameter if no
+ *                   entry is given
+ *      COMMAND_SET: Changes the parameters given by the entries as a set,
+ *                   such that either every value is applied or none. See
+ *                   PARAMETER_REGISTRY::apply_parameters()
+ * where the payload is a list of CommandEntry, and
+ *      COMMAND_STATUS: Queries the profile of every stage of the main-loop.
+ *                   The reply holds the text given by
+ *                   PROFILING::write_report(), truncated to
+ *                   COMMAND_MAX_PAYLOAD_SIZE bytes and not terminated
+ * Every other command is
+ * executed by the CommandHandler given to COMMAND::poll_commands(), such
+ * that the main-loop can change the state it owns
+ *      COMMAND_GEOMETRY: Loads a hydrophone configuration given as a
+ *                   GeometryConfig, which is used until a restart. See
+ *                   geometry_config.h
+ *      COMMAND_STORE_GEOMETRY: Stores the hydrophone configuration in use
+ *                   in flash, such that it is used after a restart. The
+ *                   acquisition is stopped while the flash is erased,
+ *                   which takes up to a couple of seconds
+ *      COMMAND_RAW_STREAM: Starts the raw stream if the payload is a
+ *                   uint32_t of 1, and stops it if 0. The reply holds 1 if
+ *                   the stream is running. See raw_stream.h
+ *      COMMAND_TRACE: Requests the trace to be sent to TRACE_DEST_PORT. The
+ *                   dump is sent by the main-loop once the descriptors are
+ *                   free, after the reply. See trace.h
+ *
+ * Every command is answered with a reply of the same format, holding the
+ * command, the sequence-number of the command, the status and a payload
+ * given by the command. The reply of a COMMAND_GET or COMMAND_SET holds the
+ * current value of the parameters of the command. The topside detects a
+ * lost command or reply from the sequence-number, and sends it again. As a
+ * set is applied as a whole, sending it twice has the same effect as once
+ *
+ * The commands are received and applied by COMMAND::poll_commands() in the
+ * main-loop, between two frames, such that a frame is always processed
+ * with a consistent set of parameters
+ */
+#ifndef ACOUSTICS_COMMAND_H
+#define ACOUSTICS_COMMAND_H
+
+#include <string.h>
+
+#include "parameter_registry.h"
+
+/**
+ * @brief Largest command or reply [bytes]
+ */
+#define COMMAND_MAX_PACKET_SIZE (sizeof(CommandHeader) + COMMAND_MAX_PAYLOAD_SIZE)
+
+
+/**
+ * @brief The commands
+ */
+typedef enum{
+  COMMAND_GET,                      /* Query the parameters                           */
+  COMMAND_SET,                      /* Change the parameters as a set                 */
+  COMMAND_GEOMETRY,                 /* Load a hydrophone configuration, given as a    */
+                                    /* GeometryConfig                                 */
+  COMMAND_STATUS,                   /* Query the profile of the main-loop             */
+  COMMAND_RAW_STREAM,               /* Start or stop streaming the raw frames         */
+  COMMAND_TRACE,                    /* Request the trace to be sent                   */
+  COMMAND_STORE_GEOMETRY,           /* Store the hydrophone configuration in flash    */
+  NUM_COMMAND_TYPES
+}COMMAND_TYPES; /* enum COMMAND_TYPES */
+
+
+/**
+ * @brief Header of every command and reply
+ *
+ * @param magic Always COMMAND_MAGIC
+ *
+ * @param version Always COMMAND_VERSION
+ *
+ * @param command The command. See COMMAND_TYPES
+ *
+ * @param sequence Sequence-number given by the topside, and copied to the
+ * reply
+ *
+ * @param status Result of the command in a reply. See PARAMETER_STATUS. 0
+ * in a command
+ *
+ * @param payload_length Length of the payload following the header [bytes]
+ */
+typedef struct{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t command;
+  uint32_t sequence;
+  uint16_t status;
+  uint16_t payload_length;
+}CommandHeader; /* struct CommandHeader */
+
+static_assert(sizeof(CommandHeader) == 16, "CommandHeader must not contain any padding");
+
+
+/**
+ * @brief A parameter in a command or reply
+ *
+ * @param id The parameter. See PARAMETER_IDS
+ *
+ * @param type Type of the value. See PARAMETER_TYPES
+ *
+ * @param value The value, as the bits of a float32_t or a uint32_t
+ */
+typedef struct{
+  uint16_t id;
+  uint16_t type;
+  uint32_t value;
+}CommandEntry; /* struct CommandEntry */
+
+static_assert(sizeof(CommandEntry) == 8, "CommandEntry must not contain any padding");
+
+static_assert(COMMAND_MAX_ENTRIES >= NUM_PARAMETERS,
+        "A reply must be able to hold every parameter");
+
+static_assert(COMMAND_MAX_ENTRIES * sizeof(CommandEntry) <= COMMAND_MAX_PAYLOAD_SIZE,
+        "The payload must be able to hold COMMAND_MAX_ENTRIES entries");
+
+
+/**
+ * @brief Executes a command that is not handled by the registry. Given to
+ * COMMAND::poll_commands() by the owner of the state changed by the command
+ *
+ * @retval Returns the status of the command. See PARAMETER_STATUS
+ *
+ * @param command The command
+ *
+ * @param p_payload The payload of the command
+ *
+ * @param payload_length Length of @p p_payload [bytes]
+ *
+ * @param p_reply_payload The payload of the reply. Holds
+ * COMMAND_MAX_PAYLOAD_SIZE bytes
+ *
+ * @param reply_length Length of the payload of the reply [bytes]. 0 when
+ * called
+ */
+typedef uint16_t (*CommandHandler)(
+            const COMMAND_TYPES& command,
+            const uint8_t* p_payload,
+            const uint32_t& payload_length,
+            uint8_t* p_reply_payload,
+            uint32_t& reply_length);
+
+
+/**
+ * @brief Namespace/wrapper for the commands
+ */
+namespace COMMAND{
+
+
+/**
+ * @brief Writes a command or reply
+ *
+ * @retval Returns the length of the packet [bytes]
+ *
+ * @param command The command
+ *
+ * @param sequence Sequence-number of the command
+ *
+ * @param status The status. 0 in a command
+ *
+ * @param p_payload The payload, such as a list of CommandEntry
+ *
+ * @param payload_length Length of @p p_payload [bytes]. At most
+ * COMMAND_MAX_PAYLOAD_SIZE
+ *
+ * @param p_packet The packet. Must hold COMMAND_MAX_PACKET_SIZE bytes
+ */
+uint32_t write_packet(
+            const COMMAND_TYPES& command,
+            const uint32_t& sequence,
+            const uint16_t& status,
+            const void* p_payload,
+            const uint32_t& payload_length,
+            uint8_t* p_packet);
+
+
+/**
+ * @brief Reads and validates a command or reply
+ *
+ * @retval Returns 1 if the packet is valid. Returns 0 if the magic, version
+ * or command is wrong, or the length does not match the payload
+ *
+ * @param data The packet
+ *
+ * @param length Length of the packet [bytes]
+ *
+ * @param header The header read from the packet
+ *
+ * @param p_payload The payload copied from the packet, such that it is
+ * aligned
+ *
+ * @param max_payload_length Size of @p p_payload [bytes]
+ */
+uint8_t parse_packet(
+            const uint8_t* data,
+            const uint32_t& length,
+            CommandHeader& header,
+            void* p_payload,
+            const uint32_t& max_payload_length);
+
+
+/**
+ * @brief Executes a command, and writes the reply
+ *
+ * @warning Must not be called while a frame is being processed
+ *
+ * @retval Returns the length of the reply [bytes]. Returns 0 if the
+ * command is invalid, which is not answered
+ *
+ * @param data The command
+ *
+ * @param length Length of the command [bytes]
+ *
+ * @param p_reply The reply. Must hold COMMAND_MAX_PACKET_SIZE bytes
+ *
+ * @param handler Executes the commands not handled by the registry. These
+ * are answered with PARAMETER_UNKNOWN_ID if NULL
+ */
+uint32_t handle_command(
+            const uint8_t* data,
+            const uint32_t& length,
+            uint8_t* p_reply,
+            CommandHandler handler = NULL);
+
+
+/**
+ * @brief Receives and executes every waiting command, and sends the
+ * replies with TELEMETRY_TRANSPORT. Does nothing if USE_COMMANDS is not set
+ *
+ * @warning Must not be called while a frame is being processed
+ *
+ * @retval Returns the number of commands executed
+ *
+ * @param handler Executes the commands not handled by the registry
+ */
+uint32_t poll_commands(CommandHandler handler = NULL);
+
+
+} /* namespace COMMAND */
+
+#endif /* ACOUSTICS_COMMAND_H */
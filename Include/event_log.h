@@ -0,0 +1,171 @@
+/**
+ * @file
+ *
+ * @brief Log of the errors and events in the system. The events are kept in
+ * a ring of EVENT_LOG_LENGTH records, where the oldest record is overwritten
+ * when the ring is full. Every type of event is in addition counted by a
+ * saturating counter, such that the number of events is known even after
+ * the records are overwritten
+ *
+ * The log is lock-free, and EVENT_LOG::log_event() can be called both from
+ * the main-loop and from interrupts, such as DMA2_Stream0_IRQHandler(). A
+ * slot is reserved by atomically incrementing the number of logged events
+ * (LDREX/STREX on the Cortex-M7), such that an interrupt logging while the
+ * main-loop is logging gets the next slot. Logging costs a few tens of
+ * cycles, and the log is therefore always enabled
+ *
+ * Every slot holds the sequence-number of its record, which is cleared
+ * while the record is written. A record is read by checking the
+ * sequence-number before and after copying it, such that a record
+ * overwritten while it is read is rejected
+ *
+ * Usage:
+ *      EVENT_LOG::log_event(ERROR_TYPES::ERROR_DMA_CONV, DMA2->LISR);
+ *
+ *      EventRecord record;
+ *      for(uint32_t index = EVENT_LOG::get_oldest_index();
+ *          index < EVENT_LOG::get_num_events(); index++){
+ *        if(EVENT_LOG::read_event(index, record)){
+ *          ...
+ *        }
+ *      }
+ *
+ * @note The timestamps are given by TIMING::get_ticks(), and therefore
+ * wrap after 2^32 ticks (about 20 s on the MCU). The order of the records
+ * is given by the sequence-numbers
+ */
+#ifndef ACOUSTICS_EVENT_LOG_H
+#define ACOUSTICS_EVENT_LOG_H
+
+#include "timing.h"
+
+static_assert((EVENT_LOG_LENGTH & (EVENT_LOG_LENGTH - 1)) == 0 && EVENT_LOG_LENGTH > 0,
+        "EVENT_LOG_LENGTH must be a power of two");
+
+
+/**
+ * @brief Enum to hold some of the potential errors that could occur
+ */
+typedef enum{
+  ERROR_ADC_INIT,             /* Error on initializing ADC                          */
+  ERROR_ADC_CONFIG,           /* Error on configuring ADC                           */
+  ERROR_DMA_START,            /* Error while starting DMA                           */
+  ERROR_DMA_STOP,             /* Error while stopping DMA                           */
+  ERROR_DMA_CONV,             /* Error while converting values                      */
+  ERROR_TRILATERATION_INIT,   /* Error on initializing TRILATERATION                */
+  ERROR_TIME_SIGNAL,          /* Error on calculating invalid time of signals       */
+  ERROR_UNIDENTIFIED,         /* Unidentified error. Thrown using Error_handler()   */
+  ERROR_MEMORY,               /* Out of memory for error_handling. Not used, as the */
+                              /* event-log overwrites the oldest records            */
+  ERROR_A_NOT_INVERTIBLE,     /* (A^T * A)-matrix not invertible                    */
+  ERROR_LOOKUP_INVALID,       /* Lags not consistent/covered by the lookup-table    */
+  ERROR_NONLINEAR_SOLVER,     /* Iterative solver diverged or became singular       */
+  ERROR_GEOMETRY_CONFIG,      /* Invalid hydrophone configuration received          */
+  ERROR_FLASH_WRITE,          /* Error while storing the configuration in flash     */
+  ERROR_TELEMETRY_INIT,       /* Error while starting the ETH-peripheral            */
+  ERROR_RAW_STREAM,           /* Raw frame dropped, as the previous is still sent   */
+  NUM_ERROR_TYPES
+}ERROR_TYPES; /* enum ERROR_TYPES */
+
+
+/**
+ * @brief A single record in the event-log
+ *
+ * @param sequence Number of events logged before this record, plus one. 0
+ * while the record is written
+ *
+ * @param timestamp Time the event was logged. See TIMING::get_ticks() [ticks]
+ *
+ * @param type The type of event. See ERROR_TYPES
+ *
+ * @param payload Value given by the caller, such as a status-register
+ */
+typedef struct{
+  uint32_t sequence;
+  uint32_t timestamp;
+  uint32_t type;
+  uint32_t payload;
+}EventRecord; /* struct EventRecord */
+
+
+/**
+ * @brief Namespace/wrapper for the event-log
+ */
+namespace EVENT_LOG{
+
+
+/**
+ * @brief Name of every error, indexed by ERROR_TYPES
+ */
+extern const char* const error_names[NUM_ERROR_TYPES];
+
+
+/**
+ * @brief Clears the records and the counters. Must not be called while
+ * events are logged
+ */
+void reset_log();
+
+
+/**
+ * @brief Logs an event, overwriting the oldest record if the log is full,
+ * and increments the counter of @p type. Lock-free, and safe to call from
+ * interrupts
+ *
+ * @param type The type of event. Logged as ERROR_UNIDENTIFIED if it is not
+ * a valid ERROR_TYPES
+ *
+ * @param payload Value stored together with the event
+ */
+void log_event(
+            const ERROR_TYPES& type,
+            const uint32_t& payload);
+
+
+/**
+ * @brief Returns the number of events logged since the log was reset. The
+ * latest record has the index get_num_events() - 1
+ */
+uint32_t get_num_events();
+
+
+/**
+ * @brief Returns the index of the oldest record not overwritten
+ */
+uint32_t get_oldest_index();
+
+
+/**
+ * @brief Copies the record with index @p index
+ *
+ * @retval Returns 1 if the record is copied. Returns 0 if the record is not
+ * logged yet, is overwritten, or is being written
+ *
+ * @param index Index of the record, counted from the reset of the log
+ *
+ * @param record The copied record
+ */
+uint8_t read_event(
+            const uint32_t& index,
+            EventRecord& record);
+
+
+/**
+ * @brief Returns the number of events of @p type logged since the log was
+ * reset. Saturates at UINT32_MAX
+ *
+ * @param type The type of event
+ */
+uint32_t get_count(const ERROR_TYPES& type);
+
+
+/**
+ * @brief Returns the number of events of every type logged since the log
+ * was reset. Saturates at UINT32_MAX
+ */
+uint32_t get_total_count();
+
+
+} /* namespace EVENT_LOG */
+
+#endif /* ACOUSTICS_EVENT_LOG_H */
@@ -0,0 +1,148 @@
+/**
+ * @file
+ *
+ * @brief Runtime configuration of the hydrophone positions. The positions
+ * given in parameters.h are used as default, and can be replaced by a blob
+ * received over ethernet or stored in flash, such that a mechanical change
+ * does not require a reflash
+ *
+ * Loading a configuration recomputes everything derived from the positions
+ * once: the geometry used by the solvers (baselines, pseudo-inverse and
+ * max_lag), the lag lookup-table and the window used when searching the
+ * cross-correlation. The processing of each frame only reads the
+ * precomputed data, and is therefore unchanged
+ *
+ * The blob is given as a GeometryConfig in little-endian, with a CRC-32
+ * (IEEE 802.3) calculated over every byte before the crc-field
+ */
+#ifndef ACOUSTICS_GEOMETRY_CONFIG_H
+#define ACOUSTICS_GEOMETRY_CONFIG_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "trilateration.h"
+
+
+/**
+ * @brief A configuration of the hydrophone positions
+ *
+ * @param magic Always GEOMETRY_CONFIG_MAGIC
+ *
+ * @param version Always GEOMETRY_CONFIG_VERSION
+ *
+ * @param num_hydrophones Number of hydrophones. Must equal NUM_HYDROPHONES
+ *
+ * @param positions Position {x, y, z} of each hydrophone [m]. Given in the
+ * same order as HYDROPHONE_POSITIONS
+ *
+ * @param crc CRC-32 of the preceding bytes
+ */
+typedef struct{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t num_hydrophones;
+  float32_t positions[NUM_HYDROPHONES][3];
+  uint32_t crc;
+}GeometryConfig; /* struct GeometryConfig */
+
+static_assert(sizeof(GeometryConfig) == 12 + 12 * NUM_HYDROPHONES,
+        "GeometryConfig must not contain any padding");
+
+
+/**
+ * @brief Namespace/wrapper for the geometry configuration
+ */
+namespace GEOMETRY_CONFIG{
+
+
+/**
+ * @brief Calculates the CRC-32 (IEEE 802.3) of @p length bytes
+ *
+ * @param data The bytes
+ *
+ * @param length Number of bytes
+ */
+uint32_t calculate_crc(
+            const uint8_t* data,
+            const uint32_t& length);
+
+
+/**
+ * @brief Creates a configuration holding the positions given in
+ * HYDROPHONE_POSITIONS in parameters.h
+ *
+ * @param config The configuration to fill
+ */
+void get_default_config(GeometryConfig& config);
+
+
+/**
+ * @brief Creates a configuration from @p positions, with the header and
+ * CRC set
+ *
+ * @param positions Position {x, y, z} of each hydrophone [m]
+ *
+ * @param config The configuration to fill
+ */
+void create_config(
+            const float32_t (&positions)[NUM_HYDROPHONES][3],
+            GeometryConfig& config);
+
+
+/**
+ * @brief Reads and validates a configuration from a blob
+ *
+ * @retval Returns 1 if the blob holds a valid configuration. Returns 0 if
+ * the length, magic, version, number of hydrophones or CRC is wrong, or if
+ * any position is not finite. @p config is then undefined
+ *
+ * @param data The blob, as received over ethernet or read from flash
+ *
+ * @param length Length of the blob [bytes]
+ *
+ * @param config The configuration read from the blob
+ */
+uint8_t parse_config(
+            const uint8_t* data,
+            const uint32_t& length,
+            GeometryConfig& config);
+
+
+/**
+ * @brief Applies a configuration. Recomputes TRILATERATION::hydrophone_geometry,
+ * and regenerates the lag lookup-table if USE_LAG_LOOKUP_TABLE is set
+ *
+ * The new geometry is validated before anything is changed, such that the
+ * previous configuration is kept if the new one is invalid
+ *
+ * @warning Must not be called while a frame is being processed. The
+ * estimates kept by the caller, such as the initial guess of the iterative
+ * solver and the tracker, are relative to the old array and must be reset
+ *
+ * @retval Returns 1 if the configuration is applied. Returns 0 if the
+ * hydrophones are placed on a line, or if the lookup-table does not cover
+ * the max_lag of the new geometry
+ *
+ * @param config The configuration to apply
+ */
+uint8_t apply_config(const GeometryConfig& config);
+
+
+/**
+ * @brief Parses and applies a blob. Combines parse_config() and apply_config()
+ *
+ * @retval Returns 1 if the blob is valid and applied
+ *
+ * @param data The blob
+ *
+ * @param length Length of the blob [bytes]
+ */
+uint8_t load_config(
+            const uint8_t* data,
+            const uint32_t& length);
+
+
+} /* namespace GEOMETRY_CONFIG */
+
+#endif /* ACOUSTICS_GEOMETRY_CONFIG_H */
@@ -0,0 +1,90 @@
+/**
+ * @file
+ *
+ * @brief Compile-time helpers used to template the signal-processing and
+ * the trilateration on the number of hydrophones. Every loop over the
+ * hydrophones or the hydrophone-pairs is unrolled at compile time, such
+ * that adding a hydrophone does not add any runtime dispatch
+ *
+ * Hydrophone-pairs are enumerated in lexicographic order. With N = 3
+ *      pair 0 = (0, 1)     port      - starboard
+ *      pair 1 = (0, 2)     port      - stern
+ *      pair 2 = (1, 2)     starboard - stern
+ * The first N - 1 pairs therefore always use hydrophone 0 as reference
+ */
+#ifndef ACOUSTICS_HYDROPHONE_ARRAY_H
+#define ACOUSTICS_HYDROPHONE_ARRAY_H
+
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "parameters.h"
+
+/**
+ * @brief The templated functions are explicitly instantiated for three to
+ * MAX_NUM_HYDROPHONES hydrophones
+ */
+#define MAX_NUM_HYDROPHONES 5u
+
+static_assert(NUM_HYDROPHONES >= 3 && NUM_HYDROPHONES <= MAX_NUM_HYDROPHONES,
+        "NUM_HYDROPHONES must be between 3 and MAX_NUM_HYDROPHONES");
+
+
+/**
+ * @brief Compile-time enumeration of the hydrophone-pairs for an array
+ * of @p N hydrophones
+ *
+ * @param count Number of pairs
+ *
+ * @param first Index of the first hydrophone in a pair
+ *
+ * @param second Index of the second hydrophone in a pair
+ */
+template<uint32_t N>
+struct HydrophonePairs{
+  static_assert(N >= 3, "At least three hydrophones are required");
+
+  static constexpr uint32_t count = N * (N - 1) / 2;
+
+  static constexpr uint32_t first(uint32_t pair){
+    uint32_t hyd = 0;
+    while(pair >= N - 1 - hyd){
+      pair -= N - 1 - hyd;
+      hyd++;
+    }
+    return hyd;
+  }
+
+  static constexpr uint32_t second(uint32_t pair){
+    uint32_t hyd = 0;
+    while(pair >= N - 1 - hyd){
+      pair -= N - 1 - hyd;
+      hyd++;
+    }
+    return hyd + 1 + pair;
+  }
+}; /* struct HydrophonePairs */
+
+
+/**
+ * @brief Helpers to unroll a loop at compile time. The function @p f is
+ * called once for every i = 0, 1, ..., COUNT - 1 with i given as a literal,
+ * such that the compiler folds the index into every call after inlining
+ *
+ * Example:
+ *      unroll<NUM_HYDROPHONES>([&](uint32_t hyd){ process(data[hyd]); });
+ */
+template<typename F, uint32_t... I>
+inline void unroll_sequence(
+        F&& f,
+        std::integer_sequence<uint32_t, I...>){
+  (void) std::initializer_list<int>{ (f(I), 0)... };
+}
+
+template<uint32_t COUNT, typename F>
+inline void unroll(F&& f){
+  unroll_sequence(std::forward<F>(f), std::make_integer_sequence<uint32_t, COUNT>{});
+}
+
+#endif /* ACOUSTICS_HYDROPHONE_ARRAY_H */
@@ -0,0 +1,128 @@
+/**
+ * @file
+ *
+ * @brief Lookup-table mapping integer lags directly to an estimate of
+ * the pinger position. Since the lags are integers within
+ * +- max_lag, there are only a few thousand valid combinations of
+ * (lag_port_starboard, lag_port_stern). Every combination is solved
+ * once, such that the estimate for a frame is a single memory lookup
+ */
+#ifndef ACOUSTICS_LAG_LOOKUP_H
+#define ACOUSTICS_LAG_LOOKUP_H
+
+#include "trilateration.h"
+
+/**
+ * @brief The table is indexed by the two lags relative to the port
+ * hydrophone, and is therefore only defined for three hydrophones
+ */
+static_assert(NUM_HYDROPHONES == 3 || !USE_LAG_LOOKUP_TABLE,
+        "The lag lookup-table requires NUM_HYDROPHONES == 3");
+
+/**
+ * @brief Size of the lookup-table
+ *
+ * @param LAG_LOOKUP_DIMENSION Number of lags covered in each direction
+ *
+ * @param LAG_LOOKUP_TABLE_SIZE Total number of entries in the table
+ */
+#define LAG_LOOKUP_DIMENSION    (2 * LAG_LOOKUP_MAX_LAG + 1)
+#define LAG_LOOKUP_TABLE_SIZE   (LAG_LOOKUP_DIMENSION * LAG_LOOKUP_DIMENSION)
+
+
+/**
+ * @brief An entry in the lookup-table. The values are stored as
+ * fixed-point to keep the table small
+ *
+ * @param x_estimate Estimated x-position [cm]
+ *
+ * @param y_estimate Estimated y-position [cm]
+ *
+ * @param bearing Bearing to the pinger, clockwise from the bow [0.01 deg]
+ *
+ * @param bool_valid 1 if the lags are consistent and the position could be
+ * estimated, 0 otherwise
+ */
+typedef struct{
+  int16_t x_estimate;
+  int16_t y_estimate;
+  int16_t bearing;
+  uint8_t bool_valid;
+  uint8_t reserved;
+}LagLookupEntry; /* struct LagLookupEntry */
+
+
+/**
+ * @brief Namespace/wrapper for the lookup-table
+ */
+namespace LAG_LOOKUP{
+
+
+#if USE_LAG_LOOKUP_TABLE
+/**
+ * @brief The lookup-table used by the system. Only allocated if
+ * USE_LAG_LOOKUP_TABLE is set, as it requires
+ * LAG_LOOKUP_TABLE_SIZE * sizeof(LagLookupEntry) bytes of RAM
+ */
+extern LagLookupEntry lag_lookup_table[LAG_LOOKUP_TABLE_SIZE];
+#endif /* USE_LAG_LOOKUP_TABLE */
+
+
+/**
+ * @brief Function that generates the lookup-table by solving every
+ * combination of (lag_port_starboard, lag_port_stern) within +- @p max_lag
+ * with TRILATERATION::trilaterate_pinger_position
+ *
+ * A combination is marked invalid if the implied lag_starboard_stern
+ * exceeds the max_lag of the geometry, or if no position could be found
+ *
+ * @warning Requires TRILATERATION::initialize_trilateration_globals() to
+ * have been called
+ *
+ * @retval Returns the number of valid entries. Returns 0 if the geometry
+ * requires a larger table than given by @p max_lag
+ *
+ * @param table The table to fill. Must hold (2 * @p max_lag + 1)^2 entries
+ *
+ * @param max_lag Largest abs lag covered by @p table
+ */
+uint32_t generate_lag_lookup_table(
+            LagLookupEntry* table,
+            const int32_t& max_lag);
+
+
+/**
+ * @brief Function that looks up the estimated position of the pinger in
+ * @p table based on the measured lags
+ *
+ * @retval Returns 1 if the lags are consistent and a valid entry was
+ * found, and 0 otherwise
+ *
+ * @param table The table generated by generate_lag_lookup_table()
+ *
+ * @param max_lag Largest abs lag covered by @p table
+ *
+ * @param p_lag_array Array containing pointers to the cross-correlated lags.
+ * @p lag_array expands to
+ *      p_lag_array = { *p_lag_port_starboard,
+ *                      *p_lag_port_stern,
+ *                      *p_lag_starboard_stern }
+ *
+ * @param x_estimate Reference to the estimated x-position [m]
+ *
+ * @param y_estimate Reference to the estimated y-position [m]
+ *
+ * @param bearing Reference to the estimated bearing, clockwise from the bow [deg]
+ */
+uint8_t lookup_pinger_position(
+            const LagLookupEntry* table,
+            const int32_t& max_lag,
+            uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+            float32_t& x_estimate,
+            float32_t& y_estimate,
+            float32_t& bearing);
+
+
+} /* namespace LAG_LOOKUP */
+
+#endif /* ACOUSTICS_LAG_LOOKUP_H */
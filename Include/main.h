@@ -101,21 +101,7 @@
 #include "stm32f767xx.h"
 #include "system_stm32f7xx.h"
 
-/**
- * @brief Enum to hold some of the potential errors that could occur
- */
-typedef enum{
-  ERROR_ADC_INIT,             /* Error on initializing ADC                          */
-  ERROR_ADC_CONFIG,           /* Error on configuring ADC                           */
-  ERROR_DMA_START,            /* Error while starting DMA                           */
-  ERROR_DMA_STOP,             /* Error while stopping DMA                           */
-  ERROR_DMA_CONV,             /* Error while converting values                      */
-  ERROR_TRILATERATION_INIT,   /* Error on initializing TRILATERATION                */
-  ERROR_TIME_SIGNAL,          /* Error on calculating invalid time of signals       */
-  ERROR_UNIDENTIFIED,         /* Unidentified error. Thrown using Error_handler()   */
-  ERROR_MEMORY,               /* Out of memory for error_handling                   */
-  ERROR_A_NOT_INVERTIBLE      /* (A^T * A)-matrix not invertible                    */
-}ERROR_TYPES; /* enum ERROR_TYPES */
+#include "event_log.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,232 @@
+/**
+ * @file
+ *
+ * @brief Registry of the parameters that can be tuned at runtime, such that
+ * the topside can change them over ethernet without a rebuild and reflash.
+ * The commands are given by command.h
+ *
+ * Every parameter has an ID, a name, a type and a valid range given by
+ * PARAMETER_REGISTRY::parameter_info. The values are changed as a set by
+ * PARAMETER_REGISTRY::apply_parameters(), where every value is validated
+ * and everything derived from the changed values is recomputed before
+ * anything is replaced. Either every value of the set is applied, or none
+ *
+ * The derived data is only recomputed when its inputs change
+ *      margin_time_epsilon                     : the geometry, and the lag
+ *                                                lookup-table if used
+ *      filter_low_frequency/high_frequency     : the filter-coefficients
+ * such that setting a parameter to its current value costs nothing
+ *
+ * @note Parameters sizing the buffers, such as IN_BUFFER_LENGTH, are given
+ * at compile-time and are not in the registry
+ */
+#ifndef ACOUSTICS_PARAMETER_REGISTRY_H
+#define ACOUSTICS_PARAMETER_REGISTRY_H
+
+#include "analyze_data.h"
+
+
+/**
+ * @brief The parameters in the registry. The IDs are used by the commands,
+ * such that new parameters must be added before NUM_PARAMETERS
+ */
+typedef enum{
+  PARAMETER_MARGIN_TIME_EPSILON,    /* See TRILATERATION::margin_time_epsilon         */
+  PARAMETER_FILTER_LOW_FREQUENCY,   /* Lower cut-off frequency of the filter  [Hz]    */
+  PARAMETER_FILTER_HIGH_FREQUENCY,  /* Upper cut-off frequency of the filter  [Hz]    */
+  PARAMETER_SOLVER_MODE,            /* See TRILATERATION::solver_mode                 */
+  NUM_PARAMETERS
+}PARAMETER_IDS; /* enum PARAMETER_IDS */
+
+
+/**
+ * @brief Type of the value of a parameter
+ */
+typedef enum{
+  PARAMETER_FLOAT,                  /* float32_t                                      */
+  PARAMETER_UINT32,                 /* uint32_t                                       */
+  NUM_PARAMETER_TYPES
+}PARAMETER_TYPES; /* enum PARAMETER_TYPES */
+
+
+/**
+ * @brief Data derived from the parameters, which is recomputed when they
+ * change
+ */
+typedef enum{
+  REBUILD_NONE      = 0,
+  REBUILD_GEOMETRY  = 1u << 0,      /* The geometry and the lag lookup-table          */
+  REBUILD_FILTER    = 1u << 1       /* The filter-coefficients                        */
+}PARAMETER_REBUILDS; /* enum PARAMETER_REBUILDS */
+
+
+/**
+ * @brief Result of changing the parameters
+ */
+typedef enum{
+  PARAMETER_OK,                     /* Every value is applied                         */
+  PARAMETER_UNKNOWN_ID,             /* The ID is not in the registry, or the command  */
+                                    /* is not handled                                 */
+  PARAMETER_WRONG_TYPE,             /* The type does not match the parameter          */
+  PARAMETER_INVALID_VALUE,          /* Not finite, out of range, or inconsistent with */
+                                    /* the other parameters                           */
+  PARAMETER_REBUILD_FAILED,         /* The derived data could not be recomputed, or   */
+                                    /* the configuration could not be stored          */
+  NUM_PARAMETER_STATUS
+}PARAMETER_STATUS; /* enum PARAMETER_STATUS */
+
+
+/**
+ * @brief Value of a parameter, interpreted as given by PARAMETER_TYPES
+ */
+typedef union{
+  float32_t as_float;
+  uint32_t as_uint32;
+}ParameterValue; /* union ParameterValue */
+
+
+/**
+ * @brief Description of a parameter
+ *
+ * @param name Name used by the tools
+ *
+ * @param type The type of the value
+ *
+ * @param minimum Smallest valid value
+ *
+ * @param maximum Largest valid value
+ *
+ * @param default_value The value at startup
+ *
+ * @param rebuilds Data recomputed when the value changes. See PARAMETER_REBUILDS
+ */
+typedef struct{
+  const char* name;
+  PARAMETER_TYPES type;
+  ParameterValue minimum;
+  ParameterValue maximum;
+  ParameterValue default_value;
+  uint32_t rebuilds;
+}ParameterInfo; /* struct ParameterInfo */
+
+
+/**
+ * @brief A new value of a parameter
+ *
+ * @param id The parameter. See PARAMETER_IDS
+ *
+ * @param type The type of @p value. Must match the parameter
+ *
+ * @param value The new value
+ */
+typedef struct{
+  uint32_t id;
+  uint32_t type;
+  ParameterValue value;
+}ParameterAssignment; /* struct ParameterAssignment */
+
+
+/**
+ * @brief Number of changes and of recomputations since the registry was reset
+ *
+ * @param num_applied Number of sets applied
+ *
+ * @param num_rejected Number of sets rejected
+ *
+ * @param num_geometry_rebuilds Number of times the geometry was recomputed
+ *
+ * @param num_filter_rebuilds Number of times the filter was redesigned
+ */
+typedef struct{
+  uint32_t num_applied;
+  uint32_t num_rejected;
+  uint32_t num_geometry_rebuilds;
+  uint32_t num_filter_rebuilds;
+}ParameterStatistics; /* struct ParameterStatistics */
+
+
+/**
+ * @brief Namespace/wrapper for the parameter registry
+ */
+namespace PARAMETER_REGISTRY{
+
+
+/**
+ * @brief Description of every parameter, indexed by PARAMETER_IDS
+ */
+extern const ParameterInfo parameter_info[NUM_PARAMETERS];
+
+
+/**
+ * @brief Sets every parameter to its default value, as given in
+ * parameters.h, and clears the statistics. Must be called during startup,
+ * before the geometry is initialized
+ *
+ * The derived data is not recomputed, as the defaults are the values it is
+ * initialized from. The filter-coefficients in use at the first reset are
+ * kept, and restored by every later reset
+ */
+void reset_parameters();
+
+
+/**
+ * @brief Returns the value of a parameter
+ *
+ * @retval Returns 1 if @p id is in the registry
+ *
+ * @param id The parameter
+ *
+ * @param value The current value
+ */
+uint8_t get_parameter(
+            const uint32_t& id,
+            ParameterValue& value);
+
+
+/**
+ * @brief Checks a single value against the type and the range of its
+ * parameter. Consistency with the other parameters is checked by
+ * apply_parameters()
+ *
+ * @param assignment The new value
+ */
+PARAMETER_STATUS check_assignment(const ParameterAssignment& assignment);
+
+
+/**
+ * @brief Changes a set of parameters. Every value is validated, and the
+ * derived data of the changed parameters is recomputed into temporaries,
+ * before the set is applied as a whole. Nothing is changed unless
+ * PARAMETER_OK is returned
+ *
+ * A parameter given more than once gets the last value
+ *
+ * @warning Must not be called while a frame is being processed
+ *
+ * @retval Returns PARAMETER_OK if the set is applied. Otherwise the status
+ * of the first assignment failing, given by @p failed_index
+ *
+ * @param assignments The new values
+ *
+ * @param num_assignments Number of new values
+ *
+ * @param failed_index Index of the failing assignment. Equals
+ * @p num_assignments if the set as a whole is inconsistent
+ */
+PARAMETER_STATUS apply_parameters(
+            const ParameterAssignment* assignments,
+            const uint32_t& num_assignments,
+            uint32_t& failed_index);
+
+
+/**
+ * @brief The number of changes and recomputations
+ *
+ * @param statistics The statistics
+ */
+void get_statistics(ParameterStatistics& statistics);
+
+
+} /* namespace PARAMETER_REGISTRY */
+
+#endif /* ACOUSTICS_PARAMETER_REGISTRY_H */
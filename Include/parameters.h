@@ -12,8 +12,51 @@
  *        Hydrophone amplification
  *        Hydrophone position
  * 
+ *    GEOMETRY_CONFIG_SETUP:
+ *        Format and flash-location of the runtime hydrophone configuration
+ * 
+ *    RECORDING_SETUP:
+ *        Format of the raw recordings
+ * 
+ *    SAMPLE_CODING_SETUP:
+ *        Block-length and escape of the Rice-coded samples
+ * 
+ *    TELEMETRY_SETUP:
+ *        Format and addresses of the UDP telemetry-stream
+ * 
+ *    RAW_STREAM_SETUP:
+ *        Streaming of the raw ADC-frames over UDP
+ * 
+ *    LOOKUP_TABLE_SETUP:
+ *        Enables and sizes the integer-lag lookup-table
+ * 
+ *    SOLVER_SETUP:
+ *        Selection between the far-field and the hyperbolic solver
+ * 
+ *    NONLINEAR_SOLVER_SETUP:
+ *        Iteration-cap and tolerances of the iterative solver
+ * 
+ *    TRACKING_SETUP:
+ *        Noise and gating of the filter tracking the pinger over frames
+ * 
+ *    PROFILING_SETUP:
+ *        Enables and sizes the profiling of the main-loop
+ * 
+ *    ALLOCATION_SETUP:
+ *        Trapping of heap-allocations in the main-loop
+ * 
+ *    EVENT_LOG_SETUP:
+ *        Size of the ring of logged errors and events
+ * 
+ *    TRACE_SETUP:
+ *        Size and transport of the binary event-trace
+ * 
+ *    COMMAND_SETUP:
+ *        Format and ports of the runtime parameter-commands
+ * 
  *    TEST_PARAMETERS:
  *        Position of fictional sound-source
+ *        Default waveform of the simulated pinger
  * 
  *    PHYSICAL_CONSTANTS:
  *        Speed of sound in water
@@ -41,14 +84,22 @@
 #ifndef DSP_CONSTANTS
 #define DSP_CONSTANTS
 
+  #ifndef SAMPLE_FREQUENCY                          /* May be overridden by the host sweep            */
   #define SAMPLE_FREQUENCY    112500.0f             /* Sample frequency                     [Hz]      */
+  #endif /* SAMPLE_FREQUENCY */
   #define SAMPLE_TIME         1 / SAMPLE_FREQUENCY  /* Sample time                          [s]       */
 
-  #define IN_BUFFER_LENGTH    4096u                 /* Total number (real + imaginary) measurements   */
-                                                    /* per hydrophone                                 */
-  #define DMA_BUFFER_LENGTH   IN_BUFFER_LENGTH / 2  /* Number real measurements transferred with DMA  */
+  #ifndef IN_BUFFER_LENGTH                          /* May be overridden by the host benchmark/sweep  */
+  #define IN_BUFFER_LENGTH    2048u                 /* Number of measurements per hydrophone          */
+  #endif /* IN_BUFFER_LENGTH */
+  #define DMA_BUFFER_LENGTH   IN_BUFFER_LENGTH      /* Number measurements per hydrophone transferred */
+                                                    /* with DMA                                       */
   #define IIR_SIZE            IN_BUFFER_LENGTH      /* Number of data-points to filter                */
 
+  #define ADC_MAX_VALUE       4095u                 /* Largest value given by the 12-bit ADC          */
+  #define ADC_MID_VALUE       2048u                 /* ADC-value of a silent hydrophone. The signal   */
+                                                    /* is biased to the middle of the range           */
+
 #endif /* DSP_CONSTANTS */
 
 
@@ -100,11 +151,16 @@
  * to the axis that mechanical works with. This implies
  * that n_HYD_X equals mechanical's y-axis
  * 
+ * @note The positions are collected in HYDROPHONE_POSITIONS below. To add
+ * a hydrophone, increase NUM_HYDROPHONES and add a row to HYDROPHONE_POSITIONS.
+ * With four or more hydrophones, the position is solved in x, y and z
  */
 #ifndef HYDROPHONE_DETAILS
 #define HYDROPHONE_DETAILS
 
   #define NUM_HYDROPHONES     3                     /* Number of hydrophones used on the AUV          */
+  #define NUM_HYDROPHONE_PAIRS  (NUM_HYDROPHONES * (NUM_HYDROPHONES - 1) / 2)
+                                                    /* Number of cross-correlated lags                */
   #define HYD_PREAMP_DB       40                    /* Number of dB the signal is preamplifies        */
   #define HYD_FFVS           -173                   /* Average FFVS for 20 - 40 kHz [dB V/μPa]        */  
 
@@ -147,6 +203,288 @@
 #endif /* SYSTEM_MARGINS */
 
 
+/**
+ * @brief Defines used by the runtime configuration of the hydrophone
+ * positions. See geometry_config.h for more information
+ * 
+ * The configuration is stored in the last flash-sector, which is not
+ * used by the program
+ */
+#ifndef GEOMETRY_CONFIG_SETUP
+#define GEOMETRY_CONFIG_SETUP
+
+  #define GEOMETRY_CONFIG_MAGIC     0x47445948u     /* Magic-number of a configuration ("HYDG")       */
+  #define GEOMETRY_CONFIG_VERSION   1u              /* Version of the configuration-format            */
+  #define GEOMETRY_FLASH_SECTOR     11u             /* Flash-sector holding the configuration         */
+  #define GEOMETRY_FLASH_ADDRESS    0x081C0000u     /* Start-address of GEOMETRY_FLASH_SECTOR         */
+
+#endif /* GEOMETRY_CONFIG_SETUP */
+
+
+/**
+ * @brief Defines used by the format of the raw recordings. See recording.h
+ * for more information
+ */
+#ifndef RECORDING_SETUP
+#define RECORDING_SETUP
+
+  #define RECORDING_MAGIC           0x43524341u     /* Magic-number of a recording ("ACRC")           */
+  #define RECORDING_VERSION         2u              /* Version of the recording-format                */
+  #define ADC_RESOLUTION            12u             /* Number of bits given by the ADC                */
+  #define RECORDING_READER_WINDOW   0x4000000u      /* Bytes prefetched ahead of, and kept behind,    */
+                                                    /* the frame replayed on the host                 */
+
+#endif /* RECORDING_SETUP */
+
+
+/**
+ * @brief Defines used by the lossless encodings of the samples. See 
+ * sample_coding.h for more information
+ */
+#ifndef SAMPLE_CODING_SETUP
+#define SAMPLE_CODING_SETUP
+
+  #define SAMPLE_RICE_BLOCK_LENGTH  64u             /* Samples sharing a Rice-parameter               */
+  #define SAMPLE_RICE_ESCAPE        24u             /* Longest unary quotient before the residual is  */
+                                                    /* stored as it is                                */
+
+#endif /* SAMPLE_CODING_SETUP */
+
+
+/**
+ * @brief Defines used by the binary telemetry sent over UDP. See 
+ * telemetry.h for more information
+ * 
+ * No ARP is implemented, such that the frames are sent to the broadcast
+ * MAC-address. The receiver still filters on TELEMETRY_DEST_IP
+ */
+#ifndef TELEMETRY_SETUP
+#define TELEMETRY_SETUP
+
+  #define USE_TELEMETRY             1u              /* Send an estimate for every frame               */
+  #define TELEMETRY_MAGIC           0x4D4C4554u     /* Magic-number of a packet ("TELM")              */
+  #define TELEMETRY_VERSION         1u              /* Version of the record-format                   */
+  #define TELEMETRY_BATCH_SIZE      8u              /* Records batched in every packet                */
+  #define TELEMETRY_SOURCE_IP       0x0A000014u     /* IPv4-address of the MCU (10.0.0.20)            */
+  #define TELEMETRY_DEST_IP         0x0A000001u     /* IPv4-address of the Xavier (10.0.0.1)          */
+  #define TELEMETRY_SOURCE_PORT     5004u           /* UDP-port sent from                             */
+  #define TELEMETRY_DEST_PORT       5005u           /* UDP-port sent to                               */
+
+#endif /* TELEMETRY_SETUP */
+
+
+/**
+ * @brief Defines used when streaming the raw ADC-frames over UDP. See 
+ * raw_stream.h for more information
+ * 
+ * The DMA alternates between two buffers, such that a frame is sent 
+ * directly from its buffer while the next is acquired. A frame is dropped
+ * if the previous is still being sent, such that a stalled link never 
+ * delays the acquisition. A frame of 
+ * NUM_HYDROPHONES * DMA_BUFFER_LENGTH samples is split into packets of 
+ * RAW_STREAM_PACKET_SAMPLES samples, each fitting a single Ethernet-frame
+ * 
+ * The stream is started and stopped by COMMAND_RAW_STREAM. See command.h
+ */
+#ifndef RAW_STREAM_SETUP
+#define RAW_STREAM_SETUP
+
+  #define USE_RAW_STREAM            1u              /* Double-buffer the DMA, such that the raw       */
+                                                    /* frames can be streamed                         */
+  #define RAW_STREAM_AT_STARTUP     0u              /* Stream the raw frames from startup             */
+  #define RAW_STREAM_MAGIC          0x57415241u     /* Magic-number of a packet ("ARAW")              */
+  #define RAW_STREAM_VERSION        2u              /* Version of the packet-format                   */
+  #define RAW_STREAM_PACKET_SAMPLES 716u            /* Samples in every packet                        */
+  #define RAW_STREAM_PACKED         0u              /* Pack the samples into 12 bits. Copies the      */
+                                                    /* samples instead of sending them from the DMA   */
+  #define RAW_STREAM_DEST_PORT      5006u           /* UDP-port sent to                               */
+
+#endif /* RAW_STREAM_SETUP */
+
+
+/**
+ * @brief Defines that indicate if, and how large, the lookup-table
+ * mapping integer lags directly to a position is
+ * 
+ * The table is indexed by (lag_port_starboard, lag_port_stern), and 
+ * therefore holds (2 * LAG_LOOKUP_MAX_LAG + 1)^2 entries. Run the tool 
+ * Tools/lag_lookup_generator.cpp to see the memory footprint and the
+ * resolution for the current configuration
+ * 
+ * @warning LAG_LOOKUP_MAX_LAG must be at least the max_lag calculated 
+ * in TRILATERATION::hydrophone_geometry, otherwise the table is not generated
+ */
+#ifndef LOOKUP_TABLE_SETUP
+#define LOOKUP_TABLE_SETUP
+
+  #define USE_LAG_LOOKUP_TABLE 0u                   /* Bool to indicate if the lookup-table is used   */
+                                                    /*    Solve linear equations : 0u                 */
+                                                    /*    Lookup-table           : 1u                 */
+
+  #define LAG_LOOKUP_MAX_LAG  48                    /* Largest abs lag covered by the table [samples] */
+  #define LAG_LOOKUP_CLOSURE  1                     /* Allowed deviation between the measured         */
+                                                    /* lag_starboard_stern and the one implied by the */
+                                                    /* two other lags                       [samples] */
+
+#endif /* LOOKUP_TABLE_SETUP */
+
+
+/**
+ * @brief Defines used to select between the far-field (bearing-only) solver
+ * and the hyperbolic solver. See TRILATERATION::use_hyperbolic_solver()
+ * 
+ * The far-field solver assumes the sound arrives as a plane wave, and is 
+ * accurate when the range is large compared to the distance between the 
+ * hydrophones
+ */
+#ifndef SOLVER_SETUP
+#define SOLVER_SETUP
+
+  #define SOLVER_MODE_DEFAULT       SOLVER_AUTO     /* Solver used at startup                         */
+  #define FAR_FIELD_MIN_RANGE       5.0f            /* Range where the far-field solver is used [m]   */
+  #define FAR_FIELD_RANGE_REFRESH   10u             /* Frames between each refresh of the range when  */
+                                                    /* the far-field solver is used in SOLVER_AUTO    */
+
+#endif /* SOLVER_SETUP */
+
+
+/**
+ * @brief Defines used by the iterative (Levenberg-Marquardt) solver refining
+ * the hyperbolic position. See TRILATERATION::refine_position()
+ * 
+ * The solver is warm-started from the previous estimate, and usually 
+ * converges in one or two iterations. The iteration-cap bounds the latency
+ * if it does not
+ */
+#ifndef NONLINEAR_SOLVER_SETUP
+#define NONLINEAR_SOLVER_SETUP
+
+  #define USE_NONLINEAR_SOLVER      1u              /* Refine the linear solution iteratively         */
+  #define NONLINEAR_MAX_ITERATIONS  5u              /* Max iterations for a single frame              */
+  #define NONLINEAR_STEP_TOLERANCE  1e-2f           /* Step considered as converged         [m]       */
+  #define NONLINEAR_MAX_RANGE       100.0f          /* Estimates further away are rejected  [m]       */
+  #define NONLINEAR_INITIAL_DAMPING 1e-3f           /* Initial Levenberg-Marquardt damping            */
+  #define NONLINEAR_ASSUMED_Z       0.0f            /* z-position assumed for the pinger with three   */
+                                                    /* hydrophones                          [m]       */
+
+#endif /* NONLINEAR_SOLVER_SETUP */
+
+
+/**
+ * @brief Defines used by the filter tracking the pinger position across 
+ * frames. See tracking.h for more information
+ * 
+ * The measurement noise grows with the range, as the TDOA-solution is
+ * increasingly sensitive to a single sample of lag far away from the AUV
+ */
+#ifndef TRACKING_SETUP
+#define TRACKING_SETUP
+
+  #define TRACKING_ACCEL_NOISE      0.5f            /* Std of unmodelled acceleration       [m/s^2]   */
+  #define TRACKING_MEAS_NOISE_BASE  0.25f           /* Std of position measurement at 0 m   [m]       */
+  #define TRACKING_MEAS_NOISE_RANGE 0.1f            /* Additional std per meter of range    [m/m]     */
+  #define TRACKING_INITIAL_VEL_STD  1.0f            /* Initial std of the velocity          [m/s]     */
+  #define TRACKING_GATE             13.8f           /* Chi-square gate for 2 DOF (99.9 %)             */
+  #define TRACKING_MAX_REJECTS      5u              /* Consecutive rejected measurements before the   */
+                                                    /* tracker is reset to the latest measurement     */
+
+#endif /* TRACKING_SETUP */
+
+
+/**
+ * @brief Defines used when profiling the stages of the main-loop. See 
+ * profiling.h for more information
+ * 
+ * Bucket k of the histogram holds the durations in [2^(k-1), 2^k) us, and
+ * bucket 0 the durations below 1 us. The last bucket holds every duration
+ * above the range
+ */
+#ifndef PROFILING_SETUP
+#define PROFILING_SETUP
+
+  #define USE_PROFILING             1u              /* Measure the time spent in each stage           */
+  #define PROFILING_NUM_BUCKETS     20u             /* Buckets in the histogram of each stage         */
+
+#endif /* PROFILING_SETUP */
+
+
+/**
+ * @brief Defines that indicate if heap-allocations are trapped. See 
+ * allocation_guard.h for more information
+ * 
+ * The main-loop must not allocate, as the heap is not sized for it and the
+ * time spent is unbounded. With the guard every allocation after 
+ * ALLOCATION_GUARD::enable_guard() traps on the MCU, and is counted on the
+ * host. EIGEN_NO_MALLOC is then defined, such that Eigen asserts instead of
+ * allocating a temporary
+ */
+#ifndef ALLOCATION_SETUP
+#define ALLOCATION_SETUP
+
+  #define USE_ALLOCATION_GUARD      1u              /* Trap on allocations in the main-loop, and      */
+                                                    /* define EIGEN_NO_MALLOC                         */
+
+#endif /* ALLOCATION_SETUP */
+
+
+/**
+ * @brief Defines used by the log of errors and events. See event_log.h for
+ * more information
+ * 
+ * The oldest record is overwritten when the ring is full, while the number
+ * of events of each type is counted separately
+ */
+#ifndef EVENT_LOG_SETUP
+#define EVENT_LOG_SETUP
+
+  #define EVENT_LOG_LENGTH          256u            /* Records in the ring. Must be a power of two    */
+
+#endif /* EVENT_LOG_SETUP */
+
+
+/**
+ * @brief Defines used by the binary trace of the events. See trace.h for
+ * more information
+ * 
+ * The trace is a ring of TRACE_LENGTH records of 8 bytes, where the oldest
+ * record is overwritten. A dump is sent as packets of TRACE_PACKET_RECORDS
+ * records, each fitting a single Ethernet-frame
+ */
+#ifndef TRACE_SETUP
+#define TRACE_SETUP
+
+  #define USE_TRACE                 1u              /* Trace the events and the stages                */
+  #define TRACE_LENGTH              1024u           /* Records in the ring. Must be a power of two    */
+  #define TRACE_MAGIC               0x45435254u     /* Magic-number of a dump ("TRCE")                */
+  #define TRACE_VERSION             1u              /* Version of the dump-format                     */
+  #define TRACE_PACKET_RECORDS      180u            /* Records in every packet                        */
+  #define TRACE_DEST_PORT           5007u           /* UDP-port sent to                               */
+
+#endif /* TRACE_SETUP */
+
+
+/**
+ * @brief Defines used by the commands setting and querying the parameters
+ * at runtime. See command.h and parameter_registry.h for more information
+ * 
+ * The commands are received on COMMAND_PORT, and answered with a reply sent
+ * to COMMAND_REPLY_PORT on TELEMETRY_DEST_IP. Every command fits a single
+ * Ethernet-frame
+ */
+#ifndef COMMAND_SETUP
+#define COMMAND_SETUP
+
+  #define USE_COMMANDS              1u              /* Receive commands over ethernet                 */
+  #define COMMAND_MAGIC             0x444D4F43u     /* Magic-number of a command ("COMD")             */
+  #define COMMAND_VERSION           2u              /* Version of the command-format                  */
+  #define COMMAND_MAX_ENTRIES       16u             /* Parameters in a single command                 */
+  #define COMMAND_MAX_PAYLOAD_SIZE  1408u           /* Payload of a single command or reply   [bytes] */
+  #define COMMAND_PORT              5008u           /* UDP-port listened to                           */
+  #define COMMAND_REPLY_PORT        5009u           /* UDP-port the replies are sent to               */
+
+#endif /* COMMAND_SETUP */
+
+
 /**
  * @brief Defines that indicate which parameters are to be tested 
  */
@@ -160,6 +498,14 @@
   #define SOURCE_POS_X        10.0f                 /* x - position of sound-source                   */
   #define SOURCE_POS_Y        2.0f                  /* y - position of sound-source                   */
   #define SOURCE_POS_Z        0.0f                  /* z - position of sound-source                   */
+  #define BENCHMARK_NUM_FRAMES 360u                 /* Frames solved when comparing the solvers       */
+
+  #define SIM_PINGER_FREQUENCY 25000.0f             /* Frequency of the simulated pinger    [Hz]      */
+  #define SIM_PULSE_LENGTH    4e-3f                 /* Length of the simulated pulse        [s]       */
+  #define SIM_PULSE_START     2e-3f                 /* Time the pulse reaches the reference [s]       */
+                                                    /* hydrophone, from the start of the frame        */
+  #define SIM_AMPLITUDE       1000.0f               /* Amplitude of the direct path         [ADC]     */
+  #define SIM_NOISE_STD       20.0f                 /* Std of the white noise               [ADC]     */
 
 #endif /* TEST_PARAMETERS */
 
@@ -193,6 +539,33 @@
 #include "arm_math.h"
 #include "arm_const_structs.h" 
 
+/**
+ * @brief Position {x, y, z} of every hydrophone [m]. The first hydrophone
+ * is used as reference during the trilateration
+ * 
+ * The order of the rows must match the order of the channels delivered
+ * by the ADC
+ */
+#ifndef HYDROPHONE_GEOMETRY
+#define HYDROPHONE_GEOMETRY
+
+  constexpr float32_t HYDROPHONE_POSITIONS[NUM_HYDROPHONES][3] = 
+  {
+    { PORT_HYD_X,       PORT_HYD_Y,       PORT_HYD_Z      },
+    { STARBOARD_HYD_X,  STARBOARD_HYD_Y,  STARBOARD_HYD_Z },
+    { STERN_HYD_X,      STERN_HYD_Y,      STERN_HYD_Z     }
+  };
+
+  /**
+   * ADC-channel of each hydrophone, in the same order as HYDROPHONE_POSITIONS.
+   * The channel for hydrophone n is given rank n + 1. The numbers equal
+   * ADC_CHANNEL_n in the HAL
+   */
+  constexpr uint32_t HYDROPHONE_ADC_CHANNELS[] = { 3, 10, 13 };
+
+#endif /* HYDROPHONE_GEOMETRY */
+
+
 /**
  * @brief A fourth-order IIR-filter to filter the data before 
  * processing it. By using this filter, we should (hopefully)
@@ -241,25 +614,32 @@
  * @param num_stages            Number of second order cascade-filters. Determines the
  *                              filter order. Order = 2 * num_stages
  * 
- * @param state_coefficients    Initial values for x[n-1], x[n-2], ..., x[n-(2*num_stages)]
- *                              y[n-1], y[n-2], ..., y[n-(2*num_stages)]
+ * @param filter_coefficients   Filter coefficients given as {b10, b11, b12, -a11, -a12
+ *                              b20, b21, b22, -a21, -a22, ...}. CMSIS adds the feedback-
+ *                              terms, such that the a-coefficients are given negated
  * 
- * @param filter_coefficients   Filter coefficients given as {b10, b11, b12, a11, a12
- *                              b20, b21, b22, a21, a22, ...}
+ * @note The state of the filter (x[n-1], x[n-2], y[n-1], y[n-2] for each stage) 
+ * is kept separately for each hydrophone, and reset for every frame, as the 
+ * frames are not continuous. See ANALYZE_DATA::filter_raw_data()
  * 
- * @param IIR_FILTER            A struct describing a biquad DF1 IIR filter
+ * @warning The coefficients are designed for a SAMPLE_FREQUENCY of 112.5 kHz,
+ * and must be redesigned if it is changed
+ * 
+ * @note The cut-off frequencies can be changed at runtime through 
+ * PARAMETER_REGISTRY, which redesigns the coefficients with 
+ * ANALYZE_DATA::design_bandpass_filter(). The coefficients above are used
+ * until then
  */
 #ifndef FILTER_SETUP
 #define FILTER_SETUP
 
+  #define FILTER_LOW_FREQUENCY      15000.0f        /* Lower cut-off frequency at startup   [Hz]      */
+  #define FILTER_HIGH_FREQUENCY     45000.0f        /* Upper cut-off frequency at startup   [Hz]      */
+
   const uint32_t num_stages = 2;
-  
-  extern float32_t state_coefficients[4 * num_stages];
 
   extern float32_t filter_coefficients[5 * num_stages];
   
-  extern const arm_biquad_casd_df1_inst_f32 IIR_FILTER;
-  
 #endif /* FILTER_SETUP */
 
 
@@ -0,0 +1,128 @@
+/**
+ * @file
+ *
+ * @brief Profiling of the stages in the main-loop. The time spent in each
+ * stage is measured with TIMING::get_ticks(), such that the DWT
+ * cycle-counter is used on the MCU and std::chrono::steady_clock on the host
+ *
+ * Every stage holds the min/mean/max and a histogram of the durations. The
+ * profiles are kept in PROFILING::stage_profiles, which can be read directly
+ * with the debugger, or formatted with PROFILING::write_report() when the
+ * status is queried
+ *
+ * The stages are measured back to back, such that a single read of the
+ * counter both ends one stage and starts the next
+ *      uint32_t ticks = TIMING::get_ticks();
+ *      ANALYZE_DATA::filter_raw_data(...);
+ *      ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, ticks);
+ *      ANALYZE_DATA::calculate_xcorr_lag_array(...);
+ *      ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CORRELATE, ticks);
+ */
+#ifndef ACOUSTICS_PROFILING_H
+#define ACOUSTICS_PROFILING_H
+
+#include "timing.h"
+
+
+/**
+ * @brief The stages of the main-loop
+ */
+typedef enum{
+  STAGE_ACQUIRE,              /* Waiting for the DMA to finish the frame              */
+  STAGE_CONVERT,              /* Converting the DMA-buffer and restarting the DMA     */
+  STAGE_FILTER,               /* Filtering the raw data                               */
+  STAGE_CORRELATE,            /* Cross-correlating every hydrophone-pair              */
+  STAGE_VALIDATE,             /* Checking the lags                                    */
+  STAGE_SOLVE,                /* Solvers and tracker                                  */
+  STAGE_TRANSMIT,             /* Sending the estimate                                 */
+  STAGE_FRAME,                /* Every stage after STAGE_ACQUIRE                      */
+  NUM_PROFILING_STAGES
+}PROFILING_STAGES; /* enum PROFILING_STAGES */
+
+
+/**
+ * @brief The profile of a single stage
+ *
+ * @param timing Min/mean/max of the durations [ticks]
+ *
+ * @param histogram Number of durations in each bucket. See PROFILING_SETUP
+ * in parameters.h for the range of each bucket
+ */
+typedef struct{
+  TimingStatistics timing;
+  uint32_t histogram[PROFILING_NUM_BUCKETS];
+}StageProfile; /* struct StageProfile */
+
+
+/**
+ * @brief Namespace/wrapper for the profiling
+ */
+namespace PROFILING{
+
+
+/**
+ * @brief Profile of every stage, indexed by PROFILING_STAGES
+ */
+extern StageProfile stage_profiles[NUM_PROFILING_STAGES];
+
+
+/**
+ * @brief Name of every stage, indexed by PROFILING_STAGES
+ */
+extern const char* const stage_names[NUM_PROFILING_STAGES];
+
+
+/**
+ * @brief Resets the profile of every stage
+ */
+void reset_profiles();
+
+
+/**
+ * @brief Calculates the bucket of the histogram holding @p ticks
+ *
+ * @param ticks The duration [ticks]
+ */
+uint32_t get_bucket(const uint32_t& ticks);
+
+
+/**
+ * @brief Adds the duration from @p start_ticks until now to the profile of
+ * @p stage. Does nothing if USE_PROFILING is not set
+ *
+ * With USE_TRACE the stage is also traced as a TRACE_STAGE_BEGIN at
+ * @p start_ticks and a TRACE_STAGE_END at the end. See trace.h
+ *
+ * @retval Returns the current tick-count, which is used as the start of the
+ * next stage. Returns 0 if USE_PROFILING is not set
+ *
+ * @param stage The stage that has finished
+ *
+ * @param start_ticks Tick-count at the start of @p stage
+ */
+uint32_t record_stage(
+            const PROFILING_STAGES& stage,
+            const uint32_t& start_ticks);
+
+
+/**
+ * @brief Writes the profile of every stage as text, with one line for
+ * each stage
+ *      <name> <num> <min> <mean> <max> [us] <histogram>
+ *
+ * The text is always terminated, and truncated if @p length is too small
+ *
+ * @retval Returns the number of characters written, without the terminator
+ *
+ * @param buffer The buffer to write to
+ *
+ * @param length Size of @p buffer [bytes]
+ */
+uint32_t write_report(
+            char* buffer,
+            const uint32_t& length);
+
+
+} /* namespace PROFILING */
+
+#endif /* ACOUSTICS_PROFILING_H */
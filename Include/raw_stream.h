@@ -0,0 +1,142 @@
+/**
+ * @file
+ *
+ * @brief Packet-format used to stream the raw ADC-frames over UDP, such
+ * that the hydrophone-data can be recorded on the topside computer during
+ * in-water debugging
+ *
+ * Every frame of NUM_HYDROPHONES * DMA_BUFFER_LENGTH interleaved samples is
+ * split into RAW_STREAM_PACKETS_PER_FRAME packets. Every packet is a
+ * RawStreamHeader followed by num_samples samples
+ *      {header, s_(offset), s_(offset + 1), ..., s_(offset + num_samples - 1)}
+ * encoded as given by the header. See sample_coding.h
+ *
+ * The samples are by default sent as the 16-bit halfwords written by the
+ * DMA, and are then never copied on the MCU. The header is written into a
+ * separate buffer, and the Ethernet-DMA gathers the header and the samples
+ * directly from the DMA-buffer of the ADC. See TELEMETRY_TRANSPORT. With
+ * RAW_STREAM_PACKED the samples are packed into 12 bits, which saves a
+ * quarter of the bandwidth at the cost of a copy
+ *
+ * The frames are numbered by the sequence-number, and every packet holds its
+ * index within the frame, such that the receiver detects lost packets and
+ * frames. The frames are recorded in the format given by recording.h
+ */
+#ifndef ACOUSTICS_RAW_STREAM_H
+#define ACOUSTICS_RAW_STREAM_H
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+#include "sample_coding.h"
+
+/**
+ * @brief Number of packets needed for every frame
+ */
+#define RAW_STREAM_PACKETS_PER_FRAME \
+        ((NUM_HYDROPHONES * DMA_BUFFER_LENGTH + RAW_STREAM_PACKET_SAMPLES - 1) / RAW_STREAM_PACKET_SAMPLES)
+
+
+/**
+ * @brief Header at the start of every packet
+ *
+ * @param magic Always RAW_STREAM_MAGIC
+ *
+ * @param version Always RAW_STREAM_VERSION
+ *
+ * @param num_hydrophones Number of hydrophones in the frame
+ *
+ * @param timestamp Time the frame was captured, after startup [us]
+ *
+ * @param sequence Sequence-number of the frame
+ *
+ * @param frame_length Number of samples per hydrophone in the frame
+ *
+ * @param sample_offset Index of the first sample of the packet within the
+ * interleaved frame
+ *
+ * @param num_samples Number of samples in the packet
+ *
+ * @param packet_index Index of the packet within the frame
+ *
+ * @param num_packets Number of packets in the frame
+ *
+ * @param adc_resolution Number of bits used in every sample
+ *
+ * @param encoding Encoding of the samples. Either SAMPLE_ENCODING_RAW or
+ * SAMPLE_ENCODING_PACKED
+ *
+ * @param reserved Reserved. Always 0
+ */
+typedef struct{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t num_hydrophones;
+  uint64_t timestamp;
+  uint32_t sequence;
+  uint32_t frame_length;
+  uint32_t sample_offset;
+  uint16_t num_samples;
+  uint16_t packet_index;
+  uint16_t num_packets;
+  uint16_t adc_resolution;
+  uint16_t encoding;
+  uint16_t reserved;
+}RawStreamHeader; /* struct RawStreamHeader */
+
+static_assert(sizeof(RawStreamHeader) == 40,
+        "RawStreamHeader must not contain any padding");
+
+static_assert(sizeof(RawStreamHeader) + RAW_STREAM_PACKET_SAMPLES * sizeof(uint16_t) <= 1472u,
+        "A packet must fit in a single Ethernet-frame without fragmentation");
+
+
+/**
+ * @brief Namespace/wrapper for the raw stream
+ */
+namespace RAW_STREAM{
+
+
+/**
+ * @brief Creates the header of a packet in a frame of the size given in
+ * parameters.h
+ *
+ * @param sequence Sequence-number of the frame
+ *
+ * @param timestamp Time the frame was captured [us]
+ *
+ * @param packet_index Index of the packet. Must be less than
+ * RAW_STREAM_PACKETS_PER_FRAME
+ *
+ * @param header The header to fill
+ */
+void create_packet_header(
+            const uint32_t& sequence,
+            const uint64_t& timestamp,
+            const uint32_t& packet_index,
+            RawStreamHeader& header);
+
+
+/**
+ * @brief Reads and validates the header of a packet
+ *
+ * @retval Returns 1 if the header is valid. Returns 0 if the magic,
+ * version or encoding is wrong, the samples are not within the frame, or
+ * @p length does not match the encoded samples
+ *
+ * @param data The packet
+ *
+ * @param length Number of bytes in @p data
+ *
+ * @param header The header read from @p data
+ */
+uint8_t parse_packet_header(
+            const uint8_t* data,
+            const uint32_t& length,
+            RawStreamHeader& header);
+
+
+} /* namespace RAW_STREAM */
+
+#endif /* ACOUSTICS_RAW_STREAM_H */
@@ -0,0 +1,235 @@
+/**
+ * @file
+ *
+ * @brief Binary format for recordings of raw ADC-frames, such that frames
+ * captured in the field can be replayed through the same processing on
+ * the host
+ *
+ * A recording is a RecordingHeader followed by any number of frames. Every
+ * frame is a RecordingFrameHeader followed by the samples, in the same
+ * interleaved order as transferred by the DMA
+ *      {h_0, h_1, ..., h_(N-1), h_0, h_1, ... }
+ * encoded as given by the header. See sample_coding.h. Raw and packed
+ * frames all have the same size, while Rice-coded frames vary in size and
+ * must be read in order
+ *
+ * Version 1 of the format always stored the samples as little-endian
+ * uint16_t, and is still read
+ *
+ * The header holds everything needed to process the frames without
+ * parameters.h: the geometry, the sample-frequency, the channel-map and
+ * the ADC-resolution. The header is protected by a CRC-32, calculated
+ * with GEOMETRY_CONFIG::calculate_crc()
+ *
+ * The functions only work on buffers, such that they can be used both on
+ * the MCU and the host
+ */
+#ifndef ACOUSTICS_RECORDING_H
+#define ACOUSTICS_RECORDING_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "geometry_config.h"
+#include "sample_coding.h"
+
+
+/**
+ * @brief Header at the start of every recording
+ *
+ * @param magic Always RECORDING_MAGIC
+ *
+ * @param version Always RECORDING_VERSION
+ *
+ * @param num_hydrophones Number of hydrophones in every frame
+ *
+ * @param adc_resolution Number of bits in every sample
+ *
+ * @param encoding Encoding of the samples in every frame. See
+ * SAMPLE_ENCODING. Always 2 in version 1, where it was the number of bytes
+ * in every sample
+ *
+ * @param frame_length Number of samples per hydrophone in every frame
+ *
+ * @param sample_frequency Sample frequency of every hydrophone [Hz]
+ *
+ * @param channel_map ADC-channel of each hydrophone. The unused entries are 0
+ *
+ * @param positions Position {x, y, z} of each hydrophone [m]. The unused
+ * entries are 0
+ *
+ * @param crc CRC-32 of the preceding bytes
+ */
+typedef struct{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t num_hydrophones;
+  uint16_t adc_resolution;
+  uint16_t encoding;
+  uint32_t frame_length;
+  float32_t sample_frequency;
+  uint32_t channel_map[MAX_NUM_HYDROPHONES];
+  float32_t positions[MAX_NUM_HYDROPHONES][3];
+  uint32_t crc;
+}RecordingHeader; /* struct RecordingHeader */
+
+static_assert(sizeof(RecordingHeader) == 24 + 16 * MAX_NUM_HYDROPHONES,
+        "RecordingHeader must not contain any padding");
+
+
+/**
+ * @brief Header at the start of every frame
+ *
+ * @param sequence Sequence-number of the frame. Increased by one for every
+ * captured frame, such that dropped frames are detected
+ *
+ * @param length Number of bytes of samples following the header. Always 0
+ * in version 1, where it was reserved
+ *
+ * @param timestamp Time the frame was captured, after startup [us]
+ */
+typedef struct{
+  uint32_t sequence;
+  uint32_t length;
+  uint64_t timestamp;
+}RecordingFrameHeader; /* struct RecordingFrameHeader */
+
+static_assert(sizeof(RecordingFrameHeader) == 16,
+        "RecordingFrameHeader must not contain any padding");
+
+
+/**
+ * @brief Namespace/wrapper for the recordings
+ */
+namespace RECORDING{
+
+
+/**
+ * @brief Creates a header for frames of the size given in parameters.h
+ *
+ * @param positions Position {x, y, z} of each hydrophone [m]
+ *
+ * @param encoding Encoding of the samples. See SAMPLE_ENCODING. Must hold
+ * ADC_RESOLUTION bits
+ *
+ * @param header The header to fill
+ */
+void create_header(
+            const float32_t (&positions)[NUM_HYDROPHONES][3],
+            const uint32_t& encoding,
+            RecordingHeader& header);
+
+
+/**
+ * @brief Reads and validates a header
+ *
+ * @retval Returns 1 if the header is valid. Returns 0 if the length, magic,
+ * version or CRC is wrong, or the sizes or the encoding are not supported.
+ * The header of version 1 is returned with encoding SAMPLE_ENCODING_RAW
+ *
+ * @param data The start of the recording
+ *
+ * @param length Number of bytes available in @p data
+ *
+ * @param header The header read from @p data
+ */
+uint8_t parse_header(
+            const uint8_t* data,
+            const uint32_t& length,
+            RecordingHeader& header);
+
+
+/**
+ * @brief Checks if the frames described by @p header can be processed
+ * with the configuration in parameters.h
+ *
+ * @retval Returns 1 if the number of hydrophones, frame-length, sample
+ * frequency and ADC-resolution are equal to the ones in parameters.h
+ *
+ * @param header A valid header
+ */
+uint8_t check_compatible_header(const RecordingHeader& header);
+
+
+/**
+ * @brief Calculates the size of a frame, including its header [bytes]. For
+ * SAMPLE_ENCODING_RICE this is the largest size of a frame
+ *
+ * @param header A valid header
+ */
+uint32_t get_frame_size(const RecordingHeader& header);
+
+
+/**
+ * @brief Encodes a frame of NUM_HYDROPHONES * DMA_BUFFER_LENGTH samples
+ *
+ * @retval Returns the number of bytes written
+ *
+ * @param header Header of the recording, created by create_header()
+ *
+ * @param p_samples The interleaved samples
+ *
+ * @param sequence Sequence-number of the frame
+ *
+ * @param timestamp Time the frame was captured [us]
+ *
+ * @param p_frame The frame to write. Must hold get_frame_size() bytes
+ */
+uint32_t write_frame(
+            const RecordingHeader& header,
+            const uint16_t* p_samples,
+            const uint32_t& sequence,
+            const uint64_t& timestamp,
+            uint8_t* p_frame);
+
+
+/**
+ * @brief Reads and validates the header of a frame
+ *
+ * @retval Returns 1 if the complete frame is within @p length bytes, and
+ * its length is valid for the encoding
+ *
+ * @param header A valid header of the recording
+ *
+ * @param p_frame The frame
+ *
+ * @param length Number of bytes available in @p p_frame
+ *
+ * @param frame_header The header of the frame. The length is given for
+ * every version of the format
+ */
+uint8_t parse_frame_header(
+            const RecordingHeader& header,
+            const uint8_t* p_frame,
+            const uint64_t& length,
+            RecordingFrameHeader& frame_header);
+
+
+/**
+ * @brief Reads a frame into the interleaved samples, such that it can be
+ * processed with ANALYZE_DATA::convert_recorded_data()
+ *
+ * @retval Returns 1 if the frame is valid and decoded
+ *
+ * @param header A valid header of the recording
+ *
+ * @param p_frame The frame
+ *
+ * @param length Number of bytes available in @p p_frame
+ *
+ * @param frame_header The header of the frame
+ *
+ * @param p_samples The interleaved samples. Must hold
+ * num_hydrophones * frame_length samples, as given by @p header
+ */
+uint8_t read_frame(
+            const RecordingHeader& header,
+            const uint8_t* p_frame,
+            const uint64_t& length,
+            RecordingFrameHeader& frame_header,
+            uint16_t* p_samples);
+
+
+} /* namespace RECORDING */
+
+#endif /* ACOUSTICS_RECORDING_H */
@@ -0,0 +1,167 @@
+/**
+ * @file
+ *
+ * @brief Host-only reader memory-mapping a recording, such that recordings
+ * far larger than the RAM can be replayed. Only available on the host
+ *
+ * Every raw frame is handed out as a RecordingFrameView pointing directly
+ * into the mapping, and is given to ANALYZE_DATA::convert_recorded_data()
+ * without being copied. Packed and Rice-coded frames are decoded into a
+ * buffer allocated when the recording is opened. No memory is allocated
+ * per frame
+ *
+ * Rice-coded frames vary in size, such that the offset of every frame is
+ * found when the recording is opened
+ *
+ * The mapping is advised as sequential, such that the kernel reads ahead.
+ * The pages behind the current frame are released every
+ * RECORDING_READER_WINDOW bytes, such that the resident memory stays
+ * bounded no matter the size of the recording
+ *
+ * @warning The samples are read as little-endian, which is the byte-order
+ * of both the MCU and x86-64
+ */
+#ifndef ACOUSTICS_RECORDING_READER_H
+#define ACOUSTICS_RECORDING_READER_H
+
+#include "recording.h"
+
+#if !defined(__arm__)
+
+
+/**
+ * @brief A memory-mapped recording
+ *
+ * @param file_descriptor File-descriptor of the recording. -1 if closed
+ *
+ * @param p_data Start of the mapping
+ *
+ * @param size Size of the recording [bytes]
+ *
+ * @param header The header of the recording
+ *
+ * @param frame_size Size of every frame, including its header [bytes]. The
+ * largest size of a frame if the frames are Rice-coded
+ *
+ * @param num_frames Number of complete frames in the recording
+ *
+ * @param next_frame Index of the frame returned by the next call to
+ * RECORDING_READER::next_frame()
+ *
+ * @param released_offset Every page before this offset is released [bytes]
+ *
+ * @param prefetched_offset Every page before this offset has been
+ * prefetched [bytes]
+ *
+ * @param p_frame_offsets Offset of every frame [bytes]. Only used if the
+ * frames are Rice-coded, and nullptr otherwise
+ *
+ * @param p_decoded The frame decoded by RECORDING_READER::next_frame(). Only
+ * used if the frames are encoded, and nullptr otherwise
+ */
+typedef struct{
+  int file_descriptor;
+  const uint8_t* p_data;
+  uint64_t size;
+  RecordingHeader header;
+  uint32_t frame_size;
+  uint64_t num_frames;
+  uint64_t next_frame;
+  uint64_t released_offset;
+  uint64_t prefetched_offset;
+  uint64_t* p_frame_offsets;
+  uint16_t* p_decoded;
+}RecordingReader; /* struct RecordingReader */
+
+
+/**
+ * @brief A frame inside the mapping
+ *
+ * @param header The header of the frame
+ *
+ * @param p_samples The interleaved samples, pointing into the mapping or
+ * the buffer the frame is decoded into. Only valid until the reader is
+ * closed, the frame is released or the buffer is reused
+ */
+typedef struct{
+  RecordingFrameHeader header;
+  const uint16_t* p_samples;
+}RecordingFrameView; /* struct RecordingFrameView */
+
+
+/**
+ * @brief Namespace/wrapper for the memory-mapped reader
+ */
+namespace RECORDING_READER{
+
+
+/**
+ * @brief Opens and maps a recording, and validates its header
+ *
+ * @retval Returns 1 if the recording is mapped and the header is valid.
+ * Nothing is left open otherwise
+ *
+ * @param path Path to the recording
+ *
+ * @param reader The reader to initialize
+ */
+uint8_t open_recording(
+            const char* path,
+            RecordingReader& reader);
+
+
+/**
+ * @brief Gives a view of frame @p index. Does not change the position of
+ * the reader, and can be called from several threads at once
+ *
+ * @retval Returns 0 if @p index is outside the recording, or the frame
+ * could not be decoded
+ *
+ * @param reader An open reader
+ *
+ * @param index Index of the frame
+ *
+ * @param p_decoded Buffer the frame is decoded into if the frames are
+ * encoded. Must hold num_hydrophones * frame_length samples, as given by the
+ * header. Not used for raw frames, and may then be nullptr
+ *
+ * @param view The view of the frame
+ */
+uint8_t get_frame(
+            const RecordingReader& reader,
+            const uint64_t& index,
+            uint16_t* p_decoded,
+            RecordingFrameView& view);
+
+
+/**
+ * @brief Gives a view of the next frame, and releases the pages more than
+ * RECORDING_READER_WINDOW bytes behind it
+ *
+ * @warning Views of frames released are no longer valid. Only the latest
+ * view should be used
+ *
+ * @retval Returns 0 at the end of the recording
+ *
+ * @param reader An open reader
+ *
+ * @param view The view of the frame
+ */
+uint8_t next_frame(
+            RecordingReader& reader,
+            RecordingFrameView& view);
+
+
+/**
+ * @brief Unmaps and closes the recording
+ *
+ * @param reader The reader to close
+ */
+void close_recording(RecordingReader& reader);
+
+
+} /* namespace RECORDING_READER */
+
+#endif /* !__arm__ */
+
+#endif /* ACOUSTICS_RECORDING_READER_H */
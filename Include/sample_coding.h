@@ -0,0 +1,226 @@
+/**
+ * @file
+ *
+ * @brief Lossless encodings of the interleaved ADC-samples, used by the
+ * recordings and the raw stream. The DMA stores every sample as a 16-bit
+ * halfword, of which only the lower ADC_RESOLUTION bits are used
+ *
+ * Three encodings are given
+ *      SAMPLE_ENCODING_RAW:    Every sample as a little-endian uint16_t.
+ *                              2 bytes per sample
+ *      SAMPLE_ENCODING_PACKED: Two 12-bit samples in every 3 bytes, as the
+ *                              little-endian 24-bit word (s_0 | s_1 << 12).
+ *                              A final odd sample is stored in 2 bytes
+ *      SAMPLE_ENCODING_RICE:   Every sample is predicted by the previous
+ *                              sample of the same hydrophone, and the
+ *                              residual is Rice-coded. Variable size
+ *
+ * The Rice-coding splits the samples into blocks of SAMPLE_RICE_BLOCK_LENGTH
+ * samples, each starting with a 5-bit parameter k. The zigzag-mapped
+ * residual z is written as the quotient (z >> k) in unary (ones ended by a
+ * zero) followed by the lower k bits of z. A quotient of at least
+ * SAMPLE_RICE_ESCAPE is written as SAMPLE_RICE_ESCAPE ones followed by z in
+ * 17 bits, and a block with k = SAMPLE_RICE_VERBATIM holds the samples as
+ * they are in 16 bits. A block is therefore never larger than the raw
+ * samples. The bits are written LSB-first
+ *
+ * The packing uses SSE2 on the host. The Cortex-M7 has no vector-unit for
+ * this, and packs a pair of samples from every 32-bit word
+ *
+ * The functions only work on buffers, such that they can be used both on
+ * the MCU and the host
+ */
+#ifndef ACOUSTICS_SAMPLE_CODING_H
+#define ACOUSTICS_SAMPLE_CODING_H
+
+#include <string.h>
+#include <algorithm>
+
+#include "hydrophone_array.h"
+
+/**
+ * @brief Rice-parameter indicating a block stored verbatim
+ */
+#define SAMPLE_RICE_VERBATIM 31u
+
+
+/**
+ * @brief The encodings of the samples
+ */
+typedef enum{
+  SAMPLE_ENCODING_RAW       = 0,        /* Little-endian uint16_t                             */
+  SAMPLE_ENCODING_PACKED    = 1,        /* Two 12-bit samples in 3 bytes                      */
+  SAMPLE_ENCODING_RICE      = 2         /* Predicted and Rice-coded. Variable size            */
+}SAMPLE_ENCODING; /* enum SAMPLE_ENCODING */
+
+
+/**
+ * @brief Namespace/wrapper for the encodings of the samples
+ */
+namespace SAMPLE_CODING{
+
+
+/**
+ * @brief Checks if @p encoding is a known encoding, able to hold samples of
+ * @p adc_resolution bits
+ *
+ * @retval Returns 1 if the encoding is supported
+ *
+ * @param encoding The encoding. See SAMPLE_ENCODING
+ *
+ * @param adc_resolution Number of bits in every sample
+ */
+uint8_t check_encoding(
+            const uint32_t& encoding,
+            const uint32_t& adc_resolution);
+
+
+/**
+ * @brief Calculates the largest number of bytes used to encode
+ * @p num_samples samples. For SAMPLE_ENCODING_RAW and
+ * SAMPLE_ENCODING_PACKED this is the exact size
+ *
+ * @param encoding The encoding. Must be supported
+ *
+ * @param num_samples Number of samples
+ */
+uint32_t get_max_encoded_size(
+            const uint32_t& encoding,
+            const uint32_t& num_samples);
+
+
+/**
+ * @brief Packs the lower 12 bits of every sample, two samples in every 3
+ * bytes
+ *
+ * @retval Returns the number of bytes written
+ *
+ * @param p_samples The samples
+ *
+ * @param num_samples Number of samples
+ *
+ * @param p_packed The packed samples. Must hold
+ * get_max_encoded_size(SAMPLE_ENCODING_PACKED, @p num_samples) bytes
+ */
+uint32_t pack_samples(
+            const uint16_t* p_samples,
+            const uint32_t& num_samples,
+            uint8_t* p_packed);
+
+
+/**
+ * @brief Unpacks samples packed by pack_samples()
+ *
+ * @param p_packed The packed samples
+ *
+ * @param num_samples Number of samples
+ *
+ * @param p_samples The samples. Must hold @p num_samples samples
+ */
+void unpack_samples(
+            const uint8_t* p_packed,
+            const uint32_t& num_samples,
+            uint16_t* p_samples);
+
+
+/**
+ * @brief Rice-codes the interleaved samples of @p num_channels hydrophones
+ *
+ * @retval Returns the number of bytes written
+ *
+ * @param p_samples The interleaved samples
+ *
+ * @param num_samples Number of samples, for all the hydrophones together
+ *
+ * @param num_channels Number of interleaved hydrophones
+ *
+ * @param p_encoded The coded samples. Must hold
+ * get_max_encoded_size(SAMPLE_ENCODING_RICE, @p num_samples) bytes
+ */
+uint32_t encode_rice(
+            const uint16_t* p_samples,
+            const uint32_t& num_samples,
+            const uint32_t& num_channels,
+            uint8_t* p_encoded);
+
+
+/**
+ * @brief Decodes samples coded by encode_rice()
+ *
+ * @retval Returns 1 if the samples are decoded. Returns 0 if the code
+ * ends early, holds a residual outside the 16-bit range, or does not end
+ * within the last byte
+ *
+ * @param p_encoded The coded samples
+ *
+ * @param length Number of bytes in @p p_encoded
+ *
+ * @param num_samples Number of samples, for all the hydrophones together
+ *
+ * @param num_channels Number of interleaved hydrophones
+ *
+ * @param p_samples The interleaved samples. Must hold @p num_samples samples
+ */
+uint8_t decode_rice(
+            const uint8_t* p_encoded,
+            const uint32_t& length,
+            const uint32_t& num_samples,
+            const uint32_t& num_channels,
+            uint16_t* p_samples);
+
+
+/**
+ * @brief Encodes the interleaved samples with any of the encodings
+ *
+ * @retval Returns the number of bytes written. Returns 0 if the encoding
+ * is unknown
+ *
+ * @param encoding The encoding. See SAMPLE_ENCODING
+ *
+ * @param p_samples The interleaved samples
+ *
+ * @param num_samples Number of samples, for all the hydrophones together
+ *
+ * @param num_channels Number of interleaved hydrophones
+ *
+ * @param p_encoded The encoded samples. Must hold get_max_encoded_size()
+ * bytes
+ */
+uint32_t encode_samples(
+            const uint32_t& encoding,
+            const uint16_t* p_samples,
+            const uint32_t& num_samples,
+            const uint32_t& num_channels,
+            uint8_t* p_encoded);
+
+
+/**
+ * @brief Decodes samples encoded by encode_samples()
+ *
+ * @retval Returns 1 if the samples are decoded. Returns 0 if the encoding
+ * is unknown, or @p length does not match the samples
+ *
+ * @param encoding The encoding. See SAMPLE_ENCODING
+ *
+ * @param p_encoded The encoded samples
+ *
+ * @param length Number of bytes in @p p_encoded
+ *
+ * @param num_samples Number of samples, for all the hydrophones together
+ *
+ * @param num_channels Number of interleaved hydrophones
+ *
+ * @param p_samples The interleaved samples. Must hold @p num_samples samples
+ */
+uint8_t decode_samples(
+            const uint32_t& encoding,
+            const uint8_t* p_encoded,
+            const uint32_t& length,
+            const uint32_t& num_samples,
+            const uint32_t& num_channels,
+            uint16_t* p_samples);
+
+
+} /* namespace SAMPLE_CODING */
+
+#endif /* ACOUSTICS_SAMPLE_CODING_H */
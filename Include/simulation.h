@@ -0,0 +1,137 @@
+/**
+ * @file
+ *
+ * @brief Simulator rendering the signal from a pinger as it would be
+ * measured by the hydrophones. The output is given in the same interleaved
+ * 12-bit format as ADC1_converted_values, such that the complete pipeline
+ * (conversion, filter, cross-correlation and solvers) can be run on
+ * synthetic data, either on the MCU or on the host
+ *
+ * The pulse is evaluated at the continuous time each sample is taken, such
+ * that the delays are not rounded to whole samples. Multipath is modelled
+ * by mirroring the source in the surface and the bottom (image-source),
+ * and the noise is white and gaussian
+ */
+#ifndef ACOUSTICS_SIMULATION_H
+#define ACOUSTICS_SIMULATION_H
+
+#include "trilateration.h"
+
+
+/**
+ * @brief Configuration of a simulated ping
+ *
+ * @param source_position Position {x, y, z} of the pinger [m]
+ *
+ * @param pinger_frequency Frequency of the pinger [Hz]
+ *
+ * @param pulse_length Length of the pulse [s]
+ *
+ * @param pulse_start Time the direct path reaches the reference hydrophone,
+ * relative to the first sample of the frame [s]. The travel-time before the
+ * frame is not simulated, as the frame is started by the ping
+ *
+ * @param amplitude Amplitude of the direct path at the hydrophones [ADC]
+ *
+ * @param noise_std Standard deviation of the white noise [ADC]
+ *
+ * @param surface_z z-position of the surface [m]
+ *
+ * @param surface_reflection Reflection-coefficient of the surface. Set to
+ * 0 to disable the reflection. Usually negative
+ *
+ * @param bottom_z z-position of the bottom [m]
+ *
+ * @param bottom_reflection Reflection-coefficient of the bottom. Set to 0
+ * to disable the reflection
+ *
+ * @param seed Seed of the noise. Equal seeds give equal noise
+ */
+typedef struct{
+  float32_t source_position[3];
+  float32_t pinger_frequency;
+  float32_t pulse_length;
+  float32_t pulse_start;
+  float32_t amplitude;
+  float32_t noise_std;
+  float32_t surface_z;
+  float32_t surface_reflection;
+  float32_t bottom_z;
+  float32_t bottom_reflection;
+  uint32_t seed;
+}SimulationConfig; /* struct SimulationConfig */
+
+
+/**
+ * @brief Namespace/wrapper for the simulator
+ */
+namespace SIMULATION{
+
+
+/**
+ * @brief Creates a configuration with the source-position given in
+ * TEST_PARAMETERS, and the waveform given by the SIM_-parameters. Multipath
+ * is disabled
+ *
+ * @param config The configuration to fill
+ */
+void get_default_config(SimulationConfig& config);
+
+
+/**
+ * @brief Renders one frame from @p N hydrophones, interleaved after the
+ * ADC-rank as transferred by the DMA
+ *      {h_0, h_1, ..., h_(N-1), h_0, h_1, ... }
+ *
+ * Each sample is rounded and clamped to [0, ADC_MAX_VALUE], with a silent
+ * hydrophone at ADC_MID_VALUE
+ *
+ * @param config The simulated ping
+ *
+ * @param positions Position {x, y, z} of each hydrophone [m]
+ *
+ * @param p_adc_data The rendered frame. Must hold @p N * DMA_BUFFER_LENGTH
+ * samples
+ */
+template<uint32_t N>
+void render_adc_data(
+            const SimulationConfig& config,
+            const float32_t (&positions)[N][3],
+            uint16_t* p_adc_data);
+
+
+/**
+ * @brief Calculates the exact lag of the direct path for every
+ * hydrophone-pair, with the same sign as
+ * ANALYZE_DATA::calculate_xcorr_lag_array()
+ *
+ * @param config The simulated ping
+ *
+ * @param positions Position {x, y, z} of each hydrophone [m]
+ *
+ * @param lag_array The fractional lag of each pair [samples]
+ */
+template<uint32_t N>
+void calculate_expected_lags(
+            const SimulationConfig& config,
+            const float32_t (&positions)[N][3],
+            float32_t (&lag_array)[HydrophonePairs<N>::count]);
+
+
+/**
+ * @brief Renders one frame with the positions given in
+ * HYDROPHONE_POSITIONS. See render_adc_data()
+ *
+ * @param config The simulated ping
+ *
+ * @param p_adc_data The rendered frame. Must hold
+ * NUM_HYDROPHONES * DMA_BUFFER_LENGTH samples
+ */
+void render_ping(
+            const SimulationConfig& config,
+            uint16_t* p_adc_data);
+
+
+} /* namespace SIMULATION */
+
+#endif /* ACOUSTICS_SIMULATION_H */
@@ -0,0 +1,334 @@
+/**
+ * @file
+ *
+ * @brief Binary telemetry sent to the Xavier over UDP. Every processed
+ * frame gives a fixed-size TelemetryRecord holding the lags, the bearing,
+ * the position, the tracked position and the time spent in each stage
+ *
+ * The records are batched, and TELEMETRY_BATCH_SIZE records are sent in
+ * every packet, such that the overhead of the Ethernet, IPv4 and UDP
+ * headers is shared. A packet is a TelemetryPacketHeader followed by
+ * num_records records, all stored little-endian
+ *      {header, record_0, record_1, ..., record_(num_records - 1)}
+ *
+ * The format is versioned by TELEMETRY_VERSION. The header holds the size
+ * of every record, such that fields appended to the end of the record in a
+ * later version are skipped by an older decoder. The packet is protected
+ * by the UDP-checksum, which is inserted by the MAC
+ *
+ * The functions only work on buffers, such that the encoder is used on the
+ * MCU and the decoder on the host. The transport is given by
+ * TELEMETRY_TRANSPORT in telemetry_transport.h
+ */
+#ifndef ACOUSTICS_TELEMETRY_H
+#define ACOUSTICS_TELEMETRY_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "hydrophone_array.h"
+#include "profiling.h"
+
+/**
+ * @brief Number of hydrophone-pairs with MAX_NUM_HYDROPHONES hydrophones,
+ * such that the record has the same size for every array
+ */
+#define TELEMETRY_MAX_NUM_PAIRS (MAX_NUM_HYDROPHONES * (MAX_NUM_HYDROPHONES - 1) / 2)
+
+/**
+ * @brief Size of the Ethernet-, IPv4- and UDP-headers in front of the
+ * packet in every frame [bytes]
+ */
+#define TELEMETRY_FRAME_HEADER_SIZE 42u
+
+
+/**
+ * @brief Flags given in every record
+ */
+typedef enum{
+  TELEMETRY_VALID_LAGS      = 1u << 0,  /* The lags passed the validation                     */
+  TELEMETRY_VALID_POSITION  = 1u << 1,  /* position holds a new estimate                      */
+  TELEMETRY_VALID_BEARING   = 1u << 2,  /* bearing and elevation hold a new estimate          */
+  TELEMETRY_FAR_FIELD       = 1u << 3,  /* Solved by the far-field solver                     */
+  TELEMETRY_LOOKUP_TABLE    = 1u << 4,  /* Solved by the lookup-table                         */
+  TELEMETRY_VALID_TRACKER   = 1u << 5   /* tracked_position and tracked_variance are valid    */
+}TELEMETRY_FLAGS; /* enum TELEMETRY_FLAGS */
+
+
+/**
+ * @brief The estimate from a single frame
+ *
+ * @param sequence Sequence-number of the frame. Increased by one for every
+ * processed frame, such that dropped frames and packets are detected
+ *
+ * @param flags Combination of TELEMETRY_FLAGS
+ *
+ * @param timestamp Time the frame was captured, after startup [us]
+ *
+ * @param lags Lag of every hydrophone-pair, ordered as in
+ * hydrophone_array.h. The unused entries are 0 [samples]
+ *
+ * @param bearing Bearing to the pinger, clockwise from the bow [deg]
+ *
+ * @param elevation Elevation of the pinger. Estimated by the far-field
+ * solver, or derived from the position, with four or more hydrophones.
+ * Otherwise 0 [deg]
+ *
+ * @param position Estimated position {x, y, z} [m]
+ *
+ * @param tracked_position Position {x, y} of the tracker [m]
+ *
+ * @param tracked_variance Variance {var_x, var_y} of the tracker [m^2]
+ *
+ * @param num_errors Number of errors logged since startup
+ *
+ * @param stage_us Time spent in each stage, indexed by PROFILING_STAGES.
+ * STAGE_TRANSMIT and STAGE_FRAME are from the previous frame, as the
+ * record is created before they end [us]
+ */
+typedef struct{
+  uint32_t sequence;
+  uint32_t flags;
+  uint64_t timestamp;
+  int32_t lags[TELEMETRY_MAX_NUM_PAIRS];
+  float32_t bearing;
+  float32_t elevation;
+  float32_t position[3];
+  float32_t tracked_position[2];
+  float32_t tracked_variance[2];
+  uint32_t num_errors;
+  uint32_t stage_us[NUM_PROFILING_STAGES];
+}TelemetryRecord; /* struct TelemetryRecord */
+
+static_assert(sizeof(TelemetryRecord) == 128,
+        "TelemetryRecord must not contain any padding. Increase TELEMETRY_VERSION "
+        "if the record is changed");
+
+
+/**
+ * @brief Header at the start of every packet
+ *
+ * @param magic Always TELEMETRY_MAGIC
+ *
+ * @param version Always TELEMETRY_VERSION
+ *
+ * @param record_size Size of every record [bytes]
+ *
+ * @param sequence Sequence-number of the packet
+ *
+ * @param num_records Number of records following the header
+ *
+ * @param num_hydrophones Number of hydrophones, which gives the number of
+ * used lags in every record
+ */
+typedef struct{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t sequence;
+  uint16_t num_records;
+  uint16_t num_hydrophones;
+}TelemetryPacketHeader; /* struct TelemetryPacketHeader */
+
+static_assert(sizeof(TelemetryPacketHeader) == 16,
+        "TelemetryPacketHeader must not contain any padding");
+
+
+/**
+ * @brief Records waiting to be sent
+ *
+ * @param sequence Sequence-number of the next packet
+ *
+ * @param num_records Number of records in @p records
+ *
+ * @param records The records of the next packet
+ */
+typedef struct{
+  uint32_t sequence;
+  uint32_t num_records;
+  TelemetryRecord records[TELEMETRY_BATCH_SIZE];
+}TelemetryBatch; /* struct TelemetryBatch */
+
+
+/**
+ * @brief Size of the largest packet [bytes]
+ */
+#define TELEMETRY_MAX_PACKET_SIZE \
+        (sizeof(TelemetryPacketHeader) + TELEMETRY_BATCH_SIZE * sizeof(TelemetryRecord))
+
+
+/**
+ * @brief Namespace/wrapper for the telemetry
+ */
+namespace TELEMETRY{
+
+
+/**
+ * @brief Empties the batch, and starts the sequence-numbers at 0
+ *
+ * @param batch The batch
+ */
+void initialize_batch(TelemetryBatch& batch);
+
+
+/**
+ * @brief Clears a record, and fills the sequence-number, the timestamp and
+ * the latest duration of every stage from PROFILING::stage_profiles
+ *
+ * @param sequence Sequence-number of the frame
+ *
+ * @param timestamp Time the frame was captured [us]
+ *
+ * @param record The record to fill
+ */
+void initialize_record(
+            const uint32_t& sequence,
+            const uint64_t& timestamp,
+            TelemetryRecord& record);
+
+
+/**
+ * @brief Copies the lags into a record
+ *
+ * @param p_lag_array Array containing pointers to the lags, ordered as in
+ * hydrophone_array.h
+ *
+ * @param record The record
+ */
+void set_lags(
+            uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+            TelemetryRecord& record);
+
+
+/**
+ * @brief Adds a record to the batch
+ *
+ * @retval Returns 1 if the batch is full, and should be written with
+ * write_packet() before the next record is added
+ *
+ * @param record The record
+ *
+ * @param batch The batch. Must not be full
+ */
+uint8_t add_record(
+            const TelemetryRecord& record,
+            TelemetryBatch& batch);
+
+
+/**
+ * @brief Writes the records in the batch as a packet, and empties the batch
+ *
+ * @retval Returns the number of bytes written. Returns 0 if the batch is
+ * empty
+ *
+ * @param batch The batch
+ *
+ * @param p_packet The packet to write. Must hold TELEMETRY_MAX_PACKET_SIZE
+ * bytes
+ */
+uint32_t write_packet(
+            TelemetryBatch& batch,
+            uint8_t* p_packet);
+
+
+/**
+ * @brief Reads and validates a packet
+ *
+ * @retval Returns 1 if the packet is valid. Returns 0 if the magic or
+ * version is wrong, the records are smaller than in this version or there
+ * are more than @p max_num_records records, or the length does not match
+ *
+ * @param data The packet
+ *
+ * @param length Number of bytes in @p data
+ *
+ * @param header The header read from @p data
+ *
+ * @param records The records read from @p data. Must hold
+ * @p max_num_records records
+ *
+ * @param max_num_records Max number of records to read
+ */
+uint8_t parse_packet(
+            const uint8_t* data,
+            const uint32_t& length,
+            TelemetryPacketHeader& header,
+            TelemetryRecord* records,
+            const uint32_t& max_num_records);
+
+
+/**
+ * @brief Writes the Ethernet-, IPv4- and UDP-headers in front of a packet,
+ * such that the frame is given directly to the MAC. The addresses and the
+ * source-port are given by TELEMETRY_SETUP in parameters.h
+ *
+ * The IPv4-checksum is calculated, while the UDP-checksum is left as 0 for
+ * the MAC to insert
+ *
+ * @retval Returns the length of the frame [bytes]
+ *
+ * @param p_source_mac MAC-address of the MCU. Holds 6 bytes
+ *
+ * @param identification Identification of the IPv4-datagram
+ *
+ * @param destination_port UDP-port sent to
+ *
+ * @param payload_length Length of the packet following the headers [bytes]
+ *
+ * @param p_frame The frame. The packet follows at 
+ * p_frame + TELEMETRY_FRAME_HEADER_SIZE, or in a separate buffer gathered
+ * by the DMA
+ */
+uint32_t write_frame_header(
+            const uint8_t* p_source_mac,
+            const uint16_t& identification,
+            const uint16_t& destination_port,
+            const uint32_t& payload_length,
+            uint8_t* p_frame);
+
+
+/**
+ * @brief Reads the Ethernet-, IPv4- and UDP-headers of a received frame,
+ * and finds the payload of a datagram sent to @p destination_port on
+ * TELEMETRY_SOURCE_IP or the broadcast-address
+ *
+ * The checksums are checked by the MAC, which flags the frame as an error
+ *
+ * @retval Returns 1 if the frame holds such a datagram. Returns 0 if it is
+ * not IPv4/UDP, is fragmented, is sent to another address or port, or is
+ * truncated
+ *
+ * @param p_frame The frame, starting at the Ethernet-header
+ *
+ * @param frame_length Length of the frame, without the CRC [bytes]
+ *
+ * @param destination_port UDP-port listened to
+ *
+ * @param p_payload Start of the payload within @p p_frame
+ *
+ * @param payload_length Length of the payload [bytes]
+ */
+uint8_t parse_frame_header(
+            const uint8_t* p_frame,
+            const uint32_t& frame_length,
+            const uint16_t& destination_port,
+            const uint8_t*& p_payload,
+            uint32_t& payload_length);
+
+
+/**
+ * @brief Calculates the IPv4-checksum (the ones-complement of the
+ * ones-complement sum of the 16-bit words) of @p length bytes
+ *
+ * @param data The bytes
+ *
+ * @param length Number of bytes. Must be even
+ */
+uint16_t calculate_ip_checksum(
+            const uint8_t* data,
+            const uint32_t& length);
+
+
+} /* namespace TELEMETRY */
+
+#endif /* ACOUSTICS_TELEMETRY_H */
@@ -0,0 +1,189 @@
+/**
+ * @file
+ *
+ * @brief Transport of the telemetry-packets given by telemetry.h, of the
+ * raw frames given by raw_stream.h, of the trace-dumps given by trace.h,
+ * and of the commands and replies given by command.h
+ *
+ * On the MCU the packets are sent directly with the DMA-descriptors of the
+ * ETH-peripheral, and no IP-stack is needed. The Tx-descriptors are used as
+ * a ring, where every descriptor sends a single Ethernet-frame gathered
+ * from two buffers
+ *      buffer 1: the Ethernet-, IPv4- and UDP-headers, and the header of
+ *                the raw stream or the trace. Owned by the descriptor
+ *      buffer 2: the telemetry-packet, the samples of a raw frame read
+ *                directly from the DMA-buffer of the ADC, or the records of
+ *                a copy of the trace
+ * such that the samples are never copied, unless RAW_STREAM_PACKED packs
+ * them into a buffer of every packet. A packet is dropped if the
+ * descriptors are still owned by the DMA, such that the main-loop never
+ * waits for the link
+ *
+ * The commands are read from the Rx-descriptors when polled, and every
+ * other frame is released at once
+ *
+ * On the host the same packets are sent over UDP-sockets to the loopback
+ * address, such that the encoders and the receivers can be tested and
+ * benchmarked without the hardware
+ *
+ * @warning The D-cache is not enabled in main.cpp. The descriptors and the
+ * buffers must be placed in non-cacheable memory if it is
+ */
+#ifndef ACOUSTICS_TELEMETRY_TRANSPORT_H
+#define ACOUSTICS_TELEMETRY_TRANSPORT_H
+
+#include "command.h"
+#include "raw_stream.h"
+#include "telemetry.h"
+#include "trace.h"
+
+
+/**
+ * @brief Number of packets and frames sent and dropped since the transport
+ * was initialized
+ *
+ * @param num_telemetry_sent Number of telemetry-packets sent
+ *
+ * @param num_telemetry_dropped Number of telemetry-packets dropped
+ *
+ * @param num_raw_sent Number of raw frames sent
+ *
+ * @param num_raw_dropped Number of raw frames dropped
+ */
+typedef struct{
+  uint32_t num_telemetry_sent;
+  uint32_t num_telemetry_dropped;
+  uint32_t num_raw_sent;
+  uint32_t num_raw_dropped;
+}TransportStatistics; /* struct TransportStatistics */
+
+
+/**
+ * @brief Namespace/wrapper for the transport of the telemetry
+ */
+namespace TELEMETRY_TRANSPORT{
+
+
+/**
+ * @brief Initializes the transport. On the MCU the Tx-ring and the
+ * Rx-descriptors are initialized and the ETH-peripheral started, which
+ * requires that HAL_ETH_Init() has been called. On the host the sockets
+ * are opened towards TELEMETRY_DEST_PORT, RAW_STREAM_DEST_PORT,
+ * TRACE_DEST_PORT and COMMAND_REPLY_PORT on the loopback address, and
+ * COMMAND_PORT is listened to
+ *
+ * @retval Returns 1 if the transport is ready
+ */
+uint8_t initialize_transport();
+
+
+/**
+ * @brief Closes the transport. Only does something on the host
+ */
+void close_transport();
+
+
+/**
+ * @brief Sends the records in the batch as a single packet, and empties the
+ * batch. The batch is emptied even if it is dropped, such that the
+ * receiver detects the lost packet from the sequence-number
+ *
+ * @retval Returns 1 if the packet is sent. Returns 0 if the batch is empty,
+ * no Tx-descriptor is free or the send failed
+ *
+ * @param batch The batch
+ */
+uint8_t send_batch(TelemetryBatch& batch);
+
+
+/**
+ * @brief Sends a raw frame as RAW_STREAM_PACKETS_PER_FRAME packets. The
+ * samples are read by the DMA of the ETH-peripheral after the function
+ * returns, and @p p_adc_data must not be overwritten before
+ * check_raw_frame_sent() returns 1
+ *
+ * The frame is dropped as a whole if there are not enough free descriptors,
+ * or with RAW_STREAM_PACKED if the packed samples of the last frame are
+ * not yet sent
+ *
+ * @retval Returns 1 if every packet is queued
+ *
+ * @param p_adc_data The interleaved data from the DMA. Holds
+ * NUM_HYDROPHONES * DMA_BUFFER_LENGTH samples
+ *
+ * @param sequence Sequence-number of the frame
+ *
+ * @param timestamp Time the frame was captured [us]
+ */
+uint8_t send_raw_frame(
+            const volatile uint16_t* p_adc_data,
+            const uint32_t& sequence,
+            const uint64_t& timestamp);
+
+
+/**
+ * @brief Checks if every packet of the last raw frame has been sent, such
+ * that its buffer can be reused. Always 1 on the host
+ *
+ * @retval Returns 1 if no descriptor reads from the buffer
+ */
+uint8_t check_raw_frame_sent();
+
+
+/**
+ * @brief Copies the trace, and sends the copy as TRACE_PACKETS_PER_DUMP
+ * packets. The events are still traced while the copy is sent. Does
+ * nothing if USE_TRACE is not set
+ *
+ * @retval Returns 1 if every packet is queued. Returns 0 if there are not
+ * enough free descriptors, or the last dump is not yet sent, such that the
+ * caller should try again later
+ */
+uint8_t send_trace();
+
+
+/**
+ * @brief Receives the next command sent to COMMAND_PORT, without waiting.
+ * Every other frame received before it is released
+ *
+ * @retval Returns 1 if a command is received
+ *
+ * @param p_command The command, copied from the frame
+ *
+ * @param max_length Size of @p p_command. Longer commands are dropped
+ *
+ * @param length Length of the command [bytes]
+ */
+uint8_t receive_command(
+            uint8_t* p_command,
+            const uint32_t& max_length,
+            uint32_t& length);
+
+
+/**
+ * @brief Sends a reply to COMMAND_REPLY_PORT. The reply is copied, such
+ * that @p p_reply can be reused at once
+ *
+ * @retval Returns 1 if the reply is queued. Returns 0 if it is longer than
+ * COMMAND_MAX_PACKET_SIZE, or no Tx-descriptor or buffer is free
+ *
+ * @param p_reply The reply
+ *
+ * @param length Length of the reply [bytes]
+ */
+uint8_t send_reply(
+            const uint8_t* p_reply,
+            const uint32_t& length);
+
+
+/**
+ * @brief The number of packets and frames sent and dropped
+ *
+ * @param statistics The statistics
+ */
+void get_statistics(TransportStatistics& statistics);
+
+
+} /* namespace TELEMETRY_TRANSPORT */
+
+#endif /* ACOUSTICS_TELEMETRY_TRANSPORT_H */
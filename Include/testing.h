@@ -34,7 +34,7 @@
    * hydrophones. Returns the calculated TOA indirectly via @p lag_array
    * 
    * The TOA is calculated based on the following parameters:
-   *    @p HYD_xxx_POS   
+   *    @p HYDROPHONE_POSITIONS
    *    @p SOURCE_POS
    *    @p SOUND_SPEED
    *    @p SAMPLE_FREQUENCY
@@ -42,7 +42,7 @@
    * 
    * @param lag_array An array giving the time the sound will be detected
    * by the hydrophones. The array expands to
-   *    @p lag_array = { lag_port, lag_starboard, lag_stern }
+   *    @p lag_array = { lag_port, lag_starboard, lag_stern, ... }
    * 
    * @param bool_valid_parameters An int describing if the parameters
    * given in parameters.h are valid.
@@ -59,6 +59,22 @@
    */
   void test_trilateration_algorithm();
 
+  /**
+   * @brief Function that compares the cost and accuracy of the linear 
+   * solver and the warm-started iterative solver
+   * 
+   * The pinger is moved along a circle around the AUV, and the lags are 
+   * calculated for each position. Each frame is solved by 
+   *    1. TRILATERATION::trilaterate_pinger_position
+   *    2. TRILATERATION::refine_pinger_position, started from the previous frame
+   * 
+   * Writes the average and maximum time per solve, the average number 
+   * of iterations and the average error to the terminal
+   * 
+   * @param num_frames Number of frames to solve
+   */
+  void benchmark_trilateration_solvers(const uint32_t& num_frames);
+
   } /* namespace TESTING */
 
 #endif /* CURR_TESTING_BOOL */
@@ -0,0 +1,109 @@
+/**
+ * @file
+ *
+ * @brief Functions to measure the time spent in parts of the code. On the
+ * MCU the DWT cycle-counter is used, such that a measurement only costs a
+ * single register read. On the host std::chrono::steady_clock is used
+ *
+ * A tick is one CPU cycle on the MCU, and one nanosecond on the host.
+ * Measurements are given as the difference between two calls to
+ * TIMING::get_ticks(), which is valid across a wrap of the counter as
+ * long as the measured interval is shorter than 2^32 ticks
+ */
+#ifndef ACOUSTICS_TIMING_H
+#define ACOUSTICS_TIMING_H
+
+#include <algorithm>
+
+#include "parameters.h"
+
+#if defined(__arm__)
+  #include "stm32f7xx.h"
+#else
+  #include <chrono>
+#endif /* __arm__ */
+
+
+/**
+ * @brief Statistics for a repeatedly measured part of the code
+ *
+ * @param last_ticks Duration of the latest measurement [ticks]
+ *
+ * @param min_ticks Shortest measured duration [ticks]
+ *
+ * @param max_ticks Longest measured duration [ticks]
+ *
+ * @param total_ticks Sum of every measured duration [ticks]
+ *
+ * @param num_measurements Number of measurements
+ */
+typedef struct{
+  uint32_t last_ticks;
+  uint32_t min_ticks;
+  uint32_t max_ticks;
+  uint64_t total_ticks;
+  uint32_t num_measurements;
+}TimingStatistics; /* struct TimingStatistics */
+
+
+/**
+ * @brief Namespace/wrapper for the timing
+ */
+namespace TIMING{
+
+
+/**
+ * @brief Enables the cycle-counter. Must be called once during startup
+ * on the MCU. Does nothing on the host
+ */
+void initialize_timing();
+
+
+/**
+ * @brief Returns the current value of the tick-counter
+ */
+inline uint32_t get_ticks(){
+#if defined(__arm__)
+  return DWT->CYCCNT;
+#else
+  return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif /* __arm__ */
+}
+
+
+/**
+ * @brief Converts a number of ticks to microseconds
+ *
+ * @param ticks The number of ticks
+ */
+float32_t ticks_to_us(const uint64_t& ticks);
+
+
+/**
+ * @brief Resets @p statistics
+ *
+ * @param statistics The statistics to reset
+ */
+void reset_statistics(TimingStatistics& statistics);
+
+
+/**
+ * @brief Adds the measurement between @p start_ticks and the current
+ * tick-count to @p statistics
+ *
+ * @retval Returns the duration of the measurement [ticks]
+ *
+ * @param statistics The statistics to update
+ *
+ * @param start_ticks Tick-count at the start of the measurement, given
+ * by TIMING::get_ticks()
+ */
+uint32_t update_statistics(
+            TimingStatistics& statistics,
+            const uint32_t& start_ticks);
+
+
+} /* namespace TIMING */
+
+#endif /* ACOUSTICS_TIMING_H */
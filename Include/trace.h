@@ -0,0 +1,250 @@
+/**
+ * @file
+ *
+ * @brief Compact binary trace of the events in the system, such that the
+ * DMA-completions, the stages of the main-loop, the errors and the dropped
+ * packets are seen on a single time-axis when diagnosing missed pings
+ *
+ * Every event is a TraceRecord of 8 bytes, with an ID given at
+ * compile-time by TRACE_EVENTS. The records are written to a ring of
+ * TRACE_LENGTH records in RAM, where the oldest record is overwritten. A
+ * slot is reserved by atomically incrementing the number of events, such
+ * that the trace can be written from interrupts. An event costs a read of
+ * the cycle-counter, the increment and a store of the record
+ *
+ * The ring is held by TRACE::trace_buffer together with a TraceHeader, such
+ * that the buffer is a complete trace-dump. The dump can be read by the
+ * debugger
+ *      (gdb) dump binary value trace.bin TRACE::trace_buffer
+ * or be sent over UDP with TELEMETRY_TRANSPORT::send_trace(), which splits
+ * the dump into TRACE_PACKETS_PER_DUMP packets. Every packet is a
+ * TraceHeader followed by the records of the slots
+ *      {first_slot, first_slot + 1, ..., first_slot + num_records - 1}
+ * The dump is converted to a Chrome/Perfetto timeline by
+ * Tools/trace_decoder.cpp
+ *
+ * Usage:
+ *      TRACE::trace_event(TRACE_EVENTS::TRACE_DMA_COMPLETE, dma_buffer_idx);
+ *
+ * The stages of the main-loop are traced by PROFILING::record_stage()
+ *
+ * @note The timestamps are given by TIMING::get_ticks(), which wraps after
+ * 2^32 ticks. The decoder unwraps them from the difference between
+ * consecutive records, such that the trace must not be silent for more than
+ * 2^31 ticks (about 10 s on the MCU)
+ */
+#ifndef ACOUSTICS_TRACE_H
+#define ACOUSTICS_TRACE_H
+
+#include <string.h>
+
+#include "timing.h"
+
+static_assert((TRACE_LENGTH & (TRACE_LENGTH - 1)) == 0 && TRACE_LENGTH > 0,
+        "TRACE_LENGTH must be a power of two");
+
+/**
+ * @brief Number of packets needed for every trace-dump
+ */
+#define TRACE_PACKETS_PER_DUMP \
+        ((TRACE_LENGTH + TRACE_PACKET_RECORDS - 1) / TRACE_PACKET_RECORDS)
+
+
+/**
+ * @brief The events in the trace. The meaning of the argument is given for
+ * every event
+ */
+typedef enum{
+  TRACE_STAGE_BEGIN,          /* Stage started. Argument is PROFILING_STAGES          */
+  TRACE_STAGE_END,            /* Stage finished. Argument is PROFILING_STAGES         */
+  TRACE_DMA_COMPLETE,         /* DMA finished a frame. Argument is the buffer-index   */
+  TRACE_ERROR,                /* Error logged. Argument is ERROR_TYPES                */
+  TRACE_RAW_DROPPED,          /* Raw frame dropped. Argument is the sequence-number   */
+  TRACE_TELEMETRY_DROPPED,    /* Telemetry-packet dropped. Argument is the sequence   */
+  TRACE_MARKER,               /* Marker used while debugging. Argument is free        */
+  NUM_TRACE_EVENTS
+}TRACE_EVENTS; /* enum TRACE_EVENTS */
+
+
+/**
+ * @brief A single event in the trace
+ *
+ * @param timestamp Time of the event. See TIMING::get_ticks() [ticks]
+ *
+ * @param id The event. See TRACE_EVENTS
+ *
+ * @param arg Argument of the event. The lower 16 bits if wider
+ */
+typedef struct{
+  uint32_t timestamp;
+  uint16_t id;
+  uint16_t arg;
+}TraceRecord; /* struct TraceRecord */
+
+static_assert(sizeof(TraceRecord) == 8, "TraceRecord must not contain any padding");
+
+
+/**
+ * @brief Header of a trace-dump, and of every packet of it
+ *
+ * @param magic Always TRACE_MAGIC
+ *
+ * @param version Always TRACE_VERSION
+ *
+ * @param record_size Size of a TraceRecord [bytes]
+ *
+ * @param ticks_per_us Number of ticks every microsecond
+ *
+ * @param length Number of records in the ring. Always a power of two
+ *
+ * @param num_events Number of events traced since startup. The event with
+ * index i is held by the slot i % length
+ *
+ * @param first_slot Slot of the first record following the header
+ *
+ * @param num_records Number of records following the header
+ */
+typedef struct{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t ticks_per_us;
+  uint32_t length;
+  uint32_t num_events;
+  uint32_t first_slot;
+  uint32_t num_records;
+}TraceHeader; /* struct TraceHeader */
+
+static_assert(sizeof(TraceHeader) == 28, "TraceHeader must not contain any padding");
+
+static_assert(sizeof(TraceHeader) + TRACE_PACKET_RECORDS * sizeof(TraceRecord) <= 1472u,
+        "A packet must fit in a single Ethernet-frame without fragmentation");
+
+
+/**
+ * @brief The trace as it is kept in RAM, which is also a complete dump
+ *
+ * @param header The header, where num_events is updated by every event
+ *
+ * @param records The ring of records
+ */
+typedef struct{
+  TraceHeader header;
+  TraceRecord records[TRACE_LENGTH];
+}TraceBuffer; /* struct TraceBuffer */
+
+
+/**
+ * @brief Namespace/wrapper for the trace
+ */
+namespace TRACE{
+
+
+/**
+ * @brief The trace. Read by the debugger, or sent with
+ * TELEMETRY_TRANSPORT::send_trace()
+ */
+extern TraceBuffer trace_buffer;
+
+
+/**
+ * @brief Name of every event, indexed by TRACE_EVENTS
+ */
+extern const char* const event_names[NUM_TRACE_EVENTS];
+
+
+/**
+ * @brief Clears the trace, and sets the tick-rate of the header. Must be
+ * called once during startup, after the system-clock is configured
+ */
+void initialize_trace();
+
+
+/**
+ * @brief Adds an event with a given timestamp to the trace. Lock-free, and
+ * safe to call from interrupts. Does nothing if USE_TRACE is not set
+ *
+ * @param id The event
+ *
+ * @param arg Argument of the event. Only the lower 16 bits are kept
+ *
+ * @param timestamp Time of the event [ticks]
+ */
+inline void trace_event_at(
+            const TRACE_EVENTS& id,
+            const uint32_t& arg,
+            const uint32_t& timestamp){
+#if USE_TRACE
+  const uint32_t index = __atomic_fetch_add(&trace_buffer.header.num_events, 1u, __ATOMIC_RELAXED);
+  TraceRecord& record = trace_buffer.records[index & (TRACE_LENGTH - 1u)];
+  record.timestamp = timestamp;
+  record.id = (uint16_t) id;
+  record.arg = (uint16_t) arg;
+#endif /* USE_TRACE */
+}
+
+
+/**
+ * @brief Adds an event at the current time to the trace. Lock-free, and
+ * safe to call from interrupts. Does nothing if USE_TRACE is not set
+ *
+ * @param id The event
+ *
+ * @param arg Argument of the event. Only the lower 16 bits are kept
+ */
+inline void trace_event(
+            const TRACE_EVENTS& id,
+            const uint32_t& arg){
+#if USE_TRACE
+  TRACE::trace_event_at(id, arg, TIMING::get_ticks());
+#endif /* USE_TRACE */
+}
+
+
+/**
+ * @brief Copies the trace, such that it can be sent while new events are
+ * traced. An event traced by an interrupt during the copy may be torn
+ *
+ * @param snapshot The copy
+ */
+void copy_trace(TraceBuffer& snapshot);
+
+
+/**
+ * @brief Creates the header of a packet of the dump @p dump
+ *
+ * @param dump The dump being sent
+ *
+ * @param packet_index Index of the packet. Must be less than
+ * TRACE_PACKETS_PER_DUMP
+ *
+ * @param header The header to fill
+ */
+void create_packet_header(
+            const TraceBuffer& dump,
+            const uint32_t& packet_index,
+            TraceHeader& header);
+
+
+/**
+ * @brief Reads and validates the header of a packet, or of a complete dump
+ *
+ * @retval Returns 1 if the header is valid. Returns 0 if the magic, version
+ * or record-size is wrong, the records are not within the ring, or
+ * @p length is too short for the records
+ *
+ * @param data The packet or dump
+ *
+ * @param length Number of bytes in @p data
+ *
+ * @param header The header read from @p data
+ */
+uint8_t parse_header(
+            const uint8_t* data,
+            const uint64_t& length,
+            TraceHeader& header);
+
+
+} /* namespace TRACE */
+
+#endif /* ACOUSTICS_TRACE_H */
@@ -0,0 +1,127 @@
+/**
+ * @file
+ *
+ * @brief Recursive filter tracking the position of the acoustic pinger
+ * across frames. Each frame's estimate is fused with the previous ones,
+ * such that shorter frames can be used at a higher rate while still
+ * giving a stable output
+ *
+ * The tracker is a Kalman-filter with a constant-velocity model, using the
+ * estimated position from the trilateration as measurement. As the model and
+ * the measurement noise are independent in x and y, each axis is filtered
+ * separately with a 2x2 covariance. Every update is therefore O(1)
+ */
+#ifndef ACOUSTICS_TRACKING_H
+#define ACOUSTICS_TRACKING_H
+
+#include "parameters.h"
+
+/**
+ * @brief State of the tracker
+ *
+ * @param position Filtered position {x, y} [m]
+ *
+ * @param velocity Filtered velocity {v_x, v_y} [m/s]
+ *
+ * @param covariance Covariance for each axis, given as
+ *      { P_pos_pos, P_pos_vel, P_vel_vel }
+ *
+ * @param num_updates Number of accepted measurements
+ *
+ * @param num_rejected Number of consecutive measurements rejected by the gate
+ *
+ * @param bool_initialized 1 when the tracker has received its first measurement
+ */
+typedef struct{
+  float32_t position[2];
+  float32_t velocity[2];
+  float32_t covariance[2][3];
+  uint32_t num_updates;
+  uint32_t num_rejected;
+  uint8_t bool_initialized;
+}TrackerState; /* struct TrackerState */
+
+
+/**
+ * @brief Namespace/wrapper for the tracking
+ */
+namespace TRACKING{
+
+
+/**
+ * @brief Resets the tracker. The next measurement initializes the state
+ *
+ * @param tracker The tracker to reset
+ */
+void initialize_tracker(TrackerState& tracker);
+
+
+/**
+ * @brief Propagates the state @p time_step seconds forward without any
+ * measurement. Used by the main-loop for every frame that is discarded or
+ * gives no position, such that the uncertainty grows while the pinger is
+ * not heard
+ *
+ * @param tracker The tracker to propagate
+ *
+ * @param time_step Time since the last prediction [s]
+ */
+void predict_tracker(
+            TrackerState& tracker,
+            const float32_t& time_step);
+
+
+/**
+ * @brief Propagates the state and fuses a new position-measurement
+ *
+ * The measurement is rejected if the normalized innovation exceeds
+ * TRACKING_GATE. After TRACKING_MAX_REJECTS consecutive rejections the
+ * tracker is reset to the measurement, as the pinger has most likely moved
+ *
+ * @retval Returns 1 if the measurement was used, and 0 if it was rejected
+ *
+ * @param tracker The tracker to update
+ *
+ * @param x_measured Estimated x-position from the trilateration [m]
+ *
+ * @param y_measured Estimated y-position from the trilateration [m]
+ *
+ * @param time_step Time since the last update/prediction [s]
+ */
+uint8_t update_tracker(
+            TrackerState& tracker,
+            const float32_t& x_measured,
+            const float32_t& y_measured,
+            const float32_t& time_step);
+
+
+/**
+ * @brief Returns the smoothed estimate of the tracker indirectly using
+ * references
+ *
+ * @retval Returns 0 if the tracker has not been initialized
+ *
+ * @param tracker The tracker
+ *
+ * @param x_estimate Smoothed x-position [m]
+ *
+ * @param y_estimate Smoothed y-position [m]
+ *
+ * @param bearing Bearing to the pinger, clockwise from the bow [deg]
+ *
+ * @param range Distance to the pinger [m]
+ *
+ * @param position_variance Variance in x and y {var_x, var_y} [m^2]
+ */
+uint8_t get_tracker_estimate(
+            const TrackerState& tracker,
+            float32_t& x_estimate,
+            float32_t& y_estimate,
+            float32_t& bearing,
+            float32_t& range,
+            float32_t position_variance[2]);
+
+
+} /* namespace TRACKING */
+
+#endif /* ACOUSTICS_TRACKING_H */
@@ -8,6 +8,8 @@
 #ifndef ACOUSTICS_TRILATERATION_H
 #define ACOUSTICS_TRILATERATION_H
 
+#include "parameters.h"
+
 /**
  * @brief Defines used to specify the workflow from the Eigen-library
  */
@@ -18,6 +20,10 @@
     #define EIGEN_NO_STATIC_ASSERT    /* Prevents static assertion                  */  
   #endif /* EIGEN_NO_STATIC_ASSERT    */
 
+  #if USE_ALLOCATION_GUARD && !defined(EIGEN_NO_MALLOC)
+    #define EIGEN_NO_MALLOC           /* Asserts if Eigen allocates on the heap     */
+  #endif /* USE_ALLOCATION_GUARD      */
+
 #endif /* EIGEN_DEFINES */
 
 #include <algorithm> 
@@ -25,14 +31,104 @@
 #include <Eigen/LU> 
 #include <Eigen/Core>
 
-#include "parameters.h"
+#include "hydrophone_array.h"
+#include "timing.h"
+
+
+/**
+ * @brief Struct holding every constant that can be derived from the
+ * (fixed) position of @p N hydrophones. The struct is filled once by
+ * TRILATERATION::initialize_hydrophone_geometry(), such that the 
+ * trilateration only requires a few multiply-adds per frame
+ * 
+ * Hydrophones are labeled as a number, with hydrophone 0 as the reference.
+ * With the default setup
+ *      Port hydrophone         : 0
+ *      Starboard hydrophone    : 1
+ *      Stern hydrophone        : 2
+ * 
+ * With three hydrophones the position is solved in the xy-plane. With four
+ * or more, the position is solved in x, y and z
+ * 
+ * @param dimension Number of coordinates solved for. 2 if N = 3, otherwise 3
+ * 
+ * @param position Position {x, y, z} of each hydrophone [m]
+ * 
+ * @param baseline Difference in position between the reference and
+ * hydrophone i + 1. Example: baseline[0] = { x_01, y_01, z_01 } with
+ * x_01 = x_0 - x_1
+ * 
+ * @param squared_norm Squared norm of each hydrophone, using the @p dimension
+ * first coordinates. Example: squared_norm[0] = x_0^2 + y_0^2 if N = 3
+ * 
+ * @param half_squared_norm_diff Constant part of the B-vector. 
+ * Example: half_squared_norm_diff[0] = 1/2 * (squared_norm[0] - squared_norm[1])
+ * 
+ * @param baseline_inverse Rows of the pseudo-inverse (M^T * M)^(-1) * M^T of the 
+ * (N - 1) x dimension baseline-matrix. With three hydrophones 
+ *      M = [ x_01, y_01 ;
+ *            x_02, y_02 ]
+ * and the pseudo-inverse equals the inverse. Used to solve the linear system 
+ * in TRILATERATION::trilaterate_pinger_position
+ * 
+ * @param baseline_determinant Determinant of M^T * M. If 0, the hydrophones
+ * are placed on a line (or a plane if N > 3) and the position cannot be estimated
+ * 
+ * @param max_hydrophone_distance The maximum distance measured between 
+ * the hydrophones [m]
+ * 
+ * @param max_time_diff The maximum time-difference that should be possible
+ * between the data signals, including TRILATERATION::margin_time_epsilon [s]
+ * 
+ * @param max_lag The maximum lag that should be possible between the data
+ * signals [samples]. Equals floor(max_time_diff * SAMPLE_FREQUENCY)
+ * 
+ * @param lag_to_distance Factor converting a lag in samples to a 
+ * difference in distance [m/sample]
+ */
+template<uint32_t N>
+struct HydrophoneArrayGeometry{
+  static constexpr uint32_t dimension = (N > 3) ? 3 : 2;
+
+  float32_t position[N][3];
+  float32_t baseline[N - 1][3];
+  float32_t squared_norm[N];
+  float32_t half_squared_norm_diff[N - 1];
+  float32_t baseline_inverse[dimension][N - 1];
+  float32_t baseline_determinant;
+  float32_t max_hydrophone_distance;
+  float32_t max_time_diff;
+  int32_t max_lag;
+  float32_t lag_to_distance;
+}; /* struct HydrophoneArrayGeometry */
+
+
+/**
+ * @brief Typedefs used during trilateration
+ * 
+ * The linear system for @p N hydrophones is given by an (N - 1) x (dimension + 1) 
+ * matrix A and an (N - 1) x 1 vector B
+ */
+template<uint32_t N>
+using TDOAMatrix = Eigen::Matrix<float32_t, N - 1, HydrophoneArrayGeometry<N>::dimension + 1>;
+
+template<uint32_t N>
+using TDOAVector = Eigen::Matrix<float32_t, N - 1, 1>;
+
+typedef HydrophoneArrayGeometry<NUM_HYDROPHONES> HydrophoneGeometry;
+typedef TDOAMatrix<NUM_HYDROPHONES> Matrix_A_f;
+typedef TDOAVector<NUM_HYDROPHONES> Vector_B_f;
 
 
 /**
- * @brief Typedef used during trilateration
+ * @brief Solvers that can be used to estimate the direction to the pinger.
+ * Selected at runtime through TRILATERATION::solver_mode
  */
-typedef Eigen::Matrix<float32_t, 2, 3> Matrix_2_3_f;
-typedef Eigen::Matrix<float32_t, 2, 1> Vector_2_1_f;
+typedef enum{
+  SOLVER_FAR_FIELD,           /* Bearing (and elevation) only, assuming a plane wave  */
+  SOLVER_HYPERBOLIC,          /* Full position from the hyperbolic equations          */
+  SOLVER_AUTO                 /* Hyperbolic when closer than FAR_FIELD_MIN_RANGE      */
+}SOLVER_MODES; /* enum SOLVER_MODES */
 
 
 /**
@@ -42,56 +138,97 @@ namespace TRILATERATION{
 
 
 /**
- * @brief Constants used for the trilaterations 
- * 
- * @param max_hydrophone_distance The maximum distance 
- * measured between the hydrophones. 
+ * @brief The geometry used for the trilateration. Initialized by 
+ * TRILATERATION::initialize_trilateration_globals()
  * 
- * @param max_time_diff The maximum time-difference that
- * should be possible between the data signals
+ * Every entry is set to 0 before initialization, such that it is 
+ * easy to check if the geometry is invalid
  */
-extern float32_t max_hydrophone_distance; 
-extern float32_t max_time_diff;
+extern HydrophoneGeometry hydrophone_geometry;
 
 
 /**
- * @brief Function that calculates the maximum distance
- * between the hydrophones, and use it to calculate the
- * allowed time_difference. See the overview in hydrophones.h
- * for a better explenation of the hydrophones positioning
+ * @brief The solver used by the system. Initialized to SOLVER_MODE_DEFAULT,
+ * and can be changed at runtime
+ */
+extern SOLVER_MODES solver_mode;
+
+
+/**
+ * @brief The margin added to the time sound needs between the hydrophones
+ * furthest apart. Initialized to MARGIN_TIME_EPSILON, and changed at
+ * runtime through PARAMETER_REGISTRY, which recomputes the geometry
+ */
+extern float32_t margin_time_epsilon;
+
+
+/**
+ * @brief Time spent in TRILATERATION::refine_pinger_position(), used to 
+ * verify that the latency of the iterative solver stays bounded
+ */
+extern TimingStatistics nonlinear_solver_timing;
+
+
+/**
+ * @brief Function that calculates every geometry-derived constant from
+ * the position of @p N hydrophones. See the overview in parameters.h for
+ * a better explenation of the hydrophones positioning
  * 
- * @retval Returns 1/0 to indicate whether the values are initialized
- * correctly. Returns 0 if either max_hydrophone_distance or
- * maximum_time_diff is unchanged
+ * @retval Returns 1/0 to indicate whether the geometry is valid. Returns
+ * 0 if the hydrophones are placed such that the baseline-matrix is singular
  * 
- * @param pos_hyd_port Position of port hydrophone
+ * @param geometry The geometry to fill
  * 
- * @param pos_hyd_starboard Position of starboard hydrophone
+ * @param positions Position {x, y, z} of each hydrophone [m]
+ * 
+ * @param margin Margin added to the maximum time-difference. See
+ * TRILATERATION::margin_time_epsilon
+ */
+template<uint32_t N>
+uint8_t initialize_hydrophone_geometry(
+            HydrophoneArrayGeometry<N>& geometry,
+            const float32_t (&positions)[N][3],
+            const float32_t& margin = TRILATERATION::margin_time_epsilon);
+
+
+/**
+ * @brief Overload using HYDROPHONE_POSITIONS given in parameters.h
+ */
+uint8_t initialize_hydrophone_geometry(HydrophoneGeometry& geometry);
+
+
+/**
+ * @brief Function that initializes TRILATERATION::hydrophone_geometry, 
+ * which holds the maximum distance between the hydrophones and the 
+ * allowed time_difference
  * 
- * @param pos_hyd_stern Position of stern hydrophone 
+ * @retval Returns 1/0 to indicate whether the values are initialized
+ * correctly. Returns 0 if either max_hydrophone_distance or
+ * max_time_diff is unchanged
  */
 uint8_t initialize_trilateration_globals();
 
 
 /**
- * @brief Initializes the matrix @p A to a 2x3 0-matrix
+ * @brief Initializes the matrix @p A to a 0-matrix
  * 
- * @retval Returns a 2x3 matrix with all entries set to 0
+ * @retval Returns a (NUM_HYDROPHONES - 1) x (dimension + 1) matrix with 
+ * all entries set to 0
  */
-Matrix_2_3_f initialize_A_matrix();
+Matrix_A_f initialize_A_matrix();
 
 
 /**
- * @brief Initializes the vector @p B to a 2x3 0-matrix
+ * @brief Initializes the vector @p B to a 0-vector
  * 
- * @retval Returns a 2x1 vector with both entries set to 0
+ * @retval Returns a (NUM_HYDROPHONES - 1) x 1 vector with all entries set to 0
  */
-Vector_2_1_f initialize_B_vector();
+Vector_B_f initialize_B_vector();
 
 
 /**
- * @brief Function that check if the global variables 
- * @p max_hydrophone_distance and @p max_time_diff have been 
+ * @brief Function that check if @p max_hydrophone_distance and 
+ * @p max_time_diff in TRILATERATION::hydrophone_geometry have been 
  * initialized correctly 
  * 
  * @retval Returns true if set up correctly
@@ -99,14 +236,31 @@ Vector_2_1_f initialize_B_vector();
 uint8_t check_initialized_globals();
 
 
+/**
+ * @brief Function to check the validy of each lag for an array of 
+ * @p N hydrophones
+ * 
+ * @retval Returns true if every abs lag is within the max_lag of @p geometry
+ * 
+ * @param geometry The geometry of the hydrophones
+ * 
+ * @param lag_array The measured lags for every hydrophone-pair. See 
+ * hydrophone_array.h for the order of the pairs
+ */
+template<uint32_t N>
+uint8_t check_valid_lags(
+            const HydrophoneArrayGeometry<N>& geometry,
+            const int32_t (&lag_array)[HydrophonePairs<N>::count]);
+
+
 /**
  * @brief Function to check the validy of each signal 
  * 
  * @retval Returns true if the values are valid, and false if not. 
  * If false is returned, @p bool_time_error is set to 1
  * 
- * @param p_lag_array Array containing the measured lags. 
- * @p lag_array expands to 
+ * @param p_lag_array Array containing the measured lags for every 
+ * hydrophone-pair. With three hydrophones @p lag_array expands to 
  *      p_lag_array = { *p_lag_port_starboard, 
  *                      *p_lag_port_stern, 
  *                      *p_lag_starboard_stern }
@@ -114,14 +268,14 @@ uint8_t check_initialized_globals();
  * @param bool_time_error Int used to indicate time-error
  */
 uint8_t check_valid_signals(
-            uint32_t* p_lag_array[NUM_HYDROPHONES],
+            uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
             uint8_t& bool_time_error); 
 
 
 /**
  * @brief Helper function. Checks if the time-difference between two 
  * signals are valid. The time difference between the signals are checked 
- * against TRILATERATION::maximum_time_diff
+ * against the max_lag in TRILATERATION::hydrophone_geometry
  * 
  * @retval Returns false/true (0/1) depending on the result of the test
  * 
@@ -137,7 +291,7 @@ uint8_t check_valid_time(
 /**
  * @brief Helper function. Checks if a given time-difference is valid. 
  * The time difference between the signals are checked 
- * against TRILATERATION::maximum_time_diff
+ * against the max_lag in TRILATERATION::hydrophone_geometry
  * 
  * @retval Returns false/true (0/1) depending on the result of the test
  * 
@@ -147,6 +301,84 @@ uint8_t check_valid_time(const uint32_t& time_diff);
 
 
 
+/**
+ * @brief Helper-function that set the matrices @p A and @p B for an array
+ * of @p N hydrophones
+ * 
+ * Row i of the linear system is given by
+ *      A_i = [ baseline[i][0 : dimension], d_0(i+1) ]
+ *      B_i = 1/2 * d_0(i+1)^2 + half_squared_norm_diff[i]
+ * where d_0(i+1) is the difference in distance from the pinger to the 
+ * reference and to hydrophone i + 1
+ * 
+ * @param geometry The geometry of the hydrophones
+ * 
+ * @param distance_diff The difference in distance d_0(i+1) [m]
+ * 
+ * @param A The matrix containing the parameters to the linear equations
+ * 
+ * @param B A vector containing the solutions to the linear equations
+ */
+template<uint32_t N>
+void calculate_tdoa_system(
+            const HydrophoneArrayGeometry<N>& geometry,
+            const float32_t (&distance_diff)[N - 1],
+            TDOAMatrix<N>& A,
+            TDOAVector<N>& B);
+
+
+/**
+ * @brief Function solving the linear system given by @p A and @p B
+ * for an array of @p N hydrophones
+ * 
+ * With hydrophone 0 as reference, the linear equations are solved for the
+ * position s as a function of the range r_0 to the reference, using the
+ * precomputed pseudo-inverse M^+ in @p geometry
+ *      s = M^+ * (B - r_0 * [d_01, d_02, ...]^T)
+ * Inserting this into r_0^2 = |s - p_0|^2 gives a second order equation 
+ * in r_0. If both roots are positive, the largest is used, as the pinger
+ * is expected to be far away compared to the hydrophones
+ * 
+ * @retval Returns 0 if the baseline-matrix is singular or no positive range exists
+ * 
+ * @param geometry The geometry of the hydrophones
+ * 
+ * @param A The matrix set by calculate_tdoa_system()
+ * 
+ * @param B The vector set by calculate_tdoa_system()
+ * 
+ * @param position The estimated position {x, y, z} [m]. With three hydrophones
+ * z is set to the height of the reference hydrophone
+ */
+template<uint32_t N>
+uint8_t solve_tdoa_system(
+            const HydrophoneArrayGeometry<N>& geometry,
+            const TDOAMatrix<N>& A,
+            const TDOAVector<N>& B,
+            float32_t (&position)[3]);
+
+
+/**
+ * @brief Function to trilaterate the position of the acoustic pinger for an 
+ * array of @p N hydrophones. Combines calculate_tdoa_system() and 
+ * solve_tdoa_system()
+ * 
+ * @retval Returns 0 if no position could be estimated
+ * 
+ * @param geometry The geometry of the hydrophones
+ * 
+ * @param lag_array The measured lags for every hydrophone-pair. Only the
+ * N - 1 first pairs, which all include the reference, are used
+ * 
+ * @param position The estimated position {x, y, z} [m]
+ */
+template<uint32_t N>
+uint8_t trilaterate_position(
+            const HydrophoneArrayGeometry<N>& geometry,
+            const int32_t (&lag_array)[HydrophonePairs<N>::count],
+            float32_t (&position)[3]);
+
+
 /**
  * @brief Function to trilaterate the position of the acoustic pinger based
  * on the time of arrival. The function uses the TDOA and linear algebra to 
@@ -159,23 +391,27 @@ uint8_t check_valid_time(const uint32_t& time_diff);
  *      TOA: Time of arrival
  *      TDOA: Time-difference of arrival
  * 
- * @retval Returns the estimated x- and y-value indirectly using references
+ * The system is solved using TRILATERATION::hydrophone_geometry. See
+ * solve_tdoa_system() for the details
+ * 
+ * @retval Returns the estimated position indirectly using references.
+ * Returns 0 if the baseline-matrix is singular or no positive range exists
  * 
- * @warning The code assumes that the hydrophones are on the same plane/level 
- * as the acoustic pinger. The estimates will therefore exceed the actual 
- * position of the acoustic pinger somewhat.
+ * @warning With three hydrophones, the code assumes that the hydrophones are 
+ * on the same plane/level as the acoustic pinger. The estimates will therefore 
+ * exceed the actual position of the acoustic pinger somewhat.
  * 
  * @warning The code does not take into consideration any pitch/roll which will
  * affect the hydrophones' position
  * 
- * @param A A @c Matrix_2_3_f that holds the positions of, and the distances between
- * the hydrophones. Size: 4x4
+ * @param A A @c Matrix_A_f that holds the positions of, and the distances between
+ * the hydrophones. Size: (NUM_HYDROPHONES - 1) x (dimension + 1)
  * 
- * @param B A @c Vector_2_1_f that holds the minimal solutions to the equations. 
- * Size: 4x1
+ * @param B A @c Vector_B_f that holds the minimal solutions to the equations. 
+ * Size: (NUM_HYDROPHONES - 1) x 1
  * 
  * @param p_lag_array Array containing pointers to the cross-correlated lags. 
- * @p lag_array expands to 
+ * With three hydrophones @p lag_array expands to 
  *      p_lag_array = { *p_lag_port_starboard, 
  *                      *p_lag_port_stern, 
  *                      *p_lag_starboard_stern }
@@ -185,25 +421,168 @@ uint8_t check_valid_time(const uint32_t& time_diff);
  * 
  * @param y_estimate Reference to the estimated y-position. Used to return
  * the y-position indirectly
+ * 
+ * @param z_estimate Reference to the estimated z-position. Only estimated
+ * with four or more hydrophones, and otherwise set to the height of the
+ * reference hydrophone
  */
 uint8_t trilaterate_pinger_position(
-            Matrix_2_3_f& A,
-            Vector_2_1_f& B,
-            uint32_t* p_lag_array[NUM_HYDROPHONES],
+            Matrix_A_f& A,
+            Vector_B_f& B,
+            uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+            float32_t& x_estimate,
+            float32_t& y_estimate,
+            float32_t& z_estimate); 
+
+
+/**
+ * @brief Function refining the position of the pinger for an array of
+ * @p N hydrophones with the Levenberg-Marquardt method
+ * 
+ * The residual of hydrophone-pair (i, j) is given by
+ *      r_ij = |s - p_i| - |s - p_j| - d_ij
+ * such that every pair is used, and no linearisation around the reference
+ * is required. The Jacobian is fixed-size, and every iteration solves a
+ * dimension x dimension system without any allocation
+ * 
+ * With three hydrophones only x and y are solved for, and z is fixed to 
+ * the value given in @p position
+ * 
+ * @retval Returns 0 if the system became singular, or the estimate is invalid
+ * or further away than NONLINEAR_MAX_RANGE
+ * 
+ * @param geometry The geometry of the hydrophones
+ * 
+ * @param lag_array The measured lags for every hydrophone-pair
+ * 
+ * @param position The initial estimate {x, y, z}, which is overwritten with
+ * the refined estimate [m]
+ * 
+ * @param num_iterations The number of iterations used. At most 
+ * NONLINEAR_MAX_ITERATIONS
+ */
+template<uint32_t N>
+uint8_t refine_position(
+            const HydrophoneArrayGeometry<N>& geometry,
+            const int32_t (&lag_array)[HydrophonePairs<N>::count],
+            float32_t (&position)[3],
+            uint32_t& num_iterations);
+
+
+/**
+ * @brief Function to refine the estimated position of the acoustic pinger,
+ * using TRILATERATION::hydrophone_geometry. See refine_position() for the
+ * details
+ * 
+ * The estimates are used as the initial guess, and should be given by either
+ * the previous frame or trilaterate_pinger_position(). The time spent is 
+ * added to TRILATERATION::nonlinear_solver_timing
+ * 
+ * @retval Returns 0 if no position could be estimated. The estimates are 
+ * then unchanged
+ * 
+ * @param p_lag_array Array containing pointers to the cross-correlated lags
+ * 
+ * @param x_estimate Reference to the estimated x-position
+ * 
+ * @param y_estimate Reference to the estimated y-position
+ * 
+ * @param z_estimate Reference to the estimated z-position. Not changed with
+ * three hydrophones
+ */
+uint8_t refine_pinger_position(
+            uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
             float32_t& x_estimate,
-            float32_t& y_estimate); 
+            float32_t& y_estimate,
+            float32_t& z_estimate);
+
+
+/**
+ * @brief Function estimating the direction to the pinger for an array of
+ * @p N hydrophones, assuming that the pinger is far enough away for the
+ * sound to arrive as a plane wave
+ * 
+ * With the unit vector k pointing from the array towards the pinger, the 
+ * difference in distance is given by d_0(i+1) = -baseline[i] * k. The 
+ * direction is therefore found directly with the precomputed pseudo-inverse
+ *      k = -M^+ * [d_01, d_02, ...]^T
+ * which requires (N - 1) * dimension multiply-adds and no matrix inversion
+ * 
+ * @retval Returns 0 if the baseline-matrix is singular or all lags are 0
+ * 
+ * @param geometry The geometry of the hydrophones
+ * 
+ * @param lag_array The measured lags for every hydrophone-pair. Only the
+ * N - 1 first pairs, which all include the reference, are used
+ * 
+ * @param bearing Bearing to the pinger, clockwise from the bow [deg]
+ * 
+ * @param elevation Elevation of the pinger above the xy-plane [deg]. Only 
+ * estimated with four or more hydrophones, and otherwise set to 0
+ */
+template<uint32_t N>
+uint8_t estimate_direction(
+            const HydrophoneArrayGeometry<N>& geometry,
+            const int32_t (&lag_array)[HydrophonePairs<N>::count],
+            float32_t& bearing,
+            float32_t& elevation);
+
+
+/**
+ * @brief Function to estimate the bearing to the acoustic pinger, using 
+ * TRILATERATION::hydrophone_geometry. See estimate_direction() for the details
+ * 
+ * Much cheaper than trilaterate_pinger_position(), but gives no range. 
+ * Valid when the range is large compared to the distance between the 
+ * hydrophones
+ * 
+ * @retval Returns 0 if no direction could be estimated
+ * 
+ * @param p_lag_array Array containing pointers to the cross-correlated lags
+ * 
+ * @param bearing Reference to the estimated bearing, clockwise from the bow [deg]
+ * 
+ * @param elevation Reference to the estimated elevation [deg]. Only estimated
+ * with four or more hydrophones
+ */
+uint8_t estimate_pinger_bearing(
+            uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+            float32_t& bearing,
+            float32_t& elevation);
+
+
+/**
+ * @brief Function deciding if the hyperbolic solver should be used for the
+ * current frame, based on TRILATERATION::solver_mode
+ * 
+ * With SOLVER_AUTO the hyperbolic solver is used while the range is unknown
+ * or below FAR_FIELD_MIN_RANGE. Otherwise the far-field solver is used, 
+ * except for every FAR_FIELD_RANGE_REFRESH frame where the range is refreshed
+ * 
+ * @retval Returns 1 if the hyperbolic solver should be used, and 0 if the 
+ * far-field solver should be used
+ * 
+ * @param range_estimate Latest estimated range to the pinger [m]. Set to 0
+ * if unknown
+ * 
+ * @param num_frames_far_field Number of frames solved with the far-field 
+ * solver since @p range_estimate was updated
+ */
+uint8_t use_hyperbolic_solver(
+            const float32_t& range_estimate,
+            const uint32_t& num_frames_far_field);
 
 
 /**
  * @brief Helper-function that set the matrices @p A and @p B to the desired
  * values specified in @p TDOA_array
  * 
- * The values of @p A and @p B are calculated from @p TDOA_array and the position
- * of the hydrophones. Calcualtions are described at
+ * The values of @p A and @p B are calculated from @p TDOA_array and the 
+ * precomputed TRILATERATION::hydrophone_geometry. Calcualtions are described at
  * https://math.stackexchange.com/questions/1722021/trilateration-using-tdoa
  * 
- * @param TDOA_array Array containg the calculated TDOA 
- * The array is given as 
+ * @param TDOA_array Array containg the calculated TDOA for every hydrophone-pair
+ * With three hydrophones the array is given as 
  *      @p TDOA_array = { TDOA_port_starboard, TDOA_port_stern, TDOA_starboard_stern }
  * where ex. TDOA_port_starboard is the time-difference between port and starboard
  * 
@@ -212,9 +591,9 @@ uint8_t trilaterate_pinger_position(
  * @param B A vector containing the solutions to the linear equations
  */
 void calculate_tdoa_matrices(
-            float32_t TDOA_array[NUM_HYDROPHONES], 
-            Matrix_2_3_f& A,
-            Vector_2_1_f& B);
+            float32_t TDOA_array[NUM_HYDROPHONE_PAIRS], 
+            Matrix_A_f& A,
+            Vector_B_f& B);
 
 
 } /* namespace TRILATERATION */
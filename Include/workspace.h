@@ -0,0 +1,236 @@
+/**
+ * @file
+ *
+ * @brief Statically sized workspace holding every per-frame scratch-buffer,
+ * such that the large arrays are neither placed on the stack nor on the
+ * heap. The memory is handed out by a bump-allocator, and given back in
+ * the opposite order by WorkspaceScope
+ *
+ * The buffers of a frame are planned after their lifetime, such that
+ * buffers never live at the same time share the memory:
+ *
+ *      stage       | live buffers
+ *      ------------+------------------------------------------
+ *      convert     | data (raw)
+ *      filter      | data (raw, filtered in-place)
+ *      correlate   | data (filtered) | cross-correlation (one pair at a time)
+ *
+ * The raw data is dead once filtered, and is overwritten by the filter. The
+ * cross-correlation of a pair is dead once its peak is found, and the same
+ * buffer is used for every pair. The peak is therefore the data and a
+ * single cross-correlation. WORKSPACE_SIZE is calculated from this plan at
+ * compile-time, and the high-water mark of the workspace is kept such that
+ * the peak RAM-usage is known
+ *
+ * Usage:
+ *      {
+ *        WorkspaceScope scope(WORKSPACE::frame_workspace);
+ *        float32_t* p_data = WORKSPACE::allocate<float32_t>(
+ *              WORKSPACE::frame_workspace, IN_BUFFER_LENGTH);
+ *        ...
+ *      } // p_data is given back
+ *
+ * @warning A workspace must only be used by a single thread. The host-tools
+ * processing frames in parallel must give each thread its own workspace
+ */
+#ifndef ACOUSTICS_WORKSPACE_H
+#define ACOUSTICS_WORKSPACE_H
+
+#include "parameters.h"
+#include "hydrophone_array.h"
+
+
+/**
+ * @brief Alignment of every allocation [bytes]. Equal to the size of a
+ * cache-line on the Cortex-M7
+ */
+constexpr uint32_t WORKSPACE_ALIGNMENT = 32u;
+
+
+/**
+ * @brief Size of an allocation of @p size bytes, rounded up to the alignment
+ */
+constexpr uint32_t workspace_aligned_size(const uint32_t size){
+  return (size + WORKSPACE_ALIGNMENT - 1u) / WORKSPACE_ALIGNMENT * WORKSPACE_ALIGNMENT;
+}
+
+
+/**
+ * @brief Size of the data-arrays of @p N hydrophones with @p buffer_length
+ * samples each. Holds the raw data, and the filtered data after filtering
+ * in-place [bytes]
+ */
+constexpr uint32_t workspace_data_size(
+      const uint32_t N,
+      const uint32_t buffer_length){
+  return workspace_aligned_size(N * buffer_length * sizeof(float32_t));
+}
+
+
+/**
+ * @brief Size of the cross-correlation of one pair of hydrophones with
+ * @p buffer_length samples each [bytes]
+ */
+constexpr uint32_t workspace_xcorr_size(const uint32_t buffer_length){
+  return workspace_aligned_size((2 * buffer_length - 1) * sizeof(float32_t));
+}
+
+
+/**
+ * @brief Size of the workspace required by a frame from @p N hydrophones
+ * with @p buffer_length samples each, following the plan above [bytes]
+ */
+constexpr uint32_t workspace_frame_size(
+      const uint32_t N,
+      const uint32_t buffer_length){
+  return workspace_data_size(N, buffer_length) + workspace_xcorr_size(buffer_length);
+}
+
+
+/**
+ * @brief Size of the workspace used by main.cpp [bytes]
+ */
+constexpr uint32_t WORKSPACE_SIZE = workspace_frame_size(NUM_HYDROPHONES, IN_BUFFER_LENGTH);
+
+
+/**
+ * @brief A workspace
+ *
+ * @param p_memory Start of the memory. Aligned to WORKSPACE_ALIGNMENT
+ *
+ * @param size Size of the memory [bytes]
+ *
+ * @param offset Number of bytes in use [bytes]
+ *
+ * @param high_water_mark Largest number of bytes in use since the last
+ * reset [bytes]
+ *
+ * @param num_failed Number of allocations that did not fit
+ */
+typedef struct{
+  uint8_t* p_memory;
+  uint32_t size;
+  uint32_t offset;
+  uint32_t high_water_mark;
+  uint32_t num_failed;
+}Workspace; /* struct Workspace */
+
+
+/**
+ * @brief Gives back every allocation made after the scope was created,
+ * when the scope is destroyed
+ */
+class WorkspaceScope{
+public:
+  explicit WorkspaceScope(Workspace& workspace) :
+    workspace(workspace), marker(workspace.offset) {}
+
+  ~WorkspaceScope(){
+    workspace.offset = marker;
+  }
+
+  WorkspaceScope(const WorkspaceScope&) = delete;
+  WorkspaceScope& operator=(const WorkspaceScope&) = delete;
+
+private:
+  Workspace& workspace;
+  const uint32_t marker;
+}; /* class WorkspaceScope */
+
+
+/**
+ * @brief Namespace/wrapper for the workspace
+ */
+namespace WORKSPACE{
+
+
+/**
+ * @brief The workspace used by main.cpp. Holds WORKSPACE_SIZE bytes of
+ * static memory
+ */
+extern Workspace frame_workspace;
+
+
+/**
+ * @brief Initializes @p workspace to use @p size bytes at @p p_memory
+ *
+ * @param workspace The workspace to initialize
+ *
+ * @param p_memory The memory. Must be aligned to WORKSPACE_ALIGNMENT
+ *
+ * @param size Size of the memory [bytes]
+ */
+void initialize_workspace(
+            Workspace& workspace,
+            uint8_t* p_memory,
+            const uint32_t& size);
+
+
+/**
+ * @brief Allocates @p size bytes from @p workspace
+ *
+ * @retval Returns a pointer aligned to WORKSPACE_ALIGNMENT, or nullptr if
+ * the allocation does not fit. num_failed is then increased
+ *
+ * @param workspace The workspace to allocate from
+ *
+ * @param size Number of bytes
+ */
+void* allocate_bytes(
+            Workspace& workspace,
+            const uint32_t& size);
+
+
+/**
+ * @brief Allocates an array of @p count elements from @p workspace. The
+ * elements are not initialized
+ *
+ * @retval Returns nullptr if the allocation does not fit
+ */
+template<typename T>
+T* allocate(
+            Workspace& workspace,
+            const uint32_t& count){
+  return (T*) WORKSPACE::allocate_bytes(workspace, count * sizeof(T));
+}
+
+
+/**
+ * @brief Allocates one array of @p length floats for each of the @p N
+ * hydrophones
+ *
+ * @retval Returns 0 if the allocation does not fit
+ *
+ * @param workspace The workspace to allocate from
+ *
+ * @param p_data_array Set to the array of each hydrophone
+ *
+ * @param length Number of floats for each hydrophone
+ */
+template<uint32_t N>
+uint8_t allocate_arrays(
+            Workspace& workspace,
+            float32_t* (&p_data_array)[N],
+            const uint32_t& length){
+  float32_t* p_data = WORKSPACE::allocate<float32_t>(workspace, N * length);
+  if(!p_data){
+    return 0;
+  }
+  unroll<N>([&](uint32_t hyd){
+    p_data_array[hyd] = p_data + hyd * length;
+  });
+  return 1;
+}
+
+
+/**
+ * @brief Resets the high-water mark and the number of failed allocations
+ *
+ * @param workspace The workspace to reset
+ */
+void reset_statistics(Workspace& workspace);
+
+
+} /* namespace WORKSPACE */
+
+#endif /* ACOUSTICS_WORKSPACE_H */
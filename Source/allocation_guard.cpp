@@ -0,0 +1,132 @@
+#include "allocation_guard.h"
+
+#include <stdlib.h>
+
+#if defined(__arm__)
+  #include <reent.h>
+#endif /* __arm__ */
+
+/**
+ * State of the guard. Volatile, as it is read by the replacements called
+ * from any context
+ */
+namespace{
+
+        volatile uint8_t bool_guard_enabled = 0;
+        volatile uint64_t num_allocations = 0;
+        volatile uint64_t num_guarded_allocations = 0;
+
+        /* Called by every replacement before allocating */
+        inline void check_allocation(){
+                num_allocations++;
+                if(bool_guard_enabled){
+                        num_guarded_allocations++;
+                        #if defined(__arm__)
+                        __builtin_trap();
+                        #endif /* __arm__ */
+                }
+        }
+
+} /* namespace */
+
+
+/**
+ * Functions for the allocation-guard
+ */
+void ALLOCATION_GUARD::enable_guard(){
+        bool_guard_enabled = 1;
+}
+
+
+void ALLOCATION_GUARD::disable_guard(){
+        bool_guard_enabled = 0;
+}
+
+
+uint8_t ALLOCATION_GUARD::check_enabled_guard(){
+        return bool_guard_enabled;
+}
+
+
+uint64_t ALLOCATION_GUARD::get_num_allocations(){
+        #if defined(__arm__)
+        return 0;
+        #else
+        return num_allocations;
+        #endif /* __arm__ */
+}
+
+
+uint64_t ALLOCATION_GUARD::get_num_guarded_allocations(){
+        #if defined(__arm__)
+        return 0;
+        #else
+        return num_guarded_allocations;
+        #endif /* __arm__ */
+}
+
+
+/**
+ * Replacements of the allocation-functions. Operator new allocates
+ * through malloc, and is therefore covered
+ */
+#if !defined(__arm__)
+
+/* The allocators of glibc, which the replacements forward to */
+extern "C" {
+        void* __libc_malloc(size_t size);
+        void* __libc_calloc(size_t num, size_t size);
+        void* __libc_realloc(void* ptr, size_t size);
+        void* __libc_memalign(size_t alignment, size_t size);
+}
+
+extern "C" void* malloc(size_t size){
+        check_allocation();
+        return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t num, size_t size){
+        check_allocation();
+        return __libc_calloc(num, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size){
+        check_allocation();
+        return __libc_realloc(ptr, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size){
+        check_allocation();
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr ? 0 : 12; /* ENOMEM */
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size){
+        check_allocation();
+        return __libc_memalign(alignment, size);
+}
+
+#elif USE_ALLOCATION_GUARD
+
+/* The reentrant allocators of newlib, which the replacements forward to */
+extern "C" void* malloc(size_t size){
+        check_allocation();
+        return _malloc_r(_REENT, size);
+}
+
+extern "C" void* calloc(size_t num, size_t size){
+        check_allocation();
+        return _calloc_r(_REENT, num, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size){
+        check_allocation();
+        return _realloc_r(_REENT, ptr, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size){
+        check_allocation();
+        return _memalign_r(_REENT, alignment, size);
+}
+
+#endif /* __arm__ */
@@ -1,29 +1,46 @@
 #include "analyze_data.h"
 
+#include <complex>
+
 /**
  * Initializing the extern filter-variables. 
  * 
  * See FILTER_SETUP in parameters.h for more information on the variables
  */
-float32_t state_coefficients[4 * num_stages] = 
-{
-        0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
-};
-
 float32_t filter_coefficients[5 * num_stages] =
 {
         0.56942484, 0.0, -0.56942484,             /* Numerator filter 1   { b10, b11, b12 }           */
-        -1.12551866, 0.46469620,                  /* Denominator filter 1 {      a11, a12 }           */
+        1.12551866, -0.46469620,                  /* Denominator filter 1 {     -a11, -a12 }          */
         0.56942484, 0.0, -0.56942484,             /* Numerator filter 2   { b20, b21, b22 }           */
-        -0.83226204, 0.3694894                    /* Denominator filter 2 {      a21, a22 }           */
+        0.83226204, -0.3694894                    /* Denominator filter 2 {     -a21, -a22 }          */
 };
 
-const arm_biquad_casd_df1_inst_f32 IIR_FILTER = 
-{
-    .numStages = num_stages, 
-    .pState = &state_coefficients[0],
-    .pCoeffs = &filter_coefficients[0]
-};
+
+namespace{
+
+/**
+ * @brief Splits the interleaved samples into one array for each hydrophone.
+ * Shared by the DMA-buffer and the recordings, such that both use the same
+ * channel-order and scaling
+ *
+ * @param p_samples The interleaved samples. Either the volatile DMA-buffer,
+ * or a recording where the compiler is free to vectorize the loop
+ *
+ * @param p_raw_data_array One array for each hydrophone
+ */
+template<uint32_t N, typename Sample>
+inline void deinterleave_samples(
+        const Sample* p_samples,
+        float32_t* (&p_raw_data_array)[N]){
+
+    for(uint32_t i = 0; i < DMA_BUFFER_LENGTH; i++){
+        unroll<N>([&](uint32_t hyd){
+            p_raw_data_array[hyd][i] = (float32_t) p_samples[(N * i) + hyd];
+        });
+    }
+}
+
+} /* namespace */
 
 
 /**
@@ -57,107 +74,196 @@ void ANALYZE_DATA::array_max_value(
 
 
 
+template<uint32_t N>
+void ANALYZE_DATA::convert_adc_data(
+        const volatile uint16_t* p_adc_data,
+        float32_t* (&p_raw_data_array)[N]){
+
+    deinterleave_samples<N>(p_adc_data, p_raw_data_array);
+}
+
+
+template<uint32_t N>
+void ANALYZE_DATA::convert_recorded_data(
+        const uint16_t* p_samples,
+        float32_t* (&p_raw_data_array)[N]){
+
+    /* Not volatile, such that the compiler is free to vectorize the loop */
+    deinterleave_samples<N>(p_samples, p_raw_data_array);
+}
+
+
+template<uint32_t N>
 void ANALYZE_DATA::filter_raw_data(
-        float32_t* p_raw_data_array[NUM_HYDROPHONES];
-        float32_t* p_filtered_data_array[NUM_HYDROPHONES]){
+        float32_t* (&p_raw_data_array)[N],
+        float32_t* (&p_filtered_data_array)[N]){
     
-    /* Getting the values from the arrays */
-    float32_t* p_raw_data_port = p_filtered_data_array[0];
-    float32_t* p_raw_data_starboard = p_filtered_data_array[1];
-    float32_t* p_raw_data_stern = p_filtered_data_array[2];
-
-    float32_t* p_filtered_data_port = p_filtered_data_array[0];
-    float32_t* p_filtered_data_starboard = p_filtered_data_array[1];
-    float32_t* p_filtered_data_stern = p_filtered_data_array[2];
-
-    /* Filters the data using an fourth-order IIR-filter */
-    arm_biquad_cascade_df1_f32(
-            &IIR_FILTER,
-            p_raw_data_port, 
-            p_filtered_data_port, 
-            IIR_SIZE);
-
-    arm_biquad_cascade_df1_f32(
-            &IIR_FILTER,
-            p_raw_data_starboard, 
-            p_filtered_data_starboard, 
-            IIR_SIZE);
-
-    arm_biquad_cascade_df1_f32(
-            &IIR_FILTER,
-            p_raw_data_stern, 
-            p_filtered_data_stern, 
-            IIR_SIZE);
+    /** 
+     * Filters the data from each hydrophone using an fourth-order IIR-filter.
+     * Every sample is read before the output is written, such that the
+     * arrays may be the same
+     */
+    unroll<N>([&](uint32_t hyd){
+        /* Separate state for each hydrophone, starting at rest every frame */
+        float32_t state[4 * num_stages] = { 0 };
+        arm_biquad_casd_df1_inst_f32 filter = 
+        {
+            .numStages = num_stages, 
+            .pState = &state[0],
+            .pCoeffs = &filter_coefficients[0]
+        };
+
+        arm_biquad_cascade_df1_f32(
+                &filter,
+                p_raw_data_array[hyd], 
+                p_filtered_data_array[hyd], 
+                IIR_SIZE);
+    });
 }
 
 
+template<uint32_t N>
+void ANALYZE_DATA::filter_raw_data(float32_t* (&p_data_array)[N]){
+    ANALYZE_DATA::filter_raw_data<N>(p_data_array, p_data_array);
+}
+
+
+uint8_t ANALYZE_DATA::design_bandpass_filter(
+        const float32_t& low_frequency,
+        const float32_t& high_frequency,
+        float32_t (&coefficients)[5 * num_stages]){
+
+    static_assert(num_stages == 2, "The band-pass is designed as two second-order stages");
+
+    if(!std::isfinite(low_frequency) || !std::isfinite(high_frequency) ||
+       low_frequency <= 0 || low_frequency >= high_frequency ||
+       high_frequency >= 0.5f * SAMPLE_FREQUENCY){
+        return 0;
+    }
+
+    /* Prewarping the cut-off frequencies, such that they are kept by the bilinear transform */
+    const float64_t k = 2.0 * SAMPLE_FREQUENCY;
+    const float64_t w_low = k * std::tan(M_PI * low_frequency / SAMPLE_FREQUENCY);
+    const float64_t w_high = k * std::tan(M_PI * high_frequency / SAMPLE_FREQUENCY);
+    const float64_t bandwidth = w_high - w_low;
+    const float64_t w_center_squared = w_low * w_high;
+
+    /**
+     * The second-order low-pass prototype has the pole p = exp(j * 3 * pi / 4).
+     * The band-pass transform s_lp = (s^2 + w_c^2) / (bandwidth * s) maps it
+     * to the roots of s^2 - p * bandwidth * s + w_c^2, and every root gives a
+     * stage together with its conjugate
+     */
+    const std::complex<float64_t> pole(-M_SQRT1_2, M_SQRT1_2);
+    const std::complex<float64_t> root = std::sqrt(
+            pole * pole * bandwidth * bandwidth - 4.0 * w_center_squared);
+    const std::complex<float64_t> analog_poles[num_stages] =
+            { 0.5 * (pole * bandwidth + root), 0.5 * (pole * bandwidth - root) };
+
+    /**
+     * Every stage is bandwidth * s / (s^2 + a * s + b), with a zero at s = 0
+     * and s = inf, giving the numerator g * (1 - z^(-2)) after the transform
+     */
+    float64_t gain = 1.0;
+    float64_t feedback[num_stages][2];
+    for(uint32_t stage = 0; stage < num_stages; stage++){
+        const float64_t a = -2.0 * analog_poles[stage].real();
+        const float64_t b = std::norm(analog_poles[stage]);
+        const float64_t d0 = k * k + a * k + b;
+
+        gain *= bandwidth * k / d0;
+        feedback[stage][0] = -2.0 * (b - k * k) / d0;
+        feedback[stage][1] = -(k * k - a * k + b) / d0;
+    }
+
+    const float64_t stage_gain = std::sqrt(gain);
+    for(uint32_t stage = 0; stage < num_stages; stage++){
+        float32_t* p_stage = &coefficients[5 * stage];
+        p_stage[0] = (float32_t) stage_gain;
+        p_stage[1] = 0.0f;
+        p_stage[2] = (float32_t) -stage_gain;
+        p_stage[3] = (float32_t) feedback[stage][0];
+        p_stage[4] = (float32_t) feedback[stage][1];
+    }
+    return 1;
+}
+
+
+template<uint32_t N>
 void ANALYZE_DATA::calculate_xcorr_lag_array(
-        float32_t* p_filtered_data_array[NUM_HYDROPHONES],
-        uint32_t* p_lag_array[NUM_HYDROPHONES]){
+        float32_t* (&p_filtered_data_array)[N],
+        uint32_t* (&p_lag_array)[HydrophonePairs<N>::count],
+        const int32_t& max_lag,
+        Workspace& workspace){
     
-    /* Getting the values from the arrays */
-    float32_t* p_filtered_data_port = p_filtered_data_array[0];
-    float32_t* p_filtered_data_starboard = p_filtered_data_array[1];
-    float32_t* p_filtered_data_stern = p_filtered_data_array[2];
-
-    /* Creating temporary arrays to hold the result */
-    float32_t cross_corr_port_starboard[2 * IN_BUFFER_LENGTH - 1];
-    float32_t cross_corr_port_stern[2 * IN_BUFFER_LENGTH - 1];
-    float32_t cross_corr_starboard_port[2 * IN_BUFFER_LENGTH - 1];
-
-    /* Crosscorrelating the data */
-    arm_correlate_f32(
-            p_filtered_data_port, IN_BUFFER_LENGTH, 
-            p_filtered_data_starboard, IN_BUFFER_LENGTH, 
-            cross_corr_port_starboard);
-
-    arm_correlate_f32(
-            p_filtered_data_port, IN_BUFFER_LENGTH, 
-            p_filtered_data_stern, IN_BUFFER_LENGTH, 
-            cross_corr_port_stern);
-
-    arm_correlate_f32(
-            p_filtered_data_starboard, IN_BUFFER_LENGTH, 
-            p_filtered_data_stern, IN_BUFFER_LENGTH, 
-            cross_corr_starboard_stern);
-
-    /* Calculating cross-correlated lag */
-    uint32_t lag_port_starboard, lag_port_stern, lag_starboard_stern;
-    float32_t max_val_port_starboard, max_val_port_stern, max_val_starboard_stern;
-
-    ANALYZE_DATA::array_max_value(
-            cross_corr_port_starboard,
-            2 * IN_BUFFER_LENGTH - 1,
-            lag_port_starboard,
-            max_val_port_starboard);
-
-    ANALYZE_DATA::array_max_value(
-            cross_corr_port_stern,
-            2 * IN_BUFFER_LENGTH - 1,
-            lag_port_stern,
-            max_val_port_stern);
-
-    ANALYZE_DATA::array_max_value(
-            cross_corr_starboard_stern,
-            2 * IN_BUFFER_LENGTH - 1,
-            lag_starboard_stern,
-            max_val_starboard_stern);
+    constexpr uint32_t num_pairs = HydrophonePairs<N>::count;
 
-    /**
-     * Linear transformation to the cross-correlated lags to find the
-     * difference in number samples. 
-     * 
-     * When these values are shifted around 0, it is much easier to later
-     * determine which hydrophone measured the signal first
+    /* Window around zero lag, found at index IN_BUFFER_LENGTH - 1 */
+    const uint32_t window_length = std::min(
+            (uint32_t) (2 * std::max(max_lag, (int32_t) 0) + 1), 2 * IN_BUFFER_LENGTH - 1);
+    const uint32_t window_start = (IN_BUFFER_LENGTH - 1) - (window_length - 1) / 2;
+
+    /** 
+     * Temporary array in the workspace. The cross-correlation of a pair is 
+     * not needed once its lag is found, such that every pair uses the same
      */
-    lag_port_starboard - IN_BUFFER_LENGTH;
-    lag_port_stern - IN_BUFFER_LENGTH;
-    lag_starboard_stern - IN_BUFFER_LENGTH;
-
-    /* Inserting calculated cross-correlated lag into array */
-    *(p_lag_array[0]) = lag_port_starboard;
-    *(p_lag_array[1]) = lag_port_stern;
-    *(p_lag_array[2]) = lag_starboard_stern;
+    constexpr uint32_t xcorr_length = 2 * IN_BUFFER_LENGTH - 1;
+    WorkspaceScope scope(workspace);
+    float32_t* cross_corr = WORKSPACE::allocate<float32_t>(workspace, xcorr_length);
+    if(!cross_corr){
+        unroll<num_pairs>([&](uint32_t pair){
+            *(p_lag_array[pair]) = IN_BUFFER_LENGTH;
+        });
+        return;
+    }
+
+    unroll<num_pairs>([&](uint32_t pair){
+        const uint32_t first = HydrophonePairs<N>::first(pair);
+        const uint32_t second = HydrophonePairs<N>::second(pair);
+
+        /* Crosscorrelating the data */
+        arm_correlate_f32(
+                p_filtered_data_array[first], IN_BUFFER_LENGTH, 
+                p_filtered_data_array[second], IN_BUFFER_LENGTH, 
+                cross_corr);
+
+        /* Calculating cross-correlated lag within the window */
+        uint32_t lag;
+        float32_t max_val;
+        ANALYZE_DATA::array_max_value(
+                &cross_corr[window_start],
+                window_length,
+                lag,
+                max_val);
+
+        /**
+         * Linear transformation to the cross-correlated lags to find the
+         * difference in number samples. Zero lag is found at index 
+         * IN_BUFFER_LENGTH - 1
+         * 
+         * When these values are shifted around 0, it is much easier to later
+         * determine which hydrophone measured the signal first
+         */
+        *(p_lag_array[pair]) = (window_start + lag) - (IN_BUFFER_LENGTH - 1);
+    });
 }
 
 
+/**
+ * Explicit instantiation for the supported number of hydrophones
+ */
+#define INSTANTIATE_ANALYZE_DATA(N)                                             \
+    template void ANALYZE_DATA::convert_adc_data<N>(                            \
+            const volatile uint16_t*, float32_t* (&)[N]);                       \
+    template void ANALYZE_DATA::convert_recorded_data<N>(                       \
+            const uint16_t*, float32_t* (&)[N]);                                \
+    template void ANALYZE_DATA::filter_raw_data<N>(                             \
+            float32_t* (&)[N], float32_t* (&)[N]);                              \
+    template void ANALYZE_DATA::filter_raw_data<N>(float32_t* (&)[N]);          \
+    template void ANALYZE_DATA::calculate_xcorr_lag_array<N>(                   \
+            float32_t* (&)[N], uint32_t* (&)[HydrophonePairs<N>::count],        \
+            const int32_t&, Workspace&);
+
+INSTANTIATE_ANALYZE_DATA(3)
+INSTANTIATE_ANALYZE_DATA(4)
+INSTANTIATE_ANALYZE_DATA(5)
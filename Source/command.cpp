@@ -0,0 +1,200 @@
+#include "command.h"
+#include "profiling.h"
+#include "telemetry_transport.h"
+
+namespace{
+
+/**
+ * @brief The command being executed, its payload and its reply. Static,
+ * such that they are not placed on the stack
+ */
+uint8_t command_packet[COMMAND_MAX_PACKET_SIZE] __attribute__((aligned(4)));
+uint8_t command_payload[COMMAND_MAX_PAYLOAD_SIZE] __attribute__((aligned(4)));
+uint8_t reply_packet[COMMAND_MAX_PACKET_SIZE] __attribute__((aligned(4)));
+
+
+/**
+ * @brief Fills the reply-entries with the current value of the parameters
+ * given by @p entries, or of every parameter if none is given
+ *
+ * @retval Returns the number of reply-entries. Returns 0 if any ID is not
+ * in the registry
+ */
+uint32_t get_current_values(
+        const CommandEntry* entries,
+        const uint32_t& num_entries,
+        CommandEntry* reply_entries){
+
+        const uint32_t num_values = num_entries ? num_entries : (uint32_t) NUM_PARAMETERS;
+        for(uint32_t i = 0; i < num_values; i++){
+                const uint32_t id = num_entries ? entries[i].id : i;
+
+                ParameterValue value;
+                if(!PARAMETER_REGISTRY::get_parameter(id, value)){
+                        return 0;
+                }
+                reply_entries[i].id = (uint16_t) id;
+                reply_entries[i].type = (uint16_t) PARAMETER_REGISTRY::parameter_info[id].type;
+                reply_entries[i].value = value.as_uint32;
+        }
+        return num_values;
+}
+
+
+/**
+ * @brief Writes the header of a reply, whose payload is already written
+ * after the header
+ *
+ * @retval Returns the length of the reply [bytes]
+ */
+uint32_t write_reply_header(
+        const CommandHeader& header,
+        const uint16_t& status,
+        const uint32_t& payload_length,
+        uint8_t* p_reply){
+
+        CommandHeader reply_header = header;
+        reply_header.status = status;
+        reply_header.payload_length = (uint16_t) std::min(payload_length, (uint32_t) COMMAND_MAX_PAYLOAD_SIZE);
+        memcpy(p_reply, &reply_header, sizeof(CommandHeader));
+        return sizeof(CommandHeader) + reply_header.payload_length;
+}
+
+} /* namespace */
+
+
+/**
+ * Functions for the commands
+ */
+uint32_t COMMAND::write_packet(
+        const COMMAND_TYPES& command,
+        const uint32_t& sequence,
+        const uint16_t& status,
+        const void* p_payload,
+        const uint32_t& payload_length,
+        uint8_t* p_packet){
+
+        CommandHeader header;
+        header.magic = COMMAND_MAGIC;
+        header.version = COMMAND_VERSION;
+        header.command = (uint16_t) command;
+        header.sequence = sequence;
+        header.status = status;
+        header.payload_length = (uint16_t) payload_length;
+
+        memcpy(p_packet, &header, sizeof(CommandHeader));
+        if(payload_length){
+                memcpy(p_packet + sizeof(CommandHeader), p_payload, payload_length);
+        }
+        return sizeof(CommandHeader) + payload_length;
+}
+
+
+uint8_t COMMAND::parse_packet(
+        const uint8_t* data,
+        const uint32_t& length,
+        CommandHeader& header,
+        void* p_payload,
+        const uint32_t& max_payload_length){
+
+        if(!data || length < sizeof(CommandHeader)){
+                return 0;
+        }
+
+        /* Copying, as the packet is not necessarily aligned */
+        memcpy(&header, data, sizeof(CommandHeader));
+
+        if(header.magic != COMMAND_MAGIC || header.version != COMMAND_VERSION ||
+           header.command >= NUM_COMMAND_TYPES || header.payload_length > max_payload_length ||
+           length != sizeof(CommandHeader) + header.payload_length){
+                return 0;
+        }
+
+        if(header.payload_length){
+                memcpy(p_payload, data + sizeof(CommandHeader), header.payload_length);
+        }
+        return 1;
+}
+
+
+uint32_t COMMAND::handle_command(
+        const uint8_t* data,
+        const uint32_t& length,
+        uint8_t* p_reply,
+        CommandHandler handler){
+
+        CommandHeader header;
+        if(!COMMAND::parse_packet(data, length, header, command_payload, COMMAND_MAX_PAYLOAD_SIZE)){
+                return 0;
+        }
+
+        /* The status is answered with the profile, written directly to the reply */
+        if(header.command == COMMAND_STATUS){
+                const uint32_t reply_length = PROFILING::write_report(
+                        (char*) p_reply + sizeof(CommandHeader), COMMAND_MAX_PAYLOAD_SIZE);
+                return write_reply_header(header, PARAMETER_OK, reply_length, p_reply);
+        }
+
+        /* The other commands are executed by their handler */
+        if(header.command != COMMAND_GET && header.command != COMMAND_SET){
+                uint32_t reply_length = 0;
+                const uint16_t status = handler ?
+                        handler((COMMAND_TYPES) header.command, command_payload,
+                                header.payload_length, p_reply + sizeof(CommandHeader), reply_length) :
+                        (uint16_t) PARAMETER_UNKNOWN_ID;
+                return write_reply_header(header, status, reply_length, p_reply);
+        }
+
+        /* The parameters are given as a list of entries */
+        const CommandEntry* entries = (const CommandEntry*) command_payload;
+        const uint32_t num_entries = header.payload_length / sizeof(CommandEntry);
+        if(header.payload_length % sizeof(CommandEntry) || num_entries > COMMAND_MAX_ENTRIES){
+                return 0;
+        }
+
+        /* The set is staged and applied as a whole, or not at all */
+        PARAMETER_STATUS status = PARAMETER_OK;
+        if(header.command == COMMAND_SET){
+                ParameterAssignment assignments[COMMAND_MAX_ENTRIES] = {};
+                for(uint32_t i = 0; i < num_entries; i++){
+                        assignments[i].id = entries[i].id;
+                        assignments[i].type = entries[i].type;
+                        assignments[i].value.as_uint32 = entries[i].value;
+                }
+
+                uint32_t failed_index;
+                status = PARAMETER_REGISTRY::apply_parameters(
+                        assignments, num_entries, failed_index);
+        }
+
+        /* The reply holds the values in use after the command */
+        CommandEntry reply_entries[COMMAND_MAX_ENTRIES];
+        const uint32_t num_reply_entries = get_current_values(entries, num_entries, reply_entries);
+        if(!num_reply_entries && status == PARAMETER_OK){
+                status = PARAMETER_UNKNOWN_ID;
+        }
+
+        return COMMAND::write_packet((COMMAND_TYPES) header.command, header.sequence, (uint16_t) status,
+                reply_entries, num_reply_entries * sizeof(CommandEntry), p_reply);
+}
+
+
+uint32_t COMMAND::poll_commands(CommandHandler handler){
+        uint32_t num_commands = 0;
+
+        #if USE_COMMANDS
+        uint32_t length;
+        while(TELEMETRY_TRANSPORT::receive_command(command_packet, COMMAND_MAX_PACKET_SIZE, length)){
+                const uint32_t reply_length = COMMAND::handle_command(command_packet, length, reply_packet, handler);
+                if(!reply_length){
+                        continue;
+                }
+
+                /* A lost reply is detected by the topside, which sends the command again */
+                TELEMETRY_TRANSPORT::send_reply(reply_packet, reply_length);
+                num_commands++;
+        }
+        #endif /* USE_COMMANDS */
+
+        return num_commands;
+}
@@ -0,0 +1,127 @@
+#include "event_log.h"
+
+namespace{
+
+/**
+ * @brief The records and counters of the log. Only accessed through the
+ * __atomic-builtins, such that the interrupts and the main-loop see
+ * consistent values
+ */
+EventRecord records[EVENT_LOG_LENGTH] = {};
+uint32_t counters[NUM_ERROR_TYPES] = {};
+uint32_t num_events = 0;
+
+
+/**
+ * @brief Increments @p counter, unless it is at UINT32_MAX
+ */
+inline void increment_saturating(uint32_t& counter){
+        uint32_t count = __atomic_load_n(&counter, __ATOMIC_RELAXED);
+        while(count != UINT32_MAX &&
+              !__atomic_compare_exchange_n(&counter, &count, count + 1u, true,
+                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+} /* namespace */
+
+
+/**
+ * Global variables for the event-log
+ */
+const char* const EVENT_LOG::error_names[NUM_ERROR_TYPES] =
+        { "adc_init", "adc_config", "dma_start", "dma_stop", "dma_conv",
+          "trilateration_init", "time_signal", "unidentified", "memory",
+          "a_not_invertible", "lookup_invalid", "nonlinear_solver",
+          "geometry_config", "flash_write", "telemetry_init", "raw_stream" };
+
+
+/**
+ * Functions for the event-log
+ */
+void EVENT_LOG::reset_log(){
+        for(uint32_t i = 0; i < EVENT_LOG_LENGTH; i++){
+                __atomic_store_n(&records[i].sequence, 0u, __ATOMIC_RELAXED);
+        }
+        for(uint32_t type = 0; type < NUM_ERROR_TYPES; type++){
+                __atomic_store_n(&counters[type], 0u, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&num_events, 0u, __ATOMIC_RELEASE);
+}
+
+
+void EVENT_LOG::log_event(
+        const ERROR_TYPES& type,
+        const uint32_t& payload){
+
+        const uint32_t valid_type = ((uint32_t) type < NUM_ERROR_TYPES) ?
+                (uint32_t) type : (uint32_t) ERROR_TYPES::ERROR_UNIDENTIFIED;
+        const uint32_t timestamp = TIMING::get_ticks();
+
+        /* Reserving the slot. An interrupt logging in between gets the next one */
+        const uint32_t index = __atomic_fetch_add(&num_events, 1u, __ATOMIC_RELAXED);
+        EventRecord& record = records[index & (EVENT_LOG_LENGTH - 1u)];
+
+        /* Invalidating the slot before it is written, such that readers reject it */
+        __atomic_store_n(&record.sequence, 0u, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&record.timestamp, timestamp, __ATOMIC_RELAXED);
+        __atomic_store_n(&record.type, valid_type, __ATOMIC_RELAXED);
+        __atomic_store_n(&record.payload, payload, __ATOMIC_RELAXED);
+        __atomic_store_n(&record.sequence, index + 1u, __ATOMIC_RELEASE);
+
+        increment_saturating(counters[valid_type]);
+}
+
+
+uint32_t EVENT_LOG::get_num_events(){
+        return __atomic_load_n(&num_events, __ATOMIC_ACQUIRE);
+}
+
+
+uint32_t EVENT_LOG::get_oldest_index(){
+        const uint32_t num = EVENT_LOG::get_num_events();
+        return (num > EVENT_LOG_LENGTH) ? num - EVENT_LOG_LENGTH : 0u;
+}
+
+
+uint8_t EVENT_LOG::read_event(
+        const uint32_t& index,
+        EventRecord& record){
+
+        /* Unsigned subtraction rejects both the future and the overwritten records */
+        if(EVENT_LOG::get_num_events() - index - 1u >= EVENT_LOG_LENGTH){
+                return 0;
+        }
+
+        const EventRecord& slot = records[index & (EVENT_LOG_LENGTH - 1u)];
+        const uint32_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+        if(sequence != index + 1u){
+                return 0;
+        }
+
+        record.sequence = sequence;
+        record.timestamp = __atomic_load_n(&slot.timestamp, __ATOMIC_RELAXED);
+        record.type = __atomic_load_n(&slot.type, __ATOMIC_RELAXED);
+        record.payload = __atomic_load_n(&slot.payload, __ATOMIC_RELAXED);
+
+        /* Rejecting the copy if the slot was overwritten while it was read */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&slot.sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+
+uint32_t EVENT_LOG::get_count(const ERROR_TYPES& type){
+        if((uint32_t) type >= NUM_ERROR_TYPES){
+                return 0;
+        }
+        return __atomic_load_n(&counters[type], __ATOMIC_RELAXED);
+}
+
+
+uint32_t EVENT_LOG::get_total_count(){
+        uint64_t total = 0;
+        for(uint32_t type = 0; type < NUM_ERROR_TYPES; type++){
+                total += __atomic_load_n(&counters[type], __ATOMIC_RELAXED);
+        }
+        return (uint32_t) std::min(total, (uint64_t) UINT32_MAX);
+}
@@ -0,0 +1,115 @@
+#include "geometry_config.h"
+#include "lag_lookup.h"
+
+/**
+ * Functions for the geometry configuration
+ */
+uint32_t GEOMETRY_CONFIG::calculate_crc(
+        const uint8_t* data,
+        const uint32_t& length){
+
+        /* Bitwise CRC-32. Only used when a configuration is loaded */
+        uint32_t crc = 0xFFFFFFFFu;
+        for(uint32_t i = 0; i < length; i++){
+                crc ^= data[i];
+                for(uint32_t bit = 0; bit < 8; bit++){
+                        crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+                }
+        }
+        return ~crc;
+}
+
+
+void GEOMETRY_CONFIG::get_default_config(GeometryConfig& config){
+        GEOMETRY_CONFIG::create_config(HYDROPHONE_POSITIONS, config);
+}
+
+
+void GEOMETRY_CONFIG::create_config(
+        const float32_t (&positions)[NUM_HYDROPHONES][3],
+        GeometryConfig& config){
+
+        config.magic = GEOMETRY_CONFIG_MAGIC;
+        config.version = GEOMETRY_CONFIG_VERSION;
+        config.num_hydrophones = NUM_HYDROPHONES;
+        memcpy(config.positions, positions, sizeof(config.positions));
+        config.crc = GEOMETRY_CONFIG::calculate_crc(
+                (const uint8_t*) &config, offsetof(GeometryConfig, crc));
+}
+
+
+uint8_t GEOMETRY_CONFIG::parse_config(
+        const uint8_t* data,
+        const uint32_t& length,
+        GeometryConfig& config){
+
+        if(!data || length != sizeof(GeometryConfig)){
+                return 0;
+        }
+
+        /* Copying, as the blob is not necessarily aligned */
+        memcpy(&config, data, sizeof(GeometryConfig));
+
+        if(config.magic != GEOMETRY_CONFIG_MAGIC ||
+           config.version != GEOMETRY_CONFIG_VERSION ||
+           config.num_hydrophones != NUM_HYDROPHONES){
+                return 0;
+        }
+
+        if(config.crc != GEOMETRY_CONFIG::calculate_crc(data, offsetof(GeometryConfig, crc))){
+                return 0;
+        }
+
+        for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+                for(uint32_t coord = 0; coord < 3; coord++){
+                        if(!std::isfinite(config.positions[hyd][coord])){
+                                return 0;
+                        }
+                }
+        }
+
+        return 1;
+}
+
+
+uint8_t GEOMETRY_CONFIG::apply_config(const GeometryConfig& config){
+
+        /* Calculating the new geometry without changing the one in use */
+        HydrophoneGeometry geometry = {};
+        if(!TRILATERATION::initialize_hydrophone_geometry(geometry, config.positions)){
+                return 0;
+        }
+
+        #if USE_LAG_LOOKUP_TABLE
+        /* The size of the table is fixed, and must cover the new max_lag */
+        if(geometry.max_lag > LAG_LOOKUP_MAX_LAG){
+                return 0;
+        }
+        #endif /* USE_LAG_LOOKUP_TABLE */
+
+        /**
+         * Replacing the geometry. The window used when searching the
+         * cross-correlation is given by the max_lag of the geometry
+         */
+        TRILATERATION::hydrophone_geometry = geometry;
+
+        /* Cannot fail, as the table is checked to cover the new max_lag above */
+        #if USE_LAG_LOOKUP_TABLE
+        LAG_LOOKUP::generate_lag_lookup_table(
+                LAG_LOOKUP::lag_lookup_table, LAG_LOOKUP_MAX_LAG);
+        #endif /* USE_LAG_LOOKUP_TABLE */
+
+        return 1;
+}
+
+
+uint8_t GEOMETRY_CONFIG::load_config(
+        const uint8_t* data,
+        const uint32_t& length){
+
+        GeometryConfig config;
+        if(!GEOMETRY_CONFIG::parse_config(data, length, config)){
+                return 0;
+        }
+        return GEOMETRY_CONFIG::apply_config(config);
+}
@@ -0,0 +1,127 @@
+#include "lag_lookup.h"
+
+#if USE_LAG_LOOKUP_TABLE
+/**
+ * Allocating the lookup-table. The table is filled by
+ * LAG_LOOKUP::generate_lag_lookup_table during startup
+ */
+LagLookupEntry LAG_LOOKUP::lag_lookup_table[LAG_LOOKUP_TABLE_SIZE];
+#endif /* USE_LAG_LOOKUP_TABLE */
+
+
+/**
+ * Helper-function to convert a float to fixed-point with saturation
+ */
+static int16_t to_fixed_point(
+        const float32_t& value,
+        const float32_t& scale){
+
+        float32_t scaled = std::round(value * scale);
+        if(scaled > INT16_MAX){
+                return INT16_MAX;
+        }
+        if(scaled < INT16_MIN){
+                return INT16_MIN;
+        }
+        return (int16_t) scaled;
+}
+
+
+/**
+ * Functions for generating and using the lookup-table
+ */
+uint32_t LAG_LOOKUP::generate_lag_lookup_table(
+        LagLookupEntry* table,
+        const int32_t& max_lag){
+
+        /* Checking that the table covers every possible lag */
+        const int32_t geometry_max_lag = TRILATERATION::hydrophone_geometry.max_lag;
+        if(geometry_max_lag < 0 || max_lag < geometry_max_lag){
+                return 0;
+        }
+
+        /* Matrices used by the solver */
+        Matrix_A_f A = TRILATERATION::initialize_A_matrix();
+        Vector_B_f B = TRILATERATION::initialize_B_vector();
+
+        const int32_t dimension = 2 * max_lag + 1;
+        uint32_t num_valid = 0;
+
+        for(int32_t lag_port_starboard = -max_lag; lag_port_starboard <= max_lag; lag_port_starboard++){
+                for(int32_t lag_port_stern = -max_lag; lag_port_stern <= max_lag; lag_port_stern++){
+                        LagLookupEntry& entry = table[
+                                (lag_port_starboard + max_lag) * dimension +
+                                (lag_port_stern + max_lag)];
+                        entry = { 0, 0, 0, 0, 0 };
+
+                        /* The third lag is given by closure of the two others */
+                        int32_t lag_starboard_stern = lag_port_stern - lag_port_starboard;
+                        if(std::abs(lag_port_starboard) > geometry_max_lag ||
+                           std::abs(lag_port_stern) > geometry_max_lag ||
+                           std::abs(lag_starboard_stern) > geometry_max_lag){
+                                continue;
+                        }
+
+                        uint32_t lag_array[NUM_HYDROPHONE_PAIRS] =
+                                { (uint32_t) lag_port_starboard,
+                                  (uint32_t) lag_port_stern,
+                                  (uint32_t) lag_starboard_stern };
+                        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS] =
+                                { &lag_array[0], &lag_array[1], &lag_array[2] };
+
+                        float32_t x_estimate, y_estimate, z_estimate;
+                        if(!TRILATERATION::trilaterate_pinger_position(
+                                A, B, p_lag_array, x_estimate, y_estimate, z_estimate)){
+                                continue;
+                        }
+
+                        /* Storing the estimate as fixed-point */
+                        entry.x_estimate = to_fixed_point(x_estimate, 100.0f);
+                        entry.y_estimate = to_fixed_point(y_estimate, 100.0f);
+                        entry.bearing = to_fixed_point(
+                                (float32_t) (std::atan2(x_estimate, y_estimate) * 180.0 / M_PI),
+                                100.0f);
+                        entry.bool_valid = 1;
+                        num_valid++;
+                }
+        }
+
+        return num_valid;
+}
+
+
+uint8_t LAG_LOOKUP::lookup_pinger_position(
+        const LagLookupEntry* table,
+        const int32_t& max_lag,
+        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+        float32_t& x_estimate,
+        float32_t& y_estimate,
+        float32_t& bearing){
+
+        /* Recovering the lags from the array */
+        int32_t lag_port_starboard = (int32_t) *(p_lag_array[0]);
+        int32_t lag_port_stern = (int32_t) *(p_lag_array[1]);
+        int32_t lag_starboard_stern = (int32_t) *(p_lag_array[2]);
+
+        /* Checking that the lags are covered by the table and consistent */
+        if(std::abs(lag_port_starboard) > max_lag || std::abs(lag_port_stern) > max_lag){
+                return 0;
+        }
+        if(std::abs(lag_starboard_stern - (lag_port_stern - lag_port_starboard)) > LAG_LOOKUP_CLOSURE){
+                return 0;
+        }
+
+        const LagLookupEntry& entry = table[
+                (lag_port_starboard + max_lag) * (2 * max_lag + 1) +
+                (lag_port_stern + max_lag)];
+        if(!entry.bool_valid){
+                return 0;
+        }
+
+        /* Extracting the values */
+        x_estimate = 0.01f * entry.x_estimate;
+        y_estimate = 0.01f * entry.y_estimate;
+        bearing = 0.01f * entry.bearing;
+
+        return 1;
+}
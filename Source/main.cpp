@@ -25,6 +25,15 @@
 
 #include "main.h"
 #include "analyze_data.h"
+#include "lag_lookup.h"
+#include "tracking.h"
+#include "geometry_config.h"
+#include "profiling.h"
+#include "trace.h"
+#include "workspace.h"
+#include "allocation_guard.h"
+#include "telemetry_transport.h"
+#include "command.h"
 
 #include "stm32f7xx.h"
 #include "stm32f7xx_hal.h"
@@ -47,13 +56,44 @@ DMA_HandleTypeDef hdma_adc1;
 ETH_HandleTypeDef heth;       
 //SPI_HandleTypeDef hspi1;        
 
-/* Errors and errors-detected */
-uint32_t error_idx = 0;
-const uint16_t max_num_errors = 256;
-static volatile ERROR_TYPES errors_occured[max_num_errors];
+/** 
+ * Memory that the DMA will push the data to. With USE_RAW_STREAM the DMA 
+ * alternates between two buffers, such that a frame is streamed directly
+ * from its buffer while the next frame is acquired
+ * 
+ * Every sample is transferred as a 16-bit halfword, such that the two 
+ * buffers use the memory of a single buffer of 32-bit words
+ */
+#if USE_RAW_STREAM
+  #define NUM_DMA_BUFFERS 2u
+#else
+  #define NUM_DMA_BUFFERS 1u
+#endif /* USE_RAW_STREAM */
+static volatile uint16_t ADC1_converted_values[NUM_DMA_BUFFERS][NUM_HYDROPHONES * DMA_BUFFER_LENGTH];
+
+/* Index of the buffer the DMA is pushing the data to */
+static uint32_t dma_buffer_idx = 0;
+
+/* Variable used to indicate if the raw frames are streamed over ethernet. Set by COMMAND_RAW_STREAM */
+static volatile uint8_t bool_raw_streaming = RAW_STREAM_AT_STARTUP;
+
+/* Variable used to request the trace to be sent over ethernet. Set by COMMAND_TRACE or the debugger */
+static volatile uint8_t bool_send_trace = 0;
+
+/* The hydrophone configuration in use. Stored in flash by COMMAND_STORE_GEOMETRY */
+static GeometryConfig geometry_config;
+
+/* Variable used to indicate that a new configuration is applied. Set by COMMAND_GEOMETRY */
+static volatile uint8_t bool_geometry_changed = 0;
 
-/* Memory that the DMA will push the data to */
-static volatile uint32_t ADC1_converted_values[NUM_HYDROPHONES * DMA_BUFFER_LENGTH];
+/**
+ * ADC-channel for each hydrophone is given by HYDROPHONE_ADC_CHANNELS in 
+ * parameters.h, such that it is also known by the host-tools
+ */
+static_assert(sizeof(HYDROPHONE_ADC_CHANNELS) / sizeof(HYDROPHONE_ADC_CHANNELS[0]) 
+      == NUM_HYDROPHONES, "An ADC-channel must be given for every hydrophone");
+static_assert(ADC_CHANNEL_3 == 3 && ADC_CHANNEL_10 == 10 && ADC_CHANNEL_13 == 13,
+      "HYDROPHONE_ADC_CHANNELS assumes that ADC_CHANNEL_n equals n");
 
 /* Variable used to indicate if conversion is ready. Changed via cb-function */
 static volatile uint8_t bool_DMA_conv_ready = 0;
@@ -79,21 +119,36 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc);
 /* Another function to handle interrupts which should be called when DMA is finished */
 void DMA2_Stream0_IRQHandler(void);
 
-/* Function to start the convertion over DMA */
+/* Functions to start and stop the convertion over DMA */
 static void start_convertion_adc_dma(void);
-
-/* Function to access DMA to get data from the hydrophones */
-static void read_measurements(
-          float32_t raw_data_port[IN_BUFFER_LENGTH], 
-          float32_t raw_data_starboard[IN_BUFFER_LENGTH],
-          float32_t raw_data_stern[IN_BUFFER_LENGTH]);
+static void stop_convertion_adc_dma(void);
 
 /* Functions to log errors */
-static void log_error(ERROR_TYPES error_code);
+static void log_error(ERROR_TYPES error_code, uint32_t payload = 0);
 static void check_signal_error(uint8_t& bool_time_error); 
 
 /* Function to coordinate the communication over the ethernet */
 uint8_t ethernet_coordination(void);
+static uint16_t execute_command(const COMMAND_TYPES& command, const uint8_t* p_payload,
+      const uint32_t& payload_length, uint8_t* p_reply_payload, uint32_t& reply_length);
+
+/* Functions to send the estimate from a frame to the Xavier, and to end the frame on every path */
+static void transmit_record(TelemetryRecord& record, TelemetryBatch& batch);
+static void finish_frame(TelemetryRecord& record, TelemetryBatch& batch,
+      const uint32_t& stage_ticks, const uint32_t& frame_ticks);
+
+/* Functions to add the tracked estimate to the record, and to propagate the tracker without a position */
+static void set_tracker_estimate(const TrackerState& tracker, TelemetryRecord& record);
+static void predict_tracker(TrackerState& tracker, uint32_t& tick_last_update, TelemetryRecord& record);
+
+/* Function to start or stop the raw stream */
+static uint16_t update_raw_streaming(const uint8_t* p_payload, const uint32_t& payload_length,
+      uint8_t* p_reply_payload, uint32_t& reply_length);
+
+/* Functions to load and store the hydrophone configuration */
+static PARAMETER_STATUS update_geometry_config(const uint8_t* data, uint32_t length);
+static PARAMETER_STATUS save_geometry_config(void);
+static uint8_t store_geometry_config(const GeometryConfig& config);
 
 /**
   * @brief The application entry point.
@@ -104,9 +159,16 @@ int main(void)
   /* Checks if the code is used for testing or not */
   #if CURR_TESTING_BOOL
   /**
-   * Testing
+   * Testing. The geometry is initialized as in normal operations, 
+   * as every solver depends on it
    */
+  PARAMETER_REGISTRY::reset_parameters();
+  if(!TRILATERATION::initialize_trilateration_globals()){
+    printf("\nThe geometry could not be initialized");
+    return 0;
+  }
   TESTING::test_trilateration_algorithm();
+  TESTING::benchmark_trilateration_solvers(BENCHMARK_NUM_FRAMES);
 
   #else
   /**
@@ -138,6 +200,10 @@ int main(void)
 
     /* USER CODE BEGIN SysInit */
 
+    /* Enable the cycle-counter used to time the code, and the trace using it */
+    TIMING::initialize_timing();
+    TRACE::initialize_trace();
+
     /* USER CODE END SysInit */
 
     /* Initialize all configured peripherals */
@@ -149,6 +215,12 @@ int main(void)
     
 
     /* USER CODE BEGIN 2 */
+    /**
+     * Reset the parameters tuned at runtime to the values in parameters.h,
+     * such that a restart does not keep the values set by the topside
+     */
+    PARAMETER_REGISTRY::reset_parameters();
+
     /** 
      * Initialize variables for trilateration 
      * Log error if invalid
@@ -161,98 +233,178 @@ int main(void)
       break; 
     }
 
+    /**
+     * Replace the positions in parameters.h with the configuration stored 
+     * in flash, if any. An erased or invalid sector is ignored. Applying 
+     * the stored configuration also generates the lookup-table
+     */
+    GeometryConfig stored_config;
+    GEOMETRY_CONFIG::get_default_config(geometry_config);
+    const uint8_t bool_stored_config = 
+        GEOMETRY_CONFIG::parse_config((const uint8_t*) GEOMETRY_FLASH_ADDRESS, 
+          sizeof(GeometryConfig), stored_config) && 
+        GEOMETRY_CONFIG::apply_config(stored_config);
+    if(bool_stored_config){
+      geometry_config = stored_config;
+    }
+
+    /**
+     * Generate the lookup-table from the geometry in parameters.h, unless
+     * already generated for the stored configuration. Only done once, as
+     * it solves every possible combination of lags
+     */
+    #if USE_LAG_LOOKUP_TABLE
+    if(!bool_stored_config && !LAG_LOOKUP::generate_lag_lookup_table(
+          LAG_LOOKUP::lag_lookup_table, LAG_LOOKUP_MAX_LAG)){
+      log_error(ERROR_TYPES::ERROR_TRILATERATION_INIT);
+      break;
+    }
+    #endif /* USE_LAG_LOOKUP_TABLE */
+
+    /**
+     * Starting the ETH-peripheral with the descriptors used by the telemetry.
+     * The estimates are still processed if the link is down
+     */
+    #if USE_TELEMETRY
+    if(!TELEMETRY_TRANSPORT::initialize_transport()){
+      log_error(ERROR_TYPES::ERROR_TELEMETRY_INIT);
+    }
+    #endif /* USE_TELEMETRY */
+
 
     /* Initialize the matrices used for trilatiration */
-    Matrix_2_3_f A_matrix = TRILATERATION::initialize_A_matrix();
-    Vector_2_1_f B_vector = TRILATERATION::initialize_B_vector();
+    Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+    Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
 
 
-    /* Cross-correlated lag between the measurements */
-    uint32_t lag_port_starboard, lag_port_stern, lag_starboard_stern;
+    /** 
+     * Cross-correlated lag between every pair of hydrophones. The pairs are
+     * ordered as given in hydrophone_array.h, such that for three hydrophones
+     *    lag_array = { lag_port_starboard, lag_port_stern, lag_starboard_stern }
+     */
+    uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+    uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+    unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+      p_lag_array[pair] = &lag_array[pair];
+    });
 
-    uint32_t* p_lag_array[NUM_HYDROPHONES] = 
-          { &lag_port_starboard, &lag_port_stern, &lag_starboard_stern };
 
+    /** 
+     * The data-arrays are allocated from the static workspace for every 
+     * frame, such that they are not placed on the stack. See workspace.h
+     */
+    Workspace& workspace = WORKSPACE::frame_workspace;
 
-    /* Intializing the data-arrays */
-    float32_t raw_data_port[IN_BUFFER_LENGTH];
-    float32_t raw_data_starboard[IN_BUFFER_LENGTH];
-    float32_t raw_data_stern[IN_BUFFER_LENGTH];
 
-    float32_t* raw_data_array[NUM_HYDROPHONES] = 
-          { &raw_data_port[0], &raw_data_starboard[0], &raw_data_stern[0] };
+    /** 
+     * Estimated position of the acoustic pinger. z is only estimated
+     * with four or more hydrophones, and is otherwise set to the height
+     * of the port hydrophone
+     */
+    float32_t x_pos_es, y_pos_es, z_pos_es = 0;
+
+    /** 
+     * Estimated bearing and elevation to the acoustic pinger. The elevation
+     * is only estimated with four or more hydrophones, and is otherwise 0
+     */
+    float32_t bearing_es, elevation_es = 0;
 
-    float32_t filtered_data_port[IN_BUFFER_LENGTH];
-    float32_t filtered_data_starboard[IN_BUFFER_LENGTH];
-    float32_t filtered_data_stern[IN_BUFFER_LENGTH];
 
-    float32_t* filtered_data_array[NUM_HYDROPHONES] = 
-          { &filtered_data_port[0], &filtered_data_starboard[0], &filtered_data_stern[0] };
+    /**
+     * Latest estimated range to the pinger, and the number of frames solved 
+     * by the far-field solver since. Used to select the solver at runtime
+     */
+    float32_t range_es = 0;
+    uint32_t num_frames_far_field = 0;
 
 
-    /* Variables used to indicate error(s) with the signal */
-    uint8_t bool_time_error = 0;
+    /** 
+     * Indicates if the previous estimate is valid as initial guess for the
+     * iterative solver. Otherwise the linear solution is used
+     */
+    uint8_t bool_warm_start = 0;
 
 
-    /* Variable indicating the max distance between the hydrophones */
-    static float32_t max_hydrophone_distance = -1.0f;
+    /* Tracker fusing the estimates over multiple frames */
+    TrackerState pinger_tracker;
+    TRACKING::initialize_tracker(pinger_tracker);
 
 
-    /* Variable indicating the max allowed time-difference between the signals */
-    static float32_t max_time_diff = -1.0f;
+    /* Time of the last update of the tracker [ms] */
+    uint32_t tick_last_update = HAL_GetTick();
 
 
-    /* Estimated position of the acoustic pinger */
-    float32_t x_pos_es, y_pos_es;
+    /** 
+     * Sequence-number of the current frame, used by both the telemetry and
+     * the raw stream. The telemetry of the current frame, and the records
+     * waiting to be sent. The batch is static, such that it is not placed
+     * on the stack
+     */
+    uint32_t frame_sequence = 0;
+    TelemetryRecord telemetry_record;
+    static TelemetryBatch telemetry_batch;
+    TELEMETRY::initialize_batch(telemetry_batch);
 
 
     /* Starting com between ADC and DMA */
     start_convertion_adc_dma();
+
+    /** 
+     * Everything is initialized. The main-loop must not allocate, and any
+     * allocation from here traps if USE_ALLOCATION_GUARD is set
+     */
+    ALLOCATION_GUARD::enable_guard();
     
     /* USER CODE END 2 */
 
     /* Infinite loop */
     /* USER CODE BEGIN WHILE */
     while(1){
-        /** 
-        * Using the ethernet to decleare the MCU to start recording.
-        * Start a time-estimate, such that the Xavier knows how old 
-        * the estimated position is 
-        * 
-        * NOTE: Requires more logic here! Otherwise it will be a bug,
-        * since the system will not move further 
-        */
-        if(ethernet_coordination()){
-          /** 
-           * TODO@TODO
-           * 
-           * Do something if given an order over ethernet
-           * Must be implemented further and in coordination with the team
-           * making the code/implementation for the Xavier
-           */
-        }
+        /**
+         * The commands are applied between two frames, such that every 
+         * frame is processed with a consistent set of parameters. Every
+         * frame is timestamped, such that the Xavier knows how old the
+         * estimated position is
+         */
+        ethernet_coordination();
 
-        /* (Re)starting DMA */
-        // if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*) ADC1_converted_values, 
-        //     NUM_HYDROPHONES * DMA_BUFFER_LENGTH) != HAL_OK){
-        //   log_error(ERROR_TYPES::ERROR_DMA_START);
-        //   continue;
-        // }
+        /**
+         * The previous estimates are given relative to the old array. The
+         * iterative solver is started from the linear solution, and the 
+         * tracker is started from the next position, such that the old 
+         * estimate is neither used as initial guess nor to gate the new ones
+         */
+        if(bool_geometry_changed){
+          bool_geometry_changed = 0;
+          #if !USE_LAG_LOOKUP_TABLE
+          bool_warm_start = 0;
+          range_es = 0;
+          num_frames_far_field = 0;
+          #endif /* !USE_LAG_LOOKUP_TABLE */
+          TRACKING::initialize_tracker(pinger_tracker);
+          tick_last_update = HAL_GetTick();
+        }
 
         /** 
          * Waiting for the DMA to be ready
          * 
          * The variables @p bool_DMA_conv_ready and @p bool_DMA_conv_error are 
          * changed via interrupt/cb-function
+         * 
+         * The time spent in each stage is added to PROFILING::stage_profiles.
+         * The time spent waiting is the slack left in the frame-budget
          */
+        uint32_t stage_ticks = TIMING::get_ticks();
         while(!bool_DMA_conv_ready && !bool_DMA_conv_error);
+        stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_ACQUIRE, stage_ticks);
+        const uint32_t frame_ticks = stage_ticks;
+        const uint64_t frame_timestamp = (uint64_t) HAL_GetTick() * 1000u;
 
         /**
          * Checking if an error occured during convertion 
          */
         if(bool_DMA_conv_error){
-          /* Logging the error */
-          log_error(ERROR_TYPES::ERROR_DMA_CONV);
+          /* The error is logged by DMA2_Stream0_IRQHandler() */
 
           /* Reset FLAGS */
           bool_DMA_conv_error = 0;
@@ -264,12 +416,23 @@ int main(void)
         }
 
         /**
-         * Stopping the DMA to prevent overwriting the memory
+         * The frame is taken. Cleared before the DMA is restarted, such 
+         * that the next iteration waits for the next frame to complete
          */
-        // if(HAL_ADC_Stop_DMA(&hadc1) != HAL_OK){     
-        //   log_error(ERROR_TYPES::ERROR_DMA_STOP);
-        //   continue;
-        // }
+        bool_DMA_conv_ready = 0;
+        frame_sequence++;
+
+        /**
+         * Allocating the data-arrays. One array for each hydrophone
+         * 
+         * The raw data is filtered in-place, such that the same arrays hold
+         * the filtered data. Everything allocated is given back at the end
+         * of the iteration. The allocation cannot fail, as WORKSPACE_SIZE 
+         * is calculated for this plan. See workspace.h
+         */
+        WorkspaceScope frame_scope(workspace);
+        float32_t* data_array[NUM_HYDROPHONES];
+        WORKSPACE::allocate_arrays(workspace, data_array, IN_BUFFER_LENGTH);
 
         /** 
          * Reading the data from the ADC 
@@ -277,7 +440,8 @@ int main(void)
          * The data should be correct, as the DMA-transfer has stopped. It should
          * therefore be impossible to overwrite the memory
          */
-        read_measurements(raw_data_port, raw_data_starboard, raw_data_stern);
+        const volatile uint16_t* p_adc_data = ADC1_converted_values[dma_buffer_idx];
+        ANALYZE_DATA::convert_adc_data(p_adc_data, data_array);
 
         /**
          * Recording the time of measurement in seconds after startup
@@ -292,56 +456,185 @@ int main(void)
          * 
          * Restarting reading and transfer again, such that new data is ready almost immediately
          * when the CPU has processed the old data
+         * 
+         * With USE_RAW_STREAM the frame is streamed directly from its buffer,
+         * and the next frame is pushed to the other buffer. The other buffer
+         * holds the previous frame, and is only reused once the ethernet no
+         * longer reads it. Otherwise the link is stalled, and the acquisition
+         * is not delayed: the next frame is pushed to the same buffer and the
+         * current frame is dropped from the stream. Packed samples are 
+         * copied, such that the buffer is free at once. The stream is 
+         * started and stopped by COMMAND_RAW_STREAM
          */
+        #if USE_RAW_STREAM
+        uint8_t bool_stream_frame = bool_raw_streaming;
+        if(bool_stream_frame && !RAW_STREAM_PACKED && 
+            !TELEMETRY_TRANSPORT::check_raw_frame_sent()){
+          log_error(ERROR_TYPES::ERROR_RAW_STREAM, frame_sequence);
+          bool_stream_frame = 0;
+        }
+        if(bool_stream_frame){
+          dma_buffer_idx = (dma_buffer_idx + 1) % NUM_DMA_BUFFERS;
+        }
+        #endif /* USE_RAW_STREAM */
         start_convertion_adc_dma();
 
-        /* Filtering the raw data */
-        ANALYZE_DATA::filter_raw_data(raw_data_array, filtered_data_array);
+        #if USE_RAW_STREAM
+        if(bool_stream_frame){
+          TELEMETRY_TRANSPORT::send_raw_frame(p_adc_data, frame_sequence, frame_timestamp);
+        }
+        #endif /* USE_RAW_STREAM */
+
+        /**
+         * Sending the trace when requested. The trace is copied, such that 
+         * the events are still traced while it is sent
+         */
+        #if USE_TRACE && USE_TELEMETRY
+        if(bool_send_trace && TELEMETRY_TRANSPORT::send_trace()){
+          bool_send_trace = 0;
+        }
+        #endif /* USE_TRACE && USE_TELEMETRY */
+        stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CONVERT, stage_ticks);
+
+        /* Filtering the raw data in-place */
+        ANALYZE_DATA::filter_raw_data(data_array);
+        stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, stage_ticks);
 
         /* Calulating the p_TDOA-array */
-        ANALYZE_DATA::calculate_xcorr_lag_array(filtered_data_array, p_lag_array);
+        ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array, 
+            TRILATERATION::hydrophone_geometry.max_lag, workspace);
+        stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CORRELATE, stage_ticks);
 
         /**
          * Checking is the measurements are valid. The measurements 
          * are discarded if they deviate too much in either time lag
          * 
-         * Take new samples if the data is invalid
+         * Take new samples if the data is invalid. The errors are only
+         * set by the current frame, such that a rejected frame does not
+         * discard the frames after it
          */
-        if(!TRILATERATION::check_valid_signals(p_lag_array, bool_time_error)){
-          log_error(ERROR_TYPES::ERROR_TIME_SIGNAL);
+        uint8_t bool_time_error = 0;
+        uint8_t bool_valid_lags = 
+            TRILATERATION::check_valid_signals(p_lag_array, bool_time_error);
+        stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_VALIDATE, stage_ticks);
+
+        /**
+         * Every frame with lags is sent, such that the Xavier knows the 
+         * quality of the signal even when no position is estimated
+         */
+        TELEMETRY::initialize_record(frame_sequence, frame_timestamp, telemetry_record);
+        TELEMETRY::set_lags(p_lag_array, telemetry_record);
+
+        if(!bool_valid_lags){
+          check_signal_error(bool_time_error);
+          predict_tracker(pinger_tracker, tick_last_update, telemetry_record);
+          finish_frame(telemetry_record, telemetry_batch, stage_ticks, frame_ticks);
           continue;
         }
+        telemetry_record.flags |= TELEMETRY_VALID_LAGS;
 
         /**
          * Triliterate the position of the acoustic pinger
          * 
          * The coordinates are given as a reference to the center of the AUV
          * 
-         * @warning Outcommented until the problem with TDOA is fixed.
-         * As of 01.02., the code uses the direct time of arrival and not the
-         * time-difference
+         * If USE_LAG_LOOKUP_TABLE is set, the position is found directly from
+         * the precomputed table instead of solving the equations
+         * 
+         * Otherwise TRILATERATION::solver_mode decides if the full position or 
+         * only the direction is estimated. The far-field solver gives no new
+         * position, and the tracker is therefore not updated
          */
-        // if(!TRILATERATION::trilaterate_pinger_position(A_matrix, B_vector, 
-        //     TDOA_array, x_pos_es, y_pos_es)){
-        //   log_error(ERROR_TYPES::ERROR_A_NOT_INVERTIBLE);
-        //   continue;
-        // }
+        #if USE_LAG_LOOKUP_TABLE
+        if(!LAG_LOOKUP::lookup_pinger_position(LAG_LOOKUP::lag_lookup_table, 
+            LAG_LOOKUP_MAX_LAG, p_lag_array, x_pos_es, y_pos_es, bearing_es)){
+          log_error(ERROR_TYPES::ERROR_LOOKUP_INVALID);
+          predict_tracker(pinger_tracker, tick_last_update, telemetry_record);
+          finish_frame(telemetry_record, telemetry_batch, stage_ticks, frame_ticks);
+          continue;
+        }
+        telemetry_record.flags |= TELEMETRY_LOOKUP_TABLE;
+
+        /* The table is only defined for three hydrophones, where z is not estimated */
+        z_pos_es = TRILATERATION::hydrophone_geometry.position[0][2];
+        elevation_es = 0;
+        #else
+        if(!TRILATERATION::use_hyperbolic_solver(range_es, num_frames_far_field)){
+          telemetry_record.flags |= TELEMETRY_FAR_FIELD;
+          if(TRILATERATION::estimate_pinger_bearing(p_lag_array, bearing_es, elevation_es)){
+            telemetry_record.flags |= TELEMETRY_VALID_BEARING;
+            telemetry_record.bearing = bearing_es;
+            telemetry_record.elevation = elevation_es;
+          }
+          else{
+            log_error(ERROR_TYPES::ERROR_A_NOT_INVERTIBLE);
+          }
+          num_frames_far_field++;
+          predict_tracker(pinger_tracker, tick_last_update, telemetry_record);
+          finish_frame(telemetry_record, telemetry_batch, stage_ticks, frame_ticks);
+          continue;
+        }
+
+        if(!bool_warm_start && !TRILATERATION::trilaterate_pinger_position(
+            A_matrix, B_vector, p_lag_array, x_pos_es, y_pos_es, z_pos_es)){
+          log_error(ERROR_TYPES::ERROR_A_NOT_INVERTIBLE);
+          predict_tracker(pinger_tracker, tick_last_update, telemetry_record);
+          finish_frame(telemetry_record, telemetry_batch, stage_ticks, frame_ticks);
+          continue;
+        }
+
+        #if USE_NONLINEAR_SOLVER
+        bool_warm_start = TRILATERATION::refine_pinger_position(
+            p_lag_array, x_pos_es, y_pos_es, z_pos_es);
+        if(!bool_warm_start){
+          log_error(ERROR_TYPES::ERROR_NONLINEAR_SOLVER);
+          predict_tracker(pinger_tracker, tick_last_update, telemetry_record);
+          finish_frame(telemetry_record, telemetry_batch, stage_ticks, frame_ticks);
+          continue;
+        }
+        #endif /* USE_NONLINEAR_SOLVER */
+
+        range_es = std::sqrt(x_pos_es * x_pos_es + y_pos_es * y_pos_es);
+        bearing_es = (float32_t) (std::atan2(x_pos_es, y_pos_es) * 180.0 / M_PI);
+
+        /* The elevation is derived from the position, and is only known when z is estimated */
+        #if NUM_HYDROPHONES > 3
+        elevation_es = (float32_t) (std::atan2(z_pos_es, range_es) * 180.0 / M_PI);
+        #else
+        elevation_es = 0;
+        #endif /* NUM_HYDROPHONES > 3 */
+        num_frames_far_field = 0;
+        #endif /* USE_LAG_LOOKUP_TABLE */
 
         /**
-         * TODO@TODO
-         * 
-         * Send the data to the Xavier in a predetermined format
-         * 
-         * Required to send the estimated position of the acoustic pinger
-         * alongside the time of measurment
+         * Fusing the estimate with the previous frames. The smoothed estimate
+         * and its covariance is given by TRACKING::get_tracker_estimate
          */
+        uint32_t tick_current = HAL_GetTick();
+        TRACKING::update_tracker(pinger_tracker, x_pos_es, y_pos_es, 
+            (tick_current - tick_last_update) / 1000.0f);
+        tick_last_update = tick_current;
+
+        /**
+         * Sending the estimated position of the acoustic pinger alongside
+         * the time of measurement. The records are batched, such that a 
+         * packet is only sent every TELEMETRY_BATCH_SIZE frames
+         */
+        telemetry_record.flags |= TELEMETRY_VALID_POSITION | TELEMETRY_VALID_BEARING;
+        telemetry_record.bearing = bearing_es;
+        telemetry_record.elevation = elevation_es;
+        telemetry_record.position[0] = x_pos_es;
+        telemetry_record.position[1] = y_pos_es;
+        telemetry_record.position[2] = z_pos_es;
+        set_tracker_estimate(pinger_tracker, telemetry_record);
+        finish_frame(telemetry_record, telemetry_batch, stage_ticks, frame_ticks);
     }
 
+    /* The system is initialized again, which is allowed to allocate */
+    ALLOCATION_GUARD::disable_guard();
+
     /* Stopping the ADC and the DMA for safety */
-    if(HAL_ADC_Stop_DMA(&hadc1) != HAL_OK){     
-      log_error(ERROR_TYPES::ERROR_DMA_STOP);
-      continue;
-    }
+    stop_convertion_adc_dma();
   }
 
   /**
@@ -440,7 +733,7 @@ static void MX_ADC1_Init(void)
   hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
   hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
   hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
-  hadc1.Init.NbrOfConversion = 3;
+  hadc1.Init.NbrOfConversion = NUM_HYDROPHONES;
   hadc1.Init.DMAContinuousRequests = ENABLE;
   hadc1.Init.EOCSelection = ADC_EOC_SEQ_CONV;
   if (HAL_ADC_Init(&hadc1) != HAL_OK)
@@ -448,29 +741,17 @@ static void MX_ADC1_Init(void)
     log_error(ERROR_TYPES::ERROR_ADC_INIT);
   }
   /** Configure for the selected ADC regular channel its corresponding rank in the sequencer and its sample time.
+   *  The ranks are numbered from 1, such that ADC_REGULAR_RANK_n == n
   */
-  sConfig.Channel = ADC_CHANNEL_3;
-  sConfig.Rank = ADC_REGULAR_RANK_1;
   sConfig.SamplingTime = ADC_SAMPLETIME_3CYCLES;
-  if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
-  {
-    log_error(ERROR_TYPES::ERROR_ADC_CONFIG);
-  }
-  /** Configure for the selected ADC regular channel its corresponding rank in the sequencer and its sample time.
-  */
-  sConfig.Channel = ADC_CHANNEL_10;
-  sConfig.Rank = ADC_REGULAR_RANK_2;
-  if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
+  for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++)
   {
-    log_error(ERROR_TYPES::ERROR_ADC_CONFIG);
-  }
-  /** Configure for the selected ADC regular channel its corresponding rank in the sequencer and its sample time.
-  */
-  sConfig.Channel = ADC_CHANNEL_13;
-  sConfig.Rank = ADC_REGULAR_RANK_3;
-  if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
-  {
-    log_error(ERROR_TYPES::ERROR_ADC_CONFIG);
+    sConfig.Channel = HYDROPHONE_ADC_CHANNELS[hyd];
+    sConfig.Rank = hyd + 1;
+    if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
+    {
+      log_error(ERROR_TYPES::ERROR_ADC_CONFIG, hyd);
+    }
   }
   /* USER CODE BEGIN ADC1_Init 2 */
 
@@ -491,6 +772,10 @@ static void MX_ETH_Init(void)
 
   /* USER CODE BEGIN ETH_Init 1 */
 
+  /* The HAL only holds a pointer to the MAC-address, which must be kept */
+  static uint8_t MACAddr[6];
+  heth.Init.MACAddr = &MACAddr[0];
+
   /* USER CODE END ETH_Init 1 */
   heth.Instance = ETH;
   heth.Init.AutoNegotiation = ETH_AUTONEGOTIATION_ENABLE;
@@ -625,6 +910,31 @@ static void MX_DMA_Init(void)
   /* DMA controller clock enable */
   __HAL_RCC_DMA2_CLK_ENABLE();
 
+  /**
+   * DMA2 Stream0 moves the conversions of ADC1 to ADC1_converted_values.
+   * Every sample is transferred as a 16-bit halfword. Configured once here,
+   * as the width cannot be changed while the stream is enabled
+   */
+  hdma_adc1.Instance = DMA2_Stream0;
+  hdma_adc1.Init.Channel = DMA_CHANNEL_0;
+  hdma_adc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_adc1.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_adc1.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_adc1.Init.Mode = DMA_NORMAL;
+  hdma_adc1.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_adc1.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+  {
+    log_error(ERROR_TYPES::ERROR_DMA_START);
+  }
+  __HAL_LINKDMA(&hadc1, DMA_Handle, hdma_adc1);
+
+  /* The completion and the errors are handled by DMA2_Stream0_IRQHandler() */
+  SET_BIT(DMA2_Stream0->CR, DMA_SxCR_TCIE | DMA_SxCR_TEIE);
+  WRITE_REG(DMA2_Stream0->PAR, (uint32_t) &(ADC1->DR));
+
   /* DMA interrupt init */
   /* DMA2_Stream0_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 0, 0);
@@ -650,108 +960,307 @@ static void MX_GPIO_Init(void)
 /* USER CODE BEGIN 4 */
 
 /**
- * @brief Read the ADC by using DMA
+ * @brief Detects if the error was caused by either time or the intensity
+ * and logs the correct error
  * 
- * The data is fed into the even indeces of the arrays, while the odd indeces
- * are set to 0. This is due to the usage of complex FFT, which requires the
- * imaginary components to be on the odd indeces. 
+ * Could be updated to detect other errors
  * 
- * @param raw_data_port Pointer to the memory for the port hydrophone
- * @param raw_data_starboard Pointer to the starboard hydrophone's memory
- * @param raw_data_stern Pointer to the stern hydrophone's memory
+ * @param bool_time_error Int used to indicate error with the time
+ */
+static void check_signal_error(uint8_t& bool_time_error){
+  if(bool_time_error){
+    bool_time_error = 0;
+    log_error(ERROR_TYPES::ERROR_TIME_SIGNAL);
+  }
+}
+
+
+/**
+ * @brief Function to handle communication over ethernet. The commands 
+ * setting and querying the parameters, and the status query answered with
+ * the profile of the stages, are executed and answered by 
+ * COMMAND::poll_commands(). Every other command by execute_command()
  * 
- * @warning Unsure if I have read/understood it correctly!
- * Assuming that there exists two possibilities for the DMA to push the
- * data depending on the rank:
+ * @retval Returns 1 if any command was executed
+ */
+uint8_t ethernet_coordination(void){
+  #if USE_TELEMETRY
+  if(COMMAND::poll_commands(execute_command)){
+    return 1;
+  }
+  #endif /* USE_TELEMETRY */
+  return 0;
+}
+
+
+/**
+ * @brief Executes the commands changing the state owned by the main-loop.
+ * Given to COMMAND::poll_commands(), and only called between two frames
  * 
- *    1) 
- *      Data is pushed in serial after rank. Since the DMA/ADC is in scan
- *      mode, it scans all of the channel after rank. Most likely
- *        
- *        r1 = rank1, r2 = rank2, r3 = rank3
- *        {r1, r2, r3, r1, r2, r3, ... , r1, r2, r3}
+ * @retval Returns the status of the command. See PARAMETER_STATUS
  * 
- *    2) 
- *      All of the data for the highest priority rank is pushed first, then
- *      the data belonging to the second priority rank and so forth
+ * @param command The command
+ * @param p_payload The payload of the command
+ * @param payload_length Length of the payload
+ * @param p_reply_payload The payload of the reply
+ * @param reply_length Length of the payload of the reply
+ */
+static uint16_t execute_command(const COMMAND_TYPES& command, const uint8_t* p_payload,
+      const uint32_t& payload_length, uint8_t* p_reply_payload, uint32_t& reply_length){
+  switch(command){
+  case COMMAND_GEOMETRY:
+    return update_geometry_config(p_payload, payload_length);
+
+  case COMMAND_STORE_GEOMETRY:
+    return save_geometry_config();
+
+  #if USE_RAW_STREAM
+  case COMMAND_RAW_STREAM:
+    return update_raw_streaming(p_payload, payload_length, p_reply_payload, reply_length);
+  #endif /* USE_RAW_STREAM */
+
+  /* The trace is sent by the main-loop, once the descriptors are free */
+  #if USE_TRACE
+  case COMMAND_TRACE:
+    bool_send_trace = 1;
+    return PARAMETER_OK;
+  #endif /* USE_TRACE */
+
+  default:
+    return PARAMETER_UNKNOWN_ID;
+  }
+}
+
+
+/**
+ * @brief Adds the record of a frame to the batch, and sends the batch over
+ * UDP when it is full. Does nothing if USE_TELEMETRY is not set
+ * 
+ * A dropped packet is not logged as an error, as the Xavier detects it 
+ * from the sequence-numbers. See TELEMETRY_TRANSPORT::get_statistics()
  * 
- *      {r1, r1, ..., r1, r2, r2, ..., r2, r3, r3, ..., r3}
+ * @param record The record of the frame. The number of errors is added
  * 
- * From my understanding of the circular DMA and ADC in scan-mode, it uses
- * the first method. The code assumes this true, however it is potentially 
- * a serious bug! 
+ * @param batch The records waiting to be sent
  */
-static void read_measurements(
-        float32_t raw_data_port[IN_BUFFER_LENGTH], 
-        float32_t raw_data_starboard[IN_BUFFER_LENGTH],
-        float32_t raw_data_stern[IN_BUFFER_LENGTH]){
+static void transmit_record(TelemetryRecord& record, TelemetryBatch& batch){
+  #if USE_TELEMETRY
+  record.num_errors = EVENT_LOG::get_total_count();
+  if(TELEMETRY::add_record(record, batch)){
+    TELEMETRY_TRANSPORT::send_batch(batch);
+  }
+  #endif /* USE_TELEMETRY */
+}
 
-  /**
-   * Reading the data. Dropping the last couple of datapoints, since
-   * 2048 % 3 = 2. Reducing the number of datapoints reduces the 
-   * accuracy of the analysis, however prevents out-of-range error
-   */
-  for(uint i = 0; i < DMA_BUFFER_LENGTH - NUM_HYDROPHONES; i++){
-    raw_data_port[2 * i] = ADC1_converted_values[3 * i];
-    raw_data_port[(2 * i) + 1] = 0;
 
-    raw_data_starboard[2 * i] = (float32_t)ADC1_converted_values[(3 * i) + 1];
-    raw_data_starboard[(2 * i) + 1] = 0;
+/**
+ * @brief Ends a frame. Called on every path through the main-loop once the
+ * lags are validated, such that the profiles of STAGE_SOLVE, STAGE_TRANSMIT
+ * and STAGE_FRAME also hold the frames rejected or without a position
+ * 
+ * The time spent solving is added to the record before it is sent
+ * 
+ * @param record The record of the frame
+ * @param batch The records waiting to be sent
+ * @param stage_ticks Tick-count at the start of STAGE_SOLVE
+ * @param frame_ticks Tick-count at the start of the frame
+ */
+static void finish_frame(TelemetryRecord& record, TelemetryBatch& batch,
+      const uint32_t& stage_ticks, const uint32_t& frame_ticks){
+  const uint32_t transmit_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_SOLVE, stage_ticks);
+  record.stage_us[PROFILING_STAGES::STAGE_SOLVE] = (uint32_t) TIMING::ticks_to_us(
+      PROFILING::stage_profiles[PROFILING_STAGES::STAGE_SOLVE].timing.last_ticks);
+
+  transmit_record(record, batch);
+  PROFILING::record_stage(PROFILING_STAGES::STAGE_TRANSMIT, transmit_ticks);
+  PROFILING::record_stage(PROFILING_STAGES::STAGE_FRAME, frame_ticks);
+}
+
 
-    raw_data_stern[2 * i] = (float32_t)ADC1_converted_values[(3 * i) + 2];
-    raw_data_stern[(2 * i) + 1] = 0;
+/**
+ * @brief Adds the smoothed estimate of the tracker and its variance to the
+ * record, if the tracker is initialized
+ * 
+ * @param tracker The tracker
+ * @param record The record of the frame
+ */
+static void set_tracker_estimate(const TrackerState& tracker, TelemetryRecord& record){
+  float32_t range_tracked, bearing_tracked;
+  if(TRACKING::get_tracker_estimate(tracker, record.tracked_position[0],
+      record.tracked_position[1], bearing_tracked, range_tracked, 
+      record.tracked_variance)){
+    record.flags |= TELEMETRY_VALID_TRACKER;
   }
 }
 
 
 /**
- * @brief Detects if the error was caused by either time or the intensity
- * and logs the correct error
+ * @brief Propagates the tracker to the current time for a frame giving no
+ * position, such that the variance of the tracked estimate grows while the
+ * pinger is not heard
  * 
- * Could be updated to detect other errors
+ * @param tracker The tracker
+ * @param tick_last_update Time of the last update or prediction [ms]. Set
+ * to the current time
+ * @param record The record of the frame. The tracked estimate is added
+ */
+static void predict_tracker(TrackerState& tracker, uint32_t& tick_last_update, TelemetryRecord& record){
+  uint32_t tick_current = HAL_GetTick();
+  TRACKING::predict_tracker(tracker, (tick_current - tick_last_update) / 1000.0f);
+  tick_last_update = tick_current;
+  set_tracker_estimate(tracker, record);
+}
+
+
+/**
+ * @brief Starts or stops streaming the raw frames. The stream starts with
+ * the next frame acquired
  * 
- * @param bool_time_error Int used to indicate error with the time
+ * @retval Returns PARAMETER_OK, or PARAMETER_INVALID_VALUE if the payload
+ * is not a single uint32_t
+ * 
+ * @param p_payload 1 to start the stream, and 0 to stop it
+ * @param payload_length Length of the payload
+ * @param p_reply_payload Set to 1 if the stream is running after the command
+ * @param reply_length Length of the payload of the reply
  */
-static void check_signal_error(uint8_t& bool_time_error){
-  if(bool_time_error){
-    bool_time_error = 0;
-    log_error(ERROR_TYPES::ERROR_TIME_SIGNAL);
+static uint16_t update_raw_streaming(const uint8_t* p_payload, const uint32_t& payload_length,
+      uint8_t* p_reply_payload, uint32_t& reply_length){
+  uint32_t bool_start;
+  if(payload_length != sizeof(uint32_t)){
+    return PARAMETER_INVALID_VALUE;
   }
+  memcpy(&bool_start, p_payload, sizeof(uint32_t));
+  bool_raw_streaming = (bool_start != 0);
+
+  const uint32_t bool_streaming = bool_raw_streaming;
+  memcpy(p_reply_payload, &bool_streaming, sizeof(uint32_t));
+  reply_length = sizeof(uint32_t);
+  return PARAMETER_OK;
 }
 
 
 /**
- * @brief Function to handle communication over ethernet
+ * @brief Loads a new hydrophone configuration. The configuration is only
+ * stored in flash by COMMAND_STORE_GEOMETRY, as erasing the flash stalls
+ * the main-loop
  * 
- * @warning Not implemented as of 11.12.2020, as I am not sure how the
- * communication between the STM32 and the main CPU should be
+ * Everything derived from the positions is recomputed once by
+ * GEOMETRY_CONFIG::apply_config(). The previous configuration is kept
+ * if the new one is invalid
+ * 
+ * @retval Returns PARAMETER_OK if the configuration is loaded. Returns 
+ * PARAMETER_INVALID_VALUE if the blob is invalid, and 
+ * PARAMETER_REBUILD_FAILED if it could not be applied
+ * 
+ * @param data The blob received over ethernet
+ * @param length Length of the blob
  */
-uint8_t ethernet_coordination(void){
-  return 0;
+static PARAMETER_STATUS update_geometry_config(const uint8_t* data, uint32_t length){
+  GeometryConfig config;
+  if(!GEOMETRY_CONFIG::parse_config(data, length, config)){
+    log_error(ERROR_TYPES::ERROR_GEOMETRY_CONFIG);
+    return PARAMETER_INVALID_VALUE;
+  }
+
+  if(!GEOMETRY_CONFIG::apply_config(config)){
+    log_error(ERROR_TYPES::ERROR_GEOMETRY_CONFIG);
+    return PARAMETER_REBUILD_FAILED;
+  }
+
+  /* The configuration is in use, but is lost at a restart unless stored */
+  geometry_config = config;
+  bool_geometry_changed = 1;
+  return PARAMETER_OK;
 }
 
 
 /**
- * @brief Function to log the errors
- * Could also be interesting to implement a timestamp to detect when the
- * error occurs. This could be done in the future, but is not a priority
- * as of 14.12.2020
+ * @brief Stores the hydrophone configuration in use in flash, such that it
+ * is used after a restart
  * 
- * NOTE: Could be improved by using a txt-file or other log, or send the number
- * of errors to the Xavier to be analyzed later. Using an array for temporary
- * storage, however should be improved in the future
+ * The ADC and the DMA are stopped while the sector is erased, as the 
+ * main-loop is blocked for up to a couple of seconds. The frame being 
+ * acquired is discarded, and the acquisition is started again afterwards
  * 
- * @param error The error that occured
+ * @retval Returns PARAMETER_OK if the configuration is stored, and
+ * PARAMETER_REBUILD_FAILED otherwise
  */
-static void log_error(ERROR_TYPES error){
-  if(error_idx < max_num_errors - 1){
-    errors_occured[error_idx] = error;
-    error_idx++;
-    return;
+static PARAMETER_STATUS save_geometry_config(void){
+  stop_convertion_adc_dma();
+  const uint8_t bool_stored = store_geometry_config(geometry_config);
+
+  bool_DMA_conv_ready = 0;
+  bool_DMA_conv_error = 0;
+  start_convertion_adc_dma();
+
+  if(!bool_stored){
+    log_error(ERROR_TYPES::ERROR_FLASH_WRITE);
+    return PARAMETER_REBUILD_FAILED;
   }
-  if(error_idx == max_num_errors - 1){
-    errors_occured[error_idx] = ERROR_TYPES::ERROR_MEMORY;
+  return PARAMETER_OK;
+}
+
+
+/**
+ * @brief Stores a hydrophone configuration in GEOMETRY_FLASH_SECTOR. The 
+ * sector is erased before the configuration is written word for word
+ * 
+ * @warning Erasing a sector takes up to a couple of seconds, during which
+ * the flash cannot be read. Must only be called with the acquisition 
+ * stopped. See save_geometry_config()
+ * 
+ * @retval Returns 1 if the configuration was written and verified
+ * 
+ * @param config The configuration to store
+ */
+static uint8_t store_geometry_config(const GeometryConfig& config){
+  static_assert(sizeof(GeometryConfig) % sizeof(uint32_t) == 0, 
+        "GeometryConfig is written to flash word for word");
+
+  if(HAL_FLASH_Unlock() != HAL_OK){
+    return 0;
+  }
+
+  FLASH_EraseInitTypeDef erase_init;
+  erase_init.TypeErase = FLASH_TYPEERASE_SECTORS;
+  erase_init.Sector = GEOMETRY_FLASH_SECTOR;
+  erase_init.NbSectors = 1;
+  erase_init.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+  uint32_t sector_error = 0;
+  uint8_t bool_valid = (HAL_FLASHEx_Erase(&erase_init, &sector_error) == HAL_OK);
+
+  uint32_t words[sizeof(GeometryConfig) / sizeof(uint32_t)];
+  memcpy(words, &config, sizeof(GeometryConfig));
+  for(uint32_t i = 0; bool_valid && i < sizeof(words) / sizeof(uint32_t); i++){
+    bool_valid = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, 
+          GEOMETRY_FLASH_ADDRESS + i * sizeof(uint32_t), words[i]) == HAL_OK);
   }
+
+  HAL_FLASH_Lock();
+
+  /* Verifying the written configuration */
+  return bool_valid && 
+        !memcmp((const void*) GEOMETRY_FLASH_ADDRESS, &config, sizeof(GeometryConfig));
+}
+
+
+/**
+ * @brief Function to log the errors. The errors are timestamped and kept in
+ * the ring of EVENT_LOG, where the oldest error is overwritten when it is
+ * full. The number of errors of each type is kept by EVENT_LOG::get_count()
+ * 
+ * NOTE: The log can be read with the debugger, or be sent to the Xavier to
+ * be analyzed later. The total number of errors is sent in the telemetry
+ * 
+ * @param error The error that occured
+ * 
+ * @param payload Value stored with the error, such as a status-register
+ */
+static void log_error(ERROR_TYPES error, uint32_t payload){
+  EVENT_LOG::log_event(error, payload);
+  TRACE::trace_event(TRACE_EVENTS::TRACE_ERROR, error);
 }
 
 
@@ -781,10 +1290,14 @@ void DMA2_Stream0_IRQHandler(void){
 
     /* Setting global state variable */
     bool_DMA_conv_ready = 1;
+    TRACE::trace_event(TRACE_EVENTS::TRACE_DMA_COMPLETE, dma_buffer_idx);
   }
 
   /* Checking if an error occured during converting */
   if (READ_BIT(DMA2->LISR, DMA_LISR_TEIF0)) {
+    /* Logging the error with the status-flags, as the cause is lost when cleared */
+    log_error(ERROR_TYPES::ERROR_DMA_CONV, READ_REG(DMA2->LISR));
+
     /* Clear register */
     WRITE_REG(DMA2->LIFCR, DMA_LIFCR_CTEIF0);
 
@@ -795,6 +1308,12 @@ void DMA2_Stream0_IRQHandler(void){
 
 /**
  * @brief A function that starts the convertion between the ADC and the DMA
+ * to ADC1_converted_values[dma_buffer_idx]
+ * 
+ * The stream runs in normal mode, and is disabled by the hardware once a
+ * frame is transferred. It is disabled again in case it was stopped by an
+ * error, as the address and the number of transfers can only be written
+ * while EN is cleared. The stream is then rearmed for a single frame
  * 
  * According to the manual, to restart the convertion between the ADC and DMA, 
  * the bit must be cleared by software: 
@@ -803,6 +1322,30 @@ void DMA2_Stream0_IRQHandler(void){
  * then to 1 to start a new transfer"
  */
 static void start_convertion_adc_dma(void){
+  /* Waiting for the stream to stop, as it finishes the current transfer first */
+  CLEAR_BIT(DMA2_Stream0->CR, DMA_SxCR_EN);
+  while(READ_BIT(DMA2_Stream0->CR, DMA_SxCR_EN));
+
+  /* Every flag of the stream must be cleared before it is enabled */
+  WRITE_REG(DMA2->LIFCR, DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | 
+      DMA_LIFCR_CTEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0);
+
+  /* Pushing a single frame to the current buffer */
+  WRITE_REG(DMA2_Stream0->NDTR, NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+  WRITE_REG(DMA2_Stream0->M0AR, (uint32_t) ADC1_converted_values[dma_buffer_idx]);
+  SET_BIT(DMA2_Stream0->CR, DMA_SxCR_EN);
+
+  /**
+   * The ADC keeps converting after the last transfer, and the overrun 
+   * stops its DMA-requests until cleared. The ADC is enabled on the first 
+   * start, and needs a few microseconds to stabilize
+   */
+  CLEAR_BIT(ADC1->SR, ADC_SR_OVR);
+  if(!READ_BIT(ADC1->CR2, ADC_CR2_ADON)){
+    SET_BIT(ADC1->CR2, ADC_CR2_ADON);
+    HAL_Delay(1);
+  }
+
   /* Triggering ADC with DMA */
   CLEAR_BIT(ADC1->CR2, ADC_CR2_DMA);
   SET_BIT(ADC1->CR2, ADC_CR2_DMA);
@@ -811,6 +1354,16 @@ static void start_convertion_adc_dma(void){
   SET_BIT(ADC1->CR2, ADC_CR2_SWSTART);
 }
 
+/**
+ * @brief Stops the convertion between the ADC and the DMA. The frame being
+ * acquired is discarded
+ */
+static void stop_convertion_adc_dma(void){
+  CLEAR_BIT(ADC1->CR2, ADC_CR2_DMA | ADC_CR2_ADON);
+  CLEAR_BIT(DMA2_Stream0->CR, DMA_SxCR_EN);
+  while(READ_BIT(DMA2_Stream0->CR, DMA_SxCR_EN));
+}
+
 /* USER CODE END 4 */
 
 /**
@@ -0,0 +1,203 @@
+#include "parameter_registry.h"
+#include "lag_lookup.h"
+
+namespace{
+
+/**
+ * @brief The current value of every parameter, and the statistics
+ */
+ParameterValue parameter_values[NUM_PARAMETERS];
+ParameterStatistics parameter_statistics = {};
+
+
+/**
+ * @brief The filter-coefficients given in analyze_data.cpp. Kept by the
+ * first reset, such that a later reset restores them
+ */
+float32_t default_coefficients[5 * num_stages];
+uint8_t bool_default_coefficients_kept = 0;
+
+
+/**
+ * @brief Writes the values read directly by the processing to the globals
+ * of their modules
+ */
+void write_globals(){
+        TRILATERATION::margin_time_epsilon =
+                parameter_values[PARAMETER_MARGIN_TIME_EPSILON].as_float;
+        TRILATERATION::solver_mode =
+                (SOLVER_MODES) parameter_values[PARAMETER_SOLVER_MODE].as_uint32;
+}
+
+} /* namespace */
+
+
+/**
+ * Global variables for the parameter registry
+ */
+const ParameterInfo PARAMETER_REGISTRY::parameter_info[NUM_PARAMETERS] =
+{
+        { "margin_time_epsilon", PARAMETER_FLOAT,
+          { .as_float = 0.0f }, { .as_float = 1.0f },
+          { .as_float = MARGIN_TIME_EPSILON }, REBUILD_GEOMETRY },
+        { "filter_low_frequency", PARAMETER_FLOAT,
+          { .as_float = 1.0f }, { .as_float = 0.5f * SAMPLE_FREQUENCY },
+          { .as_float = FILTER_LOW_FREQUENCY }, REBUILD_FILTER },
+        { "filter_high_frequency", PARAMETER_FLOAT,
+          { .as_float = 1.0f }, { .as_float = 0.5f * SAMPLE_FREQUENCY },
+          { .as_float = FILTER_HIGH_FREQUENCY }, REBUILD_FILTER },
+        { "solver_mode", PARAMETER_UINT32,
+          { .as_uint32 = SOLVER_FAR_FIELD }, { .as_uint32 = SOLVER_AUTO },
+          { .as_uint32 = SOLVER_MODE_DEFAULT }, REBUILD_NONE }
+};
+
+
+/**
+ * Functions for the parameter registry
+ */
+void PARAMETER_REGISTRY::reset_parameters(){
+        for(uint32_t id = 0; id < NUM_PARAMETERS; id++){
+                parameter_values[id] = PARAMETER_REGISTRY::parameter_info[id].default_value;
+        }
+        memset(&parameter_statistics, 0, sizeof(ParameterStatistics));
+        write_globals();
+
+        if(!bool_default_coefficients_kept){
+                memcpy(default_coefficients, filter_coefficients, sizeof(default_coefficients));
+                bool_default_coefficients_kept = 1;
+        }
+        else{
+                memcpy(filter_coefficients, default_coefficients, sizeof(default_coefficients));
+        }
+}
+
+
+uint8_t PARAMETER_REGISTRY::get_parameter(
+        const uint32_t& id,
+        ParameterValue& value){
+
+        if(id >= NUM_PARAMETERS){
+                return 0;
+        }
+        value = parameter_values[id];
+        return 1;
+}
+
+
+PARAMETER_STATUS PARAMETER_REGISTRY::check_assignment(const ParameterAssignment& assignment){
+        if(assignment.id >= NUM_PARAMETERS){
+                return PARAMETER_UNKNOWN_ID;
+        }
+
+        const ParameterInfo& info = PARAMETER_REGISTRY::parameter_info[assignment.id];
+        if(assignment.type != (uint32_t) info.type){
+                return PARAMETER_WRONG_TYPE;
+        }
+
+        uint8_t bool_valid = 0;
+        switch(info.type){
+        case PARAMETER_FLOAT:
+                bool_valid = std::isfinite(assignment.value.as_float) &&
+                        assignment.value.as_float >= info.minimum.as_float &&
+                        assignment.value.as_float <= info.maximum.as_float;
+                break;
+        case PARAMETER_UINT32:
+                bool_valid = assignment.value.as_uint32 >= info.minimum.as_uint32 &&
+                        assignment.value.as_uint32 <= info.maximum.as_uint32;
+                break;
+        default:
+                break;
+        }
+        return bool_valid ? PARAMETER_OK : PARAMETER_INVALID_VALUE;
+}
+
+
+PARAMETER_STATUS PARAMETER_REGISTRY::apply_parameters(
+        const ParameterAssignment* assignments,
+        const uint32_t& num_assignments,
+        uint32_t& failed_index){
+
+        failed_index = num_assignments;
+
+        /* Staging the new values, without changing the ones in use */
+        ParameterValue values[NUM_PARAMETERS];
+        memcpy(values, parameter_values, sizeof(values));
+        for(uint32_t i = 0; i < num_assignments; i++){
+                const PARAMETER_STATUS status = PARAMETER_REGISTRY::check_assignment(assignments[i]);
+                if(status != PARAMETER_OK){
+                        failed_index = i;
+                        parameter_statistics.num_rejected++;
+                        return status;
+                }
+                values[assignments[i].id] = assignments[i].value;
+        }
+
+        /* Only the data derived from a changed value is recomputed */
+        uint32_t rebuilds = REBUILD_NONE;
+        for(uint32_t id = 0; id < NUM_PARAMETERS; id++){
+                if(values[id].as_uint32 != parameter_values[id].as_uint32){
+                        rebuilds |= PARAMETER_REGISTRY::parameter_info[id].rebuilds;
+                }
+        }
+
+        /* The band must be valid together, and is therefore checked here */
+        float32_t coefficients[5 * num_stages];
+        if((rebuilds & REBUILD_FILTER) && !ANALYZE_DATA::design_bandpass_filter(
+                values[PARAMETER_FILTER_LOW_FREQUENCY].as_float,
+                values[PARAMETER_FILTER_HIGH_FREQUENCY].as_float,
+                coefficients)){
+                parameter_statistics.num_rejected++;
+                return PARAMETER_INVALID_VALUE;
+        }
+
+        /* The geometry is recomputed from the positions in use */
+        HydrophoneGeometry geometry = {};
+        if(rebuilds & REBUILD_GEOMETRY){
+                if(!TRILATERATION::initialize_hydrophone_geometry(geometry,
+                        TRILATERATION::hydrophone_geometry.position,
+                        values[PARAMETER_MARGIN_TIME_EPSILON].as_float)){
+                        parameter_statistics.num_rejected++;
+                        return PARAMETER_REBUILD_FAILED;
+                }
+
+                #if USE_LAG_LOOKUP_TABLE
+                /* The size of the table is fixed, and must cover the new max_lag */
+                if(geometry.max_lag > LAG_LOOKUP_MAX_LAG){
+                        parameter_statistics.num_rejected++;
+                        return PARAMETER_REBUILD_FAILED;
+                }
+                #endif /* USE_LAG_LOOKUP_TABLE */
+        }
+
+        /* Everything is valid. Replacing the values and the derived data */
+        memcpy(parameter_values, values, sizeof(parameter_values));
+        write_globals();
+
+        if(rebuilds & REBUILD_FILTER){
+                memcpy(filter_coefficients, coefficients, sizeof(coefficients));
+                parameter_statistics.num_filter_rebuilds++;
+        }
+
+        if(rebuilds & REBUILD_GEOMETRY){
+                TRILATERATION::hydrophone_geometry = geometry;
+                parameter_statistics.num_geometry_rebuilds++;
+
+                /**
+                 * Cannot fail, as the table is checked to cover the new
+                 * max_lag above. The table is too large to be staged, and a
+                 * combination without a solution is only marked invalid
+                 */
+                #if USE_LAG_LOOKUP_TABLE
+                LAG_LOOKUP::generate_lag_lookup_table(
+                        LAG_LOOKUP::lag_lookup_table, LAG_LOOKUP_MAX_LAG);
+                #endif /* USE_LAG_LOOKUP_TABLE */
+        }
+
+        parameter_statistics.num_applied++;
+        return PARAMETER_OK;
+}
+
+
+void PARAMETER_REGISTRY::get_statistics(ParameterStatistics& statistics){
+        statistics = parameter_statistics;
+}
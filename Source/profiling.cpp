@@ -0,0 +1,96 @@
+#include <stdio.h>
+
+#include "profiling.h"
+#include "trace.h"
+
+/**
+ * Global variables for the profiling
+ */
+StageProfile PROFILING::stage_profiles[NUM_PROFILING_STAGES] = {};
+
+const char* const PROFILING::stage_names[NUM_PROFILING_STAGES] =
+        { "acquire", "convert", "filter", "correlate", "validate", "solve",
+          "transmit", "frame" };
+
+
+/**
+ * Functions for profiling
+ */
+void PROFILING::reset_profiles(){
+        for(uint32_t stage = 0; stage < NUM_PROFILING_STAGES; stage++){
+                TIMING::reset_statistics(PROFILING::stage_profiles[stage].timing);
+                for(uint32_t bucket = 0; bucket < PROFILING_NUM_BUCKETS; bucket++){
+                        PROFILING::stage_profiles[stage].histogram[bucket] = 0;
+                }
+        }
+}
+
+
+uint32_t PROFILING::get_bucket(const uint32_t& ticks){
+        /* Bucket k holds [2^(k-1), 2^k) us, found from the leading zeros */
+        uint32_t us = (uint32_t) TIMING::ticks_to_us(ticks);
+        uint32_t bucket = us ? 32u - __builtin_clz(us) : 0u;
+        return std::min(bucket, PROFILING_NUM_BUCKETS - 1u);
+}
+
+
+uint32_t PROFILING::record_stage(
+        const PROFILING_STAGES& stage,
+        const uint32_t& start_ticks){
+
+        #if USE_PROFILING
+        StageProfile& profile = PROFILING::stage_profiles[stage];
+        uint32_t ticks = TIMING::update_statistics(profile.timing, start_ticks);
+        profile.histogram[PROFILING::get_bucket(ticks)]++;
+
+        /* Tracing both ends of the stage, such that it is drawn as a span */
+        TRACE::trace_event_at(TRACE_EVENTS::TRACE_STAGE_BEGIN, stage, start_ticks);
+        TRACE::trace_event_at(TRACE_EVENTS::TRACE_STAGE_END, stage, start_ticks + ticks);
+
+        /* Excluding the time spent in the profiling from the next stage */
+        return TIMING::get_ticks();
+        #else
+        return 0;
+        #endif /* USE_PROFILING */
+}
+
+
+uint32_t PROFILING::write_report(
+        char* buffer,
+        const uint32_t& length){
+
+        if(!buffer || !length){
+                return 0;
+        }
+
+        uint32_t num_written = 0;
+        auto append = [&](int num_chars){
+                /* snprintf returns the length of the untruncated text */
+                if(num_chars > 0){
+                        num_written = std::min(num_written + (uint32_t) num_chars, length - 1);
+                }
+        };
+
+        append(snprintf(buffer, length, "stage num min mean max [us] histogram\n"));
+
+        for(uint32_t stage = 0; stage < NUM_PROFILING_STAGES; stage++){
+                const TimingStatistics& timing = PROFILING::stage_profiles[stage].timing;
+                float32_t mean_ticks = timing.num_measurements ?
+                        (float32_t) timing.total_ticks / timing.num_measurements : 0.0f;
+
+                append(snprintf(buffer + num_written, length - num_written,
+                        "%s %u %.1f %.1f %.1f", PROFILING::stage_names[stage],
+                        (unsigned) timing.num_measurements,
+                        (double) TIMING::ticks_to_us(timing.min_ticks),
+                        (double) TIMING::ticks_to_us((uint64_t) mean_ticks),
+                        (double) TIMING::ticks_to_us(timing.max_ticks)));
+
+                for(uint32_t bucket = 0; bucket < PROFILING_NUM_BUCKETS; bucket++){
+                        append(snprintf(buffer + num_written, length - num_written,
+                                " %u", (unsigned) PROFILING::stage_profiles[stage].histogram[bucket]));
+                }
+                append(snprintf(buffer + num_written, length - num_written, "\n"));
+        }
+
+        return num_written;
+}
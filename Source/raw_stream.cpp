@@ -0,0 +1,62 @@
+#include "raw_stream.h"
+
+/**
+ * Functions for the raw stream
+ */
+void RAW_STREAM::create_packet_header(
+        const uint32_t& sequence,
+        const uint64_t& timestamp,
+        const uint32_t& packet_index,
+        RawStreamHeader& header){
+
+        const uint32_t sample_offset = packet_index * RAW_STREAM_PACKET_SAMPLES;
+
+        header.magic = RAW_STREAM_MAGIC;
+        header.version = RAW_STREAM_VERSION;
+        header.num_hydrophones = NUM_HYDROPHONES;
+        header.timestamp = timestamp;
+        header.sequence = sequence;
+        header.frame_length = DMA_BUFFER_LENGTH;
+        header.sample_offset = sample_offset;
+        header.num_samples = std::min(RAW_STREAM_PACKET_SAMPLES,
+                NUM_HYDROPHONES * DMA_BUFFER_LENGTH - sample_offset);
+        header.packet_index = packet_index;
+        header.num_packets = RAW_STREAM_PACKETS_PER_FRAME;
+        header.adc_resolution = ADC_RESOLUTION;
+        header.encoding = RAW_STREAM_PACKED ? SAMPLE_ENCODING_PACKED : SAMPLE_ENCODING_RAW;
+        header.reserved = 0;
+}
+
+
+uint8_t RAW_STREAM::parse_packet_header(
+        const uint8_t* data,
+        const uint32_t& length,
+        RawStreamHeader& header){
+
+        if(!data || length < sizeof(RawStreamHeader)){
+                return 0;
+        }
+
+        /* Copying, as the data is not necessarily aligned */
+        memcpy(&header, data, sizeof(RawStreamHeader));
+
+        if(header.magic != RAW_STREAM_MAGIC || header.version != RAW_STREAM_VERSION){
+                return 0;
+        }
+
+        const uint64_t frame_size = (uint64_t) header.num_hydrophones * header.frame_length;
+        if(header.encoding == SAMPLE_ENCODING_RICE ||
+           !SAMPLE_CODING::check_encoding(header.encoding, header.adc_resolution)){
+                return 0;
+        }
+
+        if(header.num_hydrophones < 3 || header.num_hydrophones > MAX_NUM_HYDROPHONES ||
+           header.packet_index >= header.num_packets ||
+           (uint64_t) header.sample_offset + header.num_samples > frame_size ||
+           length != sizeof(RawStreamHeader) +
+                     SAMPLE_CODING::get_max_encoded_size(header.encoding, header.num_samples)){
+                return 0;
+        }
+
+        return 1;
+}
@@ -0,0 +1,144 @@
+#include "recording.h"
+
+/**
+ * Functions for the recordings
+ */
+void RECORDING::create_header(
+        const float32_t (&positions)[NUM_HYDROPHONES][3],
+        const uint32_t& encoding,
+        RecordingHeader& header){
+
+        memset(&header, 0, sizeof(RecordingHeader));
+        header.magic = RECORDING_MAGIC;
+        header.version = RECORDING_VERSION;
+        header.num_hydrophones = NUM_HYDROPHONES;
+        header.adc_resolution = ADC_RESOLUTION;
+        header.encoding = encoding;
+        header.frame_length = DMA_BUFFER_LENGTH;
+        header.sample_frequency = SAMPLE_FREQUENCY;
+
+        for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+                header.channel_map[hyd] = HYDROPHONE_ADC_CHANNELS[hyd];
+                for(uint32_t coord = 0; coord < 3; coord++){
+                        header.positions[hyd][coord] = positions[hyd][coord];
+                }
+        }
+
+        header.crc = GEOMETRY_CONFIG::calculate_crc(
+                (const uint8_t*) &header, offsetof(RecordingHeader, crc));
+}
+
+
+uint8_t RECORDING::parse_header(
+        const uint8_t* data,
+        const uint32_t& length,
+        RecordingHeader& header){
+
+        if(!data || length < sizeof(RecordingHeader)){
+                return 0;
+        }
+
+        /* Copying, as the data is not necessarily aligned */
+        memcpy(&header, data, sizeof(RecordingHeader));
+
+        if(header.magic != RECORDING_MAGIC || header.version == 0 || header.version > RECORDING_VERSION){
+                return 0;
+        }
+
+        if(header.crc != GEOMETRY_CONFIG::calculate_crc(data, offsetof(RecordingHeader, crc))){
+                return 0;
+        }
+
+        /* Version 1 held the number of bytes in every raw sample */
+        if(header.version == 1){
+                if(header.encoding != sizeof(uint16_t)){
+                        return 0;
+                }
+                header.encoding = SAMPLE_ENCODING_RAW;
+        }
+
+        if(header.num_hydrophones < 3 || header.num_hydrophones > MAX_NUM_HYDROPHONES ||
+           header.adc_resolution == 0 ||
+           !SAMPLE_CODING::check_encoding(header.encoding, header.adc_resolution) ||
+           header.frame_length == 0 || header.frame_length > 0x100000u ||
+           !(header.sample_frequency > 0.0f)){
+                return 0;
+        }
+
+        return 1;
+}
+
+
+uint8_t RECORDING::check_compatible_header(const RecordingHeader& header){
+        return header.num_hydrophones == NUM_HYDROPHONES &&
+               header.frame_length == DMA_BUFFER_LENGTH &&
+               header.sample_frequency == SAMPLE_FREQUENCY &&
+               header.adc_resolution == ADC_RESOLUTION;
+}
+
+
+uint32_t RECORDING::get_frame_size(const RecordingHeader& header){
+        return sizeof(RecordingFrameHeader) + SAMPLE_CODING::get_max_encoded_size(
+                header.encoding, header.num_hydrophones * header.frame_length);
+}
+
+
+uint32_t RECORDING::write_frame(
+        const RecordingHeader& header,
+        const uint16_t* p_samples,
+        const uint32_t& sequence,
+        const uint64_t& timestamp,
+        uint8_t* p_frame){
+
+        RecordingFrameHeader frame_header;
+        frame_header.sequence = sequence;
+        frame_header.length = SAMPLE_CODING::encode_samples(header.encoding, p_samples,
+                NUM_HYDROPHONES * DMA_BUFFER_LENGTH, NUM_HYDROPHONES,
+                p_frame + sizeof(RecordingFrameHeader));
+        frame_header.timestamp = timestamp;
+        memcpy(p_frame, &frame_header, sizeof(RecordingFrameHeader));
+
+        return sizeof(RecordingFrameHeader) + frame_header.length;
+}
+
+
+uint8_t RECORDING::parse_frame_header(
+        const RecordingHeader& header,
+        const uint8_t* p_frame,
+        const uint64_t& length,
+        RecordingFrameHeader& frame_header){
+
+        if(length < sizeof(RecordingFrameHeader)){
+                return 0;
+        }
+        memcpy(&frame_header, p_frame, sizeof(RecordingFrameHeader));
+
+        /* Only Rice-coded frames vary in size */
+        const uint32_t max_length = RECORDING::get_frame_size(header) - sizeof(RecordingFrameHeader);
+        if(header.version == 1){
+                frame_header.length = max_length;
+        }
+        if(frame_header.length > max_length ||
+           (header.encoding != SAMPLE_ENCODING_RICE && frame_header.length != max_length)){
+                return 0;
+        }
+
+        return length - sizeof(RecordingFrameHeader) >= frame_header.length;
+}
+
+
+uint8_t RECORDING::read_frame(
+        const RecordingHeader& header,
+        const uint8_t* p_frame,
+        const uint64_t& length,
+        RecordingFrameHeader& frame_header,
+        uint16_t* p_samples){
+
+        if(!RECORDING::parse_frame_header(header, p_frame, length, frame_header)){
+                return 0;
+        }
+
+        return SAMPLE_CODING::decode_samples(header.encoding, p_frame + sizeof(RecordingFrameHeader),
+                frame_header.length, header.num_hydrophones * header.frame_length,
+                header.num_hydrophones, p_samples);
+}
@@ -0,0 +1,188 @@
+#include "recording_reader.h"
+
+#if !defined(__arm__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Helper-functions for the reader
+ */
+namespace{
+
+        /* Rounds @p offset down to the start of its page */
+        uint64_t align_to_page(const uint64_t& offset){
+                static const uint64_t page_size = (uint64_t) sysconf(_SC_PAGESIZE);
+                return offset - (offset % page_size);
+        }
+
+        /* Offset of frame @p index [bytes] */
+        uint64_t get_frame_offset(
+                const RecordingReader& reader,
+                const uint64_t& index){
+
+                if(reader.p_frame_offsets){
+                        return reader.p_frame_offsets[index];
+                }
+                return sizeof(RecordingHeader) + index * reader.frame_size;
+        }
+
+        /**
+         * Walks the frames of a Rice-coded recording, and counts the
+         * complete frames. The offsets are stored if @p p_offsets is given
+         */
+        uint64_t find_frame_offsets(
+                const RecordingReader& reader,
+                uint64_t* p_offsets){
+
+                uint64_t num_frames = 0;
+                uint64_t offset = sizeof(RecordingHeader);
+                RecordingFrameHeader frame_header;
+                while(RECORDING::parse_frame_header(reader.header, reader.p_data + offset,
+                      reader.size - offset, frame_header)){
+                        if(p_offsets){
+                                p_offsets[num_frames] = offset;
+                        }
+                        num_frames++;
+                        offset += sizeof(RecordingFrameHeader) + frame_header.length;
+                }
+                return num_frames;
+        }
+
+} /* namespace */
+
+
+/**
+ * Functions for the memory-mapped reader
+ */
+uint8_t RECORDING_READER::open_recording(
+        const char* path,
+        RecordingReader& reader){
+
+        memset(&reader, 0, sizeof(RecordingReader));
+        reader.file_descriptor = open(path, O_RDONLY);
+        if(reader.file_descriptor < 0){
+                return 0;
+        }
+
+        struct stat file_status;
+        if(fstat(reader.file_descriptor, &file_status) != 0 ||
+           (uint64_t) file_status.st_size < sizeof(RecordingHeader)){
+                RECORDING_READER::close_recording(reader);
+                return 0;
+        }
+        reader.size = (uint64_t) file_status.st_size;
+
+        void* p_mapping = mmap(nullptr, reader.size, PROT_READ, MAP_PRIVATE,
+                reader.file_descriptor, 0);
+        if(p_mapping == MAP_FAILED){
+                RECORDING_READER::close_recording(reader);
+                return 0;
+        }
+        reader.p_data = (const uint8_t*) p_mapping;
+
+        /* The frames are read in order, such that the kernel should read ahead */
+        madvise(p_mapping, reader.size, MADV_SEQUENTIAL);
+
+        if(!RECORDING::parse_header(reader.p_data, sizeof(RecordingHeader), reader.header)){
+                RECORDING_READER::close_recording(reader);
+                return 0;
+        }
+
+        reader.frame_size = RECORDING::get_frame_size(reader.header);
+        if(reader.header.encoding == SAMPLE_ENCODING_RICE){
+                reader.num_frames = find_frame_offsets(reader, nullptr);
+                reader.p_frame_offsets = new uint64_t[reader.num_frames + 1];
+                find_frame_offsets(reader, reader.p_frame_offsets);
+        }
+        else{
+                reader.num_frames = (reader.size - sizeof(RecordingHeader)) / reader.frame_size;
+        }
+
+        if(reader.header.encoding != SAMPLE_ENCODING_RAW){
+                reader.p_decoded = new uint16_t[reader.header.num_hydrophones * reader.header.frame_length];
+        }
+        return 1;
+}
+
+
+uint8_t RECORDING_READER::get_frame(
+        const RecordingReader& reader,
+        const uint64_t& index,
+        uint16_t* p_decoded,
+        RecordingFrameView& view){
+
+        if(!reader.p_data || index >= reader.num_frames){
+                return 0;
+        }
+
+        const uint64_t offset = get_frame_offset(reader, index);
+        const uint8_t* p_frame = reader.p_data + offset;
+
+        /* Every raw frame starts at an even offset, such that the samples are aligned */
+        if(reader.header.encoding == SAMPLE_ENCODING_RAW){
+                if(!RECORDING::parse_frame_header(reader.header, p_frame, reader.size - offset, view.header)){
+                        return 0;
+                }
+                view.p_samples = (const uint16_t*) (p_frame + sizeof(RecordingFrameHeader));
+                return 1;
+        }
+
+        view.p_samples = p_decoded;
+        return p_decoded &&
+               RECORDING::read_frame(reader.header, p_frame, reader.size - offset, view.header, p_decoded);
+}
+
+
+uint8_t RECORDING_READER::next_frame(
+        RecordingReader& reader,
+        RecordingFrameView& view){
+
+        if(!RECORDING_READER::get_frame(reader, reader.next_frame, reader.p_decoded, view)){
+                return 0;
+        }
+
+        const uint64_t offset = get_frame_offset(reader, reader.next_frame);
+        reader.next_frame++;
+
+        /**
+         * Prefetching the next window, and releasing the pages of the window
+         * behind the current frame. The pages are backed by the file, such
+         * that released pages are read again if the frames are revisited
+         */
+        if(offset + reader.frame_size > reader.prefetched_offset){
+                uint64_t start = align_to_page(offset);
+                uint64_t length = std::min((uint64_t) RECORDING_READER_WINDOW, reader.size - start);
+                madvise((void*) (reader.p_data + start), length, MADV_WILLNEED);
+                reader.prefetched_offset = start + length;
+        }
+
+        if(offset > reader.released_offset + 2 * (uint64_t) RECORDING_READER_WINDOW){
+                uint64_t end = align_to_page(offset - RECORDING_READER_WINDOW);
+                madvise((void*) (reader.p_data + reader.released_offset),
+                        end - reader.released_offset, MADV_DONTNEED);
+                reader.released_offset = end;
+        }
+
+        return 1;
+}
+
+
+void RECORDING_READER::close_recording(RecordingReader& reader){
+        if(reader.p_data){
+                munmap((void*) reader.p_data, reader.size);
+        }
+        if(reader.file_descriptor >= 0){
+                close(reader.file_descriptor);
+        }
+        delete[] reader.p_frame_offsets;
+        delete[] reader.p_decoded;
+        reader.p_frame_offsets = nullptr;
+        reader.p_decoded = nullptr;
+        reader.p_data = nullptr;
+        reader.file_descriptor = -1;
+}
+
+#endif /* !__arm__ */
@@ -0,0 +1,423 @@
+#include "sample_coding.h"
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif /* __SSE2__ */
+
+static_assert(SAMPLE_RICE_ESCAPE + 17u + 7u <= 64u,
+        "An escaped residual must fit in the bit-buffer next to the bits not yet written");
+
+/**
+ * Helper-functions for the encodings
+ */
+namespace{
+
+        /* Number of bits used to store an escaped residual */
+        const uint32_t ESCAPED_BITS = 17u;
+
+        /* Bits written LSB-first into a byte-buffer */
+        typedef struct{
+                uint8_t* p_data;
+                uint64_t bits;
+                uint32_t num_bits;
+        }BitWriter;
+
+        void write_bits(
+                BitWriter& writer,
+                const uint64_t& bits,
+                const uint32_t& num_bits){
+
+                writer.bits |= bits << writer.num_bits;
+                writer.num_bits += num_bits;
+                while(writer.num_bits >= 8){
+                        *writer.p_data++ = (uint8_t) writer.bits;
+                        writer.bits >>= 8;
+                        writer.num_bits -= 8;
+                }
+        }
+
+        /* Bits read LSB-first from a byte-buffer, never reading past its end */
+        typedef struct{
+                const uint8_t* p_data;
+                const uint8_t* p_end;
+                uint64_t bits;
+                uint32_t num_bits;
+        }BitReader;
+
+        void refill_bits(BitReader& reader){
+                while(reader.num_bits <= 56 && reader.p_data < reader.p_end){
+                        reader.bits |= (uint64_t) *reader.p_data++ << reader.num_bits;
+                        reader.num_bits += 8;
+                }
+        }
+
+        uint8_t read_bits(
+                BitReader& reader,
+                const uint32_t& num_bits,
+                uint32_t& value){
+
+                refill_bits(reader);
+                if(reader.num_bits < num_bits){
+                        return 0;
+                }
+                value = (uint32_t) (reader.bits & ((1ull << num_bits) - 1));
+                reader.bits >>= num_bits;
+                reader.num_bits -= num_bits;
+                return 1;
+        }
+
+        /* Residual of sample @p i, predicted by the previous sample of the same hydrophone */
+        uint32_t get_zigzag_residual(
+                const uint16_t* p_samples,
+                const uint32_t& i,
+                const uint32_t& num_channels){
+
+                const int32_t prediction = (i >= num_channels) ? p_samples[i - num_channels] : 0;
+                const int32_t residual = (int32_t) p_samples[i] - prediction;
+                return ((uint32_t) residual << 1) ^ (uint32_t) (residual >> 31);
+        }
+
+        /* Number of bits used by the Rice-code of @p z with parameter @p k */
+        uint32_t get_code_length(
+                const uint32_t& z,
+                const uint32_t& k){
+
+                const uint32_t quotient = z >> k;
+                return (quotient < SAMPLE_RICE_ESCAPE) ?
+                        quotient + 1u + k : SAMPLE_RICE_ESCAPE + ESCAPED_BITS;
+        }
+
+        /* Packs 2 samples into 3 bytes */
+        inline void pack_pair(
+                const uint16_t* p_samples,
+                uint8_t* p_packed){
+
+                const uint32_t word = (p_samples[0] & 0xFFFu) | ((p_samples[1] & 0xFFFu) << 12);
+                p_packed[0] = (uint8_t) word;
+                p_packed[1] = (uint8_t) (word >> 8);
+                p_packed[2] = (uint8_t) (word >> 16);
+        }
+
+        inline void unpack_pair(
+                const uint8_t* p_packed,
+                uint16_t* p_samples){
+
+                const uint32_t word = p_packed[0] | (p_packed[1] << 8) | (p_packed[2] << 16);
+                p_samples[0] = (uint16_t) (word & 0xFFFu);
+                p_samples[1] = (uint16_t) (word >> 12);
+        }
+
+} /* namespace */
+
+
+/**
+ * Functions for the encodings
+ */
+uint8_t SAMPLE_CODING::check_encoding(
+        const uint32_t& encoding,
+        const uint32_t& adc_resolution){
+
+        switch(encoding){
+                case SAMPLE_ENCODING_RAW:
+                case SAMPLE_ENCODING_RICE:
+                        return adc_resolution <= 16;
+                case SAMPLE_ENCODING_PACKED:
+                        return adc_resolution <= 12;
+                default:
+                        return 0;
+        }
+}
+
+
+uint32_t SAMPLE_CODING::get_max_encoded_size(
+        const uint32_t& encoding,
+        const uint32_t& num_samples){
+
+        switch(encoding){
+                case SAMPLE_ENCODING_PACKED:
+                        return (num_samples / 2) * 3 + (num_samples % 2) * 2;
+                case SAMPLE_ENCODING_RICE:{
+                        /* Every block is at most stored verbatim */
+                        const uint32_t num_blocks = (num_samples + SAMPLE_RICE_BLOCK_LENGTH - 1) /
+                                SAMPLE_RICE_BLOCK_LENGTH;
+                        return (num_blocks * 5 + num_samples * 16 + 7) / 8;
+                }
+                default:
+                        return num_samples * sizeof(uint16_t);
+        }
+}
+
+
+uint32_t SAMPLE_CODING::pack_samples(
+        const uint16_t* p_samples,
+        const uint32_t& num_samples,
+        uint8_t* p_packed){
+
+        uint32_t i = 0;
+        uint8_t* p_output = p_packed;
+
+        #if defined(__SSE2__)
+        /**
+         * 8 samples into 12 bytes. The pairs are merged into 24 bits in every
+         * 32-bit lane, the lanes into 48 bits in every 64-bit lane, and the
+         * upper 64-bit lane is moved next to the lower
+         */
+        const __m128i mask_first = _mm_set1_epi32(0x00000FFF);
+        const __m128i mask_second = _mm_set1_epi32(0x00FFF000);
+        const __m128i mask_lower_word = _mm_set1_epi64x(0x0000000000FFFFFFll);
+        const __m128i mask_upper_word = _mm_set1_epi64x(0x0000FFFFFF000000ll);
+        for(; i + 8 <= num_samples; i += 8){
+                __m128i samples = _mm_loadu_si128((const __m128i*) (p_samples + i));
+                __m128i pairs = _mm_or_si128(_mm_and_si128(samples, mask_first),
+                        _mm_and_si128(_mm_srli_epi32(samples, 4), mask_second));
+                __m128i quads = _mm_or_si128(_mm_and_si128(pairs, mask_lower_word),
+                        _mm_and_si128(_mm_srli_epi64(pairs, 8), mask_upper_word));
+                __m128i packed = _mm_or_si128(_mm_move_epi64(quads),
+                        _mm_slli_si128(_mm_srli_si128(quads, 8), 6));
+
+                _mm_storel_epi64((__m128i*) p_output, packed);
+                int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+                memcpy(p_output + 8, &tail, sizeof(int32_t));
+                p_output += 12;
+        }
+        #endif /* __SSE2__ */
+
+        for(; i + 2 <= num_samples; i += 2){
+                pack_pair(p_samples + i, p_output);
+                p_output += 3;
+        }
+
+        if(i < num_samples){
+                const uint16_t sample = p_samples[i] & 0xFFFu;
+                memcpy(p_output, &sample, sizeof(uint16_t));
+                p_output += sizeof(uint16_t);
+        }
+
+        return (uint32_t) (p_output - p_packed);
+}
+
+
+void SAMPLE_CODING::unpack_samples(
+        const uint8_t* p_packed,
+        const uint32_t& num_samples,
+        uint16_t* p_samples){
+
+        uint32_t i = 0;
+        const uint8_t* p_input = p_packed;
+
+        #if defined(__SSE2__)
+        /* The reverse of pack_samples(), never reading past the 12 bytes */
+        const __m128i mask_lower_lane = _mm_set_epi64x(0, 0x0000FFFFFFFFFFFFll);
+        const __m128i mask_upper_lane = _mm_set_epi64x(0x0000FFFFFFFFFFFFll, 0);
+        const __m128i mask_lower_word = _mm_set1_epi64x(0x0000000000FFFFFFll);
+        const __m128i mask_upper_word = _mm_set1_epi64x(0x00FFFFFF00000000ll);
+        const __m128i mask_first = _mm_set1_epi32(0x00000FFF);
+        const __m128i mask_second = _mm_set1_epi32(0x0FFF0000);
+        for(; i + 8 <= num_samples; i += 8){
+                int32_t tail;
+                memcpy(&tail, p_input + 8, sizeof(int32_t));
+                __m128i packed = _mm_or_si128(_mm_loadl_epi64((const __m128i*) p_input),
+                        _mm_slli_si128(_mm_cvtsi32_si128(tail), 8));
+
+                __m128i quads = _mm_or_si128(_mm_and_si128(packed, mask_lower_lane),
+                        _mm_and_si128(_mm_slli_si128(packed, 2), mask_upper_lane));
+                __m128i pairs = _mm_or_si128(_mm_and_si128(quads, mask_lower_word),
+                        _mm_and_si128(_mm_slli_epi64(quads, 8), mask_upper_word));
+                __m128i samples = _mm_or_si128(_mm_and_si128(pairs, mask_first),
+                        _mm_and_si128(_mm_slli_epi32(pairs, 4), mask_second));
+
+                _mm_storeu_si128((__m128i*) (p_samples + i), samples);
+                p_input += 12;
+        }
+        #endif /* __SSE2__ */
+
+        for(; i + 2 <= num_samples; i += 2){
+                unpack_pair(p_input, p_samples + i);
+                p_input += 3;
+        }
+
+        if(i < num_samples){
+                memcpy(&p_samples[i], p_input, sizeof(uint16_t));
+        }
+}
+
+
+uint32_t SAMPLE_CODING::encode_rice(
+        const uint16_t* p_samples,
+        const uint32_t& num_samples,
+        const uint32_t& num_channels,
+        uint8_t* p_encoded){
+
+        BitWriter writer = { p_encoded, 0, 0 };
+
+        for(uint32_t start = 0; start < num_samples; start += SAMPLE_RICE_BLOCK_LENGTH){
+                const uint32_t end = std::min(start + SAMPLE_RICE_BLOCK_LENGTH, num_samples);
+                const uint32_t block_length = end - start;
+
+                /* The parameter is estimated from the mean residual, and the neighbours tried */
+                uint32_t residuals[SAMPLE_RICE_BLOCK_LENGTH];
+                uint64_t sum = 0;
+                for(uint32_t i = 0; i < block_length; i++){
+                        residuals[i] = get_zigzag_residual(p_samples, start + i, num_channels);
+                        sum += residuals[i];
+                }
+                const uint32_t mean = (uint32_t) (sum / block_length);
+                const uint32_t k_estimate = mean ? 31u - __builtin_clz(mean) : 0u;
+
+                uint32_t best_k = SAMPLE_RICE_VERBATIM;
+                uint32_t best_length = block_length * 16u;
+                for(uint32_t k = (k_estimate ? k_estimate - 1 : 0); k <= std::min(k_estimate + 1, 16u); k++){
+                        uint32_t length = 0;
+                        for(uint32_t i = 0; i < block_length; i++){
+                                length += get_code_length(residuals[i], k);
+                        }
+                        if(length < best_length){
+                                best_length = length;
+                                best_k = k;
+                        }
+                }
+
+                write_bits(writer, best_k, 5);
+                if(best_k == SAMPLE_RICE_VERBATIM){
+                        for(uint32_t i = start; i < end; i++){
+                                write_bits(writer, p_samples[i], 16);
+                        }
+                        continue;
+                }
+
+                for(uint32_t i = 0; i < block_length; i++){
+                        const uint32_t z = residuals[i];
+                        const uint32_t quotient = z >> best_k;
+                        if(quotient < SAMPLE_RICE_ESCAPE){
+                                /* The quotient in unary, a zero and the lower bits */
+                                write_bits(writer, ((1ull << quotient) - 1) |
+                                        ((uint64_t) (z & ((1u << best_k) - 1)) << (quotient + 1)),
+                                        quotient + 1 + best_k);
+                        }
+                        else{
+                                write_bits(writer, ((1ull << SAMPLE_RICE_ESCAPE) - 1) |
+                                        ((uint64_t) z << SAMPLE_RICE_ESCAPE),
+                                        SAMPLE_RICE_ESCAPE + ESCAPED_BITS);
+                        }
+                }
+        }
+
+        /* Flushing the last byte */
+        if(writer.num_bits){
+                write_bits(writer, 0, 8 - writer.num_bits);
+        }
+        return (uint32_t) (writer.p_data - p_encoded);
+}
+
+
+uint8_t SAMPLE_CODING::decode_rice(
+        const uint8_t* p_encoded,
+        const uint32_t& length,
+        const uint32_t& num_samples,
+        const uint32_t& num_channels,
+        uint16_t* p_samples){
+
+        if(!p_encoded || !num_channels){
+                return 0;
+        }
+        BitReader reader = { p_encoded, p_encoded + length, 0, 0 };
+
+        for(uint32_t start = 0; start < num_samples; start += SAMPLE_RICE_BLOCK_LENGTH){
+                const uint32_t end = std::min(start + SAMPLE_RICE_BLOCK_LENGTH, num_samples);
+
+                uint32_t k;
+                if(!read_bits(reader, 5, k) || (k > 16 && k != SAMPLE_RICE_VERBATIM)){
+                        return 0;
+                }
+
+                for(uint32_t i = start; i < end; i++){
+                        uint32_t value;
+                        if(k == SAMPLE_RICE_VERBATIM){
+                                if(!read_bits(reader, 16, value)){
+                                        return 0;
+                                }
+                                p_samples[i] = (uint16_t) value;
+                                continue;
+                        }
+
+                        /* Counting the ones of the quotient. Bits past the end are zero */
+                        refill_bits(reader);
+                        const uint32_t quotient = __builtin_ctzll(~reader.bits | (1ull << SAMPLE_RICE_ESCAPE));
+                        uint32_t z;
+                        if(quotient < SAMPLE_RICE_ESCAPE){
+                                uint32_t remainder = 0;
+                                if(!read_bits(reader, quotient + 1, value) ||
+                                   !read_bits(reader, k, remainder)){
+                                        return 0;
+                                }
+                                z = (quotient << k) | remainder;
+                        }
+                        else if(!read_bits(reader, SAMPLE_RICE_ESCAPE, value) ||
+                                !read_bits(reader, ESCAPED_BITS, z)){
+                                return 0;
+                        }
+
+                        const int32_t prediction = (i >= num_channels) ? p_samples[i - num_channels] : 0;
+                        const int32_t sample = prediction + ((int32_t) (z >> 1) ^ -(int32_t) (z & 1));
+                        if(sample < 0 || sample > 0xFFFF){
+                                return 0;
+                        }
+                        p_samples[i] = (uint16_t) sample;
+                }
+        }
+
+        /* Only the padding of the last byte may be left */
+        refill_bits(reader);
+        return reader.p_data == reader.p_end && reader.num_bits < 8;
+}
+
+
+uint32_t SAMPLE_CODING::encode_samples(
+        const uint32_t& encoding,
+        const uint16_t* p_samples,
+        const uint32_t& num_samples,
+        const uint32_t& num_channels,
+        uint8_t* p_encoded){
+
+        switch(encoding){
+                case SAMPLE_ENCODING_RAW:
+                        memcpy(p_encoded, p_samples, num_samples * sizeof(uint16_t));
+                        return num_samples * sizeof(uint16_t);
+                case SAMPLE_ENCODING_PACKED:
+                        return SAMPLE_CODING::pack_samples(p_samples, num_samples, p_encoded);
+                case SAMPLE_ENCODING_RICE:
+                        return SAMPLE_CODING::encode_rice(p_samples, num_samples, num_channels, p_encoded);
+                default:
+                        return 0;
+        }
+}
+
+
+uint8_t SAMPLE_CODING::decode_samples(
+        const uint32_t& encoding,
+        const uint8_t* p_encoded,
+        const uint32_t& length,
+        const uint32_t& num_samples,
+        const uint32_t& num_channels,
+        uint16_t* p_samples){
+
+        switch(encoding){
+                case SAMPLE_ENCODING_RAW:
+                        if(length != num_samples * sizeof(uint16_t)){
+                                return 0;
+                        }
+                        memcpy(p_samples, p_encoded, length);
+                        return 1;
+                case SAMPLE_ENCODING_PACKED:
+                        if(length != SAMPLE_CODING::get_max_encoded_size(encoding, num_samples)){
+                                return 0;
+                        }
+                        SAMPLE_CODING::unpack_samples(p_encoded, num_samples, p_samples);
+                        return 1;
+                case SAMPLE_ENCODING_RICE:
+                        return SAMPLE_CODING::decode_rice(p_encoded, length, num_samples,
+                                num_channels, p_samples);
+                default:
+                        return 0;
+        }
+}
@@ -0,0 +1,216 @@
+#include "simulation.h"
+
+/**
+ * Helper-functions for the simulator
+ */
+namespace{
+
+        /* Fraction of the pulse used to ramp the amplitude up and down */
+        constexpr float32_t PULSE_RAMP_FRACTION = 0.1f;
+
+        /**
+         * Xorshift32. Cheap and deterministic, such that a seed always gives
+         * the same noise on both the MCU and the host
+         */
+        uint32_t next_random(uint32_t& state){
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return state;
+        }
+
+        /* Uniform in (0, 1], such that the logarithm is finite */
+        float32_t next_uniform(uint32_t& state){
+                return ((next_random(state) >> 8) + 1u) * (1.0f / 16777216.0f);
+        }
+
+        /**
+         * Pulse sent at time 0, evaluated at time @p t [s]. The edges are
+         * shaped with a raised cosine, to avoid the broadband click of
+         * a rectangular window
+         */
+        float32_t evaluate_pulse(
+                const SimulationConfig& config,
+                const float32_t& ramp_length,
+                const double& t){
+
+                if(t < 0.0 || t >= config.pulse_length){
+                        return 0.0f;
+                }
+
+                float32_t window = 1.0f;
+                float32_t t_edge = (float32_t) std::min(t, config.pulse_length - t);
+                if(t_edge < ramp_length){
+                        window = 0.5f * (1.0f - std::cos((float32_t) M_PI * t_edge / ramp_length));
+                }
+
+                /* The phase is calculated in double, as t * f grows large */
+                return window * (float32_t) std::sin(2.0 * M_PI * config.pinger_frequency * t);
+        }
+
+        /* Distance from @p source to @p position */
+        float32_t calculate_distance(
+                const float32_t (&source)[3],
+                const float32_t (&position)[3]){
+
+                float32_t dx = source[0] - position[0];
+                float32_t dy = source[1] - position[1];
+                float32_t dz = source[2] - position[2];
+                return std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+
+} /* namespace */
+
+
+/**
+ * Functions for the simulator
+ */
+void SIMULATION::get_default_config(SimulationConfig& config){
+        config.source_position[0] = SOURCE_POS_X;
+        config.source_position[1] = SOURCE_POS_Y;
+        config.source_position[2] = SOURCE_POS_Z;
+        config.pinger_frequency = SIM_PINGER_FREQUENCY;
+        config.pulse_length = SIM_PULSE_LENGTH;
+        config.pulse_start = SIM_PULSE_START;
+        config.amplitude = SIM_AMPLITUDE;
+        config.noise_std = SIM_NOISE_STD;
+        config.surface_z = 0.0f;
+        config.surface_reflection = 0.0f;
+        config.bottom_z = 0.0f;
+        config.bottom_reflection = 0.0f;
+        config.seed = 1u;
+}
+
+
+template<uint32_t N>
+void SIMULATION::render_adc_data(
+        const SimulationConfig& config,
+        const float32_t (&positions)[N][3],
+        uint16_t* p_adc_data){
+
+        /**
+         * The paths from the source to the hydrophones. The reflections are
+         * given by mirroring the source in the surface and the bottom, and are
+         * skipped if the coefficient is 0
+         */
+        constexpr uint32_t max_num_paths = 3;
+        float32_t sources[max_num_paths][3];
+        float32_t coefficients[max_num_paths];
+        uint32_t num_paths = 0;
+
+        const float32_t mirror_z[max_num_paths] = {
+                config.source_position[2],
+                2.0f * config.surface_z - config.source_position[2],
+                2.0f * config.bottom_z - config.source_position[2] };
+        const float32_t reflection[max_num_paths] = {
+                1.0f, config.surface_reflection, config.bottom_reflection };
+
+        for(uint32_t path = 0; path < max_num_paths; path++){
+                if(reflection[path] == 0.0f){
+                        continue;
+                }
+                sources[num_paths][0] = config.source_position[0];
+                sources[num_paths][1] = config.source_position[1];
+                sources[num_paths][2] = mirror_z[path];
+                coefficients[num_paths] = reflection[path];
+                num_paths++;
+        }
+
+        /**
+         * Delay and amplitude of each path to each hydrophone, relative to the
+         * direct path to the reference hydrophone. The amplitude
+         * falls with the distance (spherical spreading), normalized such that
+         * the direct path has config.amplitude
+         */
+        const float32_t reference_distance =
+                calculate_distance(config.source_position, positions[0]);
+
+        double delays[N][max_num_paths];
+        float32_t gains[N][max_num_paths];
+        for(uint32_t hyd = 0; hyd < N; hyd++){
+                float32_t direct_distance = std::max(
+                        calculate_distance(config.source_position, positions[hyd]), 1e-3f);
+
+                for(uint32_t path = 0; path < num_paths; path++){
+                        float32_t distance = std::max(
+                                calculate_distance(sources[path], positions[hyd]), 1e-3f);
+                        delays[hyd][path] = config.pulse_start +
+                                (double) (distance - reference_distance) / SOUND_SPEED;
+                        gains[hyd][path] = config.amplitude * coefficients[path] *
+                                direct_distance / distance;
+                }
+        }
+
+        /**
+         * Rendering the frame sample by sample, in the order given by the DMA
+         */
+        const float32_t ramp_length = PULSE_RAMP_FRACTION * config.pulse_length;
+        uint32_t random_state = config.seed ? config.seed : 1u;
+
+        for(uint32_t i = 0; i < DMA_BUFFER_LENGTH; i++){
+                const double t = (double) i / SAMPLE_FREQUENCY;
+
+                for(uint32_t hyd = 0; hyd < N; hyd++){
+                        float32_t value = 0.0f;
+                        for(uint32_t path = 0; path < num_paths; path++){
+                                value += gains[hyd][path] * evaluate_pulse(
+                                        config, ramp_length, t - delays[hyd][path]);
+                        }
+
+                        /* Box-Muller */
+                        if(config.noise_std > 0.0f){
+                                float32_t u1 = next_uniform(random_state);
+                                float32_t u2 = next_uniform(random_state);
+                                value += config.noise_std * std::sqrt(-2.0f * std::log(u1)) *
+                                        std::cos(2.0f * (float32_t) M_PI * u2);
+                        }
+
+                        value = std::round(ADC_MID_VALUE + value);
+                        value = std::min(std::max(value, 0.0f), (float32_t) ADC_MAX_VALUE);
+                        p_adc_data[N * i + hyd] = (uint16_t) value;
+                }
+        }
+}
+
+
+template<uint32_t N>
+void SIMULATION::calculate_expected_lags(
+        const SimulationConfig& config,
+        const float32_t (&positions)[N][3],
+        float32_t (&lag_array)[HydrophonePairs<N>::count]){
+
+        float32_t toa[N];
+        for(uint32_t hyd = 0; hyd < N; hyd++){
+                toa[hyd] = calculate_distance(config.source_position, positions[hyd]) *
+                        (SAMPLE_FREQUENCY / SOUND_SPEED);
+        }
+
+        unroll<HydrophonePairs<N>::count>([&](uint32_t pair){
+                lag_array[pair] = toa[HydrophonePairs<N>::first(pair)] -
+                                  toa[HydrophonePairs<N>::second(pair)];
+        });
+}
+
+
+void SIMULATION::render_ping(
+        const SimulationConfig& config,
+        uint16_t* p_adc_data){
+
+        SIMULATION::render_adc_data<NUM_HYDROPHONES>(config, HYDROPHONE_POSITIONS, p_adc_data);
+}
+
+
+/**
+ * Explicit instantiation for the supported number of hydrophones
+ */
+#define INSTANTIATE_SIMULATION(N)                                               \
+        template void SIMULATION::render_adc_data<N>(                           \
+                const SimulationConfig&, const float32_t (&)[N][3],             \
+                uint16_t*);                                                     \
+        template void SIMULATION::calculate_expected_lags<N>(                   \
+                const SimulationConfig&, const float32_t (&)[N][3],             \
+                float32_t (&)[HydrophonePairs<N>::count]);
+
+INSTANTIATE_SIMULATION(3)
+INSTANTIATE_SIMULATION(4)
+INSTANTIATE_SIMULATION(5)
@@ -0,0 +1,220 @@
+#include "telemetry.h"
+
+/**
+ * Functions for the telemetry
+ */
+void TELEMETRY::initialize_batch(TelemetryBatch& batch){
+        batch.sequence = 0;
+        batch.num_records = 0;
+}
+
+
+void TELEMETRY::initialize_record(
+        const uint32_t& sequence,
+        const uint64_t& timestamp,
+        TelemetryRecord& record){
+
+        memset(&record, 0, sizeof(TelemetryRecord));
+        record.sequence = sequence;
+        record.timestamp = timestamp;
+
+        for(uint32_t stage = 0; stage < NUM_PROFILING_STAGES; stage++){
+                record.stage_us[stage] = (uint32_t) TIMING::ticks_to_us(
+                        PROFILING::stage_profiles[stage].timing.last_ticks);
+        }
+}
+
+
+void TELEMETRY::set_lags(
+        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+        TelemetryRecord& record){
+
+        /* The lags are signed, although stored as uint32_t */
+        unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+                record.lags[pair] = (int32_t) *p_lag_array[pair];
+        });
+}
+
+
+uint8_t TELEMETRY::add_record(
+        const TelemetryRecord& record,
+        TelemetryBatch& batch){
+
+        batch.records[batch.num_records] = record;
+        batch.num_records++;
+        return batch.num_records >= TELEMETRY_BATCH_SIZE;
+}
+
+
+uint32_t TELEMETRY::write_packet(
+        TelemetryBatch& batch,
+        uint8_t* p_packet){
+
+        if(!batch.num_records){
+                return 0;
+        }
+
+        TelemetryPacketHeader header;
+        header.magic = TELEMETRY_MAGIC;
+        header.version = TELEMETRY_VERSION;
+        header.record_size = sizeof(TelemetryRecord);
+        header.sequence = batch.sequence;
+        header.num_records = batch.num_records;
+        header.num_hydrophones = NUM_HYDROPHONES;
+        memcpy(p_packet, &header, sizeof(TelemetryPacketHeader));
+
+        /* The records are already in the format sent, and copied as a block */
+        const uint32_t records_size = batch.num_records * sizeof(TelemetryRecord);
+        memcpy(p_packet + sizeof(TelemetryPacketHeader), batch.records, records_size);
+
+        batch.sequence++;
+        batch.num_records = 0;
+        return sizeof(TelemetryPacketHeader) + records_size;
+}
+
+
+uint8_t TELEMETRY::parse_packet(
+        const uint8_t* data,
+        const uint32_t& length,
+        TelemetryPacketHeader& header,
+        TelemetryRecord* records,
+        const uint32_t& max_num_records){
+
+        if(!data || length < sizeof(TelemetryPacketHeader)){
+                return 0;
+        }
+
+        /* Copying, as the data is not necessarily aligned */
+        memcpy(&header, data, sizeof(TelemetryPacketHeader));
+
+        if(header.magic != TELEMETRY_MAGIC || header.version < TELEMETRY_VERSION){
+                return 0;
+        }
+
+        if(header.record_size < sizeof(TelemetryRecord) ||
+           header.num_records > max_num_records ||
+           header.num_hydrophones < 3 || header.num_hydrophones > MAX_NUM_HYDROPHONES ||
+           length != sizeof(TelemetryPacketHeader) + header.num_records * header.record_size){
+                return 0;
+        }
+
+        /* Fields appended by a later version are skipped */
+        const uint8_t* p_record = data + sizeof(TelemetryPacketHeader);
+        for(uint32_t i = 0; i < header.num_records; i++){
+                memcpy(&records[i], p_record, sizeof(TelemetryRecord));
+                p_record += header.record_size;
+        }
+
+        return 1;
+}
+
+
+uint32_t TELEMETRY::write_frame_header(
+        const uint8_t* p_source_mac,
+        const uint16_t& identification,
+        const uint16_t& destination_port,
+        const uint32_t& payload_length,
+        uint8_t* p_frame){
+
+        const uint32_t udp_length = 8u + payload_length;
+        const uint32_t ip_length = 20u + udp_length;
+
+        /* Every field is big-endian */
+        auto write_u16 = [](uint8_t* p, uint32_t value){
+                p[0] = (uint8_t) (value >> 8);
+                p[1] = (uint8_t) value;
+        };
+        auto write_u32 = [&](uint8_t* p, uint32_t value){
+                write_u16(p, value >> 16);
+                write_u16(p + 2, value);
+        };
+
+        /* Ethernet. Sent to the broadcast-address, as no ARP is implemented */
+        uint8_t* p_ethernet = p_frame;
+        memset(p_ethernet, 0xFF, 6);
+        memcpy(p_ethernet + 6, p_source_mac, 6);
+        write_u16(p_ethernet + 12, 0x0800u);
+
+        /* IPv4, without options and never fragmented */
+        uint8_t* p_ip = p_ethernet + 14;
+        p_ip[0] = 0x45;
+        p_ip[1] = 0;
+        write_u16(p_ip + 2, ip_length);
+        write_u16(p_ip + 4, identification);
+        write_u16(p_ip + 6, 0x4000u);
+        p_ip[8] = 64;
+        p_ip[9] = 17;
+        write_u16(p_ip + 10, 0);
+        write_u32(p_ip + 12, TELEMETRY_SOURCE_IP);
+        write_u32(p_ip + 16, TELEMETRY_DEST_IP);
+        write_u16(p_ip + 10, TELEMETRY::calculate_ip_checksum(p_ip, 20));
+
+        /* UDP. The checksum is inserted by the MAC */
+        uint8_t* p_udp = p_ip + 20;
+        write_u16(p_udp, TELEMETRY_SOURCE_PORT);
+        write_u16(p_udp + 2, destination_port);
+        write_u16(p_udp + 4, udp_length);
+        write_u16(p_udp + 6, 0);
+
+        return TELEMETRY_FRAME_HEADER_SIZE + payload_length;
+}
+
+
+uint8_t TELEMETRY::parse_frame_header(
+        const uint8_t* p_frame,
+        const uint32_t& frame_length,
+        const uint16_t& destination_port,
+        const uint8_t*& p_payload,
+        uint32_t& payload_length){
+
+        /* Every field is big-endian */
+        auto read_u16 = [](const uint8_t* p){
+                return (uint32_t) (((uint32_t) p[0] << 8) | p[1]);
+        };
+        auto read_u32 = [&](const uint8_t* p){
+                return (read_u16(p) << 16) | read_u16(p + 2);
+        };
+
+        if(!p_frame || frame_length < TELEMETRY_FRAME_HEADER_SIZE ||
+           read_u16(p_frame + 12) != 0x0800u){
+                return 0;
+        }
+
+        /* IPv4 with any options, UDP and not fragmented */
+        const uint8_t* p_ip = p_frame + 14;
+        const uint32_t ip_header_length = 4u * (p_ip[0] & 0x0Fu);
+        const uint32_t ip_length = read_u16(p_ip + 2);
+        const uint32_t destination_ip = read_u32(p_ip + 16);
+        if((p_ip[0] >> 4) != 4u || ip_header_length < 20u || p_ip[9] != 17u ||
+           (read_u16(p_ip + 6) & 0x3FFFu) ||
+           ip_length < ip_header_length + 8u || 14u + ip_length > frame_length ||
+           (destination_ip != TELEMETRY_SOURCE_IP && destination_ip != 0xFFFFFFFFu)){
+                return 0;
+        }
+
+        const uint8_t* p_udp = p_ip + ip_header_length;
+        const uint32_t udp_length = read_u16(p_udp + 4);
+        if(read_u16(p_udp + 2) != destination_port ||
+           udp_length < 8u || ip_header_length + udp_length > ip_length){
+                return 0;
+        }
+
+        p_payload = p_udp + 8;
+        payload_length = udp_length - 8u;
+        return 1;
+}
+
+
+uint16_t TELEMETRY::calculate_ip_checksum(
+        const uint8_t* data,
+        const uint32_t& length){
+
+        uint32_t sum = 0;
+        for(uint32_t i = 0; i + 1 < length; i += 2){
+                sum += ((uint32_t) data[i] << 8) | data[i + 1];
+        }
+        while(sum >> 16){
+                sum = (sum & 0xFFFFu) + (sum >> 16);
+        }
+        return (uint16_t) ~sum;
+}
@@ -0,0 +1,517 @@
+#include "telemetry_transport.h"
+
+#if defined(__arm__)
+  #include "main.h"
+#else
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+  #include <sys/uio.h>
+  #include <unistd.h>
+#endif /* __arm__ */
+
+static_assert(TELEMETRY_FRAME_HEADER_SIZE + TELEMETRY_MAX_PACKET_SIZE <= 1514u,
+        "A telemetry-packet must fit in a single Ethernet-frame");
+static_assert(TELEMETRY_FRAME_HEADER_SIZE + COMMAND_MAX_PACKET_SIZE <= 1514u,
+        "A command must fit in a single Ethernet-frame");
+
+/**
+ * Number of telemetry-packets that can be in flight, and the size of the
+ * Tx-ring holding a complete raw frame, a trace-dump and a reply next to them
+ */
+#define TELEMETRY_NUM_BUFFERS 2u
+#define REPLY_NUM_DESCRIPTORS 1u
+#if USE_TRACE
+  #define TRACE_NUM_DESCRIPTORS TRACE_PACKETS_PER_DUMP
+#else
+  #define TRACE_NUM_DESCRIPTORS 0u
+#endif /* USE_TRACE */
+#define TX_RING_SIZE          (RAW_STREAM_PACKETS_PER_FRAME + TELEMETRY_NUM_BUFFERS + \
+                               TRACE_NUM_DESCRIPTORS + REPLY_NUM_DESCRIPTORS)
+#define TX_HEADER_SIZE        ((TELEMETRY_FRAME_HEADER_SIZE + \
+                               std::max(sizeof(RawStreamHeader), sizeof(TraceHeader)) + 3u) & ~3u)
+
+/* Size of the samples of a packet, when packed into 12 bits */
+#define RAW_PACKED_SIZE       ((RAW_STREAM_PACKET_SAMPLES / 2u) * 3u + (RAW_STREAM_PACKET_SAMPLES % 2u) * 2u)
+
+/**
+ * State of the transport
+ */
+namespace{
+
+        TransportStatistics transport_statistics;
+
+        #if USE_TRACE
+        /* Copy of the trace being sent */
+        TraceBuffer trace_snapshot;
+        #endif /* USE_TRACE */
+
+        #if RAW_STREAM_PACKED
+        /* The packed samples of every packet in a raw frame */
+        uint8_t raw_payloads[RAW_STREAM_PACKETS_PER_FRAME][RAW_PACKED_SIZE] __attribute__((aligned(4)));
+        #endif /* RAW_STREAM_PACKED */
+
+        #if defined(__arm__)
+        /* Descriptors used by the DMA of the ETH-peripheral */
+        ETH_DMADescTypeDef tx_descriptors[TX_RING_SIZE] __attribute__((aligned(4)));
+        ETH_DMADescTypeDef rx_descriptors[ETH_RXBUFNB] __attribute__((aligned(4)));
+
+        /* Headers of every Tx-descriptor, and the received frames */
+        uint8_t tx_headers[TX_RING_SIZE][TX_HEADER_SIZE] __attribute__((aligned(4)));
+        uint8_t rx_buffers[ETH_RXBUFNB][ETH_RX_BUF_SIZE] __attribute__((aligned(4)));
+
+        /* Telemetry-packets, and the descriptor last sending each of them */
+        uint8_t telemetry_packets[TELEMETRY_NUM_BUFFERS][TELEMETRY_MAX_PACKET_SIZE] __attribute__((aligned(4)));
+        uint32_t telemetry_descriptors[TELEMETRY_NUM_BUFFERS];
+        uint32_t next_telemetry_packet = 0;
+
+        /* The reply being sent, and the descriptor sending it */
+        uint8_t reply_buffer[COMMAND_MAX_PACKET_SIZE] __attribute__((aligned(4)));
+        uint32_t reply_descriptor = 0;
+
+        /* Next descriptor to fill, and the last descriptor of the last raw frame and trace */
+        uint32_t tx_index = 0;
+        uint32_t raw_last_descriptor = 0;
+        uint32_t trace_last_descriptor = 0;
+
+        /* Identification of the next IPv4-datagram */
+        uint16_t ip_identification = 0;
+
+        /* Checks if the next @p count descriptors are released by the DMA */
+        uint8_t check_free_descriptors(const uint32_t& count){
+                for(uint32_t i = 0; i < count; i++){
+                        if(tx_descriptors[(tx_index + i) % TX_RING_SIZE].Status & ETH_DMATXDESC_OWN){
+                                return 0;
+                        }
+                }
+                return 1;
+        }
+
+        /**
+         * Hands the next descriptor to the DMA. The headers are already
+         * written to tx_headers[tx_index]
+         */
+        void queue_descriptor(
+                const uint32_t& header_length,
+                const void* p_payload,
+                const uint32_t& payload_length){
+
+                ETH_DMADescTypeDef& descriptor = tx_descriptors[tx_index];
+                descriptor.Buffer2NextDescAddr = (uint32_t) p_payload;
+                descriptor.ControlBufferSize = (header_length & ETH_DMATXDESC_TBS1) |
+                        ((payload_length << 16) & ETH_DMATXDESC_TBS2);
+
+                /* Everything must be written before the DMA owns the descriptor */
+                __DSB();
+                descriptor.Status = (descriptor.Status & ETH_DMATXDESC_TER) |
+                        ETH_DMATXDESC_CIC_TCPUDPICMP_FULL | ETH_DMATXDESC_FS |
+                        ETH_DMATXDESC_LS | ETH_DMATXDESC_OWN;
+
+                tx_index = (tx_index + 1) % TX_RING_SIZE;
+        }
+
+        /* Resumes the DMA, which is suspended when it reaches a released descriptor */
+        void resume_transmission(){
+                __DSB();
+                if(heth.Instance->DMASR & ETH_DMASR_TBUS){
+                        heth.Instance->DMASR = ETH_DMASR_TBUS;
+                }
+                heth.Instance->DMATPDR = 0;
+        }
+
+        /**
+         * Hands the descriptors of the last received frame back to the DMA,
+         * and resumes the reception if it was suspended by a full ring
+         */
+        void release_received_frame(){
+                ETH_DMADescTypeDef* p_descriptor = heth.RxFrameInfos.FSRxDesc;
+                for(uint32_t i = 0; i < heth.RxFrameInfos.SegCount; i++){
+                        p_descriptor->Status |= ETH_DMARXDESC_OWN;
+                        p_descriptor = (ETH_DMADescTypeDef*) p_descriptor->Buffer2NextDescAddr;
+                }
+                heth.RxFrameInfos.SegCount = 0;
+
+                __DSB();
+                if(heth.Instance->DMASR & ETH_DMASR_RBUS){
+                        heth.Instance->DMASR = ETH_DMASR_RBUS;
+                        heth.Instance->DMARPDR = 0;
+                }
+        }
+        #else
+        /* Sockets towards the loopback-address, and the buffer of the packet */
+        int telemetry_socket = -1;
+        int raw_socket = -1;
+        int trace_socket = -1;
+        int reply_socket = -1;
+        int command_socket = -1;
+        uint8_t telemetry_packet[TELEMETRY_MAX_PACKET_SIZE];
+
+        /* Opens a socket sending to @p port on the loopback-address */
+        int open_socket(const uint16_t& port){
+                int socket_descriptor = socket(AF_INET, SOCK_DGRAM, 0);
+                if(socket_descriptor < 0){
+                        return -1;
+                }
+
+                int buffer_size = 1 << 20;
+                setsockopt(socket_descriptor, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+                struct sockaddr_in destination;
+                memset(&destination, 0, sizeof(destination));
+                destination.sin_family = AF_INET;
+                destination.sin_port = htons(port);
+                destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                if(connect(socket_descriptor, (const struct sockaddr*) &destination, sizeof(destination)) != 0){
+                        close(socket_descriptor);
+                        return -1;
+                }
+                return socket_descriptor;
+        }
+
+        /**
+         * Opens a socket listening to @p port on the loopback-address. The
+         * address may be reused, such that several tools can be run at once
+         */
+        int open_listening_socket(const uint16_t& port){
+                int socket_descriptor = socket(AF_INET, SOCK_DGRAM, 0);
+                if(socket_descriptor < 0){
+                        return -1;
+                }
+
+                int bool_reuse = 1;
+                setsockopt(socket_descriptor, SOL_SOCKET, SO_REUSEADDR, &bool_reuse, sizeof(bool_reuse));
+
+                struct sockaddr_in address;
+                memset(&address, 0, sizeof(address));
+                address.sin_family = AF_INET;
+                address.sin_port = htons(port);
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                if(bind(socket_descriptor, (const struct sockaddr*) &address, sizeof(address)) != 0){
+                        close(socket_descriptor);
+                        return -1;
+                }
+                return socket_descriptor;
+        }
+        #endif /* __arm__ */
+
+} /* namespace */
+
+
+/**
+ * Functions for the transport of the telemetry
+ */
+uint8_t TELEMETRY_TRANSPORT::initialize_transport(){
+        memset(&transport_statistics, 0, sizeof(TransportStatistics));
+
+        #if defined(__arm__)
+        /* Ring-mode, where the second buffer of every descriptor holds the payload */
+        for(uint32_t i = 0; i < TX_RING_SIZE; i++){
+                tx_descriptors[i].Status = ETH_DMATXDESC_CIC_TCPUDPICMP_FULL;
+                tx_descriptors[i].ControlBufferSize = 0;
+                tx_descriptors[i].Buffer1Addr = (uint32_t) tx_headers[i];
+                tx_descriptors[i].Buffer2NextDescAddr = 0;
+        }
+        tx_descriptors[TX_RING_SIZE - 1].Status |= ETH_DMATXDESC_TER;
+        heth.Instance->DMATDLAR = (uint32_t) tx_descriptors;
+
+        tx_index = 0;
+        raw_last_descriptor = 0;
+        trace_last_descriptor = 0;
+        reply_descriptor = 0;
+        next_telemetry_packet = 0;
+        for(uint32_t i = 0; i < TELEMETRY_NUM_BUFFERS; i++){
+                telemetry_descriptors[i] = 0;
+        }
+
+        return HAL_ETH_DMARxDescListInit(&heth, rx_descriptors, &rx_buffers[0][0], ETH_RXBUFNB) == HAL_OK &&
+               HAL_ETH_Start(&heth) == HAL_OK;
+        #else
+        TELEMETRY_TRANSPORT::close_transport();
+        telemetry_socket = open_socket(TELEMETRY_DEST_PORT);
+        raw_socket = open_socket(RAW_STREAM_DEST_PORT);
+        trace_socket = open_socket(TRACE_DEST_PORT);
+        reply_socket = open_socket(COMMAND_REPLY_PORT);
+        command_socket = open_listening_socket(COMMAND_PORT);
+        if(telemetry_socket < 0 || raw_socket < 0 || trace_socket < 0 ||
+           reply_socket < 0 || command_socket < 0){
+                TELEMETRY_TRANSPORT::close_transport();
+                return 0;
+        }
+        return 1;
+        #endif /* __arm__ */
+}
+
+
+void TELEMETRY_TRANSPORT::close_transport(){
+        #if !defined(__arm__)
+        for(int* p_socket : { &telemetry_socket, &raw_socket, &trace_socket,
+                              &reply_socket, &command_socket }){
+                if(*p_socket >= 0){
+                        close(*p_socket);
+                        *p_socket = -1;
+                }
+        }
+        #endif /* __arm__ */
+}
+
+
+uint8_t TELEMETRY_TRANSPORT::send_batch(TelemetryBatch& batch){
+        if(!batch.num_records){
+                return 0;
+        }
+
+        #if defined(__arm__)
+        /* The packet is written to a buffer not read by any descriptor */
+        uint8_t* p_packet = telemetry_packets[next_telemetry_packet];
+        if(!check_free_descriptors(1) ||
+           tx_descriptors[telemetry_descriptors[next_telemetry_packet]].Status & ETH_DMATXDESC_OWN){
+                TRACE::trace_event(TRACE_EVENTS::TRACE_TELEMETRY_DROPPED, batch.sequence);
+                batch.sequence++;
+                batch.num_records = 0;
+                transport_statistics.num_telemetry_dropped++;
+                return 0;
+        }
+
+        uint32_t payload_length = TELEMETRY::write_packet(batch, p_packet);
+        TELEMETRY::write_frame_header(heth.Init.MACAddr, ip_identification++,
+                TELEMETRY_DEST_PORT, payload_length, tx_headers[tx_index]);
+
+        telemetry_descriptors[next_telemetry_packet] = tx_index;
+        next_telemetry_packet = (next_telemetry_packet + 1) % TELEMETRY_NUM_BUFFERS;
+        queue_descriptor(TELEMETRY_FRAME_HEADER_SIZE, p_packet, payload_length);
+        resume_transmission();
+        #else
+        uint32_t payload_length = TELEMETRY::write_packet(batch, telemetry_packet);
+        if(telemetry_socket < 0 ||
+           send(telemetry_socket, telemetry_packet, payload_length, 0) != (ssize_t) payload_length){
+                TRACE::trace_event(TRACE_EVENTS::TRACE_TELEMETRY_DROPPED, batch.sequence);
+                transport_statistics.num_telemetry_dropped++;
+                return 0;
+        }
+        #endif /* __arm__ */
+
+        transport_statistics.num_telemetry_sent++;
+        return 1;
+}
+
+
+uint8_t TELEMETRY_TRANSPORT::send_raw_frame(
+        const volatile uint16_t* p_adc_data,
+        const uint32_t& sequence,
+        const uint64_t& timestamp){
+
+        #if defined(__arm__)
+        /* The packed samples of the last frame must be sent before they are overwritten */
+        if(!check_free_descriptors(RAW_STREAM_PACKETS_PER_FRAME) ||
+           (RAW_STREAM_PACKED && !TELEMETRY_TRANSPORT::check_raw_frame_sent())){
+                TRACE::trace_event(TRACE_EVENTS::TRACE_RAW_DROPPED, sequence);
+                transport_statistics.num_raw_dropped++;
+                return 0;
+        }
+        #else
+        if(raw_socket < 0){
+                TRACE::trace_event(TRACE_EVENTS::TRACE_RAW_DROPPED, sequence);
+                transport_statistics.num_raw_dropped++;
+                return 0;
+        }
+        #endif /* __arm__ */
+
+        for(uint32_t packet = 0; packet < RAW_STREAM_PACKETS_PER_FRAME; packet++){
+                RawStreamHeader header;
+                RAW_STREAM::create_packet_header(sequence, timestamp, packet, header);
+
+                /* The samples are gathered directly from the DMA-buffer, unless packed */
+                const uint16_t* p_samples = (const uint16_t*) (p_adc_data + header.sample_offset);
+                #if RAW_STREAM_PACKED
+                const void* p_payload = (const void*) raw_payloads[packet];
+                const uint32_t samples_length = SAMPLE_CODING::pack_samples(
+                        p_samples, header.num_samples, raw_payloads[packet]);
+                #else
+                const void* p_payload = (const void*) p_samples;
+                const uint32_t samples_length = header.num_samples * sizeof(uint16_t);
+                #endif /* RAW_STREAM_PACKED */
+
+                #if defined(__arm__)
+                uint8_t* p_headers = tx_headers[tx_index];
+                TELEMETRY::write_frame_header(heth.Init.MACAddr, ip_identification++,
+                        RAW_STREAM_DEST_PORT, sizeof(RawStreamHeader) + samples_length, p_headers);
+                memcpy(p_headers + TELEMETRY_FRAME_HEADER_SIZE, &header, sizeof(RawStreamHeader));
+
+                raw_last_descriptor = tx_index;
+                queue_descriptor(TELEMETRY_FRAME_HEADER_SIZE + sizeof(RawStreamHeader),
+                        p_payload, samples_length);
+                #else
+                struct iovec buffers[2];
+                buffers[0].iov_base = &header;
+                buffers[0].iov_len = sizeof(RawStreamHeader);
+                buffers[1].iov_base = (void*) p_payload;
+                buffers[1].iov_len = samples_length;
+
+                struct msghdr message;
+                memset(&message, 0, sizeof(message));
+                message.msg_iov = buffers;
+                message.msg_iovlen = 2;
+                if(sendmsg(raw_socket, &message, 0) != (ssize_t) (sizeof(RawStreamHeader) + samples_length)){
+                        TRACE::trace_event(TRACE_EVENTS::TRACE_RAW_DROPPED, sequence);
+                        transport_statistics.num_raw_dropped++;
+                        return 0;
+                }
+                #endif /* __arm__ */
+        }
+
+        #if defined(__arm__)
+        resume_transmission();
+        #endif /* __arm__ */
+
+        transport_statistics.num_raw_sent++;
+        return 1;
+}
+
+
+uint8_t TELEMETRY_TRANSPORT::check_raw_frame_sent(){
+        #if defined(__arm__)
+        /* The descriptors are released in order, such that the last is released last */
+        return !(tx_descriptors[raw_last_descriptor].Status & ETH_DMATXDESC_OWN);
+        #else
+        return 1;
+        #endif /* __arm__ */
+}
+
+
+uint8_t TELEMETRY_TRANSPORT::send_trace(){
+        #if USE_TRACE
+        #if defined(__arm__)
+        /* The snapshot of the last dump must be sent before it is overwritten */
+        if(!check_free_descriptors(TRACE_PACKETS_PER_DUMP) ||
+           tx_descriptors[trace_last_descriptor].Status & ETH_DMATXDESC_OWN){
+                return 0;
+        }
+        #else
+        if(trace_socket < 0){
+                return 0;
+        }
+        #endif /* __arm__ */
+
+        TRACE::copy_trace(trace_snapshot);
+
+        for(uint32_t packet = 0; packet < TRACE_PACKETS_PER_DUMP; packet++){
+                TraceHeader header;
+                TRACE::create_packet_header(trace_snapshot, packet, header);
+
+                /* The records are gathered directly from the snapshot */
+                const void* p_payload = (const void*) &trace_snapshot.records[header.first_slot];
+                const uint32_t records_length = header.num_records * sizeof(TraceRecord);
+
+                #if defined(__arm__)
+                uint8_t* p_headers = tx_headers[tx_index];
+                TELEMETRY::write_frame_header(heth.Init.MACAddr, ip_identification++,
+                        TRACE_DEST_PORT, sizeof(TraceHeader) + records_length, p_headers);
+                memcpy(p_headers + TELEMETRY_FRAME_HEADER_SIZE, &header, sizeof(TraceHeader));
+
+                trace_last_descriptor = tx_index;
+                queue_descriptor(TELEMETRY_FRAME_HEADER_SIZE + sizeof(TraceHeader),
+                        p_payload, records_length);
+                #else
+                struct iovec buffers[2];
+                buffers[0].iov_base = &header;
+                buffers[0].iov_len = sizeof(TraceHeader);
+                buffers[1].iov_base = (void*) p_payload;
+                buffers[1].iov_len = records_length;
+
+                struct msghdr message;
+                memset(&message, 0, sizeof(message));
+                message.msg_iov = buffers;
+                message.msg_iovlen = 2;
+                if(sendmsg(trace_socket, &message, 0) != (ssize_t) (sizeof(TraceHeader) + records_length)){
+                        return 0;
+                }
+                #endif /* __arm__ */
+        }
+
+        #if defined(__arm__)
+        resume_transmission();
+        #endif /* __arm__ */
+
+        return 1;
+        #else
+        return 0;
+        #endif /* USE_TRACE */
+}
+
+
+uint8_t TELEMETRY_TRANSPORT::receive_command(
+        uint8_t* p_command,
+        const uint32_t& max_length,
+        uint32_t& length){
+
+        #if defined(__arm__)
+        /* At most a full ring is read, such that the main-loop is not stalled */
+        for(uint32_t i = 0; i < ETH_RXBUFNB && HAL_ETH_GetReceivedFrame(&heth) == HAL_OK; i++){
+                const uint8_t* p_payload = NULL;
+                uint32_t payload_length = 0;
+
+                /* A command fits a single segment. Frames with errors are flagged by the MAC */
+                const uint8_t bool_command = heth.RxFrameInfos.SegCount == 1 &&
+                        !(heth.RxFrameInfos.LSRxDesc->Status & ETH_DMARXDESC_ES) &&
+                        TELEMETRY::parse_frame_header((const uint8_t*) heth.RxFrameInfos.buffer,
+                                heth.RxFrameInfos.length, COMMAND_PORT, p_payload, payload_length) &&
+                        payload_length <= max_length;
+                if(bool_command){
+                        memcpy(p_command, p_payload, payload_length);
+                        length = payload_length;
+                }
+
+                release_received_frame();
+                if(bool_command){
+                        return 1;
+                }
+        }
+        return 0;
+        #else
+        if(command_socket < 0){
+                return 0;
+        }
+
+        /* Longer commands are truncated, and rejected by the length */
+        const ssize_t received = recv(command_socket, p_command, max_length, MSG_DONTWAIT | MSG_TRUNC);
+        if(received < 0 || (uint32_t) received > max_length){
+                return 0;
+        }
+        length = (uint32_t) received;
+        return 1;
+        #endif /* __arm__ */
+}
+
+
+uint8_t TELEMETRY_TRANSPORT::send_reply(
+        const uint8_t* p_reply,
+        const uint32_t& length){
+
+        if(length > COMMAND_MAX_PACKET_SIZE){
+                return 0;
+        }
+
+        #if defined(__arm__)
+        /* The last reply must be sent before its buffer is overwritten */
+        if(!check_free_descriptors(1) ||
+           tx_descriptors[reply_descriptor].Status & ETH_DMATXDESC_OWN){
+                return 0;
+        }
+
+        memcpy(reply_buffer, p_reply, length);
+        TELEMETRY::write_frame_header(heth.Init.MACAddr, ip_identification++,
+                COMMAND_REPLY_PORT, length, tx_headers[tx_index]);
+
+        reply_descriptor = tx_index;
+        queue_descriptor(TELEMETRY_FRAME_HEADER_SIZE, reply_buffer, length);
+        resume_transmission();
+        return 1;
+        #else
+        return reply_socket >= 0 && send(reply_socket, p_reply, length, 0) == (ssize_t) length;
+        #endif /* __arm__ */
+}
+
+
+void TELEMETRY_TRANSPORT::get_statistics(TransportStatistics& statistics){
+        statistics = transport_statistics;
+}
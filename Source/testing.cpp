@@ -18,33 +18,19 @@ void TESTING::calculate_toa_array(
   }
   
   /**
-   * Calculating the distance between the sound-source and the hydrophones
-   */
-  float32_t dist_src_port = std::sqrt(std::pow(SOURCE_POS_X - PORT_HYD_X, 2) + 
-                                      std::pow(SOURCE_POS_Y - PORT_HYD_Y, 2) +
-                                      std::pow(SOURCE_POS_Z - PORT_HYD_Z, 2));
-  float32_t dist_src_starboard = std::sqrt(std::pow(SOURCE_POS_X - STARBOARD_HYD_X, 2) + 
-                                      std::pow(SOURCE_POS_Y - STARBOARD_HYD_Y, 2) +
-                                      std::pow(SOURCE_POS_Z - STARBOARD_HYD_Z, 2));
-  float32_t dist_src_stern = std::sqrt(std::pow(SOURCE_POS_X - STERN_HYD_X, 2) + 
-                                      std::pow(SOURCE_POS_Y - STERN_HYD_Y, 2) +
-                                      std::pow(SOURCE_POS_Z - STERN_HYD_Z, 2));
-
-  /**
-   * Calculating the time the sound will arrive at x hyd
+   * Calculating the distance between the sound-source and the hydrophones,
+   * and the time the sound will arrive at each hydrophone
    * 
    * Since the TOA uses lag (direct measuremend), these values are uint32_t 
    */
-  uint32_t lag_port = (uint32_t)(SAMPLE_FREQUENCY * (dist_src_port / SOUND_SPEED));
-  uint32_t lag_starboard = (uint32_t)(SAMPLE_FREQUENCY * (dist_src_starboard / SOUND_SPEED));
-  uint32_t lag_stern = (uint32_t)(SAMPLE_FREQUENCY * (dist_src_stern / SOUND_SPEED));
-
-  /**
-   * Setting the values into the array
-   */
-  lag_array[0] = lag_port;
-  lag_array[1] = lag_starboard;
-  lag_array[2] = lag_stern;
+  const float32_t source_position[3] = { SOURCE_POS_X, SOURCE_POS_Y, SOURCE_POS_Z };
+  for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+    float32_t dist_src_hyd = std::sqrt(
+            std::pow(source_position[0] - HYDROPHONE_POSITIONS[hyd][0], 2) + 
+            std::pow(source_position[1] - HYDROPHONE_POSITIONS[hyd][1], 2) +
+            std::pow(source_position[2] - HYDROPHONE_POSITIONS[hyd][2], 2));
+    lag_array[hyd] = (uint32_t)(SAMPLE_FREQUENCY * (dist_src_hyd / SOUND_SPEED));
+  }
 
   bool_valid_parameters = 1;
 }
@@ -59,39 +45,152 @@ void TESTING::test_trilateration_algorithm(){
   uint8_t bool_valid_parameters = 1;
 
   TESTING::calculate_toa_array(lag_array, bool_valid_parameters);
-  if(bool_valid_parameters){
+  if(!bool_valid_parameters){
     printf("\nAt least one parameter in parameter.h is invalid");
     return;
   }
 
+  /**
+   * Calculating the lag between every pair of hydrophones, in the 
+   * same order as returned by ANALYZE_DATA::calculate_xcorr_lag_array
+   */
+  uint32_t pair_lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    pair_lag_array[pair] = lag_array[HydrophonePairs<NUM_HYDROPHONES>::first(pair)] - 
+                           lag_array[HydrophonePairs<NUM_HYDROPHONES>::second(pair)];
+    p_lag_array[pair] = &pair_lag_array[pair];
+  });
+
   /**
    * Initializing the system matrices
    */
-  Matrix_2_3_f A_matrix = TRILATERATION::initialize_A_matrix();
-  Vector_2_1_f B_vector = TRILATERATION::initialize_B_vector();
+  Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+  Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
 
   /**
-   * Initializing the estimate for x-pos and y-pos
+   * Initializing the estimate for the position
    */
-  float32_t x_pos_es, y_pos_es;
+  float32_t x_pos_es, y_pos_es, z_pos_es;
 
   if(!TRILATERATION::trilaterate_pinger_position(A_matrix, B_vector, 
-          lag_array, x_pos_es, y_pos_es)){
-    printf("\nA-matrix is not invertible")
+          p_lag_array, x_pos_es, y_pos_es, z_pos_es)){
+    printf("\nA-matrix is not invertible");
+    return;
   }
 
   /**
    * Calculating the distance between the estimated position and the 
-   * actual position. Only considering x and y, since we only have
-   * three hydrophones
+   * actual position. Only considering x and y, since z is not
+   * estimated with three hydrophones
    */
   float32_t distance_diff = std::sqrt(
           std::pow(x_pos_es - SOURCE_POS_X, 2) +
           std::pow(y_pos_es - SOURCE_POS_Y, 2));
   
-  printf("\nThe estimated pinger position is at (x,y) = (%f, %f)", x_pos_ex, y_pos_es);
+  printf("\nThe estimated pinger position is at (x,y) = (%f, %f)", x_pos_es, y_pos_es);
   printf("\nThe actual pinger position is at (x,y) = (%f, %f)", SOURCE_POS_X, SOURCE_POS_Y);
   printf("\nThe difference between the actual position and the estimated position is %f m", distance_diff);
 }
 
+void TESTING::benchmark_trilateration_solvers(const uint32_t& num_frames){
+
+  /**
+   * Initializing the system matrices and the statistics
+   */
+  Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+  Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
+
+  TimingStatistics linear_timing, nonlinear_timing;
+  TIMING::reset_statistics(linear_timing);
+  TIMING::reset_statistics(TRILATERATION::nonlinear_solver_timing);
+
+  float32_t linear_error = 0, nonlinear_error = 0;
+  uint32_t num_linear_valid = 0, num_nonlinear_valid = 0;
+
+  /**
+   * Previous estimate used as initial guess for the iterative solver
+   */
+  float32_t x_warm = SOURCE_POS_X, y_warm = SOURCE_POS_Y, z_warm = SOURCE_POS_Z;
+  uint8_t bool_warm_start = 0;
+
+  const float32_t range = std::sqrt(SOURCE_POS_X * SOURCE_POS_X + SOURCE_POS_Y * SOURCE_POS_Y);
+
+  for(uint32_t frame = 0; frame < num_frames; frame++){
+
+    /**
+     * Moving the pinger along a circle, and calculating the lags
+     */
+    float32_t angle = (float32_t) (2 * M_PI * frame / num_frames);
+    const float32_t source_position[3] = 
+          { range * std::sin(angle), range * std::cos(angle), SOURCE_POS_Z };
+
+    int32_t toa_array[NUM_HYDROPHONES];
+    for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+      float32_t dist_src_hyd = std::sqrt(
+              std::pow(source_position[0] - HYDROPHONE_POSITIONS[hyd][0], 2) + 
+              std::pow(source_position[1] - HYDROPHONE_POSITIONS[hyd][1], 2) +
+              std::pow(source_position[2] - HYDROPHONE_POSITIONS[hyd][2], 2));
+      toa_array[hyd] = (int32_t) std::lround(SAMPLE_FREQUENCY * (dist_src_hyd / SOUND_SPEED));
+    }
+
+    uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+    uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+    unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+      lag_array[pair] = (uint32_t) (toa_array[HydrophonePairs<NUM_HYDROPHONES>::first(pair)] - 
+                                    toa_array[HydrophonePairs<NUM_HYDROPHONES>::second(pair)]);
+      p_lag_array[pair] = &lag_array[pair];
+    });
+
+    /**
+     * Linear solver
+     */
+    float32_t x_pos_es, y_pos_es, z_pos_es;
+    uint32_t start_ticks = TIMING::get_ticks();
+    uint8_t bool_linear_valid = TRILATERATION::trilaterate_pinger_position(
+            A_matrix, B_vector, p_lag_array, x_pos_es, y_pos_es, z_pos_es);
+    TIMING::update_statistics(linear_timing, start_ticks);
+
+    if(bool_linear_valid){
+      linear_error += std::sqrt(std::pow(x_pos_es - source_position[0], 2) + 
+                                std::pow(y_pos_es - source_position[1], 2));
+      num_linear_valid++;
+    }
+
+    /**
+     * Iterative solver. Started from the linear solution on the first frame
+     */
+    if(!bool_warm_start){
+      if(!bool_linear_valid){
+        continue;
+      }
+      x_warm = x_pos_es;
+      y_warm = y_pos_es;
+      z_warm = z_pos_es;
+    }
+
+    bool_warm_start = TRILATERATION::refine_pinger_position(
+            p_lag_array, x_warm, y_warm, z_warm);
+    if(bool_warm_start){
+      nonlinear_error += std::sqrt(std::pow(x_warm - source_position[0], 2) + 
+                                   std::pow(y_warm - source_position[1], 2));
+      num_nonlinear_valid++;
+    }
+  }
+  nonlinear_timing = TRILATERATION::nonlinear_solver_timing;
+
+  /**
+   * Writing the results
+   */
+  printf("\nSolver      Valid   Avg [us]   Max [us]   Avg error [m]");
+  printf("\nLinear      %5u   %8.2f   %8.2f   %13.3f", (unsigned) num_linear_valid,
+          (double) TIMING::ticks_to_us(linear_timing.total_ticks / std::max(linear_timing.num_measurements, 1u)),
+          (double) TIMING::ticks_to_us(linear_timing.max_ticks),
+          (double) (linear_error / std::max(num_linear_valid, 1u)));
+  printf("\nIterative   %5u   %8.2f   %8.2f   %13.3f", (unsigned) num_nonlinear_valid,
+          (double) TIMING::ticks_to_us(nonlinear_timing.total_ticks / std::max(nonlinear_timing.num_measurements, 1u)),
+          (double) TIMING::ticks_to_us(nonlinear_timing.max_ticks),
+          (double) (nonlinear_error / std::max(num_nonlinear_valid, 1u)));
+}
+
 #endif /* CURR_TESTING_BOOL */
\ No newline at end of file
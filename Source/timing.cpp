@@ -0,0 +1,50 @@
+#include "timing.h"
+
+/**
+ * Functions for measuring time
+ */
+void TIMING::initialize_timing(){
+#if defined(__arm__)
+        /* Enabling the trace-unit, unlocking the DWT and starting the counter */
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->LAR = 0xC5ACCE55;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif /* __arm__ */
+}
+
+
+float32_t TIMING::ticks_to_us(const uint64_t& ticks){
+#if defined(__arm__)
+        return (float32_t) ticks / (SystemCoreClock / 1000000u);
+#else
+        return (float32_t) ticks / 1000.0f;
+#endif /* __arm__ */
+}
+
+
+void TIMING::reset_statistics(TimingStatistics& statistics){
+        statistics.last_ticks = 0;
+        statistics.min_ticks = 0;
+        statistics.max_ticks = 0;
+        statistics.total_ticks = 0;
+        statistics.num_measurements = 0;
+}
+
+
+uint32_t TIMING::update_statistics(
+        TimingStatistics& statistics,
+        const uint32_t& start_ticks){
+
+        /* Unsigned subtraction is valid across a single wrap of the counter */
+        uint32_t ticks = TIMING::get_ticks() - start_ticks;
+
+        statistics.last_ticks = ticks;
+        statistics.min_ticks = statistics.num_measurements ? 
+                std::min(statistics.min_ticks, ticks) : ticks;
+        statistics.max_ticks = std::max(statistics.max_ticks, ticks);
+        statistics.total_ticks += ticks;
+        statistics.num_measurements++;
+
+        return ticks;
+}
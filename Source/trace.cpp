@@ -0,0 +1,80 @@
+#include "trace.h"
+
+/**
+ * Global variables for the trace
+ */
+TraceBuffer TRACE::trace_buffer = {};
+
+const char* const TRACE::event_names[NUM_TRACE_EVENTS] =
+        { "stage_begin", "stage_end", "dma_complete", "error", "raw_dropped",
+          "telemetry_dropped", "marker" };
+
+
+/**
+ * Functions for the trace
+ */
+void TRACE::initialize_trace(){
+        TraceHeader& header = TRACE::trace_buffer.header;
+        header.magic = TRACE_MAGIC;
+        header.version = TRACE_VERSION;
+        header.record_size = sizeof(TraceRecord);
+#if defined(__arm__)
+        header.ticks_per_us = SystemCoreClock / 1000000u;
+#else
+        header.ticks_per_us = 1000u;
+#endif /* __arm__ */
+        header.length = TRACE_LENGTH;
+        header.first_slot = 0;
+        header.num_records = TRACE_LENGTH;
+        memset(TRACE::trace_buffer.records, 0, sizeof(TRACE::trace_buffer.records));
+        __atomic_store_n(&header.num_events, 0u, __ATOMIC_RELEASE);
+}
+
+
+void TRACE::copy_trace(TraceBuffer& snapshot){
+        /* The number of events is read first, such that no listed event is missing */
+        snapshot.header = TRACE::trace_buffer.header;
+        snapshot.header.num_events = __atomic_load_n(
+                &TRACE::trace_buffer.header.num_events, __ATOMIC_ACQUIRE);
+        memcpy(snapshot.records, TRACE::trace_buffer.records, sizeof(snapshot.records));
+}
+
+
+void TRACE::create_packet_header(
+        const TraceBuffer& dump,
+        const uint32_t& packet_index,
+        TraceHeader& header){
+
+        const uint32_t first_slot = packet_index * TRACE_PACKET_RECORDS;
+
+        header = dump.header;
+        header.first_slot = first_slot;
+        header.num_records = std::min(TRACE_PACKET_RECORDS, TRACE_LENGTH - first_slot);
+}
+
+
+uint8_t TRACE::parse_header(
+        const uint8_t* data,
+        const uint64_t& length,
+        TraceHeader& header){
+
+        if(!data || length < sizeof(TraceHeader)){
+                return 0;
+        }
+
+        /* Copying, as the data is not necessarily aligned */
+        memcpy(&header, data, sizeof(TraceHeader));
+
+        if(header.magic != TRACE_MAGIC || header.version != TRACE_VERSION ||
+           header.record_size != sizeof(TraceRecord) || !header.ticks_per_us){
+                return 0;
+        }
+
+        if(!header.length || (header.length & (header.length - 1)) ||
+           (uint64_t) header.first_slot + header.num_records > header.length ||
+           length < sizeof(TraceHeader) + (uint64_t) header.num_records * sizeof(TraceRecord)){
+                return 0;
+        }
+
+        return 1;
+}
@@ -0,0 +1,173 @@
+#include "tracking.h"
+
+/**
+ * Helper-functions for a single axis. The state of the axis is given as
+ * {pos, vel}, with the covariance {P_pos_pos, P_pos_vel, P_vel_vel}
+ */
+static void predict_axis(
+        float32_t& pos,
+        float32_t& vel,
+        float32_t covariance[3],
+        const float32_t& time_step){
+
+        /* Process noise from a white acceleration with std TRACKING_ACCEL_NOISE */
+        const float32_t q = TRACKING_ACCEL_NOISE * TRACKING_ACCEL_NOISE;
+        const float32_t dt = time_step;
+        const float32_t dt2 = dt * dt;
+
+        pos += vel * dt;
+
+        covariance[0] += 2 * dt * covariance[1] + dt2 * covariance[2] + 0.25f * q * dt2 * dt2;
+        covariance[1] += dt * covariance[2] + 0.5f * q * dt2 * dt;
+        covariance[2] += q * dt2;
+}
+
+
+static void update_axis(
+        float32_t& pos,
+        float32_t& vel,
+        float32_t covariance[3],
+        const float32_t& innovation,
+        const float32_t& innovation_variance){
+
+        /* Kalman gain for the position and the velocity */
+        float32_t K_pos = covariance[0] / innovation_variance;
+        float32_t K_vel = covariance[1] / innovation_variance;
+
+        pos += K_pos * innovation;
+        vel += K_vel * innovation;
+
+        covariance[2] -= K_vel * covariance[1];
+        covariance[1] *= (1 - K_pos);
+        covariance[0] *= (1 - K_pos);
+}
+
+
+/**
+ * Helper-function to reset the tracker to a measurement
+ */
+static void reset_to_measurement(
+        TrackerState& tracker,
+        const float32_t measured[2],
+        const float32_t& measurement_variance){
+
+        for(uint32_t axis = 0; axis < 2; axis++){
+                tracker.position[axis] = measured[axis];
+                tracker.velocity[axis] = 0;
+                tracker.covariance[axis][0] = measurement_variance;
+                tracker.covariance[axis][1] = 0;
+                tracker.covariance[axis][2] = TRACKING_INITIAL_VEL_STD * TRACKING_INITIAL_VEL_STD;
+        }
+        tracker.num_rejected = 0;
+        tracker.bool_initialized = 1;
+}
+
+
+/**
+ * Functions for tracking
+ */
+void TRACKING::initialize_tracker(TrackerState& tracker){
+        for(uint32_t axis = 0; axis < 2; axis++){
+                tracker.position[axis] = 0;
+                tracker.velocity[axis] = 0;
+                tracker.covariance[axis][0] = 0;
+                tracker.covariance[axis][1] = 0;
+                tracker.covariance[axis][2] = 0;
+        }
+        tracker.num_updates = 0;
+        tracker.num_rejected = 0;
+        tracker.bool_initialized = 0;
+}
+
+
+void TRACKING::predict_tracker(
+        TrackerState& tracker,
+        const float32_t& time_step){
+
+        if(!tracker.bool_initialized){
+                return;
+        }
+
+        for(uint32_t axis = 0; axis < 2; axis++){
+                predict_axis(tracker.position[axis], tracker.velocity[axis],
+                        tracker.covariance[axis], time_step);
+        }
+}
+
+
+uint8_t TRACKING::update_tracker(
+        TrackerState& tracker,
+        const float32_t& x_measured,
+        const float32_t& y_measured,
+        const float32_t& time_step){
+
+        const float32_t measured[2] = { x_measured, y_measured };
+
+        /* Measurement noise grows with the range to the pinger */
+        float32_t range = std::sqrt(x_measured * x_measured + y_measured * y_measured);
+        float32_t measurement_std = TRACKING_MEAS_NOISE_BASE + TRACKING_MEAS_NOISE_RANGE * range;
+        float32_t measurement_variance = measurement_std * measurement_std;
+
+        /* Initializing the state on the first measurement */
+        if(!tracker.bool_initialized){
+                reset_to_measurement(tracker, measured, measurement_variance);
+                tracker.num_updates++;
+                return 1;
+        }
+
+        TRACKING::predict_tracker(tracker, time_step);
+
+        /* Calculating the innovation, and checking it against the gate */
+        float32_t innovation[2], innovation_variance[2];
+        float32_t normalized_innovation = 0;
+        for(uint32_t axis = 0; axis < 2; axis++){
+                innovation[axis] = measured[axis] - tracker.position[axis];
+                innovation_variance[axis] = tracker.covariance[axis][0] + measurement_variance;
+                normalized_innovation +=
+                        innovation[axis] * innovation[axis] / innovation_variance[axis];
+        }
+
+        if(normalized_innovation > TRACKING_GATE){
+                tracker.num_rejected++;
+                if(tracker.num_rejected < TRACKING_MAX_REJECTS){
+                        return 0;
+                }
+
+                /* The pinger has most likely moved. Restarting the track */
+                reset_to_measurement(tracker, measured, measurement_variance);
+                tracker.num_updates++;
+                return 1;
+        }
+
+        for(uint32_t axis = 0; axis < 2; axis++){
+                update_axis(tracker.position[axis], tracker.velocity[axis],
+                        tracker.covariance[axis], innovation[axis], innovation_variance[axis]);
+        }
+        tracker.num_rejected = 0;
+        tracker.num_updates++;
+
+        return 1;
+}
+
+
+uint8_t TRACKING::get_tracker_estimate(
+        const TrackerState& tracker,
+        float32_t& x_estimate,
+        float32_t& y_estimate,
+        float32_t& bearing,
+        float32_t& range,
+        float32_t position_variance[2]){
+
+        if(!tracker.bool_initialized){
+                return 0;
+        }
+
+        x_estimate = tracker.position[0];
+        y_estimate = tracker.position[1];
+        bearing = (float32_t) (std::atan2(x_estimate, y_estimate) * 180.0 / M_PI);
+        range = std::sqrt(x_estimate * x_estimate + y_estimate * y_estimate);
+        position_variance[0] = tracker.covariance[0][0];
+        position_variance[1] = tracker.covariance[1][0];
+
+        return 1;
+}
@@ -1,104 +1,193 @@
 #include "trilateration.h"
 
 /**
- * Initializing the variables maximum_time_diff and max_hydrophone_distance.
- * These values are updated in the function initialize_trilateration_globals
- * 
- * Initialized to -1 such that it's easy to check if the variables are incorrect
+ * Initializing the geometry used for trilateration. The values are updated
+ * in the function initialize_trilateration_globals
+ *
+ * Initialized to 0 such that it's easy to check if the variables are incorrect
  */
-float32_t TRILATERATION::max_hydrophone_distance = -1;
-float32_t TRILATERATION::max_time_diff = -1;
+HydrophoneGeometry TRILATERATION::hydrophone_geometry = {};
 
 
 /**
- * Functions for initializing 
+ * Solver used by the system. Can be changed at runtime
  */
+SOLVER_MODES TRILATERATION::solver_mode = SOLVER_MODE_DEFAULT;
+
+
+/**
+ * Margin of the maximum time-difference. Can be changed at runtime
+ */
+float32_t TRILATERATION::margin_time_epsilon = MARGIN_TIME_EPSILON;
+
+
+/**
+ * Timing of the iterative solver
+ */
+TimingStatistics TRILATERATION::nonlinear_solver_timing = {};
+
+
+/**
+ * Functions for initializing
+ */
+template<uint32_t N>
+uint8_t TRILATERATION::initialize_hydrophone_geometry(
+        HydrophoneArrayGeometry<N>& geometry,
+        const float32_t (&positions)[N][3],
+        const float32_t& margin){
+
+        constexpr uint32_t D = HydrophoneArrayGeometry<N>::dimension;
+
+        /* Positions and squared norms, using the coordinates that are solved for */
+        unroll<N>([&](uint32_t hyd){
+                geometry.squared_norm[hyd] = 0;
+                unroll<3>([&](uint32_t coord){
+                        geometry.position[hyd][coord] = positions[hyd][coord];
+                        if(coord < D){
+                                geometry.squared_norm[hyd] +=
+                                        positions[hyd][coord] * positions[hyd][coord];
+                        }
+                });
+        });
+
+        /* Baselines relative to the reference and the constant part of B */
+        Eigen::Matrix<float32_t, N - 1, D> M;
+        unroll<N - 1>([&](uint32_t i){
+                unroll<3>([&](uint32_t coord){
+                        geometry.baseline[i][coord] = positions[0][coord] - positions[i + 1][coord];
+                        if(coord < D){
+                                M(i, coord) = geometry.baseline[i][coord];
+                        }
+                });
+                geometry.half_squared_norm_diff[i] = 0.5f *
+                        (geometry.squared_norm[0] - geometry.squared_norm[i + 1]);
+        });
+
+        /* Finding the maximum distance between any pair of hydrophones */
+        geometry.max_hydrophone_distance = 0;
+        unroll<HydrophonePairs<N>::count>([&](uint32_t pair){
+                const uint32_t i = HydrophonePairs<N>::first(pair);
+                const uint32_t j = HydrophonePairs<N>::second(pair);
+                float32_t dx = positions[i][0] - positions[j][0];
+                float32_t dy = positions[i][1] - positions[j][1];
+                float32_t dz = positions[i][2] - positions[j][2];
+                geometry.max_hydrophone_distance = std::max(
+                        geometry.max_hydrophone_distance,
+                        (float32_t) std::sqrt(dx * dx + dy * dy + dz * dz));
+        });
+
+        /* Calculating max time and lag allowed over that distance */
+        geometry.max_time_diff = (1 + margin) *
+                (geometry.max_hydrophone_distance / SOUND_SPEED);
+        geometry.max_lag = (int32_t) std::floor(
+                geometry.max_time_diff * SAMPLE_FREQUENCY);
+        geometry.lag_to_distance = SOUND_SPEED / SAMPLE_FREQUENCY;
+
+        /* Calculating the pseudo-inverse of the baseline-matrix. Invalid if singular */
+        Eigen::Matrix<float32_t, D, D> M_T_M = M.transpose() * M;
+        geometry.baseline_determinant = M_T_M.determinant();
+        if(std::abs(geometry.baseline_determinant) < 1e-12f){
+                return 0;
+        }
+
+        Eigen::Matrix<float32_t, D, N - 1> M_pinv = M_T_M.inverse() * M.transpose();
+        unroll<D>([&](uint32_t row){
+                unroll<N - 1>([&](uint32_t col){
+                        geometry.baseline_inverse[row][col] = M_pinv(row, col);
+                });
+        });
+
+        return 1;
+}
+
+
+uint8_t TRILATERATION::initialize_hydrophone_geometry(
+        HydrophoneGeometry& geometry){
+        return TRILATERATION::initialize_hydrophone_geometry(geometry, HYDROPHONE_POSITIONS);
+}
+
+
 uint8_t TRILATERATION::initialize_trilateration_globals(){
 
-        /* Calculating the distances between the hydrophones */
-        float32_t dist_port_starboard = (float32_t) std::sqrt(
-                std::pow(STARBOARD_HYD_X - PORT_HYD_X, 2) + 
-                std::pow(STARBOARD_HYD_Y - PORT_HYD_Y, 2) +
-                std::pow(STARBOARD_HYD_Z - PORT_HYD_Z, 2));
-        float32_t dist_port_stern = (float32_t) std::sqrt(
-                std::pow(STERN_HYD_X - PORT_HYD_X, 2) + 
-                std::pow(STERN_HYD_Y - PORT_HYD_Y, 2) +
-                std::pow(STERN_HYD_Z - PORT_HYD_Z, 2));
-        float32_t dist_starboard_stern = (float32_t) std::sqrt(
-                std::pow(STERN_HYD_X - STARBOARD_HYD_X, 2) + 
-                std::pow(STERN_HYD_Y - STARBOARD_HYD_Y, 2) +
-                std::pow(STERN_HYD_Z - STARBOARD_HYD_Z, 2));
-
-        /* Finding the maximum distance */
-        TRILATERATION::max_hydrophone_distance = 
-                std::max(dist_port_starboard, std::max(dist_starboard_stern, dist_port_stern));
-        
-        /* Calculating max time allowed over that distance */
-        TRILATERATION::max_time_diff = (1 + MARGIN_TIME_EPSILON) *
-                (TRILATERATION::max_hydrophone_distance / SOUND_SPEED);
+        /* Calculating the geometry. Invalid if the hydrophones are on a line */
+        if(!TRILATERATION::initialize_hydrophone_geometry(
+                TRILATERATION::hydrophone_geometry)){
+                return 0;
+        }
 
         /* Returning if both variables have been set correctly */
-        return TRILATERATION::check_initialized_globals(); 
+        return TRILATERATION::check_initialized_globals();
 }
 
 
-Matrix_2_3_f TRILATERATION::initialize_A_matrix(){
-        Matrix_2_3_f A;
-        A << 0, 0, 0,
-             0, 0, 0;
-        return A;
+Matrix_A_f TRILATERATION::initialize_A_matrix(){
+        return Matrix_A_f::Zero();
 }
 
 
-Vector_2_1_f TRILATERATION::initialize_B_vector(){
-        Vector_2_1_f B;
-        B << 0,
-             0;
-        return B;
+Vector_B_f TRILATERATION::initialize_B_vector(){
+        return Vector_B_f::Zero();
 }
 
 /**
  * Functions to check if signals/data are valid
  */
 uint8_t TRILATERATION::check_initialized_globals(){
-       return (TRILATERATION::max_hydrophone_distance != -1 && 
-                TRILATERATION::max_time_diff != 1); 
+       return (TRILATERATION::hydrophone_geometry.max_hydrophone_distance > 0 &&
+                TRILATERATION::hydrophone_geometry.max_time_diff > 0);
 }
 
 
 uint8_t TRILATERATION::check_valid_time(
-        const uint32_t& time_lhs, 
+        const uint32_t& time_lhs,
         const uint32_t& time_rhs){
-        
+
         /**
          * Calculating the time-difference and checking if it exceeds the maximum
          * allowed time for a valid signal
          */
-        int32_t time_diff = time_lhs - time_rhs;
-        return (std::abs(time_diff) * SAMPLE_TIME) > TRILATERATION::max_time_diff;
+        int32_t time_diff = (int32_t) (time_lhs - time_rhs);
+        return std::abs(time_diff) > TRILATERATION::hydrophone_geometry.max_lag;
 }
 
 
 uint8_t TRILATERATION::check_valid_time(
         const uint32_t& time_diff){
-        
+
         /**
-         * Checking if the time_diff exceeds the maximum allowed time for a valid signal
+         * Checking if the time_diff exceeds the maximum allowed time for a valid signal.
+         * The lags are signed, and stored as two's complement
          */
-        return (std::abs(time_diff) * SAMPLE_TIME) > TRILATERATION::max_time_diff;
+        return std::abs((int32_t) time_diff) > TRILATERATION::hydrophone_geometry.max_lag;
+}
+
+
+template<uint32_t N>
+uint8_t TRILATERATION::check_valid_lags(
+        const HydrophoneArrayGeometry<N>& geometry,
+        const int32_t (&lag_array)[HydrophonePairs<N>::count]){
+
+        uint8_t bool_valid = 1;
+        unroll<HydrophonePairs<N>::count>([&](uint32_t pair){
+                bool_valid &= (std::abs(lag_array[pair]) <= geometry.max_lag);
+        });
+        return bool_valid;
 }
 
 
 uint8_t TRILATERATION::check_valid_signals(
-        uint32_t* p_lag_array[NUM_HYDROPHONES],
+        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
         uint8_t& bool_time_error){
 
         /**
          * Evaluating if the signals are valid in time
          */
-        if(TRILATERATION::check_valid_time(*p_lag_array[0]) || 
-        TRILATERATION::check_valid_time(*p_lag_array[1]) ||
-        TRILATERATION::check_valid_time(*p_lag_array[2]))
+        int32_t lag_array[NUM_HYDROPHONE_PAIRS];
+        unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+                lag_array[pair] = (int32_t) *(p_lag_array[pair]);
+        });
+
+        if(!TRILATERATION::check_valid_lags(TRILATERATION::hydrophone_geometry, lag_array))
                 bool_time_error = 1;
 
         /**
@@ -113,112 +202,433 @@ uint8_t TRILATERATION::check_valid_signals(
 
 
 /**
- * Functions for trilateration based on TDOA 
+ * Functions for trilateration based on TDOA
  */
+template<uint32_t N>
+void TRILATERATION::calculate_tdoa_system(
+        const HydrophoneArrayGeometry<N>& geometry,
+        const float32_t (&distance_diff)[N - 1],
+        TDOAMatrix<N>& A,
+        TDOAVector<N>& B){
+
+        constexpr uint32_t D = HydrophoneArrayGeometry<N>::dimension;
+
+        /**
+         * @brief Calculating the values of A and B
+         *
+         * Check the link in the .h file for a better explanation
+         */
+        unroll<N - 1>([&](uint32_t i){
+                unroll<D>([&](uint32_t coord){
+                        A(i, coord) = geometry.baseline[i][coord];
+                });
+                A(i, D) = distance_diff[i];
+                B(i) = 0.5f * distance_diff[i] * distance_diff[i] +
+                        geometry.half_squared_norm_diff[i];
+        });
+}
+
+
+template<uint32_t N>
+uint8_t TRILATERATION::solve_tdoa_system(
+        const HydrophoneArrayGeometry<N>& geometry,
+        const TDOAMatrix<N>& A,
+        const TDOAVector<N>& B,
+        float32_t (&position)[3]){
+
+        constexpr uint32_t D = HydrophoneArrayGeometry<N>::dimension;
+        typedef Eigen::Matrix<float32_t, D, 1> Vector_D_f;
+
+        /* Checking if the baseline-matrix is invertible. Return 0 if not */
+        if(!geometry.baseline_determinant){
+                return 0;
+        }
+
+        /**
+         * Solving for s = u + v * r_0, where
+         *      u = M^+ * B
+         *      v = -M^+ * [d_01, d_02, ...]^T
+         */
+        Eigen::Map<const Eigen::Matrix<float32_t, D, N - 1, Eigen::RowMajor>>
+                M_pinv(&geometry.baseline_inverse[0][0]);
+        Vector_D_f u = M_pinv * B;
+        Vector_D_f v = -(M_pinv * A.col(D));
+
+        /**
+         * Inserting into r_0^2 = |s - p_0|^2, which gives
+         *      a * r_0^2 + b * r_0 + c = 0
+         */
+        Vector_D_f w = u - Eigen::Map<const Vector_D_f>(&geometry.position[0][0]);
+
+        float32_t a = v.squaredNorm() - 1;
+        float32_t b = 2 * w.dot(v);
+        float32_t c = w.squaredNorm();
+
+        /* Calculating the range to the reference. Using the largest positive root */
+        float32_t r_0;
+        if(std::abs(a) < 1e-6f){
+                if(!b){
+                        return 0;
+                }
+                r_0 = -c / b;
+        }
+        else{
+                float32_t discriminant = b * b - 4 * a * c;
+                if(discriminant < 0){
+                        return 0;
+                }
+                float32_t sqrt_discriminant = std::sqrt(discriminant);
+                r_0 = std::max(
+                        (-b + sqrt_discriminant) / (2 * a),
+                        (-b - sqrt_discriminant) / (2 * a));
+        }
+
+        if(r_0 < 0){
+                return 0;
+        }
+
+        /* Extracting the values. z is the height of the reference if not solved for */
+        Vector_D_f s = u + v * r_0;
+        position[2] = geometry.position[0][2];
+        unroll<D>([&](uint32_t coord){
+                position[coord] = s(coord);
+        });
+
+        return 1;
+}
+
+
+template<uint32_t N>
+uint8_t TRILATERATION::trilaterate_position(
+        const HydrophoneArrayGeometry<N>& geometry,
+        const int32_t (&lag_array)[HydrophonePairs<N>::count],
+        float32_t (&position)[3]){
+
+        /* Converting the lags to differences in distance */
+        float32_t distance_diff[N - 1];
+        unroll<N - 1>([&](uint32_t i){
+                distance_diff[i] = geometry.lag_to_distance * lag_array[i];
+        });
+
+        TDOAMatrix<N> A;
+        TDOAVector<N> B;
+        TRILATERATION::calculate_tdoa_system(geometry, distance_diff, A, B);
+        return TRILATERATION::solve_tdoa_system(geometry, A, B, position);
+}
+
+
 uint8_t TRILATERATION::trilaterate_pinger_position(
-        Matrix_2_3_f& A,
-        Vector_2_1_f& B,
-        uint32_t* p_lag_array[NUM_HYDROPHONES],
+        Matrix_A_f& A,
+        Vector_B_f& B,
+        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
         float32_t& x_estimate,
-        float32_t& y_estimate){
-
-        /* Recovering the lags from the array */
-        uint32_t* p_lag_port_starboard = p_lag_array[0];
-        uint32_t* p_lag_port_stern = p_lag_array[1];
-        uint32_t* p_lag_starboard_stern = p_lag_array[2];
+        float32_t& y_estimate,
+        float32_t& z_estimate){
 
         /* Calculating TDOA and creating an array to hold the data */
-        float32_t TDOA_port_starboard = (float32_t)
-                SAMPLE_TIME * SOUND_SPEED * (*p_lag_port_starboard);
-        float32_t TDOA_port_stern = (float32_t)
-                SAMPLE_TIME * SOUND_SPEED * (*p_lag_port_stern);
-        float32_t TDOA_starboard_stern = (float32_t)
-                SAMPLE_TIME * SOUND_SPEED * (*p_lag_starboard_stern);
-
-        float32_t TDOA_array[NUM_HYDROPHONES] = 
-                { TDOA_port_starboard, TDOA_port_stern, TDOA_starboard_stern };
-        
+        float32_t TDOA_array[NUM_HYDROPHONE_PAIRS];
+        unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+                TDOA_array[pair] = (float32_t) SAMPLE_TIME * (int32_t) *(p_lag_array[pair]);
+        });
+
         /* Calculating the matrices */
         TRILATERATION::calculate_tdoa_matrices(TDOA_array, A, B);
 
-        /* Calculating the transpose */
-        Matrix_2_3_f A_T = A.transpose();
+        /* Solving the system */
+        float32_t position[3];
+        if(!TRILATERATION::solve_tdoa_system(
+                TRILATERATION::hydrophone_geometry, A, B, position)){
+                return 0;
+        }
+
+        /* Extracting the values */
+        x_estimate = position[0];
+        y_estimate = position[1];
+        z_estimate = position[2];
+
+        return 1;
+}
+
+
+/**
+ * Functions for the iterative solver
+ */
+template<uint32_t N>
+uint8_t TRILATERATION::refine_position(
+        const HydrophoneArrayGeometry<N>& geometry,
+        const int32_t (&lag_array)[HydrophonePairs<N>::count],
+        float32_t (&position)[3],
+        uint32_t& num_iterations){
+
+        constexpr uint32_t D = HydrophoneArrayGeometry<N>::dimension;
+        constexpr uint32_t P = HydrophonePairs<N>::count;
+        typedef Eigen::Matrix<float32_t, D, 1> Vector_D_f;
+        typedef Eigen::Matrix<float32_t, D, D> Matrix_D_f;
+        typedef Eigen::Matrix<float32_t, P, 1> Vector_P_f;
+        typedef Eigen::Matrix<float32_t, P, D> Matrix_P_D_f;
+
+        /**
+         * Helper calculating the residuals and the Jacobian at s. Returns the 
+         * sum of squared residuals
+         */
+        auto evaluate = [&](const Vector_D_f& s, Vector_P_f& residual, Matrix_P_D_f& J){
+                float32_t distance[N];
+                float32_t gradient[N][D];
+                unroll<N>([&](uint32_t hyd){
+                        float32_t diff[3];
+                        diff[2] = position[2] - geometry.position[hyd][2];
+                        unroll<D>([&](uint32_t coord){
+                                diff[coord] = s(coord) - geometry.position[hyd][coord];
+                        });
+                        distance[hyd] = std::max(std::sqrt(
+                                diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2]), 1e-6f);
+                        unroll<D>([&](uint32_t coord){
+                                gradient[hyd][coord] = diff[coord] / distance[hyd];
+                        });
+                });
+
+                unroll<P>([&](uint32_t pair){
+                        const uint32_t i = HydrophonePairs<N>::first(pair);
+                        const uint32_t j = HydrophonePairs<N>::second(pair);
+                        residual(pair) = distance[i] - distance[j] - 
+                                geometry.lag_to_distance * lag_array[pair];
+                        unroll<D>([&](uint32_t coord){
+                                J(pair, coord) = gradient[i][coord] - gradient[j][coord];
+                        });
+                });
+                return residual.squaredNorm();
+        };
+
+        Vector_D_f s;
+        unroll<D>([&](uint32_t coord){
+                s(coord) = position[coord];
+        });
+
+        Vector_P_f residual;
+        Matrix_P_D_f J;
+        float32_t cost = evaluate(s, residual, J);
+        float32_t damping = NONLINEAR_INITIAL_DAMPING;
+
+        for(num_iterations = 0; num_iterations < NONLINEAR_MAX_ITERATIONS; num_iterations++){
+
+                /* Solving the damped normal equations (J^T J + damping * diag(J^T J)) * step = -J^T r */
+                Matrix_D_f JTJ = J.transpose() * J;
+                Vector_D_f gradient = J.transpose() * residual;
+                Matrix_D_f H = JTJ;
+                H.diagonal() *= (1 + damping);
+
+                float32_t determinant = H.determinant();
+                if(!std::isfinite(determinant) || std::abs(determinant) < 1e-20f){
+                        return 0;
+                }
+                Vector_D_f step = -(H.inverse() * gradient);
+
+                /* Accepting the step if it reduces the cost. Otherwise increase the damping */
+                Vector_D_f s_new = s + step;
+                Vector_P_f residual_new;
+                Matrix_P_D_f J_new;
+                float32_t cost_new = evaluate(s_new, residual_new, J_new);
+                if(cost_new < cost){
+                        s = s_new;
+                        residual = residual_new;
+                        J = J_new;
+                        cost = cost_new;
+                        damping *= 0.1f;
+                }
+                else{
+                        damping *= 10.0f;
+                }
+
+                if(step.norm() < NONLINEAR_STEP_TOLERANCE){
+                        num_iterations++;
+                        break;
+                }
+        }
+
+        /**
+         * Inconsistent lags may give a minimum far away, along the direction
+         * to the pinger. These estimates are rejected
+         */
+        if(!s.allFinite() || s.norm() > NONLINEAR_MAX_RANGE){
+                return 0;
+        }
+
+        /* Extracting the values */
+        unroll<D>([&](uint32_t coord){
+                position[coord] = s(coord);
+        });
+
+        return 1;
+}
+
+
+uint8_t TRILATERATION::refine_pinger_position(
+        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+        float32_t& x_estimate,
+        float32_t& y_estimate,
+        float32_t& z_estimate){
+
+        const uint32_t start_ticks = TIMING::get_ticks();
+
+        int32_t lag_array[NUM_HYDROPHONE_PAIRS];
+        unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+                lag_array[pair] = (int32_t) *(p_lag_array[pair]);
+        });
+
+        /* With three hydrophones z is fixed to the assumed position of the pinger */
+        float32_t position[3] = { x_estimate, y_estimate, 
+                (HydrophoneGeometry::dimension == 3) ? z_estimate : NONLINEAR_ASSUMED_Z };
+        uint32_t num_iterations;
+        uint8_t bool_valid = TRILATERATION::refine_position(
+                TRILATERATION::hydrophone_geometry, lag_array, position, num_iterations);
+
+        if(bool_valid){
+                x_estimate = position[0];
+                y_estimate = position[1];
+                if(HydrophoneGeometry::dimension == 3){
+                        z_estimate = position[2];
+                }
+        }
+
+        TIMING::update_statistics(TRILATERATION::nonlinear_solver_timing, start_ticks);
+        return bool_valid;
+}
+
+
+/**
+ * Functions for estimating the direction in the far-field
+ */
+template<uint32_t N>
+uint8_t TRILATERATION::estimate_direction(
+        const HydrophoneArrayGeometry<N>& geometry,
+        const int32_t (&lag_array)[HydrophonePairs<N>::count],
+        float32_t& bearing,
+        float32_t& elevation){
+
+        constexpr uint32_t D = HydrophoneArrayGeometry<N>::dimension;
 
-        /* Checking if A * A_T is invertible. Return 0 if not */
-        if(!((A_T * A).determinant())){
+        /* Checking if the baseline-matrix is invertible. Return 0 if not */
+        if(!geometry.baseline_determinant){
                 return 0;
         }
 
-        /* Calculating the solution-vector */
-        Vector_2_1_f solution_vec = (A_T * A).inverse() * A_T * B;
+        /* Calculating k = -M^+ * d. The scaling of d does not affect the direction */
+        float32_t direction[3] = { 0, 0, 0 };
+        unroll<D>([&](uint32_t coord){
+                unroll<N - 1>([&](uint32_t i){
+                        direction[coord] -= geometry.baseline_inverse[coord][i] * lag_array[i];
+                });
+        });
+
+        float32_t horizontal = std::sqrt(
+                direction[0] * direction[0] + direction[1] * direction[1]);
+        if(!horizontal && !direction[2]){
+                return 0;
+        }
 
         /* Extracting the values */
-        x_estimate = solution_vec.coeff(0);
-        y_estimate = solution_vec.coeff(1);
+        bearing = (float32_t) (std::atan2(direction[0], direction[1]) * 180.0 / M_PI);
+        elevation = (float32_t) (std::atan2(direction[2], horizontal) * 180.0 / M_PI);
+
+        return 1;
+}
+
+
+uint8_t TRILATERATION::estimate_pinger_bearing(
+        uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS],
+        float32_t& bearing,
+        float32_t& elevation){
+
+        int32_t lag_array[NUM_HYDROPHONE_PAIRS];
+        unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+                lag_array[pair] = (int32_t) *(p_lag_array[pair]);
+        });
 
-        return 1;       
+        return TRILATERATION::estimate_direction(
+                TRILATERATION::hydrophone_geometry, lag_array, bearing, elevation);
+}
+
+
+uint8_t TRILATERATION::use_hyperbolic_solver(
+        const float32_t& range_estimate,
+        const uint32_t& num_frames_far_field){
+
+        switch(TRILATERATION::solver_mode){
+        case SOLVER_FAR_FIELD:
+                return 0;
+        case SOLVER_HYPERBOLIC:
+                return 1;
+        default:
+                return (range_estimate <= 0 ||
+                        range_estimate < FAR_FIELD_MIN_RANGE ||
+                        num_frames_far_field >= FAR_FIELD_RANGE_REFRESH);
+        }
 }
 
 
 void TRILATERATION::calculate_tdoa_matrices(
-        float32_t TDOA_array[NUM_HYDROPHONES], 
-        Matrix_2_3_f& A,
-        Vector_2_1_f& B){
-                
+        float32_t TDOA_array[NUM_HYDROPHONE_PAIRS],
+        Matrix_A_f& A,
+        Vector_B_f& B){
+
         /**
          * @brief Hydrophones are here labeled as a number
          *      Port hydrophone         : 0
          *      Starboard hydrophone    : 1
          *      Stern hydrophone        : 2
-         * 
+         *
          * The positions and distances are therefore calculated using the
          * port hydrophone as a reference. Example:
          *      x_01 = x_0 - x_1        Difference in x-position between hyd 0 and 1
          *      x_02 = x_0 - x_2        Difference in x-position between hyd 0 and 2
          *      etc.
-         * 
+         *
+         * The differences are precomputed in TRILATERATION::hydrophone_geometry
+         *
          * @note Only x and y is required as we are using 3 hydrophones and calculating
-         * z will in most cases result in linear dependent equations 
+         * z will in most cases result in linear dependent equations. With four or
+         * more hydrophones z is included
          */
 
-        /* Calculating the difference in position between the hydrophones */
-        float32_t x_01 = PORT_HYD_X - STARBOARD_HYD_X;
-        float32_t x_02 = PORT_HYD_X - STERN_HYD_X;
-
-        float32_t y_01 = PORT_HYD_Y - STARBOARD_HYD_Y;
-        float32_t y_02 = PORT_HYD_Y - STERN_HYD_Y;
-
-        /* Extracting the data from the array */
-        float32_t TDOA_port_starboard = TDOA_array[0];
-        float32_t TDOA_port_stern = TDOA_array[1];
-        float32_t TDOA_starboard_stern = TDOA_array[2];
-
         /* Using TDOA to calculate the distances */
-        float32_t d_01 = SOUND_SPEED * TDOA_port_starboard;
-        float32_t d_02 = SOUND_SPEED * TDOA_port_stern;
+        float32_t distance_diff[NUM_HYDROPHONES - 1];
+        unroll<NUM_HYDROPHONES - 1>([&](uint32_t i){
+                distance_diff[i] = SOUND_SPEED * TDOA_array[i];
+        });
+
+        /* Setting A and B */
+        TRILATERATION::calculate_tdoa_system(
+                TRILATERATION::hydrophone_geometry, distance_diff, A, B);
+}
 
-        /* Setting A */
-        A << x_01, y_01, d_01,
-             x_02, y_02, d_02;
 
-        /**
-         * @brief Calculating the values of the B-vector
-         * 
-         * The variables refer to the position (1-indexed) in the vector.
-         * 
-         * Check the link in the .h file for a better explanation   
-         */
-        float32_t b1 = 1 / 2 * (
-                std::pow(d_01, 2) +
-                std::pow(PORT_HYD_X, 2) - std::pow(STARBOARD_HYD_X, 2) +
-                std::pow(PORT_HYD_Y, 2) - std::pow(STARBOARD_HYD_Y, 2));
-        
-        float32_t b2 = 1 / 2 * (
-                std::pow(d_02, 2) +
-                std::pow(PORT_HYD_X, 2) - std::pow(STERN_HYD_X, 2) +
-                std::pow(PORT_HYD_Y, 2) - std::pow(STERN_HYD_Y, 2));
-
-        /* Setting B */
-        B << b1,
-             b2;
-}
\ No newline at end of file
+/**
+ * Explicit instantiation for the supported number of hydrophones
+ */
+#define INSTANTIATE_TRILATERATION(N)                                                    \
+        template uint8_t TRILATERATION::initialize_hydrophone_geometry<N>(              \
+                HydrophoneArrayGeometry<N>&, const float32_t (&)[N][3],                 \
+                const float32_t&);                                                      \
+        template uint8_t TRILATERATION::check_valid_lags<N>(                            \
+                const HydrophoneArrayGeometry<N>&,                                      \
+                const int32_t (&)[HydrophonePairs<N>::count]);                          \
+        template void TRILATERATION::calculate_tdoa_system<N>(                          \
+                const HydrophoneArrayGeometry<N>&, const float32_t (&)[N - 1],          \
+                TDOAMatrix<N>&, TDOAVector<N>&);                                        \
+        template uint8_t TRILATERATION::solve_tdoa_system<N>(                           \
+                const HydrophoneArrayGeometry<N>&, const TDOAMatrix<N>&,                \
+                const TDOAVector<N>&, float32_t (&)[3]);                                \
+        template uint8_t TRILATERATION::trilaterate_position<N>(                        \
+                const HydrophoneArrayGeometry<N>&,                                      \
+                const int32_t (&)[HydrophonePairs<N>::count], float32_t (&)[3]);        \
+        template uint8_t TRILATERATION::refine_position<N>(                             \
+                const HydrophoneArrayGeometry<N>&,                                      \
+                const int32_t (&)[HydrophonePairs<N>::count], float32_t (&)[3],         \
+                uint32_t&);                                                             \
+        template uint8_t TRILATERATION::estimate_direction<N>(                          \
+                const HydrophoneArrayGeometry<N>&,                                      \
+                const int32_t (&)[HydrophonePairs<N>::count], float32_t&, float32_t&);
+
+INSTANTIATE_TRILATERATION(3)
+INSTANTIATE_TRILATERATION(4)
+INSTANTIATE_TRILATERATION(5)
@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "workspace.h"
+
+/**
+ * Memory of the workspace used by main.cpp
+ */
+namespace{
+
+        alignas(WORKSPACE_ALIGNMENT) uint8_t frame_workspace_memory[WORKSPACE_SIZE];
+
+} /* namespace */
+
+
+/**
+ * Global variables for the workspace
+ */
+Workspace WORKSPACE::frame_workspace =
+        { frame_workspace_memory, WORKSPACE_SIZE, 0, 0, 0 };
+
+
+/**
+ * Functions for the workspace
+ */
+void WORKSPACE::initialize_workspace(
+        Workspace& workspace,
+        uint8_t* p_memory,
+        const uint32_t& size){
+
+        workspace.p_memory = p_memory;
+        workspace.size = size;
+        workspace.offset = 0;
+        WORKSPACE::reset_statistics(workspace);
+}
+
+
+void* WORKSPACE::allocate_bytes(
+        Workspace& workspace,
+        const uint32_t& size){
+
+        const uint32_t aligned_size = workspace_aligned_size(size);
+        if(aligned_size > workspace.size - workspace.offset){
+                workspace.num_failed++;
+                return nullptr;
+        }
+
+        void* p_allocation = workspace.p_memory + workspace.offset;
+        workspace.offset += aligned_size;
+        workspace.high_water_mark = std::max(workspace.high_water_mark, workspace.offset);
+        return p_allocation;
+}
+
+
+void WORKSPACE::reset_statistics(Workspace& workspace){
+        workspace.high_water_mark = workspace.offset;
+        workspace.num_failed = 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file
+ *
+ * @brief Host tool that checks that the main-loop is free of
+ * heap-allocations. Fails if anything allocates while
+ * ALLOCATION_GUARD is enabled
+ *
+ * Usage:
+ *      allocation_check [num_frames]
+ *
+ * Everything is initialized as in main.cpp, before the guard is enabled.
+ * Every frame is then processed with every stage of main.cpp: conversion,
+ * filter, cross-correlation, validation, the far-field and hyperbolic
+ * solvers, the iterative solver, the lookup-table if USE_LAG_LOOKUP_TABLE
+ * is set, the tracker, the telemetry and the profiling. Both solvers are run in every
+ * frame, such that all paths are covered no matter which is selected
+ *
+ * The pinger is placed between 1 and 200 m from the array, with different
+ * noise, such that both valid and rejected frames are processed. The
+ * rendering is done with the guard disabled, as the DMA fills the buffer
+ * on the MCU
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "allocation_guard.h"
+#include "analyze_data.h"
+#include "lag_lookup.h"
+#include "profiling.h"
+#include "simulation.h"
+#include "telemetry_transport.h"
+#include "tracking.h"
+
+int main(int argc, char** argv){
+
+  const uint32_t num_frames = (argc > 1) ? (uint32_t) atoi(argv[1]) : 200u;
+
+  /**
+   * Initialization, as in main.cpp. Allowed to allocate
+   */
+  if(!TRILATERATION::initialize_trilateration_globals()){
+    printf("Invalid hydrophone geometry in parameters.h\n");
+    return 1;
+  }
+  #if USE_LAG_LOOKUP_TABLE
+  if(!LAG_LOOKUP::generate_lag_lookup_table(LAG_LOOKUP::lag_lookup_table, LAG_LOOKUP_MAX_LAG)){
+    printf("Could not generate the lookup-table\n");
+    return 1;
+  }
+  #endif /* USE_LAG_LOOKUP_TABLE */
+
+  Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+  Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
+
+  uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    p_lag_array[pair] = &lag_array[pair];
+  });
+
+  Workspace& workspace = WORKSPACE::frame_workspace;
+  TrackerState pinger_tracker;
+  TRACKING::initialize_tracker(pinger_tracker);
+  PROFILING::reset_profiles();
+
+  /* Nothing receives the packets, which are sent to the loopback-address */
+  TelemetryRecord telemetry_record;
+  TelemetryBatch telemetry_batch;
+  TELEMETRY::initialize_batch(telemetry_batch);
+  TELEMETRY_TRANSPORT::initialize_transport();
+
+  std::vector<uint16_t> adc_data(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+  SimulationConfig config;
+  SIMULATION::get_default_config(config);
+
+  const uint64_t num_initialization_allocations = ALLOCATION_GUARD::get_num_allocations();
+
+  /**
+   * The main-loop
+   */
+  uint32_t num_valid_frames = 0;
+  uint32_t random_state = 12345u;
+  for(uint32_t frame = 0; frame < num_frames; frame++){
+
+    /* Acquiring a frame. The DMA does this on the MCU */
+    random_state = random_state * 1664525u + 1013904223u;
+    float32_t angle = (random_state >> 8) * (2.0f * (float32_t) M_PI / 16777216.0f);
+    random_state = random_state * 1664525u + 1013904223u;
+    float32_t range = 1.0f + (random_state >> 8) * (199.0f / 16777216.0f);
+    config.source_position[0] = HYDROPHONE_POSITIONS[0][0] + range * std::sin(angle);
+    config.source_position[1] = HYDROPHONE_POSITIONS[0][1] + range * std::cos(angle);
+    config.source_position[2] = HYDROPHONE_POSITIONS[0][2];
+    config.noise_std = (frame % 4 == 3) ? 2000.0f : SIM_NOISE_STD;
+    config.seed = frame + 1u;
+    SIMULATION::render_ping(config, adc_data.data());
+
+    ALLOCATION_GUARD::enable_guard();
+    uint32_t stage_ticks = TIMING::get_ticks();
+    const uint32_t frame_ticks = stage_ticks;
+
+    {
+      WorkspaceScope frame_scope(workspace);
+      float32_t* data_array[NUM_HYDROPHONES];
+      WORKSPACE::allocate_arrays(workspace, data_array, IN_BUFFER_LENGTH);
+
+      ANALYZE_DATA::convert_adc_data(adc_data.data(), data_array);
+      stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CONVERT, stage_ticks);
+      ANALYZE_DATA::filter_raw_data(data_array);
+      stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, stage_ticks);
+      ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array,
+          TRILATERATION::hydrophone_geometry.max_lag, workspace);
+      stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CORRELATE, stage_ticks);
+    }
+
+    uint8_t bool_time_error = 0;
+    uint8_t bool_valid = TRILATERATION::check_valid_signals(p_lag_array, bool_time_error);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_VALIDATE, stage_ticks);
+    TELEMETRY::initialize_record(frame, frame, telemetry_record);
+    TELEMETRY::set_lags(p_lag_array, telemetry_record);
+
+    if(bool_valid){
+      num_valid_frames++;
+      float32_t x_es = 0, y_es = 0, z_es = 0, bearing_es = 0, elevation_es = 0;
+
+      #if USE_LAG_LOOKUP_TABLE
+      LAG_LOOKUP::lookup_pinger_position(LAG_LOOKUP::lag_lookup_table,
+          LAG_LOOKUP_MAX_LAG, p_lag_array, x_es, y_es, bearing_es);
+      #endif /* USE_LAG_LOOKUP_TABLE */
+
+      TRILATERATION::use_hyperbolic_solver(std::sqrt(x_es * x_es + y_es * y_es), frame);
+      TRILATERATION::estimate_pinger_bearing(p_lag_array, bearing_es, elevation_es);
+      if(TRILATERATION::trilaterate_pinger_position(
+            A_matrix, B_vector, p_lag_array, x_es, y_es, z_es) &&
+         TRILATERATION::refine_pinger_position(p_lag_array, x_es, y_es, z_es)){
+        TRACKING::update_tracker(pinger_tracker, x_es, y_es, 1.0f);
+      }
+
+      float32_t x_tracked, y_tracked, bearing_tracked, range_tracked, variance[2];
+      TRACKING::get_tracker_estimate(pinger_tracker, x_tracked, y_tracked,
+          bearing_tracked, range_tracked, variance);
+    }
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_SOLVE, stage_ticks);
+    if(TELEMETRY::add_record(telemetry_record, telemetry_batch)){
+      TELEMETRY_TRANSPORT::send_batch(telemetry_batch);
+    }
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_TRANSMIT, stage_ticks);
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_FRAME, frame_ticks);
+
+    ALLOCATION_GUARD::disable_guard();
+  }
+
+  /**
+   * Report
+   */
+  const uint64_t num_guarded_allocations = ALLOCATION_GUARD::get_num_guarded_allocations();
+  TELEMETRY_TRANSPORT::close_transport();
+
+  printf("Frames                      : %u (%u with valid lags)\n", (unsigned) num_frames,
+      (unsigned) num_valid_frames);
+  printf("Initialization allocations  : %llu\n",
+      (unsigned long long) num_initialization_allocations);
+  printf("Main-loop allocations       : %llu\n", (unsigned long long) num_guarded_allocations);
+  printf("Eigen heap-allocations      : %s\n",
+      USE_ALLOCATION_GUARD ? "assert (EIGEN_NO_MALLOC)" : "allowed");
+
+  if(num_guarded_allocations){
+    printf("FAILED: the main-loop allocates. Run in gdb with a breakpoint on malloc "
+        "while ALLOCATION_GUARD is enabled to find the caller\n");
+    return 1;
+  }
+  printf("The main-loop is free of heap-allocations\n");
+  return 0;
+}
@@ -0,0 +1,404 @@
+/**
+ * @file
+ *
+ * @brief Host tool that processes a recording on every core. Used to
+ * reprocess long recordings from the pool, where replay is limited to a
+ * single core
+ *
+ * Usage:
+ *      batch_processor <recording> [num_threads] [estimates.csv] [verify]
+ *
+ * The frames are split into chunks of BATCH_CHUNK_FRAMES frames, and each
+ * worker is given a contiguous range of chunks. A worker takes the chunks
+ * from the front of its own range, such that it reads the recording in
+ * order, and steals from the back of the other ranges when its own is
+ * empty. num_threads defaults to the number of cores
+ *
+ * Every frame is independent: the filter starts at rest every frame (see
+ * ANALYZE_DATA::filter_raw_data()), such that no warm-up overlap between
+ * the chunks is required. The solvers are started from the linear solution
+ * in every frame, instead of the estimate of the previous frame as done by
+ * main.cpp and replay. The results are therefore the same no matter which
+ * worker processed the frame. The tracker is the only state carried between
+ * frames, and is updated afterwards in the order of the frames
+ *
+ * Each worker has its own workspace and matrices. Only the geometry in
+ * TRILATERATION::hydrophone_geometry is shared, and it is not changed
+ * after the header is applied
+ *
+ * If verify is 1 the recording is also processed on a single thread, and
+ * the results are compared
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "analyze_data.h"
+#include "recording_reader.h"
+#include "tracking.h"
+
+/* Number of frames in each chunk of work */
+constexpr uint32_t BATCH_CHUNK_FRAMES = 64u;
+
+
+/**
+ * @brief Result of processing one frame
+ *
+ * @param bool_valid_lags 1 if the lags passed TRILATERATION::check_valid_signals()
+ *
+ * @param bool_time_error 1 if the lags were rejected due to the time
+ *
+ * @param bool_valid_position 1 if a position was estimated
+ */
+typedef struct{
+  uint32_t sequence;
+  uint64_t timestamp;
+  int32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  float32_t position[3];
+  uint8_t bool_valid_lags;
+  uint8_t bool_time_error;
+  uint8_t bool_valid_position;
+}FrameResult; /* struct FrameResult */
+
+
+/**
+ * @brief A range of chunks, taken from the front by the owner and stolen
+ * from the back by the other workers
+ */
+typedef struct{
+  std::mutex mutex;
+  std::deque<uint64_t> chunks;
+}ChunkQueue; /* struct ChunkQueue */
+
+
+/**
+ * @brief Processes frame @p index of the recording, with the processing of
+ * main.cpp. Only uses memory given by the worker, including the buffer
+ * @p p_decoded an encoded frame is decoded into
+ */
+static void process_frame(
+      const RecordingReader& reader,
+      const uint64_t& index,
+      uint16_t* p_decoded,
+      Workspace& workspace,
+      Matrix_A_f& A_matrix,
+      Vector_B_f& B_vector,
+      FrameResult& result){
+
+  RecordingFrameView view;
+  memset(&result, 0, sizeof(FrameResult));
+  if(!RECORDING_READER::get_frame(reader, index, p_decoded, view)){
+    return;
+  }
+  result.sequence = view.header.sequence;
+  result.timestamp = view.header.timestamp;
+
+  WorkspaceScope frame_scope(workspace);
+  float32_t* data_array[NUM_HYDROPHONES];
+  WORKSPACE::allocate_arrays(workspace, data_array, IN_BUFFER_LENGTH);
+
+  uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    p_lag_array[pair] = &lag_array[pair];
+  });
+
+  ANALYZE_DATA::convert_recorded_data(view.p_samples, data_array);
+  ANALYZE_DATA::filter_raw_data(data_array);
+  ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array,
+      TRILATERATION::hydrophone_geometry.max_lag, workspace);
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    result.lag_array[pair] = (int32_t) lag_array[pair];
+  });
+
+  result.bool_valid_lags = TRILATERATION::check_valid_signals(p_lag_array,
+      result.bool_time_error);
+  if(!result.bool_valid_lags){
+    return;
+  }
+
+  float32_t x_es = 0, y_es = 0, z_es = 0;
+  uint8_t bool_valid = TRILATERATION::trilaterate_pinger_position(
+      A_matrix, B_vector, p_lag_array, x_es, y_es, z_es);
+
+  /**
+   * Refining as TRILATERATION::refine_pinger_position(), which is not used 
+   * as it adds to the shared TRILATERATION::nonlinear_solver_timing
+   */
+  #if USE_NONLINEAR_SOLVER
+  if(bool_valid){
+    float32_t position[3] = { x_es, y_es,
+        (HydrophoneGeometry::dimension == 3) ? z_es : NONLINEAR_ASSUMED_Z };
+    uint32_t num_iterations;
+    bool_valid = TRILATERATION::refine_position(TRILATERATION::hydrophone_geometry,
+        result.lag_array, position, num_iterations);
+    if(bool_valid){
+      x_es = position[0];
+      y_es = position[1];
+      if(HydrophoneGeometry::dimension == 3){
+        z_es = position[2];
+      }
+    }
+  }
+  #endif /* USE_NONLINEAR_SOLVER */
+
+  result.position[0] = x_es;
+  result.position[1] = y_es;
+  result.position[2] = z_es;
+  result.bool_valid_position = bool_valid;
+}
+
+
+/**
+ * @brief Processes every frame of @p reader on @p num_threads workers
+ *
+ * @param results One result for each frame, in the order of the recording
+ */
+static void process_recording(
+      const RecordingReader& reader,
+      const uint32_t& num_threads,
+      std::vector<FrameResult>& results){
+
+  results.resize(reader.num_frames);
+  const uint64_t num_chunks = (reader.num_frames + BATCH_CHUNK_FRAMES - 1) / BATCH_CHUNK_FRAMES;
+
+  /* Every worker starts with a contiguous range, such that it reads in order */
+  std::vector<ChunkQueue> queues(num_threads);
+  for(uint64_t chunk = 0; chunk < num_chunks; chunk++){
+    queues[chunk * num_threads / num_chunks].chunks.push_back(chunk);
+  }
+
+  /* Takes a chunk from the front of its own queue, or steals from the back of another */
+  auto take_chunk = [&](uint32_t worker, uint64_t& chunk, uint8_t& bool_stolen){
+    for(uint32_t i = 0; i < num_threads; i++){
+      ChunkQueue& queue = queues[(worker + i) % num_threads];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if(!queue.chunks.empty()){
+        bool_stolen = (i != 0);
+        if(!bool_stolen){
+          chunk = queue.chunks.front();
+          queue.chunks.pop_front();
+        }
+        else{
+          chunk = queue.chunks.back();
+          queue.chunks.pop_back();
+        }
+        return 1;
+      }
+    }
+    return 0;
+  };
+
+  std::atomic<uint64_t> num_stolen(0);
+
+  auto run_worker = [&](uint32_t worker){
+    /* The pipeline-state of the worker */
+    std::vector<uint8_t> workspace_memory(WORKSPACE_SIZE + WORKSPACE_ALIGNMENT);
+    uint8_t* p_memory = workspace_memory.data() + (WORKSPACE_ALIGNMENT -
+        (uintptr_t) workspace_memory.data() % WORKSPACE_ALIGNMENT) % WORKSPACE_ALIGNMENT;
+    Workspace workspace;
+    WORKSPACE::initialize_workspace(workspace, p_memory, WORKSPACE_SIZE);
+
+    Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+    Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
+    std::vector<uint16_t> decoded(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+
+    uint64_t chunk;
+    uint8_t bool_stolen;
+    while(take_chunk(worker, chunk, bool_stolen)){
+      num_stolen += bool_stolen;
+
+      const uint64_t end = std::min(reader.num_frames, (chunk + 1) * BATCH_CHUNK_FRAMES);
+      for(uint64_t index = chunk * BATCH_CHUNK_FRAMES; index < end; index++){
+        process_frame(reader, index, decoded.data(), workspace, A_matrix, B_vector, results[index]);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(uint32_t worker = 1; worker < num_threads; worker++){
+    threads.emplace_back(run_worker, worker);
+  }
+  run_worker(0);
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+
+  if(num_threads > 1){
+    printf("Chunks                      : %llu (%llu stolen)\n",
+        (unsigned long long) num_chunks, (unsigned long long) num_stolen.load());
+  }
+}
+
+
+/**
+ * @brief Wall-clock time spent by @p function [us]. TIMING wraps after a 
+ * few seconds on the host, and is not used for the whole recording
+ */
+template<typename Function>
+static float32_t measure_us(Function function){
+  auto start = std::chrono::steady_clock::now();
+  function();
+  return std::chrono::duration<float32_t, std::micro>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+
+/**
+ * @brief Compares two results. The processing is deterministic, such that
+ * the results must be bitwise equal
+ */
+static uint8_t check_equal_results(const FrameResult& a, const FrameResult& b){
+  return a.sequence == b.sequence && a.timestamp == b.timestamp &&
+         !memcmp(a.lag_array, b.lag_array, sizeof(a.lag_array)) &&
+         !memcmp(a.position, b.position, sizeof(a.position)) &&
+         a.bool_valid_lags == b.bool_valid_lags &&
+         a.bool_time_error == b.bool_time_error &&
+         a.bool_valid_position == b.bool_valid_position;
+}
+
+
+int main(int argc, char** argv){
+
+  if(argc < 2){
+    printf("Usage: %s <recording> [num_threads] [estimates.csv] [verify]\n", argv[0]);
+    return 1;
+  }
+  uint32_t num_threads = (argc > 2) ? (uint32_t) atoi(argv[2]) : 0u;
+  if(!num_threads){
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  const uint8_t bool_verify = (argc > 4) && atoi(argv[4]);
+
+  /**
+   * Mapping the recording, and applying its geometry
+   */
+  RecordingReader reader;
+  if(!RECORDING_READER::open_recording(argv[1], reader)){
+    printf("Could not open %s, or the recording-header is invalid\n", argv[1]);
+    return 1;
+  }
+  const RecordingHeader& header = reader.header;
+  if(!RECORDING::check_compatible_header(header)){
+    printf("The recording (%u hydrophones, %u samples at %.0f Hz) does not match "
+        "parameters.h\n", (unsigned) header.num_hydrophones,
+        (unsigned) header.frame_length, (double) header.sample_frequency);
+    RECORDING_READER::close_recording(reader);
+    return 1;
+  }
+
+  float32_t positions[NUM_HYDROPHONES][3];
+  memcpy(positions, header.positions, sizeof(positions));
+  GeometryConfig geometry_config;
+  GEOMETRY_CONFIG::create_config(positions, geometry_config);
+  if(!GEOMETRY_CONFIG::apply_config(geometry_config)){
+    printf("Invalid geometry in the recording\n");
+    RECORDING_READER::close_recording(reader);
+    return 1;
+  }
+
+  /**
+   * Processing the frames in parallel
+   */
+  std::vector<FrameResult> results;
+  float32_t parallel_us = measure_us([&](){
+    process_recording(reader, num_threads, results);
+  });
+
+  float32_t sequential_us = 0.0f;
+  uint64_t num_mismatches = 0;
+  if(bool_verify){
+    std::vector<FrameResult> sequential_results;
+    sequential_us = measure_us([&](){
+      process_recording(reader, 1, sequential_results);
+    });
+    for(uint64_t index = 0; index < results.size(); index++){
+      num_mismatches += !check_equal_results(results[index], sequential_results[index]);
+    }
+  }
+  RECORDING_READER::close_recording(reader);
+
+  /**
+   * Merging the results in order. The tracker is updated sequentially
+   */
+  FILE* estimates = nullptr;
+  if(argc > 3){
+    estimates = fopen(argv[3], "w");
+    if(!estimates){
+      printf("Could not open %s\n", argv[3]);
+      return 1;
+    }
+    fprintf(estimates, "sequence,timestamp_us,valid,x,y,z,bearing,x_tracked,y_tracked\n");
+  }
+
+  TrackerState pinger_tracker;
+  TRACKING::initialize_tracker(pinger_tracker);
+
+  uint32_t num_dropped = 0, num_invalid_lags = 0, num_solver_errors = 0;
+  for(uint64_t index = 0; index < results.size(); index++){
+    const FrameResult& result = results[index];
+    float32_t time_step = 0.0f;
+    if(index){
+      num_dropped += result.sequence - results[index - 1].sequence - 1;
+      time_step = (result.timestamp - results[index - 1].timestamp) * 1e-6f;
+    }
+
+    if(!result.bool_valid_lags){
+      num_invalid_lags++;
+    }
+    else if(!result.bool_valid_position && !result.bool_time_error){
+      num_solver_errors++;
+    }
+    if(result.bool_valid_position){
+      TRACKING::update_tracker(pinger_tracker, result.position[0], result.position[1],
+          time_step);
+    }
+
+    if(estimates){
+      float32_t x_tracked = 0, y_tracked = 0, bearing_tracked, range_tracked, variance[2];
+      TRACKING::get_tracker_estimate(pinger_tracker, x_tracked, y_tracked,
+          bearing_tracked, range_tracked, variance);
+      fprintf(estimates, "%u,%llu,%u,%.4f,%.4f,%.4f,%.2f,%.4f,%.4f\n",
+          (unsigned) result.sequence, (unsigned long long) result.timestamp,
+          (unsigned) result.bool_valid_position, (double) result.position[0],
+          (double) result.position[1], (double) result.position[2],
+          std::atan2(result.position[0], result.position[1]) * 180.0 / M_PI,
+          (double) x_tracked, (double) y_tracked);
+    }
+  }
+  if(estimates){
+    fclose(estimates);
+  }
+
+  /**
+   * Report
+   */
+  const float32_t frame_duration_us = 1e6f * header.frame_length / header.sample_frequency;
+  const float32_t frame_us = parallel_us / std::max(results.size(), (size_t) 1);
+
+  printf("Threads                     : %u\n", (unsigned) num_threads);
+  printf("Frames                      : %llu (%u dropped)\n",
+      (unsigned long long) results.size(), (unsigned) num_dropped);
+  printf("Invalid lags                : %u\n", (unsigned) num_invalid_lags);
+  printf("Solver errors               : %u\n", (unsigned) num_solver_errors);
+  printf("Processing time             : %.1f us/frame\n", (double) frame_us);
+  printf("Throughput                  : %.0f frames/s, %.1f MB/s\n", 1e6 / (double) frame_us,
+      (double) (reader.size - sizeof(RecordingHeader)) / std::max(reader.num_frames, (uint64_t) 1u) /
+      (double) frame_us);
+  printf("Faster than real-time       : %.2fx\n", (double) (frame_duration_us / frame_us));
+
+  if(bool_verify){
+    printf("Speedup over one thread     : %.2fx (%.0f%% efficiency)\n",
+        (double) (sequential_us / parallel_us),
+        100.0 * sequential_us / parallel_us / num_threads);
+    printf("Equal to one thread         : %s (%llu frames differ)\n",
+        num_mismatches ? "no" : "yes", (unsigned long long) num_mismatches);
+  }
+
+  return num_mismatches ? 1 : 0;
+}
@@ -0,0 +1,532 @@
+/**
+ * @file
+ *
+ * @brief Host tool that tests the commands setting and querying the
+ * parameters at runtime. The tool plays both sides over the loopback
+ * address: the topside sends every command to COMMAND_PORT, the MCU is
+ * stood in for by COMMAND::poll_commands() between two frames, and the
+ * reply is received on COMMAND_REPLY_PORT. The commands handled by the
+ * main-loop are executed by a handler doing the same as main.cpp, except
+ * for what requires the hardware
+ *
+ * Usage:
+ *      command_loopback
+ *
+ * The checks cover
+ *      - Querying every parameter, which gives the defaults
+ *      - Setting a parameter recomputes its derived data once, and setting
+ *        it again to the same value recomputes nothing
+ *      - A set holding an invalid value, an unknown ID or a wrong type is
+ *        rejected as a whole, and nothing is changed
+ *      - An invalid packet is not answered
+ *      - A hydrophone configuration is loaded from the command, and an
+ *        invalid one changes nothing
+ *      - The status query is answered with the profile of every stage
+ *      - The redesigned filter has unit gain in the center of the band and
+ *        -3 dB at the cut-off frequencies
+ * Fails if any check fails
+ *
+ * The time spent executing a set is reported with and without a change,
+ * such that the cost of the recomputations is known
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <complex>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "geometry_config.h"
+#include "profiling.h"
+#include "telemetry_transport.h"
+
+/* Time waited for a reply [ms] */
+#define REPLY_TIMEOUT_MS 100
+
+
+/**
+ * @brief Sockets of the topside
+ */
+static int command_sender = -1;
+static int reply_receiver = -1;
+static uint32_t next_sequence = 1;
+
+
+/**
+ * @brief Opens the sockets of the topside
+ *
+ * @retval Returns 1 if both are opened
+ */
+static uint8_t open_topside(){
+  command_sender = socket(AF_INET, SOCK_DGRAM, 0);
+  reply_receiver = socket(AF_INET, SOCK_DGRAM, 0);
+  if(command_sender < 0 || reply_receiver < 0){
+    return 0;
+  }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  address.sin_port = htons(COMMAND_REPLY_PORT);
+  if(bind(reply_receiver, (const struct sockaddr*) &address, sizeof(address)) != 0){
+    return 0;
+  }
+
+  address.sin_port = htons(COMMAND_PORT);
+  return connect(command_sender, (const struct sockaddr*) &address, sizeof(address)) == 0;
+}
+
+
+/**
+ * @brief Executes the commands handled by the main-loop, as
+ * execute_command() in main.cpp. COMMAND_STORE_GEOMETRY is not handled,
+ * as the host has no flash
+ */
+static uint16_t execute_command(
+      const COMMAND_TYPES& command,
+      const uint8_t* p_payload,
+      const uint32_t& payload_length,
+      uint8_t* p_reply_payload,
+      uint32_t& reply_length){
+
+  GeometryConfig config;
+  switch(command){
+  case COMMAND_GEOMETRY:
+    if(!GEOMETRY_CONFIG::parse_config(p_payload, payload_length, config)){
+      return PARAMETER_INVALID_VALUE;
+    }
+    return GEOMETRY_CONFIG::apply_config(config) ? PARAMETER_OK : PARAMETER_REBUILD_FAILED;
+
+  default:
+    return PARAMETER_UNKNOWN_ID;
+  }
+}
+
+
+/**
+ * @brief Sends a packet to the MCU, lets the MCU execute the waiting
+ * commands as between two frames, and receives the reply
+ *
+ * @retval Returns 1 if a valid reply with the sequence-number of the
+ * command is received
+ */
+static uint8_t exchange_packet(
+      const uint8_t* p_packet,
+      const uint32_t& length,
+      const uint32_t& sequence,
+      CommandHeader& reply_header,
+      void* p_reply_payload,
+      const uint32_t& max_reply_length){
+
+  if(send(command_sender, p_packet, length, 0) != (ssize_t) length){
+    return 0;
+  }
+
+  /* The MCU polls the commands at the start of every frame */
+  COMMAND::poll_commands(execute_command);
+
+  struct pollfd descriptor = { reply_receiver, POLLIN, 0 };
+  if(poll(&descriptor, 1, REPLY_TIMEOUT_MS) <= 0){
+    return 0;
+  }
+
+  uint8_t reply[COMMAND_MAX_PACKET_SIZE];
+  const ssize_t received = recv(reply_receiver, reply, sizeof(reply), 0);
+  return received > 0 &&
+         COMMAND::parse_packet(reply, (uint32_t) received, reply_header, p_reply_payload, max_reply_length) &&
+         reply_header.sequence == sequence;
+}
+
+
+/**
+ * @brief Sends a command with the next sequence-number, and receives the reply
+ *
+ * @retval Returns the status of the reply. Returns NUM_PARAMETER_STATUS if
+ * no reply is received
+ */
+static uint32_t exchange_payload(
+      const COMMAND_TYPES& command,
+      const void* p_payload,
+      const uint32_t& payload_length,
+      void* p_reply_payload,
+      const uint32_t& max_reply_length,
+      uint32_t& reply_length){
+
+  uint8_t packet[COMMAND_MAX_PACKET_SIZE];
+  const uint32_t sequence = next_sequence++;
+  const uint32_t length = COMMAND::write_packet(command, sequence, 0, p_payload, payload_length, packet);
+
+  CommandHeader reply_header;
+  if(!exchange_packet(packet, length, sequence, reply_header, p_reply_payload, max_reply_length)){
+    reply_length = 0;
+    return NUM_PARAMETER_STATUS;
+  }
+  reply_length = reply_header.payload_length;
+  return reply_header.status;
+}
+
+
+/**
+ * @brief Sends a command holding a list of entries, and receives the reply
+ */
+static uint32_t exchange_command(
+      const COMMAND_TYPES& command,
+      const CommandEntry* entries,
+      const uint32_t& num_entries,
+      CommandEntry* reply_entries,
+      uint32_t& num_reply_entries){
+
+  uint32_t reply_length;
+  const uint32_t status = exchange_payload(command, entries, num_entries * sizeof(CommandEntry),
+      reply_entries, COMMAND_MAX_ENTRIES * sizeof(CommandEntry), reply_length);
+  num_reply_entries = reply_length / sizeof(CommandEntry);
+  return status;
+}
+
+
+/**
+ * @brief Creates an entry holding a float or an integer
+ */
+static CommandEntry float_entry(const uint32_t& id, const float32_t& value){
+  CommandEntry entry = { (uint16_t) id, PARAMETER_FLOAT, 0 };
+  memcpy(&entry.value, &value, sizeof(float32_t));
+  return entry;
+}
+
+static CommandEntry uint32_entry(const uint32_t& id, const uint32_t& value){
+  return { (uint16_t) id, PARAMETER_UINT32, value };
+}
+
+
+/**
+ * @brief Returns the current value of a float-parameter in the registry
+ */
+static float32_t get_float(const uint32_t& id){
+  ParameterValue value = {};
+  PARAMETER_REGISTRY::get_parameter(id, value);
+  return value.as_float;
+}
+
+
+/**
+ * @brief Gain of the filter given by filter_coefficients at @p frequency [dB]
+ */
+static float64_t filter_gain_db(const float64_t& frequency){
+  const std::complex<float64_t> z_inv = std::polar(1.0, -2.0 * M_PI * frequency / SAMPLE_FREQUENCY);
+  std::complex<float64_t> response = 1.0;
+  for(uint32_t stage = 0; stage < num_stages; stage++){
+    const float32_t* c = &filter_coefficients[5 * stage];
+    response *= ((float64_t) c[0] + (float64_t) c[1] * z_inv + (float64_t) c[2] * z_inv * z_inv) /
+                (1.0 - (float64_t) c[3] * z_inv - (float64_t) c[4] * z_inv * z_inv);
+  }
+  return 20.0 * std::log10(std::abs(response));
+}
+
+
+/**
+ * @brief Time spent executing a command, without the transport [us]
+ */
+static float32_t measure_command_us(
+      const CommandEntry* entries,
+      const uint32_t& num_entries,
+      const uint32_t& num_repetitions){
+
+  uint8_t packet[COMMAND_MAX_PACKET_SIZE];
+  uint8_t reply[COMMAND_MAX_PACKET_SIZE];
+  const uint32_t length = COMMAND::write_packet(COMMAND_SET, 0, 0,
+      entries, num_entries * sizeof(CommandEntry), packet);
+
+  auto start = std::chrono::steady_clock::now();
+  for(uint32_t i = 0; i < num_repetitions; i++){
+    COMMAND::handle_command(packet, length, reply);
+  }
+  return std::chrono::duration<float32_t, std::micro>(
+      std::chrono::steady_clock::now() - start).count() / num_repetitions;
+}
+
+
+int main(){
+
+  if(!open_topside() || !TELEMETRY_TRANSPORT::initialize_transport()){
+    printf("Could not open the loopback-sockets on port %u and %u\n",
+        (unsigned) COMMAND_PORT, (unsigned) COMMAND_REPLY_PORT);
+    return 1;
+  }
+
+  /* Startup as on the MCU */
+  PARAMETER_REGISTRY::reset_parameters();
+  if(!TRILATERATION::initialize_trilateration_globals()){
+    printf("Invalid geometry in parameters.h\n");
+    return 1;
+  }
+
+  uint32_t num_failed = 0;
+  auto check = [&](uint8_t bool_passed, const char* name){
+    printf("  %-52s: %s\n", name, bool_passed ? "passed" : "FAILED");
+    num_failed += !bool_passed;
+  };
+
+  CommandEntry reply_entries[COMMAND_MAX_ENTRIES];
+  uint32_t num_reply_entries = 0;
+  ParameterStatistics statistics;
+
+  /**
+   * Querying the defaults
+   */
+  printf("Parameters:\n");
+  uint32_t status = exchange_command(COMMAND_GET, NULL, 0, reply_entries, num_reply_entries);
+  uint8_t bool_defaults = (status == PARAMETER_OK && num_reply_entries == NUM_PARAMETERS);
+  for(uint32_t i = 0; bool_defaults && i < num_reply_entries; i++){
+    const ParameterInfo& info = PARAMETER_REGISTRY::parameter_info[reply_entries[i].id];
+    bool_defaults &= (reply_entries[i].value == info.default_value.as_uint32);
+
+    ParameterValue value;
+    value.as_uint32 = reply_entries[i].value;
+    if(info.type == PARAMETER_FLOAT){
+      printf("  %-24s = %g\n", info.name, (double) value.as_float);
+    }
+    else{
+      printf("  %-24s = %u\n", info.name, (unsigned) value.as_uint32);
+    }
+  }
+
+  printf("Commands:\n");
+  check(bool_defaults, "Query of every parameter gives the defaults");
+
+  /**
+   * Changing the margin recomputes the geometry once
+   */
+  const int32_t default_max_lag = TRILATERATION::hydrophone_geometry.max_lag;
+  const float32_t max_hydrophone_distance = TRILATERATION::hydrophone_geometry.max_hydrophone_distance;
+  CommandEntry margin = float_entry(PARAMETER_MARGIN_TIME_EPSILON, 0.5f);
+
+  status = exchange_command(COMMAND_SET, &margin, 1, reply_entries, num_reply_entries);
+  PARAMETER_REGISTRY::get_statistics(statistics);
+  const int32_t expected_max_lag = (int32_t) std::floor(
+      1.5f * (max_hydrophone_distance / SOUND_SPEED) * SAMPLE_FREQUENCY);
+  check(status == PARAMETER_OK && num_reply_entries == 1 && reply_entries[0].value == margin.value &&
+        statistics.num_geometry_rebuilds == 1 && statistics.num_filter_rebuilds == 0 &&
+        TRILATERATION::hydrophone_geometry.max_lag == expected_max_lag &&
+        TRILATERATION::margin_time_epsilon == 0.5f,
+        "Set of the margin recomputes the geometry");
+  printf("  %-52s: %d -> %d samples\n", "max_lag", (int) default_max_lag,
+      (int) TRILATERATION::hydrophone_geometry.max_lag);
+
+  status = exchange_command(COMMAND_SET, &margin, 1, reply_entries, num_reply_entries);
+  PARAMETER_REGISTRY::get_statistics(statistics);
+  check(status == PARAMETER_OK && statistics.num_geometry_rebuilds == 1 && statistics.num_applied == 2,
+        "Set to the same value recomputes nothing");
+
+  CommandEntry solver = uint32_entry(PARAMETER_SOLVER_MODE, SOLVER_HYPERBOLIC);
+  status = exchange_command(COMMAND_SET, &solver, 1, reply_entries, num_reply_entries);
+  PARAMETER_REGISTRY::get_statistics(statistics);
+  check(status == PARAMETER_OK && TRILATERATION::solver_mode == SOLVER_HYPERBOLIC &&
+        statistics.num_geometry_rebuilds == 1 && statistics.num_filter_rebuilds == 0,
+        "Set of the solver recomputes nothing");
+
+  /**
+   * Changing the band redesigns the filter once, for both frequencies
+   */
+  CommandEntry band[2] = { float_entry(PARAMETER_FILTER_LOW_FREQUENCY, 20000.0f),
+                           float_entry(PARAMETER_FILTER_HIGH_FREQUENCY, 35000.0f) };
+  status = exchange_command(COMMAND_SET, band, 2, reply_entries, num_reply_entries);
+  PARAMETER_REGISTRY::get_statistics(statistics);
+  check(status == PARAMETER_OK && num_reply_entries == 2 &&
+        statistics.num_filter_rebuilds == 1 && statistics.num_geometry_rebuilds == 1,
+        "Set of the band redesigns the filter once");
+
+  const float64_t center_gain = filter_gain_db(std::sqrt(20000.0 * 35000.0));
+  const float64_t low_gain = filter_gain_db(20000.0);
+  const float64_t high_gain = filter_gain_db(35000.0);
+  const float64_t stop_gain = std::max(filter_gain_db(5000.0), filter_gain_db(50000.0));
+  check(std::abs(low_gain + 3.01) < 0.05 && std::abs(high_gain + 3.01) < 0.05 &&
+        center_gain > -0.2 && center_gain < 0.01 && stop_gain < -20.0,
+        "Redesigned filter is -3 dB at the cut-offs");
+  printf("  %-52s: %.2f / %.2f / %.2f / %.2f dB\n", "Gain low/center/high/stop",
+      low_gain, center_gain, high_gain, stop_gain);
+
+  /**
+   * Invalid sets are rejected as a whole
+   */
+  float32_t coefficients[5 * num_stages];
+  memcpy(coefficients, filter_coefficients, sizeof(coefficients));
+
+  CommandEntry inconsistent[2] = { float_entry(PARAMETER_MARGIN_TIME_EPSILON, 0.25f),
+                                   float_entry(PARAMETER_FILTER_LOW_FREQUENCY, 40000.0f) };
+  status = exchange_command(COMMAND_SET, inconsistent, 2, reply_entries, num_reply_entries);
+  PARAMETER_REGISTRY::get_statistics(statistics);
+  check(status == PARAMETER_INVALID_VALUE && num_reply_entries == 2 &&
+        reply_entries[0].value == margin.value && get_float(PARAMETER_MARGIN_TIME_EPSILON) == 0.5f &&
+        get_float(PARAMETER_FILTER_LOW_FREQUENCY) == 20000.0f &&
+        !memcmp(coefficients, filter_coefficients, sizeof(coefficients)) &&
+        statistics.num_geometry_rebuilds == 1 && statistics.num_filter_rebuilds == 1,
+        "Set with low > high frequency changes nothing");
+
+  CommandEntry out_of_range[2] = { float_entry(PARAMETER_MARGIN_TIME_EPSILON, 0.25f),
+                                   float_entry(PARAMETER_MARGIN_TIME_EPSILON, NAN) };
+  status = exchange_command(COMMAND_SET, out_of_range, 2, reply_entries, num_reply_entries);
+  check(status == PARAMETER_INVALID_VALUE && get_float(PARAMETER_MARGIN_TIME_EPSILON) == 0.5f,
+        "Set with a NaN changes nothing");
+
+  CommandEntry unknown[2] = { float_entry(PARAMETER_MARGIN_TIME_EPSILON, 0.25f),
+                              uint32_entry(NUM_PARAMETERS, 0) };
+  status = exchange_command(COMMAND_SET, unknown, 2, reply_entries, num_reply_entries);
+  check(status == PARAMETER_UNKNOWN_ID && num_reply_entries == 0 &&
+        get_float(PARAMETER_MARGIN_TIME_EPSILON) == 0.5f,
+        "Set with an unknown ID changes nothing");
+
+  CommandEntry wrong_type = uint32_entry(PARAMETER_MARGIN_TIME_EPSILON, 0);
+  status = exchange_command(COMMAND_SET, &wrong_type, 1, reply_entries, num_reply_entries);
+  check(status == PARAMETER_WRONG_TYPE && get_float(PARAMETER_MARGIN_TIME_EPSILON) == 0.5f,
+        "Set with the wrong type changes nothing");
+
+  CommandEntry invalid_solver = uint32_entry(PARAMETER_SOLVER_MODE, SOLVER_AUTO + 1);
+  status = exchange_command(COMMAND_SET, &invalid_solver, 1, reply_entries, num_reply_entries);
+  check(status == PARAMETER_INVALID_VALUE && TRILATERATION::solver_mode == SOLVER_HYPERBOLIC,
+        "Set of an invalid solver changes nothing");
+
+  /**
+   * Invalid packets are not answered
+   */
+  uint8_t packet[COMMAND_MAX_PACKET_SIZE];
+  uint32_t length = COMMAND::write_packet(COMMAND_GET, 1000, 0, NULL, 0, packet);
+  packet[0] ^= 0xFF;
+  CommandHeader reply_header;
+  check(!exchange_packet(packet, length, 1000, reply_header, reply_entries, sizeof(reply_entries)),
+        "Wrong magic is not answered");
+
+  length = COMMAND::write_packet(COMMAND_SET, 1001, 0, band, sizeof(band), packet);
+  check(!exchange_packet(packet, length - 1, 1001, reply_header, reply_entries, sizeof(reply_entries)),
+        "Truncated command is not answered");
+
+  length = COMMAND::write_packet(COMMAND_SET, 1002, 0, band, sizeof(band) - 1, packet);
+  check(!exchange_packet(packet, length, 1002, reply_header, reply_entries, sizeof(reply_entries)),
+        "Partial entry is not answered");
+
+  /**
+   * The frame received by the MCU. The headers are written as by the
+   * topside, sending to the MCU instead of from it
+   */
+  uint8_t frame[TELEMETRY_FRAME_HEADER_SIZE + COMMAND_MAX_PACKET_SIZE];
+  const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  length = COMMAND::write_packet(COMMAND_GET, 1003, 0, NULL, 0, frame + TELEMETRY_FRAME_HEADER_SIZE);
+  const uint32_t frame_length = TELEMETRY::write_frame_header(mac, 0, COMMAND_PORT, length, frame);
+  const uint8_t mcu_ip[4] = { (uint8_t) (TELEMETRY_SOURCE_IP >> 24), (uint8_t) (TELEMETRY_SOURCE_IP >> 16),
+                              (uint8_t) (TELEMETRY_SOURCE_IP >> 8), (uint8_t) TELEMETRY_SOURCE_IP };
+  memcpy(frame + 14 + 16, mcu_ip, sizeof(mcu_ip));
+
+  const uint8_t* p_payload = NULL;
+  uint32_t payload_length = 0;
+  check(TELEMETRY::parse_frame_header(frame, frame_length, COMMAND_PORT, p_payload, payload_length) &&
+        p_payload == frame + TELEMETRY_FRAME_HEADER_SIZE && payload_length == length &&
+        !TELEMETRY::parse_frame_header(frame, frame_length, TELEMETRY_DEST_PORT, p_payload, payload_length) &&
+        !TELEMETRY::parse_frame_header(frame, frame_length - 1, COMMAND_PORT, p_payload, payload_length),
+        "Command is found in the frame received by the MCU");
+
+  /**
+   * A hydrophone configuration is loaded as a whole, or not at all
+   */
+  float32_t positions[NUM_HYDROPHONES][3];
+  memcpy(positions, TRILATERATION::hydrophone_geometry.position, sizeof(positions));
+  float32_t scaled_positions[NUM_HYDROPHONES][3];
+  for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+    for(uint32_t axis = 0; axis < 3; axis++){
+      scaled_positions[hyd][axis] = 0.5f * positions[hyd][axis];
+    }
+  }
+
+  GeometryConfig config;
+  GEOMETRY_CONFIG::create_config(scaled_positions, config);
+  uint32_t reply_length = 0;
+  uint8_t reply_payload[COMMAND_MAX_PAYLOAD_SIZE];
+  const int32_t margin_max_lag = TRILATERATION::hydrophone_geometry.max_lag;
+  status = exchange_payload(COMMAND_GEOMETRY, &config, sizeof(config),
+      reply_payload, sizeof(reply_payload), reply_length);
+  check(status == PARAMETER_OK && reply_length == 0 &&
+        TRILATERATION::hydrophone_geometry.position[1][0] == scaled_positions[1][0] &&
+        TRILATERATION::hydrophone_geometry.max_lag < margin_max_lag,
+        "Configuration is loaded from the command");
+
+  config.positions[1][0] = 0.0f;
+  const int32_t scaled_max_lag = TRILATERATION::hydrophone_geometry.max_lag;
+  status = exchange_payload(COMMAND_GEOMETRY, &config, sizeof(config),
+      reply_payload, sizeof(reply_payload), reply_length);
+  check(status == PARAMETER_INVALID_VALUE &&
+        TRILATERATION::hydrophone_geometry.position[1][0] == scaled_positions[1][0] &&
+        TRILATERATION::hydrophone_geometry.max_lag == scaled_max_lag,
+        "Configuration with a wrong CRC changes nothing");
+
+  GEOMETRY_CONFIG::create_config(positions, config);
+  exchange_payload(COMMAND_GEOMETRY, &config, sizeof(config),
+      reply_payload, sizeof(reply_payload), reply_length);
+
+  /**
+   * The status query is answered with the same report as given by the
+   * debugger. A stage is recorded, such that the report is not empty
+   */
+  PROFILING::reset_profiles();
+  PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, TIMING::get_ticks());
+  char report[COMMAND_MAX_PAYLOAD_SIZE + 1];
+  const uint32_t report_length = PROFILING::write_report(report, sizeof(report));
+
+  status = exchange_payload(COMMAND_STATUS, NULL, 0, reply_payload, sizeof(reply_payload), reply_length);
+  uint32_t num_lines = 0;
+  for(uint32_t i = 0; i < reply_length; i++){
+    num_lines += (reply_payload[i] == '\n');
+  }
+  check(status == PARAMETER_OK && reply_length == report_length &&
+        !memcmp(reply_payload, report, report_length) && num_lines == NUM_PROFILING_STAGES + 1,
+        "Status query is answered with the profile");
+  printf("  %-52s: %u bytes\n", "Status", (unsigned) reply_length);
+
+  /**
+   * A restart resets the parameters and recomputes the geometry, such that
+   * the startup is repeatable
+   */
+  PARAMETER_REGISTRY::reset_parameters();
+  TRILATERATION::initialize_trilateration_globals();
+  status = exchange_command(COMMAND_GET, NULL, 0, reply_entries, num_reply_entries);
+  bool_defaults = (status == PARAMETER_OK && num_reply_entries == NUM_PARAMETERS);
+  for(uint32_t i = 0; bool_defaults && i < num_reply_entries; i++){
+    bool_defaults &= (reply_entries[i].value ==
+        PARAMETER_REGISTRY::parameter_info[reply_entries[i].id].default_value.as_uint32);
+  }
+  check(bool_defaults && TRILATERATION::margin_time_epsilon == MARGIN_TIME_EPSILON &&
+        TRILATERATION::hydrophone_geometry.max_lag == default_max_lag,
+        "Restart restores the defaults");
+
+  /**
+   * Cost of a set, with and without recomputing the derived data
+   */
+  const uint32_t num_repetitions = 1000;
+  CommandEntry unchanged = float_entry(PARAMETER_MARGIN_TIME_EPSILON, MARGIN_TIME_EPSILON);
+  const float32_t unchanged_us = measure_command_us(&unchanged, 1, num_repetitions);
+
+  float32_t margin_us = 0;
+  float32_t band_us = 0;
+  for(uint32_t i = 0; i < num_repetitions; i++){
+    CommandEntry changed_margin = float_entry(PARAMETER_MARGIN_TIME_EPSILON, (i % 2) ? 0.2f : 0.3f);
+    margin_us += measure_command_us(&changed_margin, 1, 1);
+    CommandEntry changed_band = float_entry(PARAMETER_FILTER_LOW_FREQUENCY, (i % 2) ? 16000.0f : 14000.0f);
+    band_us += measure_command_us(&changed_band, 1, 1);
+  }
+
+  printf("Cost of a set (without transport):\n");
+  printf("  %-24s: %8.3f us\n", "Unchanged value", (double) unchanged_us);
+  printf("  %-24s: %8.3f us\n", "Margin (geometry)", (double) (margin_us / num_repetitions));
+  printf("  %-24s: %8.3f us\n", "Band (filter)", (double) (band_us / num_repetitions));
+
+  PARAMETER_REGISTRY::reset_parameters();
+  TELEMETRY_TRANSPORT::close_transport();
+  close(command_sender);
+  close(reply_receiver);
+
+  printf("\n%s\n", num_failed ? "FAILED" : "Every check passed");
+  return num_failed ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file
+ *
+ * @brief Host tool that creates a hydrophone configuration-blob, which can
+ * be sent to the MCU with COMMAND_GEOMETRY. The MCU recomputes the geometry,
+ * and stores the configuration in flash on COMMAND_STORE_GEOMETRY. See
+ * geometry_config.h and command.h
+ *
+ * Usage:
+ *      geometry_config_generator <output-file> [x_0 y_0 z_0 x_1 y_1 z_1 ...]
+ *
+ * The positions are given in meters, in the same order as
+ * HYDROPHONE_POSITIONS. If no positions are given, the positions in
+ * parameters.h are used. The derived geometry is written to the terminal,
+ * such that an invalid configuration is detected before it is sent
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "geometry_config.h"
+
+int main(int argc, char** argv){
+
+  if(argc != 2 && argc != 2 + 3 * NUM_HYDROPHONES){
+    printf("Usage: %s <output-file> [x_0 y_0 z_0 ... x_%u y_%u z_%u]\n",
+        argv[0], (unsigned) NUM_HYDROPHONES - 1,
+        (unsigned) NUM_HYDROPHONES - 1, (unsigned) NUM_HYDROPHONES - 1);
+    return 1;
+  }
+
+  /**
+   * Reading the positions
+   */
+  float32_t positions[NUM_HYDROPHONES][3];
+  for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+    for(uint32_t coord = 0; coord < 3; coord++){
+      positions[hyd][coord] = (argc == 2) ? HYDROPHONE_POSITIONS[hyd][coord] :
+          (float32_t) atof(argv[2 + 3 * hyd + coord]);
+    }
+  }
+
+  GeometryConfig config;
+  GEOMETRY_CONFIG::create_config(positions, config);
+
+  /**
+   * Validating the configuration the same way as the MCU
+   */
+  if(!GEOMETRY_CONFIG::apply_config(config)){
+    printf("Invalid configuration. The hydrophones are placed on a line, or "
+        "the lookup-table does not cover the max lag\n");
+    return 1;
+  }
+
+  const HydrophoneGeometry& geometry = TRILATERATION::hydrophone_geometry;
+  for(uint32_t hyd = 0; hyd < NUM_HYDROPHONES; hyd++){
+    printf("Hydrophone %u                : (%.3f, %.3f, %.3f) m\n", (unsigned) hyd,
+        (double) positions[hyd][0], (double) positions[hyd][1], (double) positions[hyd][2]);
+  }
+  printf("Max hydrophone distance     : %.3f m\n", (double) geometry.max_hydrophone_distance);
+  printf("Max lag                     : %d samples\n", (int) geometry.max_lag);
+  printf("CRC                         : 0x%08X\n", (unsigned) config.crc);
+
+  /**
+   * Writing the blob
+   */
+  FILE* file = fopen(argv[1], "wb");
+  if(!file || fwrite(&config, sizeof(GeometryConfig), 1, file) != 1){
+    printf("Could not write to %s\n", argv[1]);
+    if(file){
+      fclose(file);
+    }
+    return 1;
+  }
+  fclose(file);
+
+  printf("Wrote %u bytes to %s\n", (unsigned) sizeof(GeometryConfig), argv[1]);
+  return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file
+ *
+ * @brief Host tool that generates the lag lookup-table for the current
+ * configuration in parameters.h, and reports its memory footprint and
+ * resolution. Used to decide whether USE_LAG_LOOKUP_TABLE is worth the RAM
+ *
+ * The resolution is calculated from the generated table, as the step in
+ * position and bearing between entries one lag apart. The entries are
+ * stored in cm and 0.01 deg, but the steps are set by the lag-quantization
+ * and grow with the range, up to a flip of the bearing where the
+ * lags are ambiguous
+ *
+ * The table holds one entry for every (lag_port_starboard, lag_port_stern)
+ * within +- LAG_LOOKUP_MAX_LAG. The number of entries grows with the square
+ * of the sample frequency and the hydrophone distance, while the bearing
+ * resolution only improves linearly. Entries violating closure (the implied
+ * lag_starboard_stern exceeds max_lag) are stored, but marked invalid
+ */
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "lag_lookup.h"
+
+/**
+ * @brief Calculates the difference in bearing between two entries,
+ * wrapped to [0, 180] deg
+ */
+static float32_t bearing_step(
+        const LagLookupEntry& lhs,
+        const LagLookupEntry& rhs){
+
+  float32_t step = 0.01f * std::abs(lhs.bearing - rhs.bearing);
+  return (step > 180.0f) ? 360.0f - step : step;
+}
+
+/**
+ * @brief Calculates the distance between the positions of two entries [m]
+ */
+static float32_t position_step(
+        const LagLookupEntry& lhs,
+        const LagLookupEntry& rhs){
+
+  return 0.01f * std::hypot((float32_t) (lhs.x_estimate - rhs.x_estimate),
+                            (float32_t) (lhs.y_estimate - rhs.y_estimate));
+}
+
+/**
+ * @brief Writes the mean, the 95th percentile and the maximum of @p steps
+ */
+static void print_steps(
+        const char* name,
+        std::vector<float32_t>& steps,
+        const char* unit){
+
+  if(steps.empty()){
+    printf("  %-25s : no neighbouring valid entries\n", name);
+    return;
+  }
+  std::sort(steps.begin(), steps.end());
+  double sum = 0;
+  for(float32_t step : steps){
+    sum += step;
+  }
+  printf("  %-25s : %.2f / %.2f / %.2f %s\n", name, sum / steps.size(),
+      (double) steps[(size_t) (0.95 * (steps.size() - 1))], (double) steps.back(), unit);
+}
+
+int main(void){
+
+  /**
+   * Generating the table for the configuration in parameters.h
+   */
+  if(!TRILATERATION::initialize_trilateration_globals()){
+    printf("Invalid hydrophone geometry in parameters.h\n");
+    return 1;
+  }
+
+  const HydrophoneGeometry& geometry = TRILATERATION::hydrophone_geometry;
+  const int32_t max_lag = LAG_LOOKUP_MAX_LAG;
+  const int32_t dimension = LAG_LOOKUP_DIMENSION;
+
+  std::vector<LagLookupEntry> table(LAG_LOOKUP_TABLE_SIZE);
+  uint32_t num_valid = LAG_LOOKUP::generate_lag_lookup_table(table.data(), max_lag);
+  if(!num_valid){
+    printf("LAG_LOOKUP_MAX_LAG = %d is smaller than the geometry's max_lag = %d\n",
+        (int) max_lag, (int) geometry.max_lag);
+    return 1;
+  }
+
+  /**
+   * Calculating the resolution as the step in position and in bearing
+   * between neighbouring valid entries, i.e. the change in the estimate
+   * when a single lag changes by one sample
+   */
+  std::vector<float32_t> position_steps, bearing_steps;
+  for(int32_t i = 0; i < dimension; i++){
+    for(int32_t j = 0; j < dimension; j++){
+      const LagLookupEntry& entry = table[i * dimension + j];
+      if(!entry.bool_valid){
+        continue;
+      }
+      const LagLookupEntry* neighbours[2] = {
+        (i + 1 < dimension) ? &table[(i + 1) * dimension + j] : NULL,
+        (j + 1 < dimension) ? &table[i * dimension + j + 1] : NULL };
+      for(const LagLookupEntry* neighbour : neighbours){
+        if(!neighbour || !neighbour->bool_valid){
+          continue;
+        }
+        position_steps.push_back(position_step(entry, *neighbour));
+        bearing_steps.push_back(bearing_step(entry, *neighbour));
+      }
+    }
+  }
+
+  /**
+   * Reporting the current configuration
+   */
+  printf("Lag lookup-table\n");
+  printf("  Sample frequency          : %.1f Hz\n", (double) SAMPLE_FREQUENCY);
+  printf("  Max hydrophone distance   : %.3f m\n", (double) geometry.max_hydrophone_distance);
+  printf("  Geometry max_lag          : %d samples\n", (int) geometry.max_lag);
+  printf("  LAG_LOOKUP_MAX_LAG        : %d samples\n", (int) max_lag);
+  printf("  Dimension                 : %d x %d\n", (int) dimension, (int) dimension);
+  printf("  Entries                   : %u\n", (unsigned) LAG_LOOKUP_TABLE_SIZE);
+  printf("  Valid entries             : %u (%.1f %%)\n", (unsigned) num_valid,
+      100.0 * num_valid / LAG_LOOKUP_TABLE_SIZE);
+  printf("  Bytes per entry           : %u\n", (unsigned) sizeof(LagLookupEntry));
+  printf("  Memory footprint          : %u bytes (%.1f kB)\n",
+      (unsigned) (LAG_LOOKUP_TABLE_SIZE * sizeof(LagLookupEntry)),
+      LAG_LOOKUP_TABLE_SIZE * sizeof(LagLookupEntry) / 1024.0);
+  printf("  Storage quantization      : 1 cm, 0.01 deg (int16_t, saturates at +-327 m)\n");
+  printf("\nResolution, as the step between neighbouring valid entries (mean / p95 / max)\n");
+  print_steps("Position step", position_steps, "m");
+  print_steps("Bearing step", bearing_steps, "deg");
+
+  /**
+   * Reporting the trade-off between sample frequency and table size. The
+   * table size grows quadratically, while the lag resolution grows linearly
+   */
+  printf("\nTrade-off for other sample frequencies (same geometry)\n");
+  printf("  %14s %10s %12s %14s\n", "Frequency [Hz]", "max_lag", "Entries", "Footprint [kB]");
+  const float32_t frequency_scales[] = { 0.5f, 1.0f, 2.0f, 4.0f };
+  for(float32_t scale : frequency_scales){
+    float32_t frequency = scale * SAMPLE_FREQUENCY;
+    int32_t scaled_max_lag = (int32_t) std::floor(geometry.max_time_diff * frequency);
+    uint32_t entries = (uint32_t) ((2 * scaled_max_lag + 1) * (2 * scaled_max_lag + 1));
+    printf("  %14.1f %10d %12u %14.1f\n", (double) frequency, (int) scaled_max_lag,
+        (unsigned) entries, entries * sizeof(LagLookupEntry) / 1024.0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,543 @@
+/**
+ * @file
+ *
+ * @brief Host tool that times every kernel in the hot path separately, for
+ * three, four and five hydrophones, and writes the results as JSON
+ *
+ * Usage:
+ *      microbenchmark [output-file] [min_time_s] [baseline-file] [tolerance]
+ *
+ * Every kernel is called repeatedly on a frame rendered by the simulator,
+ * until at least min_time_s (default 0.1 s) is spent. The time is split
+ * into NUM_ROUNDS rounds over every kernel, and the best round of each
+ * kernel is kept, such that a short disturbance from the rest of the
+ * workstation only affects a single round. The median and the
+ * minimum time per call are reported, together with ns/sample, samples/s
+ * and the number of heap-allocations per call, counted by ALLOCATION_GUARD.
+ * The solvers do not process any samples, and only report the time per call
+ *
+ * The results are written as JSON, or as CSV if output-file ends with
+ * ".csv". The CSV is the format of the baseline
+ *
+ * If a baseline-file is given, every result is compared against the
+ * baseline of the same kernel, number of hydrophones and buffer-length. The
+ * tool fails if a kernel is more than tolerance (default 0.25) slower than
+ * its baseline, or allocates more often. The input is rendered with a fixed
+ * seed, such that every run processes the same data
+ *
+ * The buffer-length is IN_BUFFER_LENGTH, which is fixed at compile-time.
+ * "make benchmark" builds the tool once for each of BENCHMARK_BUFFER_LENGTHS
+ * and collects the results in build_host/benchmark.json. "make
+ * benchmark_check" compares every buffer-length against
+ * Tools/benchmark_baseline.csv, and "make benchmark_baseline" rewrites it
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "allocation_guard.h"
+#include "analyze_data.h"
+#include "event_log.h"
+#include "sample_coding.h"
+#include "trace.h"
+#include "simulation.h"
+
+
+/**
+ * @brief Result of benchmarking one kernel
+ */
+typedef struct{
+  const char* kernel;
+  uint32_t num_hydrophones;
+  uint32_t iterations;
+  uint32_t samples_per_call;
+  float32_t median_ns;
+  float32_t min_ns;
+  float32_t allocations_per_call;
+}BenchmarkResult; /* struct BenchmarkResult */
+
+static std::vector<BenchmarkResult> results;
+
+/* Name of the kernel used to scale the baseline to the workstation */
+static const char* const CALIBRATION_KERNEL = "calibration";
+static float32_t min_time_s = 0.1f;
+
+/* Rounds over every kernel, and the calls per kernel in each round */
+static const uint32_t NUM_ROUNDS = 3;
+static const uint32_t MIN_ITERATIONS = 10;
+
+/* Prevents the compiler from removing the calls being timed */
+static volatile float32_t sink;
+
+
+/**
+ * @brief Times @p kernel for one round, and adds the result to results.
+ * If the kernel is already in results, the best median and minimum of the
+ * rounds are kept, and the allocations of the worst round
+ *
+ * @param num_hydrophones Number of hydrophones. 0 if not relevant
+ *
+ * @param samples_per_call Number of samples processed per call. 0 if the
+ * kernel does not process samples
+ */
+template<typename Kernel>
+static void run_benchmark(
+        const char* name,
+        const uint32_t& num_hydrophones,
+        const uint32_t& samples_per_call,
+        Kernel kernel){
+
+  /* Warming the caches and the branch-predictor */
+  for(uint32_t i = 0; i < 3; i++){
+    kernel();
+  }
+
+  std::vector<uint32_t> ticks;
+  ticks.reserve(1u << 16);
+  uint64_t total_ticks = 0;
+  uint64_t start_allocations = ALLOCATION_GUARD::get_num_allocations();
+
+  while((total_ticks < (uint64_t) (min_time_s / NUM_ROUNDS * 1e9f) ||
+         ticks.size() < MIN_ITERATIONS) && ticks.size() < ticks.capacity()){
+    uint32_t start_ticks = TIMING::get_ticks();
+    kernel();
+    uint32_t duration = TIMING::get_ticks() - start_ticks;
+    ticks.push_back(duration);
+    total_ticks += duration;
+  }
+
+  uint64_t allocations = ALLOCATION_GUARD::get_num_allocations() - start_allocations;
+  std::sort(ticks.begin(), ticks.end());
+
+  BenchmarkResult round;
+  round.kernel = name;
+  round.num_hydrophones = num_hydrophones;
+  round.iterations = ticks.size();
+  round.samples_per_call = samples_per_call;
+  round.median_ns = 1000.0f * TIMING::ticks_to_us(ticks[ticks.size() / 2]);
+  round.min_ns = 1000.0f * TIMING::ticks_to_us(ticks[0]);
+  round.allocations_per_call = (float32_t) allocations / ticks.size();
+
+  for(BenchmarkResult& result : results){
+    if(!strcmp(result.kernel, name) && result.num_hydrophones == num_hydrophones){
+      result.iterations += round.iterations;
+      result.median_ns = std::min(result.median_ns, round.median_ns);
+      result.min_ns = std::min(result.min_ns, round.min_ns);
+      result.allocations_per_call = std::max(result.allocations_per_call,
+          round.allocations_per_call);
+      return;
+    }
+  }
+  results.push_back(round);
+}
+
+
+/**
+ * @brief Writes the results of every kernel to the terminal
+ */
+static void print_results(){
+  for(const BenchmarkResult& result : results){
+    printf("%-28s N=%u  %12.1f ns/call", result.kernel, (unsigned) result.num_hydrophones,
+        (double) result.median_ns);
+    if(result.samples_per_call){
+      printf("  %7.3f ns/sample  %8.2f Msamples/s",
+          (double) (result.median_ns / result.samples_per_call),
+          (double) (1e3f * result.samples_per_call / result.median_ns));
+    }
+    printf("  %.2f alloc/call\n", (double) result.allocations_per_call);
+  }
+}
+
+
+/**
+ * @brief Places @p N hydrophones on a circle with radius 0.2 m. With four
+ * or more hydrophones every other hydrophone is raised, such that the
+ * array is not planar
+ */
+template<uint32_t N>
+static void create_positions(float32_t (&positions)[N][3]){
+  for(uint32_t hyd = 0; hyd < N; hyd++){
+    float32_t angle = 2.0f * (float32_t) M_PI * hyd / N;
+    positions[hyd][0] = 0.2f * std::sin(angle);
+    positions[hyd][1] = 0.2f * std::cos(angle);
+    positions[hyd][2] = (N > 3 && hyd % 2) ? 0.1f : 0.0f;
+  }
+}
+
+
+/**
+ * @brief Benchmarks every kernel depending on the number of hydrophones
+ */
+template<uint32_t N>
+static void benchmark_kernels(){
+  constexpr uint32_t num_pairs = HydrophonePairs<N>::count;
+
+  float32_t positions[N][3];
+  create_positions<N>(positions);
+
+  HydrophoneArrayGeometry<N> geometry = {};
+  if(!TRILATERATION::initialize_hydrophone_geometry(geometry, positions)){
+    printf("Invalid benchmark geometry for N=%u\n", (unsigned) N);
+    return;
+  }
+
+  /**
+   * Rendering a frame
+   */
+  SimulationConfig config;
+  SIMULATION::get_default_config(config);
+  config.source_position[0] = 6.0f;
+  config.source_position[1] = 8.0f;
+  config.source_position[2] = (N > 3) ? -2.0f : 0.0f;
+
+  std::vector<uint16_t> adc_data(N * DMA_BUFFER_LENGTH);
+  SIMULATION::render_adc_data<N>(config, positions, adc_data.data());
+
+  std::vector<float32_t> raw_data(N * IN_BUFFER_LENGTH);
+  std::vector<float32_t> filtered_data(N * IN_BUFFER_LENGTH);
+  float32_t* raw_data_array[N];
+  float32_t* filtered_data_array[N];
+  for(uint32_t hyd = 0; hyd < N; hyd++){
+    raw_data_array[hyd] = &raw_data[hyd * IN_BUFFER_LENGTH];
+    filtered_data_array[hyd] = &filtered_data[hyd * IN_BUFFER_LENGTH];
+  }
+
+  /* Workspace sized for N hydrophones, as frame_workspace is sized for NUM_HYDROPHONES */
+  alignas(WORKSPACE_ALIGNMENT) static uint8_t workspace_memory[
+      workspace_frame_size(N, IN_BUFFER_LENGTH)];
+  Workspace workspace;
+  WORKSPACE::initialize_workspace(workspace, workspace_memory, sizeof(workspace_memory));
+
+  uint32_t lag_array[num_pairs];
+  uint32_t* p_lag_array[num_pairs];
+  for(uint32_t pair = 0; pair < num_pairs; pair++){
+    p_lag_array[pair] = &lag_array[pair];
+  }
+
+  /* The exact lags, such that the solvers are given a valid system */
+  float32_t expected_lags[num_pairs];
+  int32_t int_lag_array[num_pairs];
+  SIMULATION::calculate_expected_lags<N>(config, positions, expected_lags);
+  for(uint32_t pair = 0; pair < num_pairs; pair++){
+    int_lag_array[pair] = (int32_t) std::round(expected_lags[pair]);
+  }
+
+  /**
+   * The signal-processing
+   */
+  run_benchmark("convert_adc_data", N, N * DMA_BUFFER_LENGTH, [&](){
+    ANALYZE_DATA::convert_adc_data<N>(adc_data.data(), raw_data_array);
+    sink = raw_data_array[N - 1][IN_BUFFER_LENGTH - 1];
+  });
+
+  run_benchmark("filter_raw_data", N, N * IN_BUFFER_LENGTH, [&](){
+    ANALYZE_DATA::filter_raw_data<N>(raw_data_array, filtered_data_array);
+    sink = filtered_data_array[N - 1][IN_BUFFER_LENGTH - 1];
+  });
+
+  run_benchmark("calculate_xcorr_lag_array", N, N * IN_BUFFER_LENGTH, [&](){
+    ANALYZE_DATA::calculate_xcorr_lag_array<N>(filtered_data_array, p_lag_array,
+        geometry.max_lag, workspace);
+    sink = (float32_t) lag_array[0];
+  });
+
+  /**
+   * The encodings of the raw frames, used by the recordings and the stream
+   */
+  std::vector<uint8_t> encoded(SAMPLE_CODING::get_max_encoded_size(
+      SAMPLE_ENCODING_RICE, N * DMA_BUFFER_LENGTH));
+  std::vector<uint16_t> decoded(N * DMA_BUFFER_LENGTH);
+
+  run_benchmark("pack_samples", N, N * DMA_BUFFER_LENGTH, [&](){
+    SAMPLE_CODING::pack_samples(adc_data.data(), N * DMA_BUFFER_LENGTH, encoded.data());
+    sink = encoded[0];
+  });
+
+  run_benchmark("unpack_samples", N, N * DMA_BUFFER_LENGTH, [&](){
+    SAMPLE_CODING::unpack_samples(encoded.data(), N * DMA_BUFFER_LENGTH, decoded.data());
+    sink = decoded[N * DMA_BUFFER_LENGTH - 1];
+  });
+
+  uint32_t encoded_length = 0;
+  run_benchmark("encode_rice", N, N * DMA_BUFFER_LENGTH, [&](){
+    encoded_length = SAMPLE_CODING::encode_rice(adc_data.data(), N * DMA_BUFFER_LENGTH, N,
+        encoded.data());
+    sink = encoded[0];
+  });
+
+  run_benchmark("decode_rice", N, N * DMA_BUFFER_LENGTH, [&](){
+    SAMPLE_CODING::decode_rice(encoded.data(), encoded_length, N * DMA_BUFFER_LENGTH, N,
+        decoded.data());
+    sink = decoded[N * DMA_BUFFER_LENGTH - 1];
+  });
+
+  /**
+   * The solvers
+   */
+  run_benchmark("trilaterate_position", N, 0, [&](){
+    float32_t position[3];
+    TRILATERATION::trilaterate_position<N>(geometry, int_lag_array, position);
+    sink = position[0];
+  });
+
+  run_benchmark("refine_position", N, 0, [&](){
+    float32_t position[3] = { config.source_position[0], config.source_position[1],
+        config.source_position[2] };
+    uint32_t num_iterations;
+    TRILATERATION::refine_position<N>(geometry, int_lag_array, position, num_iterations);
+    sink = position[0];
+  });
+
+  run_benchmark("estimate_direction", N, 0, [&](){
+    float32_t bearing, elevation;
+    TRILATERATION::estimate_direction<N>(geometry, int_lag_array, bearing, elevation);
+    sink = bearing;
+  });
+}
+
+
+/**
+ * @brief Benchmarks the calibration-kernel, and every kernel independent of
+ * the number of hydrophones
+ */
+static void benchmark_common(){
+
+  /**
+   * Fixed chain of dependent multiply-adds, independent of the code. Used to
+   * scale the baseline to the speed of the workstation when comparing
+   */
+  run_benchmark(CALIBRATION_KERNEL, 0, 0, [&](){
+    float32_t value = sink;
+    for(uint32_t i = 0; i < 4096; i++){
+      value = value * 0.999f + 1e-3f;
+    }
+    sink = value;
+  });
+
+  /* Kernels independent of the number of hydrophones */
+  std::vector<float32_t> cross_corr(2 * IN_BUFFER_LENGTH - 1);
+  for(uint32_t i = 0; i < cross_corr.size(); i++){
+    cross_corr[i] = std::sin(0.1f * i) * (float32_t) i;
+  }
+  run_benchmark("array_max_value", 0, cross_corr.size(), [&](){
+    uint32_t idx;
+    float32_t max_val;
+    ANALYZE_DATA::array_max_value(cross_corr.data(), cross_corr.size(), idx, max_val);
+    sink = max_val;
+  });
+
+  /* Logging a full ring of events. Every event is counted as a sample */
+  run_benchmark("log_event", 0, EVENT_LOG_LENGTH, [&](){
+    for(uint32_t i = 0; i < EVENT_LOG_LENGTH; i++){
+      EVENT_LOG::log_event(ERROR_TYPES::ERROR_TIME_SIGNAL, i);
+    }
+    sink = EVENT_LOG::get_num_events();
+  });
+
+  TRACE::initialize_trace();
+  run_benchmark("trace_event", 0, TRACE_LENGTH, [&](){
+    for(uint32_t i = 0; i < TRACE_LENGTH; i++){
+      TRACE::trace_event(TRACE_EVENTS::TRACE_MARKER, i);
+    }
+    sink = TRACE::trace_buffer.header.num_events;
+  });
+}
+
+
+/**
+ * @brief Writes the results as JSON
+ */
+static uint8_t write_json(const char* path){
+  FILE* file = fopen(path, "w");
+  if(!file){
+    return 0;
+  }
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"buffer_length\": %u,\n", (unsigned) IN_BUFFER_LENGTH);
+  fprintf(file, "  \"sample_frequency\": %.1f,\n", (double) SAMPLE_FREQUENCY);
+  fprintf(file, "  \"results\": [\n");
+  for(uint32_t i = 0; i < results.size(); i++){
+    const BenchmarkResult& result = results[i];
+    fprintf(file, "    {\"kernel\": \"%s\", \"num_hydrophones\": %u, \"buffer_length\": %u, "
+        "\"iterations\": %u, \"samples_per_call\": %u, \"ns_per_call\": %.1f, "
+        "\"min_ns_per_call\": %.1f, ",
+        result.kernel, (unsigned) result.num_hydrophones, (unsigned) IN_BUFFER_LENGTH,
+        (unsigned) result.iterations, (unsigned) result.samples_per_call,
+        (double) result.median_ns, (double) result.min_ns);
+    if(result.samples_per_call){
+      fprintf(file, "\"ns_per_sample\": %.4f, \"samples_per_s\": %.0f, ",
+          (double) (result.median_ns / result.samples_per_call),
+          1e9 * result.samples_per_call / (double) result.median_ns);
+    }
+    else{
+      fprintf(file, "\"ns_per_sample\": null, \"samples_per_s\": null, ");
+    }
+    fprintf(file, "\"allocations_per_call\": %.2f}%s\n",
+        (double) result.allocations_per_call, (i + 1 < results.size()) ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  return fclose(file) == 0;
+}
+
+
+/**
+ * @brief Writes the results as CSV, in the format of the baseline
+ */
+static uint8_t write_csv(const char* path){
+  FILE* file = fopen(path, "w");
+  if(!file){
+    return 0;
+  }
+
+  fprintf(file, "kernel,num_hydrophones,buffer_length,min_ns_per_call,allocations_per_call\n");
+  for(const BenchmarkResult& result : results){
+    fprintf(file, "%s,%u,%u,%.1f,%.2f\n", result.kernel, (unsigned) result.num_hydrophones,
+        (unsigned) IN_BUFFER_LENGTH, (double) result.min_ns,
+        (double) result.allocations_per_call);
+  }
+
+  return fclose(file) == 0;
+}
+
+
+/**
+ * @brief Finds the baseline of @p kernel with @p num_hydrophones, at the 
+ * current buffer-length
+ *
+ * @retval Returns 0 if the baseline has no such kernel
+ */
+static uint8_t find_baseline(
+        FILE* file,
+        const char* kernel,
+        const uint32_t& num_hydrophones,
+        float32_t& baseline_ns,
+        float32_t& baseline_allocations){
+
+  char line[256], line_kernel[64];
+  unsigned line_num_hydrophones, line_buffer_length;
+
+  rewind(file);
+  while(fgets(line, sizeof(line), file)){
+    if(sscanf(line, "%63[^,],%u,%u,%f,%f", line_kernel, &line_num_hydrophones,
+          &line_buffer_length, &baseline_ns, &baseline_allocations) == 5 &&
+       !strcmp(line_kernel, kernel) && line_num_hydrophones == num_hydrophones &&
+       line_buffer_length == IN_BUFFER_LENGTH){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+/**
+ * @brief Compares the results against the baseline in @p path, and prints
+ * the difference of every kernel
+ *
+ * The minimum time per call is compared, as it is the least affected by
+ * the rest of the workstation. Both are divided by the time of the
+ * calibration-kernel in the same run, such that a baseline from another
+ * workstation, or another clock-frequency, is scaled accordingly
+ *
+ * @retval Returns the number of kernels more than @p tolerance slower than
+ * the baseline, or allocating more often. Kernels without a baseline are
+ * reported, but not counted
+ */
+static uint32_t check_baseline(
+        const char* path,
+        const float32_t& tolerance){
+
+  FILE* file = fopen(path, "r");
+  if(!file){
+    printf("Could not open the baseline %s\n", path);
+    return 1;
+  }
+
+  /* Scaling the baseline to this run */
+  float32_t scale = 1.0f, calibration_ns, calibration_allocations;
+  for(const BenchmarkResult& result : results){
+    if(!strcmp(result.kernel, CALIBRATION_KERNEL) &&
+       find_baseline(file, CALIBRATION_KERNEL, 0, calibration_ns, calibration_allocations)){
+      scale = result.min_ns / calibration_ns;
+    }
+  }
+
+  printf("\nComparing against %s (tolerance %.0f%%, baseline scaled by %.2f)\n", path,
+      (double) (100.0f * tolerance), (double) scale);
+  printf("%-28s %2s %6s %14s %14s %8s %13s  %s\n", "kernel", "N", "length",
+      "baseline [ns]", "current [ns]", "change", "alloc/call", "status");
+
+  uint32_t num_regressions = 0;
+  for(const BenchmarkResult& result : results){
+    if(!strcmp(result.kernel, CALIBRATION_KERNEL)){
+      continue;
+    }
+
+    float32_t baseline_ns, baseline_allocations;
+    if(!find_baseline(file, result.kernel, result.num_hydrophones, baseline_ns,
+          baseline_allocations)){
+      printf("%-28s %2u %6u %14s %14.1f %8s %13.2f  new, no baseline\n", result.kernel,
+          (unsigned) result.num_hydrophones, (unsigned) IN_BUFFER_LENGTH, "-",
+          (double) result.min_ns, "-", (double) result.allocations_per_call);
+      continue;
+    }
+    baseline_ns *= scale;
+
+    const float32_t change = result.min_ns / baseline_ns - 1.0f;
+    const uint8_t bool_slower = change > tolerance;
+    const uint8_t bool_allocating = result.allocations_per_call > baseline_allocations + 0.005f;
+    num_regressions += bool_slower || bool_allocating;
+
+    printf("%-28s %2u %6u %14.1f %14.1f %+7.1f%% %6.2f (%4.2f)  %s%s%s\n", result.kernel,
+        (unsigned) result.num_hydrophones, (unsigned) IN_BUFFER_LENGTH,
+        (double) baseline_ns, (double) result.min_ns, (double) (100.0f * change),
+        (double) result.allocations_per_call, (double) baseline_allocations,
+        (bool_slower || bool_allocating) ? "FAILED:" : "ok",
+        bool_slower ? " slower" : "", bool_allocating ? " allocates" : "");
+  }
+  fclose(file);
+
+  if(num_regressions){
+    printf("%u kernel(s) regressed compared to %s\n", (unsigned) num_regressions, path);
+  }
+  return num_regressions;
+}
+
+
+int main(int argc, char** argv){
+
+  if(argc > 2){
+    min_time_s = (float32_t) atof(argv[2]);
+  }
+
+  printf("Buffer length               : %u samples per hydrophone\n",
+      (unsigned) IN_BUFFER_LENGTH);
+
+  for(uint32_t round = 0; round < NUM_ROUNDS; round++){
+    benchmark_common();
+    benchmark_kernels<3>();
+    benchmark_kernels<4>();
+    benchmark_kernels<5>();
+  }
+  print_results();
+
+  if(argc > 1){
+    const size_t length = strlen(argv[1]);
+    const uint8_t bool_csv = length > 4 && !strcmp(argv[1] + length - 4, ".csv");
+    if(!(bool_csv ? write_csv(argv[1]) : write_json(argv[1]))){
+      printf("Could not write to %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  if(argc > 3){
+    const float32_t tolerance = (argc > 4) ? (float32_t) atof(argv[4]) : 0.25f;
+    if(check_baseline(argv[3], tolerance)){
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,393 @@
+/**
+ * @file
+ *
+ * @brief Host tool that estimates the accuracy and the cost of the
+ * configuration in parameters.h, with Monte Carlo simulation of pings on
+ * every core. Used to choose the cheapest configuration that meets
+ * MARGIN_POS_ESTIMATE
+ *
+ * Usage:
+ *      monte_carlo_sweep [output-file] [pings_per_scenario] [num_threads]
+ *
+ * Every scenario is a combination of the noise and the surface-reflection.
+ * The pinger is placed at a random position between 2 and 30 m from the
+ * array in every ping. The ping is rendered by the simulator, and processed
+ * as in main.cpp. For every scenario the percentiles of the position- and
+ * bearing-error are reported, next to the CPU-time spent processing each
+ * ping and the RAM used by the frame-buffers. Pings without an estimate
+ * count as an infinite error
+ *
+ * The configuration meets the margin if the SWEEP_PERCENTILE-percentile of
+ * the position-error is within MARGIN_POS_ESTIMATE in every scenario
+ *
+ * The buffer-length and the sample-frequency are fixed at compile-time.
+ * "make sweep" builds the tool for every combination of SWEEP_BUFFER_LENGTHS
+ * and SWEEP_SAMPLE_FREQUENCIES, and collects the results in
+ * build_host/sweep.json. Every ping is seeded from its index, such that the
+ * results do not depend on the number of threads
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "analyze_data.h"
+#include "simulation.h"
+
+/* Percentile of the position-error required to be within MARGIN_POS_ESTIMATE */
+constexpr float32_t SWEEP_PERCENTILE = 90.0f;
+
+/* The scenarios. Every noise is combined with every surface-reflection */
+constexpr float32_t SWEEP_NOISE_STD[] = { 5.0f, 20.0f, 80.0f };
+constexpr float32_t SWEEP_SURFACE_REFLECTION[] = { 0.0f, 0.6f };
+
+
+/**
+ * @brief Result of one simulated ping. The errors are infinite if no
+ * estimate was given
+ */
+typedef struct{
+  float32_t position_error;
+  float32_t bearing_error;
+  float32_t cpu_us;
+}PingResult; /* struct PingResult */
+
+
+/**
+ * @brief Summary of one scenario
+ */
+typedef struct{
+  float32_t noise_std;
+  float32_t surface_reflection;
+  float32_t snr_db;
+  float32_t valid_fraction;
+  float32_t within_margin_fraction;
+  float32_t position_error[3];
+  float32_t bearing_error[3];
+  float32_t cpu_us[2];
+}ScenarioSummary; /* struct ScenarioSummary */
+
+/* Percentiles reported for the errors */
+constexpr float32_t ERROR_PERCENTILES[] = { 50.0f, SWEEP_PERCENTILE, 99.0f };
+
+
+/**
+ * @brief CPU-time used by the calling thread [us]. Not affected by the
+ * other threads
+ */
+static float32_t get_thread_cpu_us(){
+  struct timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec * 1e6f + time.tv_nsec * 1e-3f;
+}
+
+
+/**
+ * @brief Percentile @p percentile of @p values. Sorts @p values
+ */
+static float32_t get_percentile(
+      std::vector<float32_t>& values,
+      const float32_t& percentile){
+  std::sort(values.begin(), values.end());
+  uint32_t idx = (uint32_t) std::ceil(percentile / 100.0f * values.size());
+  return values[std::min(std::max(idx, 1u), (uint32_t) values.size()) - 1];
+}
+
+
+/**
+ * @brief Renders and processes ping @p ping of a scenario, with the memory
+ * given by the worker
+ */
+static void simulate_ping(
+      const SimulationConfig& scenario,
+      const uint32_t& seed,
+      uint16_t* p_adc_data,
+      Workspace& workspace,
+      Matrix_A_f& A_matrix,
+      Vector_B_f& B_vector,
+      PingResult& result){
+
+  /* Random position around the array, given by the seed */
+  SimulationConfig config = scenario;
+  uint32_t random_state = seed * 2654435761u + 1u;
+  random_state = random_state * 1664525u + 1013904223u;
+  float32_t angle = (random_state >> 8) * (2.0f * (float32_t) M_PI / 16777216.0f);
+  random_state = random_state * 1664525u + 1013904223u;
+  float32_t range = 2.0f + (random_state >> 8) * (28.0f / 16777216.0f);
+
+  config.source_position[0] = HYDROPHONE_POSITIONS[0][0] + range * std::sin(angle);
+  config.source_position[1] = HYDROPHONE_POSITIONS[0][1] + range * std::cos(angle);
+  config.source_position[2] = HYDROPHONE_POSITIONS[0][2];
+  config.seed = seed;
+  SIMULATION::render_ping(config, p_adc_data);
+
+  /* The processing, as in main.cpp */
+  const float32_t start_us = get_thread_cpu_us();
+
+  WorkspaceScope frame_scope(workspace);
+  float32_t* data_array[NUM_HYDROPHONES];
+  WORKSPACE::allocate_arrays(workspace, data_array, IN_BUFFER_LENGTH);
+
+  uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    p_lag_array[pair] = &lag_array[pair];
+  });
+
+  ANALYZE_DATA::convert_adc_data(p_adc_data, data_array);
+  ANALYZE_DATA::filter_raw_data(data_array);
+  ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array,
+      TRILATERATION::hydrophone_geometry.max_lag, workspace);
+
+  uint8_t bool_time_error = 0;
+  uint8_t bool_valid = TRILATERATION::check_valid_signals(p_lag_array, bool_time_error);
+
+  float32_t x_es = 0, y_es = 0, z_es = 0, bearing_es = 0, elevation_es = 0;
+  uint8_t bool_bearing = bool_valid && TRILATERATION::estimate_pinger_bearing(
+      p_lag_array, bearing_es, elevation_es);
+  bool_valid = bool_valid && TRILATERATION::trilaterate_pinger_position(
+      A_matrix, B_vector, p_lag_array, x_es, y_es, z_es);
+
+  /* refine_position() is used, as refine_pinger_position() adds to shared statistics */
+  #if USE_NONLINEAR_SOLVER
+  if(bool_valid){
+    int32_t int_lag_array[NUM_HYDROPHONE_PAIRS];
+    unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+      int_lag_array[pair] = (int32_t) lag_array[pair];
+    });
+    float32_t position[3] = { x_es, y_es,
+        (HydrophoneGeometry::dimension == 3) ? z_es : NONLINEAR_ASSUMED_Z };
+    uint32_t num_iterations;
+    bool_valid = TRILATERATION::refine_position(TRILATERATION::hydrophone_geometry,
+        int_lag_array, position, num_iterations);
+    x_es = position[0];
+    y_es = position[1];
+  }
+  #endif /* USE_NONLINEAR_SOLVER */
+
+  result.cpu_us = get_thread_cpu_us() - start_us;
+
+  /* Comparing against the truth */
+  const float32_t infinity = std::numeric_limits<float32_t>::infinity();
+  result.position_error = infinity;
+  result.bearing_error = infinity;
+  if(bool_valid){
+    float32_t dx = x_es - config.source_position[0];
+    float32_t dy = y_es - config.source_position[1];
+    result.position_error = std::sqrt(dx * dx + dy * dy);
+  }
+  if(bool_bearing){
+    float32_t true_bearing = (float32_t) (std::atan2(
+        config.source_position[0] - HYDROPHONE_POSITIONS[0][0],
+        config.source_position[1] - HYDROPHONE_POSITIONS[0][1]) * 180.0 / M_PI);
+    result.bearing_error = std::abs(std::remainder(bearing_es - true_bearing, 360.0f));
+  }
+}
+
+
+/**
+ * @brief Simulates @p num_pings pings of @p scenario on @p num_threads
+ * workers, and summarizes the results
+ */
+static void run_scenario(
+      const SimulationConfig& scenario,
+      const uint32_t& scenario_idx,
+      const uint32_t& num_pings,
+      const uint32_t& num_threads,
+      ScenarioSummary& summary){
+
+  std::vector<PingResult> results(num_pings);
+  std::atomic<uint32_t> next_ping(0);
+
+  auto run_worker = [&](){
+    /* The pipeline-state of the worker */
+    std::vector<uint16_t> adc_data(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+    std::vector<uint8_t> workspace_memory(WORKSPACE_SIZE + WORKSPACE_ALIGNMENT);
+    uint8_t* p_memory = workspace_memory.data() + (WORKSPACE_ALIGNMENT -
+        (uintptr_t) workspace_memory.data() % WORKSPACE_ALIGNMENT) % WORKSPACE_ALIGNMENT;
+    Workspace workspace;
+    WORKSPACE::initialize_workspace(workspace, p_memory, WORKSPACE_SIZE);
+
+    Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+    Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
+
+    for(uint32_t ping = next_ping++; ping < num_pings; ping = next_ping++){
+      simulate_ping(scenario, scenario_idx * num_pings + ping + 1u, adc_data.data(),
+          workspace, A_matrix, B_vector, results[ping]);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(uint32_t worker = 1; worker < num_threads; worker++){
+    threads.emplace_back(run_worker);
+  }
+  run_worker();
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+
+  /**
+   * Summarizing
+   */
+  std::vector<float32_t> position_errors, bearing_errors, cpu_us;
+  uint32_t num_valid = 0, num_within_margin = 0;
+  for(const PingResult& result : results){
+    position_errors.push_back(result.position_error);
+    bearing_errors.push_back(result.bearing_error);
+    cpu_us.push_back(result.cpu_us);
+    num_valid += std::isfinite(result.position_error);
+    num_within_margin += (result.position_error <= MARGIN_POS_ESTIMATE);
+  }
+
+  summary.noise_std = scenario.noise_std;
+  summary.surface_reflection = scenario.surface_reflection;
+  summary.snr_db = 10.0f * std::log10(0.5f * scenario.amplitude * scenario.amplitude /
+      std::max(scenario.noise_std * scenario.noise_std, 1e-6f));
+  summary.valid_fraction = (float32_t) num_valid / num_pings;
+  summary.within_margin_fraction = (float32_t) num_within_margin / num_pings;
+  for(uint32_t i = 0; i < 3; i++){
+    summary.position_error[i] = get_percentile(position_errors, ERROR_PERCENTILES[i]);
+    summary.bearing_error[i] = get_percentile(bearing_errors, ERROR_PERCENTILES[i]);
+  }
+  summary.cpu_us[0] = get_percentile(cpu_us, 50.0f);
+  summary.cpu_us[1] = get_percentile(cpu_us, 99.0f);
+}
+
+
+/**
+ * @brief Writes @p value as JSON, where infinity is written as null
+ */
+static void write_json_value(FILE* file, const float32_t& value){
+  if(std::isfinite(value)){
+    fprintf(file, "%.4f", (double) value);
+  }
+  else{
+    fprintf(file, "null");
+  }
+}
+
+
+int main(int argc, char** argv){
+
+  const uint32_t num_pings = (argc > 2) ? (uint32_t) atoi(argv[2]) : 200u;
+  uint32_t num_threads = (argc > 3) ? (uint32_t) atoi(argv[3]) : 0u;
+  if(!num_threads){
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  if(!num_pings){
+    printf("Usage: %s [output-file] [pings_per_scenario] [num_threads]\n", argv[0]);
+    return 1;
+  }
+
+  if(!TRILATERATION::initialize_trilateration_globals()){
+    printf("Invalid hydrophone geometry in parameters.h\n");
+    return 1;
+  }
+
+  /* RAM used by the frame-buffers: the DMA-buffer and the workspace */
+  const uint32_t ram_bytes = NUM_HYDROPHONES * DMA_BUFFER_LENGTH * sizeof(uint32_t) +
+      WORKSPACE_SIZE;
+  const float32_t frame_duration_us = 1e6f * IN_BUFFER_LENGTH / SAMPLE_FREQUENCY;
+
+  printf("Configuration               : %u samples at %.0f Hz (%.1f ms frames), %u hydrophones\n",
+      (unsigned) IN_BUFFER_LENGTH, (double) SAMPLE_FREQUENCY,
+      (double) (frame_duration_us * 1e-3f), (unsigned) NUM_HYDROPHONES);
+  printf("Frame-buffer RAM            : %u bytes\n", (unsigned) ram_bytes);
+  printf("Pings per scenario          : %u on %u threads\n\n", (unsigned) num_pings,
+      (unsigned) num_threads);
+  printf("noise  SNR[dB]  surface  valid  <margin  pos-err p50/p%.0f/p99 [m]"
+      "     bearing-err p50/p%.0f/p99 [deg]  cpu p50/p99 [us]\n",
+      (double) SWEEP_PERCENTILE, (double) SWEEP_PERCENTILE);
+
+  /**
+   * Running every scenario
+   */
+  std::vector<ScenarioSummary> summaries;
+  uint8_t bool_meets_margin = 1;
+  float32_t max_cpu_us = 0.0f;
+
+  SimulationConfig scenario;
+  SIMULATION::get_default_config(scenario);
+  scenario.surface_z = HYDROPHONE_POSITIONS[0][2] + 2.0f;
+
+  for(float32_t noise_std : SWEEP_NOISE_STD){
+    for(float32_t surface_reflection : SWEEP_SURFACE_REFLECTION){
+      scenario.noise_std = noise_std;
+      scenario.surface_reflection = surface_reflection;
+
+      ScenarioSummary summary;
+      run_scenario(scenario, summaries.size(), num_pings, num_threads, summary);
+      summaries.push_back(summary);
+
+      bool_meets_margin &= (summary.position_error[1] <= MARGIN_POS_ESTIMATE);
+      max_cpu_us = std::max(max_cpu_us, summary.cpu_us[0]);
+
+      printf("%5.1f  %7.1f  %7.2f  %4.0f%%  %6.0f%%  %8.3f %8.3f %8.3f  %8.2f %8.2f %8.2f"
+          "  %8.1f %8.1f\n", (double) summary.noise_std, (double) summary.snr_db,
+          (double) summary.surface_reflection, 100.0 * summary.valid_fraction,
+          100.0 * summary.within_margin_fraction, (double) summary.position_error[0],
+          (double) summary.position_error[1], (double) summary.position_error[2],
+          (double) summary.bearing_error[0], (double) summary.bearing_error[1],
+          (double) summary.bearing_error[2], (double) summary.cpu_us[0],
+          (double) summary.cpu_us[1]);
+    }
+  }
+
+  printf("\nCPU-time                    : %.1f us/ping (%.1f%% of the frame)\n",
+      (double) max_cpu_us, (double) (100.0f * max_cpu_us / frame_duration_us));
+  printf("Meets MARGIN_POS_ESTIMATE   : %s (p%.0f within %.2f m in every scenario)\n",
+      bool_meets_margin ? "yes" : "no", (double) SWEEP_PERCENTILE,
+      (double) MARGIN_POS_ESTIMATE);
+
+  /**
+   * Writing the results as JSON
+   */
+  if(argc > 1){
+    FILE* file = fopen(argv[1], "w");
+    if(!file){
+      printf("Could not open %s\n", argv[1]);
+      return 1;
+    }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"buffer_length\": %u,\n", (unsigned) IN_BUFFER_LENGTH);
+    fprintf(file, "  \"sample_frequency\": %.1f,\n", (double) SAMPLE_FREQUENCY);
+    fprintf(file, "  \"num_hydrophones\": %u,\n", (unsigned) NUM_HYDROPHONES);
+    fprintf(file, "  \"ram_bytes\": %u,\n", (unsigned) ram_bytes);
+    fprintf(file, "  \"cpu_us_per_ping\": %.1f,\n", (double) max_cpu_us);
+    fprintf(file, "  \"frame_duration_us\": %.1f,\n", (double) frame_duration_us);
+    fprintf(file, "  \"margin_pos_estimate\": %.3f,\n", (double) MARGIN_POS_ESTIMATE);
+    fprintf(file, "  \"meets_margin\": %s,\n", bool_meets_margin ? "true" : "false");
+    fprintf(file, "  \"scenarios\": [\n");
+    for(uint32_t i = 0; i < summaries.size(); i++){
+      const ScenarioSummary& summary = summaries[i];
+      fprintf(file, "    {\"noise_std\": %.1f, \"snr_db\": %.1f, \"surface_reflection\": %.2f, "
+          "\"pings\": %u, \"valid_fraction\": %.4f, \"within_margin_fraction\": %.4f, ",
+          (double) summary.noise_std, (double) summary.snr_db,
+          (double) summary.surface_reflection, (unsigned) num_pings,
+          (double) summary.valid_fraction, (double) summary.within_margin_fraction);
+      for(uint32_t p = 0; p < 3; p++){
+        fprintf(file, "\"position_error_p%.0f\": ", (double) ERROR_PERCENTILES[p]);
+        write_json_value(file, summary.position_error[p]);
+        fprintf(file, ", ");
+      }
+      for(uint32_t p = 0; p < 3; p++){
+        fprintf(file, "\"bearing_error_p%.0f\": ", (double) ERROR_PERCENTILES[p]);
+        write_json_value(file, summary.bearing_error[p]);
+        fprintf(file, ", ");
+      }
+      fprintf(file, "\"cpu_us_p50\": %.1f, \"cpu_us_p99\": %.1f}%s\n",
+          (double) summary.cpu_us[0], (double) summary.cpu_us[1],
+          (i + 1 < summaries.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    if(fclose(file) != 0){
+      printf("Could not write to %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  return 0;
+}
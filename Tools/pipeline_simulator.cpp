@@ -0,0 +1,209 @@
+/**
+ * @file
+ *
+ * @brief Host tool that drives the complete signal-processing pipeline with
+ * pings rendered by the simulator, and reports the throughput and accuracy
+ *
+ * Usage:
+ *      pipeline_simulator [num_frames] [noise_std] [surface_reflection] [trace-file]
+ *
+ * Every frame places the pinger at a random position between 2 and 30 m
+ * from the array, at the height of the reference hydrophone. The frame is
+ * processed the same way as in main.cpp: conversion, filter,
+ * cross-correlation, validation and the solvers. The lags are compared to
+ * the exact fractional lags, and the estimates to the true position. The
+ * time spent in each stage is reported with PROFILING::write_report()
+ *
+ * If a trace-file is given, the trace of the last frames is written to it,
+ * such that it can be converted to a timeline by Tools/trace_decoder.cpp
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "analyze_data.h"
+#include "simulation.h"
+#include "profiling.h"
+#include "trace.h"
+
+int main(int argc, char** argv){
+
+  const uint32_t num_frames = (argc > 1) ? (uint32_t) atoi(argv[1]) : 200u;
+  SimulationConfig config;
+  SIMULATION::get_default_config(config);
+  if(argc > 2){
+    config.noise_std = (float32_t) atof(argv[2]);
+  }
+  if(argc > 3){
+    config.surface_reflection = (float32_t) atof(argv[3]);
+    config.surface_z = HYDROPHONE_POSITIONS[0][2] + 2.0f;
+  }
+
+  TRACE::initialize_trace();
+
+  if(!TRILATERATION::initialize_trilateration_globals()){
+    printf("Invalid hydrophone geometry in parameters.h\n");
+    return 1;
+  }
+  const HydrophoneGeometry& geometry = TRILATERATION::hydrophone_geometry;
+
+  /**
+   * Buffers laid out as in main.cpp
+   */
+  std::vector<uint16_t> adc_data(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+  /* The data-arrays are allocated from the workspace, as in main.cpp */
+  float32_t* data_array[NUM_HYDROPHONES];
+  WORKSPACE::allocate_arrays(WORKSPACE::frame_workspace, data_array, IN_BUFFER_LENGTH);
+
+  uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    p_lag_array[pair] = &lag_array[pair];
+  });
+
+  Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+  Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
+
+  /**
+   * Statistics
+   */
+  TimingStatistics render_timing, pipeline_timing;
+  TIMING::reset_statistics(render_timing);
+  TIMING::reset_statistics(pipeline_timing);
+
+  uint32_t num_invalid_lags = 0, num_solver_errors = 0, num_estimates = 0;
+  float32_t sum_lag_error = 0.0f, max_lag_error = 0.0f;
+  float32_t sum_position_error = 0.0f, sum_bearing_error = 0.0f;
+  float32_t max_bearing_error = 0.0f;
+
+  uint32_t random_state = 12345u;
+  for(uint32_t frame = 0; frame < num_frames; frame++){
+
+    /* Random position around the array */
+    random_state = random_state * 1664525u + 1013904223u;
+    float32_t angle = (random_state >> 8) * (2.0f * (float32_t) M_PI / 16777216.0f);
+    random_state = random_state * 1664525u + 1013904223u;
+    float32_t range = 2.0f + (random_state >> 8) * (28.0f / 16777216.0f);
+
+    config.source_position[0] = HYDROPHONE_POSITIONS[0][0] + range * std::sin(angle);
+    config.source_position[1] = HYDROPHONE_POSITIONS[0][1] + range * std::cos(angle);
+    config.source_position[2] = HYDROPHONE_POSITIONS[0][2];
+    config.seed = frame + 1u;
+
+    uint32_t start_ticks = TIMING::get_ticks();
+    SIMULATION::render_ping(config, adc_data.data());
+    TIMING::update_statistics(render_timing, start_ticks);
+
+    /* The pipeline, as in main.cpp */
+    start_ticks = TIMING::get_ticks();
+    uint32_t stage_ticks = start_ticks;
+    ANALYZE_DATA::convert_adc_data(adc_data.data(), data_array);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CONVERT, stage_ticks);
+    ANALYZE_DATA::filter_raw_data(data_array);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, stage_ticks);
+    ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array,
+        geometry.max_lag, WORKSPACE::frame_workspace);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CORRELATE, stage_ticks);
+
+    uint8_t bool_time_error = 0;
+    uint8_t bool_valid_lags = TRILATERATION::check_valid_signals(p_lag_array, bool_time_error);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_VALIDATE, stage_ticks);
+
+    float32_t x_es = 0.0f, y_es = 0.0f, z_es = 0.0f, bearing_es = 0.0f, elevation_es = 0.0f;
+    uint8_t bool_position = bool_valid_lags && TRILATERATION::trilaterate_pinger_position(
+        A_matrix, B_vector, p_lag_array, x_es, y_es, z_es);
+    #if USE_NONLINEAR_SOLVER
+    bool_position = bool_position && TRILATERATION::refine_pinger_position(
+        p_lag_array, x_es, y_es, z_es);
+    #endif /* USE_NONLINEAR_SOLVER */
+    uint8_t bool_bearing = bool_valid_lags && TRILATERATION::estimate_pinger_bearing(
+        p_lag_array, bearing_es, elevation_es);
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_SOLVE, stage_ticks);
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_FRAME, start_ticks);
+    TIMING::update_statistics(pipeline_timing, start_ticks);
+
+    /**
+     * Comparing against the truth
+     */
+    if(!bool_valid_lags){
+      num_invalid_lags++;
+      continue;
+    }
+
+    float32_t expected_lags[NUM_HYDROPHONE_PAIRS];
+    SIMULATION::calculate_expected_lags<NUM_HYDROPHONES>(config,
+        HYDROPHONE_POSITIONS, expected_lags);
+    for(uint32_t pair = 0; pair < NUM_HYDROPHONE_PAIRS; pair++){
+      float32_t error = std::abs((float32_t)(int32_t) lag_array[pair] - expected_lags[pair]);
+      sum_lag_error += error;
+      max_lag_error = std::max(max_lag_error, error);
+    }
+
+    if(!bool_position || !bool_bearing){
+      num_solver_errors++;
+      continue;
+    }
+
+    float32_t dx = x_es - config.source_position[0];
+    float32_t dy = y_es - config.source_position[1];
+    sum_position_error += std::sqrt(dx * dx + dy * dy);
+
+    float32_t true_bearing = (float32_t) (std::atan2(
+        config.source_position[0] - HYDROPHONE_POSITIONS[0][0],
+        config.source_position[1] - HYDROPHONE_POSITIONS[0][1]) * 180.0 / M_PI);
+    float32_t bearing_error = std::abs(std::remainder(bearing_es - true_bearing, 360.0f));
+    sum_bearing_error += bearing_error;
+    max_bearing_error = std::max(max_bearing_error, bearing_error);
+    num_estimates++;
+  }
+
+  /**
+   * Report
+   */
+  uint32_t num_valid = num_frames - num_invalid_lags;
+  float32_t pipeline_us = TIMING::ticks_to_us(pipeline_timing.total_ticks) /
+      std::max(pipeline_timing.num_measurements, 1u);
+
+  printf("Hydrophones                 : %u\n", (unsigned) NUM_HYDROPHONES);
+  printf("Frames                      : %u\n", (unsigned) num_frames);
+  printf("Noise std                   : %.1f ADC\n", (double) config.noise_std);
+  printf("Surface reflection          : %.2f\n", (double) config.surface_reflection);
+  printf("Render time                 : %.1f us/frame\n", (double) (TIMING::ticks_to_us(
+      render_timing.total_ticks) / std::max(render_timing.num_measurements, 1u)));
+  printf("Pipeline time               : %.1f us/frame (max %.1f us)\n", (double) pipeline_us,
+      (double) TIMING::ticks_to_us(pipeline_timing.max_ticks));
+  printf("Pipeline throughput         : %.0f frames/s\n", 1e6 / (double) pipeline_us);
+  printf("Invalid lags                : %u\n", (unsigned) num_invalid_lags);
+  printf("Solver errors               : %u\n", (unsigned) num_solver_errors);
+  if(num_valid){
+    printf("Lag error                   : %.2f samples (max %.2f)\n",
+        (double) (sum_lag_error / (num_valid * NUM_HYDROPHONE_PAIRS)), (double) max_lag_error);
+  }
+  if(num_estimates){
+    printf("Position error              : %.3f m\n", (double) (sum_position_error / num_estimates));
+    printf("Bearing error               : %.2f deg (max %.2f deg)\n",
+        (double) (sum_bearing_error / num_estimates), (double) max_bearing_error);
+  }
+
+  printf("Workspace high-water mark   : %u of %u bytes\n",
+      (unsigned) WORKSPACE::frame_workspace.high_water_mark, (unsigned) WORKSPACE_SIZE);
+
+  char report[2048];
+  PROFILING::write_report(report, sizeof(report));
+  printf("\n%s", report);
+
+  if(argc > 4){
+    FILE* file = fopen(argv[4], "wb");
+    if(!file || fwrite(&TRACE::trace_buffer, sizeof(TraceBuffer), 1, file) != 1){
+      printf("Could not write the trace to %s\n", argv[4]);
+      if(file){
+        fclose(file);
+      }
+      return 1;
+    }
+    fclose(file);
+    printf("Trace written to %s\n", argv[4]);
+  }
+
+  return 0;
+}
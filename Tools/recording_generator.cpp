@@ -0,0 +1,98 @@
+/**
+ * @file
+ *
+ * @brief Host tool that writes a recording of simulated pings, in the
+ * format given in recording.h. Used to test the replay without a recording
+ * from the field
+ *
+ * Usage:
+ *      recording_generator <output-file> [num_frames] [noise_std] [raw|packed|rice]
+ *
+ * The pinger moves on a circle with radius 10 m around the AUV at 0.5 m/s,
+ * and sends one ping every second. Every ping is captured as one frame.
+ * The samples are stored raw, unless another encoding is given
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "recording.h"
+#include "simulation.h"
+
+/**
+ * @brief Finds the encoding named @p name
+ *
+ * @retval Returns 0 if the name is unknown
+ */
+static uint8_t parse_encoding(
+      const char* name,
+      uint32_t& encoding){
+
+  const char* names[] = { "raw", "packed", "rice" };
+  for(uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++){
+    if(strcmp(name, names[i]) == 0){
+      encoding = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+int main(int argc, char** argv){
+
+  uint32_t encoding = SAMPLE_ENCODING_RAW;
+  if(argc < 2 || (argc > 4 && !parse_encoding(argv[4], encoding))){
+    printf("Usage: %s <output-file> [num_frames] [noise_std] [raw|packed|rice]\n", argv[0]);
+    return 1;
+  }
+  const uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 100u;
+
+  SimulationConfig config;
+  SIMULATION::get_default_config(config);
+  if(argc > 3){
+    config.noise_std = (float32_t) atof(argv[3]);
+  }
+
+  FILE* file = fopen(argv[1], "wb");
+  if(!file){
+    printf("Could not open %s\n", argv[1]);
+    return 1;
+  }
+
+  RecordingHeader header;
+  RECORDING::create_header(HYDROPHONE_POSITIONS, encoding, header);
+  uint8_t bool_valid = (fwrite(&header, sizeof(RecordingHeader), 1, file) == 1);
+
+  std::vector<uint16_t> adc_data(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+  std::vector<uint8_t> frame(RECORDING::get_frame_size(header));
+  uint64_t num_bytes = sizeof(RecordingHeader);
+
+  const float32_t radius = 10.0f;
+  const float32_t angular_velocity = 0.5f / radius;
+
+  for(uint32_t i = 0; bool_valid && i < num_frames; i++){
+    float32_t angle = angular_velocity * i;
+    config.source_position[0] = radius * std::sin(angle);
+    config.source_position[1] = radius * std::cos(angle);
+    config.source_position[2] = HYDROPHONE_POSITIONS[0][2];
+    config.seed = i + 1u;
+
+    SIMULATION::render_ping(config, adc_data.data());
+    uint32_t frame_size = RECORDING::write_frame(header, adc_data.data(), i,
+        (uint64_t) i * 1000000u, frame.data());
+    bool_valid = (fwrite(frame.data(), frame_size, 1, file) == 1);
+    num_bytes += frame_size;
+  }
+
+  if(fclose(file) != 0 || !bool_valid){
+    printf("Could not write to %s\n", argv[1]);
+    return 1;
+  }
+
+  const uint64_t raw_bytes = (uint64_t) num_frames * NUM_HYDROPHONES * DMA_BUFFER_LENGTH * sizeof(uint16_t);
+  printf("Wrote %u frames (%llu bytes, %.2f bits/sample) to %s\n", (unsigned) num_frames,
+      (unsigned long long) num_bytes, 16.0 * num_bytes / std::max(raw_bytes, (uint64_t) 1u), argv[1]);
+  return 0;
+}
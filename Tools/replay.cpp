@@ -0,0 +1,197 @@
+/**
+ * @file
+ *
+ * @brief Host tool that replays a recording through the same processing as
+ * main.cpp, as fast as the CPU allows. Used to reproduce failures from the
+ * field and to measure the throughput on real data
+ *
+ * Usage:
+ *      replay <recording> [estimates.csv]
+ *
+ * The geometry given in the header of the recording is applied with
+ * GEOMETRY_CONFIG::apply_config() before the first frame. The number of
+ * hydrophones, frame-length and sample-frequency must equal the ones in
+ * parameters.h. Every estimate is written to estimates.csv if given
+ *
+ * The recording is memory-mapped with RECORDING_READER, and every frame is
+ * converted directly from the mapping. Recordings larger than the RAM are
+ * therefore replayed with bounded memory, limited by the processing
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "analyze_data.h"
+#include "recording_reader.h"
+#include "tracking.h"
+#include "profiling.h"
+
+int main(int argc, char** argv){
+
+  if(argc < 2){
+    printf("Usage: %s <recording> [estimates.csv]\n", argv[0]);
+    return 1;
+  }
+
+  /**
+   * Mapping the recording, and applying its geometry
+   */
+  RecordingReader reader;
+  if(!RECORDING_READER::open_recording(argv[1], reader)){
+    printf("Could not open %s, or the recording-header is invalid\n", argv[1]);
+    return 1;
+  }
+  const RecordingHeader& header = reader.header;
+  if(!RECORDING::check_compatible_header(header)){
+    printf("The recording (%u hydrophones, %u samples at %.0f Hz) does not match "
+        "parameters.h\n", (unsigned) header.num_hydrophones,
+        (unsigned) header.frame_length, (double) header.sample_frequency);
+    RECORDING_READER::close_recording(reader);
+    return 1;
+  }
+
+  float32_t positions[NUM_HYDROPHONES][3];
+  memcpy(positions, header.positions, sizeof(positions));
+  GeometryConfig geometry_config;
+  GEOMETRY_CONFIG::create_config(positions, geometry_config);
+  if(!GEOMETRY_CONFIG::apply_config(geometry_config)){
+    printf("Invalid geometry in the recording\n");
+    RECORDING_READER::close_recording(reader);
+    return 1;
+  }
+
+  FILE* estimates = nullptr;
+  if(argc > 2){
+    estimates = fopen(argv[2], "w");
+    if(!estimates){
+      printf("Could not open %s\n", argv[2]);
+      RECORDING_READER::close_recording(reader);
+      return 1;
+    }
+    fprintf(estimates, "sequence,timestamp_us,valid,x,y,z,bearing,x_tracked,y_tracked\n");
+  }
+
+  /**
+   * Buffers laid out as in main.cpp
+   */
+  /* The data-arrays are allocated from the workspace, as in main.cpp */
+  float32_t* data_array[NUM_HYDROPHONES];
+  WORKSPACE::allocate_arrays(WORKSPACE::frame_workspace, data_array, IN_BUFFER_LENGTH);
+
+  uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  unroll<NUM_HYDROPHONE_PAIRS>([&](uint32_t pair){
+    p_lag_array[pair] = &lag_array[pair];
+  });
+
+  Matrix_A_f A_matrix = TRILATERATION::initialize_A_matrix();
+  Vector_B_f B_vector = TRILATERATION::initialize_B_vector();
+
+  TrackerState pinger_tracker;
+  TRACKING::initialize_tracker(pinger_tracker);
+
+  /**
+   * Replaying every frame
+   */
+  uint32_t num_frames = 0, num_dropped = 0, num_invalid_lags = 0, num_solver_errors = 0;
+  uint32_t last_sequence = 0;
+  uint64_t last_timestamp = 0;
+  uint8_t bool_warm_start = 0;
+  float32_t x_pos_es = 0, y_pos_es = 0, z_pos_es = 0;
+
+  TimingStatistics replay_timing;
+  TIMING::reset_statistics(replay_timing);
+
+  RecordingFrameView view;
+  while(RECORDING_READER::next_frame(reader, view)){
+    uint32_t start_ticks = TIMING::get_ticks();
+    const RecordingFrameHeader& frame_header = view.header;
+
+    if(num_frames && frame_header.sequence != last_sequence + 1){
+      num_dropped += frame_header.sequence - last_sequence - 1;
+    }
+    float32_t time_step = num_frames ?
+        (frame_header.timestamp - last_timestamp) * 1e-6f : 0.0f;
+    last_sequence = frame_header.sequence;
+    last_timestamp = frame_header.timestamp;
+    num_frames++;
+
+    /* The processing, as in main.cpp */
+    uint32_t stage_ticks = start_ticks;
+    ANALYZE_DATA::convert_recorded_data(view.p_samples, data_array);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CONVERT, stage_ticks);
+    ANALYZE_DATA::filter_raw_data(data_array);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, stage_ticks);
+    ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array,
+        TRILATERATION::hydrophone_geometry.max_lag, WORKSPACE::frame_workspace);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CORRELATE, stage_ticks);
+
+    uint8_t bool_time_error = 0;
+    uint8_t bool_valid = TRILATERATION::check_valid_signals(p_lag_array, bool_time_error);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_VALIDATE, stage_ticks);
+    if(!bool_valid){
+      num_invalid_lags++;
+      bool_warm_start = 0;
+    }
+
+    if(bool_valid && !bool_warm_start){
+      bool_valid = TRILATERATION::trilaterate_pinger_position(
+          A_matrix, B_vector, p_lag_array, x_pos_es, y_pos_es, z_pos_es);
+    }
+    #if USE_NONLINEAR_SOLVER
+    if(bool_valid){
+      bool_valid = bool_warm_start = TRILATERATION::refine_pinger_position(
+          p_lag_array, x_pos_es, y_pos_es, z_pos_es);
+    }
+    #endif /* USE_NONLINEAR_SOLVER */
+    if(bool_valid){
+      TRACKING::update_tracker(pinger_tracker, x_pos_es, y_pos_es, time_step);
+    }
+    else if(!bool_time_error){
+      num_solver_errors++;
+    }
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_SOLVE, stage_ticks);
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_FRAME, start_ticks);
+    TIMING::update_statistics(replay_timing, start_ticks);
+
+    if(estimates){
+      float32_t x_tracked = 0, y_tracked = 0, bearing_tracked, range_tracked, variance[2];
+      TRACKING::get_tracker_estimate(pinger_tracker, x_tracked, y_tracked,
+          bearing_tracked, range_tracked, variance);
+      fprintf(estimates, "%u,%llu,%u,%.4f,%.4f,%.4f,%.2f,%.4f,%.4f\n",
+          (unsigned) frame_header.sequence, (unsigned long long) frame_header.timestamp,
+          (unsigned) bool_valid, (double) x_pos_es, (double) y_pos_es, (double) z_pos_es,
+          std::atan2(x_pos_es, y_pos_es) * 180.0 / M_PI,
+          (double) x_tracked, (double) y_tracked);
+    }
+  }
+  RECORDING_READER::close_recording(reader);
+  if(estimates){
+    fclose(estimates);
+  }
+
+  /**
+   * Report
+   */
+  float32_t frame_us = TIMING::ticks_to_us(replay_timing.total_ticks) /
+      std::max(replay_timing.num_measurements, 1u);
+  float32_t frame_duration_us = 1e6f * header.frame_length / header.sample_frequency;
+
+  printf("Frames                      : %u (%u dropped)\n", (unsigned) num_frames,
+      (unsigned) num_dropped);
+  printf("Invalid lags                : %u\n", (unsigned) num_invalid_lags);
+  printf("Solver errors               : %u\n", (unsigned) num_solver_errors);
+  printf("Processing time             : %.1f us/frame\n", (double) frame_us);
+  printf("Throughput                  : %.0f frames/s, %.1f MB/s\n", 1e6 / (double) frame_us,
+      (double) (reader.size - sizeof(RecordingHeader)) / std::max(reader.num_frames, (uint64_t) 1u) /
+      (double) frame_us);
+  printf("Faster than real-time       : %.2fx\n", (double) (frame_duration_us / frame_us));
+
+  printf("Workspace high-water mark   : %u of %u bytes\n",
+      (unsigned) WORKSPACE::frame_workspace.high_water_mark, (unsigned) WORKSPACE_SIZE);
+
+  char report[2048];
+  PROFILING::write_report(report, sizeof(report));
+  printf("\n%s", report);
+
+  return 0;
+}
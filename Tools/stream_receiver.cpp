@@ -0,0 +1,413 @@
+/**
+ * @file
+ *
+ * @brief Host tool that receives the raw frames streamed by the MCU, and
+ * writes them to disk as a recording. The recording is replayed with
+ * Tools/replay.cpp
+ *
+ * Usage:
+ *      stream_receiver <recording> [num_frames] [simulate_rate] [raw|packed|rice]
+ *
+ * The stream is started by sending COMMAND_RAW_STREAM to the MCU at
+ * TELEMETRY_SOURCE_IP, and stopped when receiving stops. The reply is not
+ * waited for, as the stream itself shows that the command arrived
+ *
+ * The packets are received on RAW_STREAM_DEST_PORT, and reassembled into
+ * frames by the sequence-number. A few frames are kept in flight, such
+ * that packets arriving out of order are accepted. A frame missing any
+ * packet is dropped, such that every frame in the recording is complete.
+ * Receiving stops after @p num_frames frames, or when no packet has arrived
+ * for a second after the first
+ *
+ * The stream holds no geometry, such that the recording is written with the
+ * positions in parameters.h. The samples are stored raw, unless another
+ * encoding is given. The number of hydrophones and the frame-length
+ * in the stream must match parameters.h
+ *
+ * If @p simulate_rate is given, the MCU is simulated by a thread streaming
+ * simulated pings with TELEMETRY_TRANSPORT over the loopback-address, at
+ * @p simulate_rate times the real frame-rate. The recording is then read
+ * back and compared with the frames sent. Fails if any frame is lost or
+ * differs
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "recording_reader.h"
+#include "simulation.h"
+#include "telemetry_transport.h"
+
+/* Number of frames reassembled at the same time */
+#define STREAM_WINDOW 4u
+
+/**
+ * @brief A frame being reassembled
+ *
+ * @param bool_active Indicates if the slot holds a frame
+ *
+ * @param sequence Sequence-number of the frame
+ *
+ * @param timestamp Time the frame was captured [us]
+ *
+ * @param num_received Number of packets received
+ *
+ * @param bool_received Indicates which packets are received
+ *
+ * @param samples The interleaved samples
+ */
+typedef struct{
+  uint8_t bool_active;
+  uint32_t sequence;
+  uint64_t timestamp;
+  uint32_t num_received;
+  std::vector<uint8_t> bool_received;
+  std::vector<uint16_t> samples;
+}StreamFrame; /* struct StreamFrame */
+
+
+/**
+ * @brief Opens the socket receiving the stream
+ *
+ * @retval Returns the socket. Returns -1 if the port is taken
+ */
+static int open_receiver(){
+  int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+  if(receiver < 0){
+    return -1;
+  }
+
+  /* A frame arrives as a burst of packets, which must fit in the buffer */
+  int buffer_size = 1 << 23;
+  setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+  struct timeval timeout = { 1, 0 };
+  setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(RAW_STREAM_DEST_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(receiver, (const struct sockaddr*) &address, sizeof(address)) != 0){
+    close(receiver);
+    return -1;
+  }
+  return receiver;
+}
+
+
+/**
+ * @brief Sends COMMAND_RAW_STREAM to the MCU, starting or stopping the stream
+ *
+ * @retval Returns 1 if the command is sent
+ */
+static uint8_t send_stream_command(const uint32_t& bool_start){
+  int sender = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sender < 0){
+    return 0;
+  }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(COMMAND_PORT);
+  address.sin_addr.s_addr = htonl(TELEMETRY_SOURCE_IP);
+
+  uint8_t packet[COMMAND_MAX_PACKET_SIZE];
+  const uint32_t length = COMMAND::write_packet(COMMAND_RAW_STREAM, 0, 0,
+      &bool_start, sizeof(bool_start), packet);
+  const uint8_t bool_sent = sendto(sender, packet, length, 0,
+      (const struct sockaddr*) &address, sizeof(address)) == (ssize_t) length;
+  close(sender);
+  return bool_sent;
+}
+
+
+/**
+ * @brief Renders the simulated frames streamed when simulating the MCU
+ */
+static void render_frames(
+      const uint32_t& num_frames,
+      std::vector<std::vector<uint16_t>>& frames){
+
+  SimulationConfig config;
+  SIMULATION::get_default_config(config);
+  frames.assign(num_frames, std::vector<uint16_t>(NUM_HYDROPHONES * DMA_BUFFER_LENGTH));
+
+  for(uint32_t frame = 0; frame < num_frames; frame++){
+    float32_t angle = frame * 0.05f;
+    config.source_position[0] = HYDROPHONE_POSITIONS[0][0] + 20.0f * std::sin(angle);
+    config.source_position[1] = HYDROPHONE_POSITIONS[0][1] + 20.0f * std::cos(angle);
+    config.seed = frame + 1u;
+    SIMULATION::render_ping(config, frames[frame].data());
+  }
+}
+
+
+/**
+ * @brief Streams the frames as the MCU, at @p rate times the real frame-rate
+ */
+static void simulate_mcu(
+      const std::vector<std::vector<uint16_t>>& frames,
+      const float32_t& rate){
+
+  const auto frame_period = std::chrono::duration<double>(
+      DMA_BUFFER_LENGTH / (double) SAMPLE_FREQUENCY / rate);
+  auto next_frame = std::chrono::steady_clock::now();
+
+  for(uint32_t frame = 0; frame < frames.size(); frame++){
+    std::this_thread::sleep_until(next_frame);
+    next_frame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_period);
+
+    const uint64_t timestamp = (uint64_t) (frame * DMA_BUFFER_LENGTH * 1e6 / SAMPLE_FREQUENCY);
+    TELEMETRY_TRANSPORT::send_raw_frame(frames[frame].data(), frame, timestamp);
+  }
+}
+
+
+/**
+ * @brief Compares the recording with the frames streamed
+ *
+ * @retval Returns the number of frames that are missing or differ
+ */
+static uint32_t verify_recording(
+      const char* path,
+      const std::vector<std::vector<uint16_t>>& frames){
+
+  RecordingReader reader;
+  if(!RECORDING_READER::open_recording(path, reader)){
+    return frames.size();
+  }
+
+  uint32_t num_matching = 0;
+  RecordingFrameView view;
+  while(RECORDING_READER::next_frame(reader, view)){
+    const uint32_t sequence = view.header.sequence;
+    if(sequence >= frames.size()){
+      continue;
+    }
+
+    uint8_t bool_equal = 1;
+    for(uint32_t i = 0; i < NUM_HYDROPHONES * DMA_BUFFER_LENGTH; i++){
+      bool_equal &= (view.p_samples[i] == frames[sequence][i]);
+    }
+    num_matching += bool_equal;
+  }
+
+  RECORDING_READER::close_recording(reader);
+  return frames.size() - num_matching;
+}
+
+
+/**
+ * @brief Finds the encoding named @p name
+ *
+ * @retval Returns 0 if the name is unknown
+ */
+static uint8_t parse_encoding(
+      const char* name,
+      uint32_t& encoding){
+
+  const char* names[] = { "raw", "packed", "rice" };
+  for(uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++){
+    if(strcmp(name, names[i]) == 0){
+      encoding = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+int main(int argc, char** argv){
+
+  uint32_t encoding = SAMPLE_ENCODING_RAW;
+  if(argc < 2 || (argc > 4 && !parse_encoding(argv[4], encoding))){
+    printf("Usage: %s <recording> [num_frames] [simulate_rate] [raw|packed|rice]\n", argv[0]);
+    return 1;
+  }
+  const uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 0xFFFFFFFFu;
+  const float32_t simulate_rate = (argc > 3) ? (float32_t) atof(argv[3]) : 0.0f;
+  const uint8_t bool_simulate = simulate_rate > 0.0f && num_frames != 0xFFFFFFFFu;
+
+  int receiver = open_receiver();
+  if(receiver < 0){
+    printf("Could not receive on port %u\n", (unsigned) RAW_STREAM_DEST_PORT);
+    return 1;
+  }
+
+  FILE* recording = fopen(argv[1], "wb");
+  if(!recording){
+    printf("Could not open %s\n", argv[1]);
+    close(receiver);
+    return 1;
+  }
+
+  RecordingHeader recording_header;
+  RECORDING::create_header(HYDROPHONE_POSITIONS, encoding, recording_header);
+  fwrite(&recording_header, sizeof(RecordingHeader), 1, recording);
+
+  /**
+   * Simulating the MCU, if requested
+   */
+  std::vector<std::vector<uint16_t>> simulated_frames;
+  std::thread mcu;
+  if(bool_simulate){
+    render_frames(num_frames, simulated_frames);
+    if(!TELEMETRY_TRANSPORT::initialize_transport()){
+      printf("Could not open the loopback-sockets\n");
+      return 1;
+    }
+    mcu = std::thread(simulate_mcu, std::cref(simulated_frames), simulate_rate);
+  }
+  else if(!send_stream_command(1)){
+    printf("Could not send the command starting the stream\n");
+  }
+
+  /**
+   * Receiving and reassembling the frames
+   */
+  StreamFrame window[STREAM_WINDOW];
+  for(StreamFrame& frame : window){
+    frame.bool_active = 0;
+    frame.bool_received.resize(RAW_STREAM_PACKETS_PER_FRAME);
+    frame.samples.resize(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+  }
+
+  std::vector<uint8_t> packet(2048);
+  std::vector<uint8_t> frame_buffer(RECORDING::get_frame_size(recording_header));
+  uint32_t num_written = 0, num_incomplete = 0, num_invalid = 0, num_late = 0;
+  uint64_t num_packets = 0, num_bytes = 0, num_recorded_bytes = sizeof(RecordingHeader);
+  uint32_t next_sequence = 0;
+  uint8_t bool_started = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto last_packet = start;
+
+  while(num_written < num_frames){
+    /* Waiting for the first packet for as long as it takes */
+    ssize_t length = recv(receiver, packet.data(), packet.size(), 0);
+    if(length <= 0 && bool_started){
+      break;
+    }
+    if(length <= 0){
+      continue;
+    }
+    last_packet = std::chrono::steady_clock::now();
+    num_packets++;
+    num_bytes += length;
+
+    RawStreamHeader header;
+    if(!RAW_STREAM::parse_packet_header(packet.data(), (uint32_t) length, header) ||
+       header.num_hydrophones != NUM_HYDROPHONES || header.frame_length != DMA_BUFFER_LENGTH ||
+       header.num_packets != RAW_STREAM_PACKETS_PER_FRAME){
+      num_invalid++;
+      continue;
+    }
+
+    /* Frames before the window have already been written or dropped */
+    if(!bool_started){
+      next_sequence = header.sequence;
+      bool_started = 1;
+    }
+    if((int32_t) (header.sequence - next_sequence) < 0){
+      num_late++;
+      continue;
+    }
+
+    /* A newer frame replaces an incomplete frame in the same slot */
+    StreamFrame& frame = window[header.sequence % STREAM_WINDOW];
+    if(!frame.bool_active || frame.sequence != header.sequence){
+      if(frame.bool_active){
+        num_incomplete++;
+      }
+      frame.bool_active = 1;
+      frame.sequence = header.sequence;
+      frame.timestamp = header.timestamp;
+      frame.num_received = 0;
+      std::fill(frame.bool_received.begin(), frame.bool_received.end(), 0);
+    }
+
+    if(frame.bool_received[header.packet_index]){
+      continue;
+    }
+    frame.bool_received[header.packet_index] = 1;
+    frame.num_received++;
+    SAMPLE_CODING::decode_samples(header.encoding, packet.data() + sizeof(RawStreamHeader),
+        (uint32_t) length - sizeof(RawStreamHeader), header.num_samples, NUM_HYDROPHONES,
+        frame.samples.data() + header.sample_offset);
+
+    if(frame.num_received == RAW_STREAM_PACKETS_PER_FRAME){
+      uint32_t frame_size = RECORDING::write_frame(recording_header, frame.samples.data(),
+          frame.sequence, frame.timestamp, frame_buffer.data());
+      fwrite(frame_buffer.data(), frame_size, 1, recording);
+      num_recorded_bytes += frame_size;
+      frame.bool_active = 0;
+      num_written++;
+
+      /* Frames more than STREAM_WINDOW behind are no longer accepted */
+      const uint32_t oldest_sequence = frame.sequence + 1 - STREAM_WINDOW;
+      if((int32_t) (oldest_sequence - next_sequence) > 0){
+        next_sequence = oldest_sequence;
+      }
+    }
+  }
+
+  for(StreamFrame& frame : window){
+    num_incomplete += frame.bool_active;
+  }
+  float32_t receive_s = std::chrono::duration<float32_t>(last_packet - start).count();
+
+  if(bool_simulate){
+    mcu.join();
+    TELEMETRY_TRANSPORT::close_transport();
+  }
+  else{
+    send_stream_command(0);
+  }
+  fclose(recording);
+  close(receiver);
+
+  /**
+   * Report
+   */
+  printf("Frames written                  : %u\n", (unsigned) num_written);
+  printf("Frames incomplete               : %u\n", (unsigned) num_incomplete);
+  printf("Packets received                : %llu (%u invalid, %u late)\n",
+      (unsigned long long) num_packets, (unsigned) num_invalid, (unsigned) num_late);
+  printf("Packets per frame               : %u of %u samples\n",
+      (unsigned) RAW_STREAM_PACKETS_PER_FRAME, (unsigned) RAW_STREAM_PACKET_SAMPLES);
+  if(receive_s > 0.0f){
+    printf("Received                        : %.2f Mbit/s, %.1f frames/s\n",
+        (double) (num_bytes * 8e-6f / receive_s), (double) (num_written / receive_s));
+  }
+  printf("Real-time rate                  : %.2f Mbit/s, %.1f frames/s\n",
+      (double) (RAW_STREAM_PACKETS_PER_FRAME * sizeof(RawStreamHeader) +
+          SAMPLE_CODING::get_max_encoded_size(RAW_STREAM_PACKED ? SAMPLE_ENCODING_PACKED : SAMPLE_ENCODING_RAW,
+          NUM_HYDROPHONES * DMA_BUFFER_LENGTH)) * 8e-6 * SAMPLE_FREQUENCY / DMA_BUFFER_LENGTH,
+      (double) (SAMPLE_FREQUENCY / DMA_BUFFER_LENGTH));
+  printf("Recorded                        : %.2f bits/sample\n", 16.0 * num_recorded_bytes /
+      std::max((double) num_written * NUM_HYDROPHONES * DMA_BUFFER_LENGTH * sizeof(uint16_t), 1.0));
+
+  if(bool_simulate){
+    TransportStatistics statistics;
+    TELEMETRY_TRANSPORT::get_statistics(statistics);
+    uint32_t num_failed = verify_recording(argv[1], simulated_frames);
+    printf("Frames sent/dropped by the MCU  : %u/%u\n", (unsigned) statistics.num_raw_sent,
+        (unsigned) statistics.num_raw_dropped);
+    printf("Frames missing or different     : %u\n", (unsigned) num_failed);
+    if(num_failed){
+      printf("FAILED\n");
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file
+ *
+ * @brief Host tool that tests and benchmarks the telemetry. The records are
+ * encoded as on the MCU, sent with TELEMETRY_TRANSPORT over the loopback
+ * address, and received and decoded as on the Xavier
+ *
+ * Usage:
+ *      telemetry_loopback [num_records]
+ *
+ * Every field of every record is filled with pseudo-random values, such
+ * that any field lost or moved by the encoder or the decoder is detected.
+ * Every received record must be bitwise equal to the one sent, and the
+ * packet sequence-numbers must be contiguous. The decoder is also checked
+ * against packets that are truncated, of the wrong version, or that hold
+ * records from a later version of the format. Fails if any check fails
+ *
+ * The time spent encoding and decoding is reported per record, next to the
+ * throughput of the loopback-socket and the bytes sent per record on the
+ * wire, including the Ethernet-, IPv4- and UDP-headers
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "telemetry_transport.h"
+
+/**
+ * @brief Wall-clock time spent by @p function [us]
+ */
+template<typename Function>
+static float32_t measure_us(Function function){
+  auto start = std::chrono::steady_clock::now();
+  function();
+  return std::chrono::duration<float32_t, std::micro>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+
+/**
+ * @brief Fills every byte of a record with pseudo-random values
+ */
+static void fill_record(
+      const uint32_t& sequence,
+      uint32_t& random_state,
+      TelemetryRecord& record){
+
+  TELEMETRY::initialize_record(sequence, (uint64_t) sequence * 18204u, record);
+  uint8_t* p_record = (uint8_t*) &record;
+  for(uint32_t i = sizeof(uint32_t); i < sizeof(TelemetryRecord); i++){
+    random_state = random_state * 1664525u + 1013904223u;
+    p_record[i] = (uint8_t) (random_state >> 24);
+  }
+}
+
+
+/**
+ * @brief Opens the socket receiving the telemetry, as on the Xavier
+ *
+ * @retval Returns the socket. Returns -1 if the port is taken
+ */
+static int open_receiver(){
+  int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+  if(receiver < 0){
+    return -1;
+  }
+
+  int buffer_size = 1 << 22;
+  setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(TELEMETRY_DEST_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(receiver, (const struct sockaddr*) &address, sizeof(address)) != 0){
+    close(receiver);
+    return -1;
+  }
+  return receiver;
+}
+
+
+/**
+ * @brief Checks the decoder against invalid packets and packets from a
+ * later version
+ *
+ * @retval Returns the number of failed checks
+ */
+static uint32_t check_decoder(const TelemetryRecord& record){
+  uint32_t num_failed = 0;
+  auto check = [&](uint8_t bool_passed, const char* name){
+    printf("  %-40s: %s\n", name, bool_passed ? "passed" : "FAILED");
+    num_failed += !bool_passed;
+  };
+
+  TelemetryBatch batch;
+  TELEMETRY::initialize_batch(batch);
+  TELEMETRY::add_record(record, batch);
+  TELEMETRY::add_record(record, batch);
+
+  std::vector<uint8_t> packet(TELEMETRY_MAX_PACKET_SIZE + 2 * 16);
+  uint32_t length = TELEMETRY::write_packet(batch, packet.data());
+
+  TelemetryPacketHeader header;
+  TelemetryRecord records[TELEMETRY_BATCH_SIZE];
+
+  check(TELEMETRY::parse_packet(packet.data(), length, header, records, TELEMETRY_BATCH_SIZE) &&
+        header.num_records == 2 && !memcmp(&records[1], &record, sizeof(TelemetryRecord)),
+        "Valid packet");
+  check(!TELEMETRY::parse_packet(packet.data(), length - 1, header, records, TELEMETRY_BATCH_SIZE),
+        "Truncated packet is rejected");
+  check(!TELEMETRY::parse_packet(packet.data(), length, header, records, 1),
+        "Too many records are rejected");
+
+  std::vector<uint8_t> invalid(packet.begin(), packet.begin() + length);
+  invalid[0] ^= 0xFF;
+  check(!TELEMETRY::parse_packet(invalid.data(), length, header, records, TELEMETRY_BATCH_SIZE),
+        "Wrong magic is rejected");
+
+  invalid.assign(packet.begin(), packet.begin() + length);
+  uint16_t old_version = TELEMETRY_VERSION - 1;
+  memcpy(invalid.data() + offsetof(TelemetryPacketHeader, version), &old_version, sizeof(uint16_t));
+  check(!TELEMETRY::parse_packet(invalid.data(), length, header, records, TELEMETRY_BATCH_SIZE),
+        "Older version is rejected");
+
+  /* A later version appending 16 bytes to every record */
+  const uint16_t later_size = sizeof(TelemetryRecord) + 16;
+  std::vector<uint8_t> later(sizeof(TelemetryPacketHeader) + 2 * later_size, 0xAB);
+  memcpy(later.data(), packet.data(), sizeof(TelemetryPacketHeader));
+  memcpy(later.data() + offsetof(TelemetryPacketHeader, record_size), &later_size, sizeof(uint16_t));
+  for(uint32_t i = 0; i < 2; i++){
+    memcpy(later.data() + sizeof(TelemetryPacketHeader) + i * later_size, &record,
+        sizeof(TelemetryRecord));
+  }
+  check(TELEMETRY::parse_packet(later.data(), later.size(), header, records, TELEMETRY_BATCH_SIZE) &&
+        !memcmp(&records[1], &record, sizeof(TelemetryRecord)),
+        "Records from a later version are read");
+
+  /* The checksum of a valid IPv4-header, including the checksum, is 0 */
+  uint8_t frame[TELEMETRY_FRAME_HEADER_SIZE];
+  const uint8_t mac[6] = { 0x00, 0x80, 0xE1, 0x00, 0x00, 0x00 };
+  uint32_t frame_length = TELEMETRY::write_frame_header(mac, 1234, TELEMETRY_DEST_PORT, length, frame);
+  check(frame_length == TELEMETRY_FRAME_HEADER_SIZE + length &&
+        TELEMETRY::calculate_ip_checksum(frame + 14, 20) == 0 &&
+        (uint32_t) ((frame[16] << 8) | frame[17]) == 28 + length &&
+        (uint32_t) ((frame[38] << 8) | frame[39]) == 8 + length,
+        "Ethernet-, IPv4- and UDP-headers");
+
+  return num_failed;
+}
+
+
+int main(int argc, char** argv){
+
+  const uint32_t num_records = (argc > 1) ? (uint32_t) atoi(argv[1]) : 1000000u;
+  const uint32_t num_packets = num_records / TELEMETRY_BATCH_SIZE;
+  if(!num_packets){
+    printf("At least %u records are required\n", (unsigned) TELEMETRY_BATCH_SIZE);
+    return 1;
+  }
+
+  std::vector<TelemetryRecord> sent_records(num_packets * TELEMETRY_BATCH_SIZE);
+  uint32_t random_state = 12345u;
+  for(uint32_t i = 0; i < sent_records.size(); i++){
+    fill_record(i, random_state, sent_records[i]);
+  }
+
+  /**
+   * Checks of the decoder
+   */
+  printf("Decoder:\n");
+  uint32_t num_failed = check_decoder(sent_records[0]);
+
+  /**
+   * Encoding and decoding, without the transport
+   */
+  TelemetryBatch batch;
+  TELEMETRY::initialize_batch(batch);
+  std::vector<uint8_t> packets((size_t) num_packets * TELEMETRY_MAX_PACKET_SIZE);
+  std::vector<uint32_t> packet_lengths(num_packets);
+
+  float32_t encode_us = measure_us([&](){
+    uint32_t packet = 0;
+    for(const TelemetryRecord& record : sent_records){
+      if(TELEMETRY::add_record(record, batch)){
+        packet_lengths[packet] = TELEMETRY::write_packet(batch,
+            packets.data() + (size_t) packet * TELEMETRY_MAX_PACKET_SIZE);
+        packet++;
+      }
+    }
+  });
+
+  TelemetryPacketHeader header;
+  TelemetryRecord received[TELEMETRY_BATCH_SIZE];
+  uint32_t num_decoded = 0;
+  float32_t decode_us = measure_us([&](){
+    for(uint32_t packet = 0; packet < num_packets; packet++){
+      num_decoded += TELEMETRY::parse_packet(packets.data() + (size_t) packet * TELEMETRY_MAX_PACKET_SIZE,
+          packet_lengths[packet], header, received, TELEMETRY_BATCH_SIZE);
+    }
+  });
+
+  /**
+   * Sending every packet over the loopback-address. Every packet is
+   * received before the next is sent, such that none are dropped
+   */
+  int receiver = open_receiver();
+  if(receiver < 0 || !TELEMETRY_TRANSPORT::initialize_transport()){
+    printf("Could not open the loopback-sockets on port %u\n", (unsigned) TELEMETRY_DEST_PORT);
+    return 1;
+  }
+
+  TELEMETRY::initialize_batch(batch);
+  std::vector<uint8_t> buffer(TELEMETRY_MAX_PACKET_SIZE + 1);
+  uint32_t num_mismatches = 0, num_sequence_errors = 0, num_received = 0;
+  uint64_t num_bytes = 0;
+
+  float32_t loopback_us = measure_us([&](){
+    for(const TelemetryRecord& record : sent_records){
+      if(!TELEMETRY::add_record(record, batch)){
+        continue;
+      }
+      if(!TELEMETRY_TRANSPORT::send_batch(batch)){
+        continue;
+      }
+
+      ssize_t length = recv(receiver, buffer.data(), buffer.size(), 0);
+      if(length <= 0 || !TELEMETRY::parse_packet(buffer.data(), (uint32_t) length,
+          header, received, TELEMETRY_BATCH_SIZE)){
+        num_mismatches++;
+        continue;
+      }
+
+      num_sequence_errors += (header.sequence != num_received);
+      for(uint32_t i = 0; i < header.num_records; i++){
+        num_mismatches += memcmp(&received[i],
+            &sent_records[header.sequence * TELEMETRY_BATCH_SIZE + i], sizeof(TelemetryRecord)) != 0;
+      }
+      num_received++;
+      num_bytes += length;
+    }
+  });
+
+  TransportStatistics statistics;
+  TELEMETRY_TRANSPORT::get_statistics(statistics);
+  const uint32_t num_sent = statistics.num_telemetry_sent;
+  const uint32_t num_dropped = statistics.num_telemetry_dropped;
+  TELEMETRY_TRANSPORT::close_transport();
+  close(receiver);
+
+  /**
+   * Report
+   */
+  const uint32_t num_checked = num_packets * TELEMETRY_BATCH_SIZE;
+  printf("Loopback:\n");
+  printf("  Packets sent/dropped/received         : %u/%u/%u\n", (unsigned) num_sent,
+      (unsigned) num_dropped, (unsigned) num_received);
+  printf("  Records                               : %u (%u per packet)\n", (unsigned) num_checked,
+      (unsigned) TELEMETRY_BATCH_SIZE);
+  printf("  Mismatched records                    : %u\n", (unsigned) num_mismatches);
+  printf("  Sequence errors                       : %u\n", (unsigned) num_sequence_errors);
+  printf("Cost:\n");
+  printf("  Bytes per record on the wire          : %.1f\n", (double)
+      (TELEMETRY_FRAME_HEADER_SIZE + TELEMETRY_MAX_PACKET_SIZE) / TELEMETRY_BATCH_SIZE);
+  printf("  Encode                                : %.1f ns/record\n",
+      (double) (encode_us * 1000.0f / num_checked));
+  printf("  Decode                                : %.1f ns/record\n",
+      (double) (decode_us * 1000.0f / num_checked));
+  printf("  Send and receive over loopback        : %.0f packets/s, %.1f MB/s\n",
+      (double) (num_received / (loopback_us * 1e-6f)), (double) (num_bytes / loopback_us));
+
+  if(num_decoded != num_packets || num_received != num_packets || num_dropped ||
+     num_mismatches || num_sequence_errors){
+    num_failed++;
+  }
+  if(num_failed){
+    printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
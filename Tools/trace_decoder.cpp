@@ -0,0 +1,477 @@
+/**
+ * @file
+ *
+ * @brief Host tool that converts a binary trace-dump to a timeline in the
+ * Chrome trace-event format, which is opened in https://ui.perfetto.dev or
+ * chrome://tracing
+ *
+ * Usage:
+ *      trace_decoder <trace|udp> <timeline.json> [simulate]
+ *
+ * The trace is either a file holding the dump, such as
+ *      (gdb) dump binary value trace.bin TRACE::trace_buffer
+ * or "udp", where the packets sent by TELEMETRY_TRANSPORT::send_trace() are
+ * received on TRACE_DEST_PORT. The dump is requested by sending COMMAND_TRACE
+ * to the MCU at TELEMETRY_SOURCE_IP. Receiving stops when the dump is complete,
+ * or when no packet has arrived for a second after the first. A file may
+ * also hold several packets after each other
+ *
+ * The stages are drawn as spans on the track "stages", with the complete
+ * frame on the track "frames". The DMA-completions, the errors, the dropped
+ * packets and the markers are drawn as instants on their own tracks. The
+ * timestamps are unwrapped from the difference between consecutive
+ * records, and given in microseconds from the oldest record
+ *
+ * If simulate is given together with "udp", the MCU is simulated by a
+ * thread tracing the pipeline on simulated pings, and sending the trace
+ * over the loopback-address. The decoded records are compared with the
+ * trace. Fails if any record is lost or differs
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "analyze_data.h"
+#include "event_log.h"
+#include "profiling.h"
+#include "simulation.h"
+#include "telemetry_transport.h"
+
+/**
+ * @brief Tracks of the timeline
+ */
+typedef enum{
+  TRACK_STAGES = 1,
+  TRACK_FRAMES,
+  TRACK_DMA,
+  TRACK_ERRORS,
+  TRACK_TRANSPORT,
+  TRACK_MARKERS
+}TRACKS; /* enum TRACKS */
+
+static const char* const track_names[] =
+    { "", "stages", "frames", "dma", "errors", "transport", "markers" };
+
+
+/**
+ * @brief A dump being reassembled from one or more packets
+ *
+ * @param header Header of the first packet. num_records is the number of
+ * slots received
+ *
+ * @param bool_received Indicates which slots are received
+ *
+ * @param records The ring of records
+ */
+typedef struct{
+  TraceHeader header;
+  std::vector<uint8_t> bool_received;
+  std::vector<TraceRecord> records;
+}TraceDump; /* struct TraceDump */
+
+
+/**
+ * @brief Adds a packet, or a complete dump, to @p dump. A packet of another
+ * dump replaces the slots received so far
+ *
+ * @retval Returns 0 if the packet is invalid
+ */
+static uint8_t add_packet(
+      const uint8_t* data,
+      const uint64_t& length,
+      TraceDump& dump){
+
+  TraceHeader header;
+  if(!TRACE::parse_header(data, length, header)){
+    return 0;
+  }
+
+  if(dump.records.size() != header.length || dump.header.num_events != header.num_events ||
+     dump.header.ticks_per_us != header.ticks_per_us){
+    dump.header = header;
+    dump.header.num_records = 0;
+    dump.bool_received.assign(header.length, 0);
+    dump.records.assign(header.length, TraceRecord());
+  }
+
+  memcpy(&dump.records[header.first_slot], data + sizeof(TraceHeader),
+      header.num_records * sizeof(TraceRecord));
+  for(uint32_t slot = header.first_slot; slot < header.first_slot + header.num_records; slot++){
+    dump.header.num_records += !dump.bool_received[slot];
+    dump.bool_received[slot] = 1;
+  }
+  return 1;
+}
+
+
+/**
+ * @brief Reads every dump and packet in the file @p path
+ *
+ * @retval Returns 0 if the file could not be read, or holds no valid dump
+ */
+static uint8_t read_file(
+      const char* path,
+      TraceDump& dump){
+
+  FILE* file = fopen(path, "rb");
+  if(!file){
+    printf("Could not open %s\n", path);
+    return 0;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[1 << 16];
+  size_t length;
+  while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){
+    data.insert(data.end(), buffer, buffer + length);
+  }
+  fclose(file);
+
+  uint64_t offset = 0;
+  uint32_t num_packets = 0;
+  TraceHeader header;
+  while(TRACE::parse_header(data.data() + offset, data.size() - offset, header)){
+    add_packet(data.data() + offset, data.size() - offset, dump);
+    offset += sizeof(TraceHeader) + (uint64_t) header.num_records * sizeof(TraceRecord);
+    num_packets++;
+  }
+
+  if(!num_packets){
+    printf("No valid trace in %s\n", path);
+  }
+  return num_packets > 0;
+}
+
+
+/**
+ * @brief Sends COMMAND_TRACE to the MCU, requesting a dump
+ *
+ * @retval Returns 1 if the command is sent
+ */
+static uint8_t send_trace_command(){
+  int sender = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sender < 0){
+    return 0;
+  }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(COMMAND_PORT);
+  address.sin_addr.s_addr = htonl(TELEMETRY_SOURCE_IP);
+
+  uint8_t packet[COMMAND_MAX_PACKET_SIZE];
+  const uint32_t length = COMMAND::write_packet(COMMAND_TRACE, 0, 0, NULL, 0, packet);
+  const uint8_t bool_sent = sendto(sender, packet, length, 0,
+      (const struct sockaddr*) &address, sizeof(address)) == (ssize_t) length;
+  close(sender);
+  return bool_sent;
+}
+
+
+/**
+ * @brief Receives the packets of a single dump on TRACE_DEST_PORT
+ *
+ * @retval Returns 0 if the port is taken, or nothing is received
+ *
+ * @param dump The dump received
+ *
+ * @param bool_request Requests the dump from the MCU once the port is bound
+ */
+static uint8_t receive_dump(TraceDump& dump, const uint8_t& bool_request){
+  int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+  if(receiver < 0){
+    return 0;
+  }
+
+  struct timeval timeout = { 1, 0 };
+  setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(TRACE_DEST_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(receiver, (const struct sockaddr*) &address, sizeof(address)) != 0){
+    printf("Could not receive on port %u\n", (unsigned) TRACE_DEST_PORT);
+    close(receiver);
+    return 0;
+  }
+
+  if(bool_request && !send_trace_command()){
+    printf("Could not send the command requesting the trace\n");
+  }
+
+  std::vector<uint8_t> packet(2048);
+  uint8_t bool_started = 0;
+  while(!bool_started || dump.header.num_records < dump.records.size()){
+    /* Waiting for the first packet for as long as it takes */
+    ssize_t length = recv(receiver, packet.data(), packet.size(), 0);
+    if(length <= 0 && bool_started){
+      break;
+    }
+    if(length > 0 && add_packet(packet.data(), length, dump)){
+      bool_started = 1;
+    }
+  }
+
+  close(receiver);
+  return bool_started;
+}
+
+
+/**
+ * @brief Runs the pipeline on simulated pings while tracing, as in
+ * main.cpp, and sends the trace
+ */
+static void simulate_mcu(const uint32_t& num_frames){
+  SimulationConfig config;
+  SIMULATION::get_default_config(config);
+
+  std::vector<uint16_t> adc_data(NUM_HYDROPHONES * DMA_BUFFER_LENGTH);
+  float32_t* data_array[NUM_HYDROPHONES];
+  WORKSPACE::allocate_arrays(WORKSPACE::frame_workspace, data_array, IN_BUFFER_LENGTH);
+  uint32_t lag_array[NUM_HYDROPHONE_PAIRS];
+  uint32_t* p_lag_array[NUM_HYDROPHONE_PAIRS];
+  for(uint32_t pair = 0; pair < NUM_HYDROPHONE_PAIRS; pair++){
+    p_lag_array[pair] = &lag_array[pair];
+  }
+
+  for(uint32_t frame = 0; frame < num_frames; frame++){
+    config.seed = frame + 1u;
+    uint32_t stage_ticks = TIMING::get_ticks();
+    SIMULATION::render_ping(config, adc_data.data());
+    TRACE::trace_event(TRACE_EVENTS::TRACE_DMA_COMPLETE, frame % 2u);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_ACQUIRE, stage_ticks);
+
+    const uint32_t frame_ticks = stage_ticks;
+    ANALYZE_DATA::convert_adc_data(adc_data.data(), data_array);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CONVERT, stage_ticks);
+    ANALYZE_DATA::filter_raw_data(data_array);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_FILTER, stage_ticks);
+    ANALYZE_DATA::calculate_xcorr_lag_array(data_array, p_lag_array,
+        TRILATERATION::hydrophone_geometry.max_lag, WORKSPACE::frame_workspace);
+    stage_ticks = PROFILING::record_stage(PROFILING_STAGES::STAGE_CORRELATE, stage_ticks);
+    uint8_t bool_time_error = 0;
+    if(!TRILATERATION::check_valid_signals(p_lag_array, bool_time_error)){
+      TRACE::trace_event(TRACE_EVENTS::TRACE_ERROR, ERROR_TYPES::ERROR_TIME_SIGNAL);
+    }
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_VALIDATE, stage_ticks);
+    PROFILING::record_stage(PROFILING_STAGES::STAGE_FRAME, frame_ticks);
+  }
+
+  TRACE::trace_event(TRACE_EVENTS::TRACE_MARKER, num_frames);
+  TELEMETRY_TRANSPORT::send_trace();
+}
+
+
+/**
+ * @brief Writes the records of @p dump as a timeline in the Chrome
+ * trace-event format
+ *
+ * @retval Returns 0 if the file could not be opened
+ *
+ * @param num_written Number of records written
+ *
+ * @param num_missing Number of records in the ring that are not received
+ */
+static uint8_t write_timeline(
+      const char* path,
+      const TraceDump& dump,
+      uint32_t& num_written,
+      uint32_t& num_missing){
+
+  FILE* file = fopen(path, "w");
+  if(!file){
+    printf("Could not open %s\n", path);
+    return 0;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  fprintf(file, "  {\"ph\": \"M\", \"pid\": 1, \"name\": \"process_name\", "
+      "\"args\": {\"name\": \"acoustics\"}}");
+  for(uint32_t track = TRACK_STAGES; track <= TRACK_MARKERS; track++){
+    fprintf(file, ",\n  {\"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"name\": \"thread_name\", "
+        "\"args\": {\"name\": \"%s\"}}", (unsigned) track, track_names[track]);
+  }
+
+  const TraceHeader& header = dump.header;
+  const uint32_t num_events = header.num_events;
+  const uint32_t first_index = (num_events > header.length) ? num_events - header.length : 0u;
+  const double ticks_per_us = header.ticks_per_us;
+
+  /* Start of the open span of every stage [us] */
+  double stage_begin[NUM_PROFILING_STAGES];
+  uint8_t bool_stage_open[NUM_PROFILING_STAGES] = {};
+
+  num_written = 0;
+  num_missing = 0;
+  uint8_t bool_first = 1;
+  uint32_t last_timestamp = 0;
+  int64_t ticks = 0;
+  for(uint32_t index = first_index; index != num_events; index++){
+    const uint32_t slot = index & (header.length - 1u);
+    if(!dump.bool_received[slot]){
+      num_missing++;
+      continue;
+    }
+    const TraceRecord& record = dump.records[slot];
+
+    /* Unwrapping the timestamp, where the stage-begins may be slightly out of order */
+    ticks = bool_first ? 0 : ticks + (int32_t) (record.timestamp - last_timestamp);
+    last_timestamp = record.timestamp;
+    bool_first = 0;
+    const double us = ticks / ticks_per_us;
+    num_written++;
+
+    switch(record.id){
+      case TRACE_EVENTS::TRACE_STAGE_BEGIN:
+        if(record.arg < NUM_PROFILING_STAGES){
+          stage_begin[record.arg] = us;
+          bool_stage_open[record.arg] = 1;
+        }
+        break;
+
+      case TRACE_EVENTS::TRACE_STAGE_END:
+        if(record.arg < NUM_PROFILING_STAGES && bool_stage_open[record.arg]){
+          fprintf(file, ",\n  {\"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"name\": \"%s\", "
+              "\"ts\": %.3f, \"dur\": %.3f}",
+              (unsigned) (record.arg == PROFILING_STAGES::STAGE_FRAME ? TRACK_FRAMES : TRACK_STAGES),
+              PROFILING::stage_names[record.arg], stage_begin[record.arg],
+              us - stage_begin[record.arg]);
+          bool_stage_open[record.arg] = 0;
+        }
+        break;
+
+      case TRACE_EVENTS::TRACE_DMA_COMPLETE:
+        fprintf(file, ",\n  {\"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, "
+            "\"name\": \"dma_complete\", \"ts\": %.3f, \"args\": {\"buffer\": %u}}",
+            (unsigned) TRACK_DMA, us, (unsigned) record.arg);
+        break;
+
+      case TRACE_EVENTS::TRACE_ERROR:
+        fprintf(file, ",\n  {\"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, "
+            "\"name\": \"%s\", \"ts\": %.3f}", (unsigned) TRACK_ERRORS,
+            (record.arg < NUM_ERROR_TYPES) ? EVENT_LOG::error_names[record.arg] : "unknown", us);
+        break;
+
+      case TRACE_EVENTS::TRACE_RAW_DROPPED:
+      case TRACE_EVENTS::TRACE_TELEMETRY_DROPPED:
+        fprintf(file, ",\n  {\"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, "
+            "\"name\": \"%s\", \"ts\": %.3f, \"args\": {\"sequence\": %u}}",
+            (unsigned) TRACK_TRANSPORT, TRACE::event_names[record.id], us, (unsigned) record.arg);
+        break;
+
+      default:
+        fprintf(file, ",\n  {\"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, "
+            "\"name\": \"%s\", \"ts\": %.3f, \"args\": {\"value\": %u}}",
+            (unsigned) TRACK_MARKERS,
+            (record.id < NUM_TRACE_EVENTS) ? TRACE::event_names[record.id] : "unknown",
+            us, (unsigned) record.arg);
+        break;
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  return 1;
+}
+
+
+/**
+ * @brief Compares the received records with the trace of this process
+ *
+ * @retval Returns the number of records that are missing or differ
+ */
+static uint32_t verify_dump(const TraceDump& dump){
+  const TraceHeader& header = TRACE::trace_buffer.header;
+  if(dump.header.num_events != header.num_events || dump.records.size() != TRACE_LENGTH){
+    return TRACE_LENGTH;
+  }
+
+  uint32_t num_failed = 0;
+  const uint32_t first_index = (header.num_events > TRACE_LENGTH) ?
+      header.num_events - TRACE_LENGTH : 0u;
+  for(uint32_t index = first_index; index != header.num_events; index++){
+    const uint32_t slot = index & (TRACE_LENGTH - 1u);
+    num_failed += !dump.bool_received[slot] || memcmp(&dump.records[slot],
+        &TRACE::trace_buffer.records[slot], sizeof(TraceRecord));
+  }
+  return num_failed;
+}
+
+
+int main(int argc, char** argv){
+
+  if(argc < 3){
+    printf("Usage: %s <trace|udp> <timeline.json> [simulate]\n", argv[0]);
+    return 1;
+  }
+  const uint8_t bool_udp = !strcmp(argv[1], "udp");
+  const uint8_t bool_simulate = bool_udp && argc > 3 && !strcmp(argv[3], "simulate");
+
+  /**
+   * Simulating the MCU, if requested
+   */
+  std::thread mcu;
+  if(bool_simulate){
+    TIMING::initialize_timing();
+    TRACE::initialize_trace();
+    if(!TRILATERATION::initialize_trilateration_globals() ||
+       !TELEMETRY_TRANSPORT::initialize_transport()){
+      printf("Could not initialize the simulated MCU\n");
+      return 1;
+    }
+    mcu = std::thread([](){
+      /* Waiting for the receiver to bind the port */
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      simulate_mcu(200u);
+    });
+  }
+
+  TraceDump dump;
+  dump.header.num_events = 0;
+  const uint8_t bool_read = bool_udp ? receive_dump(dump, !bool_simulate) : read_file(argv[1], dump);
+
+  if(bool_simulate){
+    mcu.join();
+    TELEMETRY_TRANSPORT::close_transport();
+  }
+  if(!bool_read){
+    return 1;
+  }
+
+  uint32_t num_written, num_missing;
+  if(!write_timeline(argv[2], dump, num_written, num_missing)){
+    return 1;
+  }
+
+  /**
+   * Report
+   */
+  const TraceHeader& header = dump.header;
+  printf("Events traced                   : %u\n", (unsigned) header.num_events);
+  printf("Records in the ring             : %u of %u\n",
+      (unsigned) std::min(header.num_events, header.length), (unsigned) header.length);
+  printf("Records decoded                 : %u (%u not received)\n",
+      (unsigned) num_written, (unsigned) num_missing);
+  printf("Tick-rate                       : %u ticks/us\n", (unsigned) header.ticks_per_us);
+  printf("Timeline written to             : %s\n", argv[2]);
+
+  if(bool_simulate){
+    uint32_t num_failed = verify_dump(dump);
+    printf("Records missing or different    : %u\n", (unsigned) num_failed);
+    if(num_failed){
+      printf("FAILED\n");
+      return 1;
+    }
+  }
+  return 0;
+}